@@ -4,15 +4,30 @@
 #include "g3log/g3log.hpp"
 
 #include "Alien.h"
+#include "CZMQToolkit.h"
+#include "ContextRegistry.h"
 
 /**
  * Alien is a ZeroMQ Sub socket.
  */
-Alien::Alien() { 
-   mCtx = zctx_new();
+Alien::Alien() : Alien(std::string()) {
+}
+
+/**
+ * Alien whose socket is created on a context shared through the ContextRegistry.
+ * @param sharedContext
+ *   The ContextRegistry name, empty for a private context
+ * @param affinity
+ *   Bit mask of the shared context's IO threads to use, 0 for any
+ */
+Alien::Alien(const std::string& sharedContext, const uint64_t affinity) {
+   mCtx = sharedContext.empty() ? zctx_new() : ContextRegistry::Instance().Acquire(sharedContext);
    CHECK(mCtx!=nullptr);
    mBody = zsocket_new(mCtx, ZMQ_SUB);
    CHECK(mBody!=nullptr);
+   if (affinity) {
+      CZMQToolkit::SetAffinity(mBody, affinity);
+   }
 }
 
 /**
@@ -90,10 +105,39 @@ void Alien::GetShot(const unsigned int timeout, std::vector<std::string>& bullet
 
 }
 
+/**
+ * The ZeroMQ socket we are shot through, to wait on it along with others.
+ * Only receive through the Alien.
+ * @return 
+ */
+void* Alien::GetSocket() const {
+   return mBody;
+}
+
+/**
+ * The socket's ZMQ_FD, to wait on the Alien in an epoll or poll loop. It is
+ * edge triggered: when it polls readable, GetShot with a 0 timeout until
+ * IsReadable returns false. The socket is made by the constructor, so the
+ * fd is there from the start, PrepareToBeShot only subscribes and connects.
+ * @return 
+ */
+int Alien::GetFd() const {
+   return CZMQToolkit::GetReadableFd(mBody);
+}
+
+/**
+ * Whether a published message can be taken without waiting, which also
+ * rearms GetFd.
+ * @return 
+ */
+bool Alien::IsReadable() {
+   return CZMQToolkit::IsReadable(mBody);
+}
+
 /**
  * Destroy the body and context of the alien.
  */
 Alien::~Alien() {
    zsocket_destroy(mCtx, mBody);
-   zctx_destroy(&mCtx);
+   ContextRegistry::Instance().Release(mCtx);
 }
@@ -4,14 +4,19 @@
 #include <stdlib.h>
 #include <vector>
 #include <string>
+#include <cstdint>
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
 class Alien {
 public:
    Alien();
+   explicit Alien(const std::string& sharedContext, const uint64_t affinity = 0);
    void PrepareToBeShot(const std::string& location);
    std::vector<std::string> GetShot();
    void GetShot(const unsigned int timeout, std::vector<std::string>& bullets);
+   void* GetSocket() const;
+   int GetFd() const;
+   bool IsReadable();
    virtual ~Alien();
     
 private:
@@ -9,23 +9,54 @@
 #include <iostream>
 #include <time.h>
 #include <vector>
-#include "boost/uuid/uuid_io.hpp"
 #include <thread>
 #include <chrono>
 #include "QueueNadoMacros.h"
 #include "BoomStick.h"
+#include "CZMQToolkit.h"
+#include "ContextRegistry.h"
 #include <boost/random/mersenne_twister.hpp>
 //#include <boost/random/random_device.hpp>
 namespace {
+   // the canonical 8-4-4-4-12 form of a UUID
+   const size_t kUuidTextSize = 36;
+   const char kHexDigits[] = "0123456789abcdef";
 
-   void ShrinkToFit(std::map<std::string, std::string>& map) {
-      std::map<std::string, std::string>(map).swap(map);
+   int HexValue(const char digit) {
+      if (digit >= '0' && digit <= '9') {
+         return digit - '0';
+      }
+      if (digit >= 'a' && digit <= 'f') {
+         return digit - 'a' + 10;
+      }
+      if (digit >= 'A' && digit <= 'F') {
+         return digit - 'A' + 10;
+      }
+      return -1;
+   }
+
+   // the budget for replies read but not asked for yet
+   const size_t kDefaultUnreadEntries = 100000;
+   const size_t kDefaultUnreadBytes = 64 * 1024 * 1024;
+   // sends between looking for replies in SendBatch
+   const size_t kBatchDrainInterval = 64;
+   // a map that uses fewer than one in this many of its slots gives them back
+   const size_t kSparseSlots = 8;
+
+   /**
+    * Give back the slots a burst left behind, but don't rehash a map that is
+    * only a little below its size.
+    */
+   template<typename Value>
+   void ShrinkIfSparse(UuidMap<Value>& map) {
+      if (map.Capacity() > UuidMap<Value>::kMinimumSlots && map.Size() * kSparseSlots < map.Capacity()) {
+         map.ShrinkToFit();
+      }
    }
 
-   void ShrinkToFit(std::map<std::string, time_t>& map) {
-      std::map<std::string, time_t>(map).swap(map);
+   bool IsDashPosition(const size_t position) {
+      return position == 8 || position == 13 || position == 18 || position == 23;
    }
-
 }
 
 /**
@@ -33,10 +64,12 @@ namespace {
  * @param binding
  *   The binding is stored, but Initialize must be used to connect to it.
  */
-BoomStick::BoomStick(const std::string& binding) : mLastGCTime(time(NULL)),
+BoomStick::BoomStick(const std::string& binding) :
+mUnreadReplies(kDefaultUnreadEntries, kDefaultUnreadBytes), mLastGCTime(time(NULL)),
 mBinding(binding), mChamber(nullptr), mCtx(nullptr), mRan(), m_uuidGen(mRan),
 mSendHWM(1000), mRecvHWM(1000), mPendingAlertSize(500), mUnreadAlertSize(500),
-mUnreadAlert(false), mPendingAlert(false), mUtilizedThread(0) {
+mUnreadAlert(false), mPendingAlert(false), mUtilizedThread(0), mAffinity(0),
+mRequestTtl(5 * MINUTES_TO_SECONDS), mReportedEvictions(0) {
 //mRan.seed(boost::uuids::detail::seed_rng()());
 boost::random::mt19937 gen(rng());
 
@@ -48,19 +81,19 @@ boost::random::mt19937 gen(rng());
  */
 BoomStick::~BoomStick() {
    if (mCtx != nullptr) {
-      zctx_destroy(&mCtx);
+      ContextRegistry::Instance().Release(mCtx);
    }
-   if (!mPendingReplies.empty()) {
-      LOG(WARNING) << "Pending replies never emptied " << mPendingReplies.size();
-      for (auto reply : mPendingReplies) {
-         LOG(WARNING) << reply.first;
-      }
+   if (!mPendingReplies.Empty()) {
+      LOG(WARNING) << "Pending replies never emptied " << mPendingReplies.Size();
+      mPendingReplies.ForEach([this](const RequestId& id, PendingRequest&) {
+         LOG(WARNING) << DescribeId(id);
+      });
    }
-   if (!mUnreadReplies.empty()) {
-      LOG(WARNING) << "mUnreadReplies replies never emptied " << mUnreadReplies.size();
-      for (auto reply : mUnreadReplies) {
-         LOG(WARNING) << reply.first;
-      }
+   if (!mUnreadReplies.Empty()) {
+      LOG(WARNING) << "mUnreadReplies replies never emptied " << mUnreadReplies.Size();
+      mUnreadReplies.ForEach([this](const RequestId& id) {
+         LOG(WARNING) << DescribeId(id);
+      });
    }
 }
 
@@ -72,6 +105,26 @@ zctx_t* BoomStick::GetContext() {
    return mCtx;
 }
 
+/**
+ * The socket's ZMQ_FD, to wait for replies to SendAsync in an epoll or poll
+ * loop. It is edge triggered: when it polls readable, collect replies with
+ * GetAsyncReply and a 0 wait until IsReadable returns false. Sending can use
+ * up the edge, so check IsReadable after SendAsync too.
+ * @return 
+ *   -1 before Initialize
+ */
+int BoomStick::GetFd() const {
+   return CZMQToolkit::GetReadableFd(mChamber);
+}
+
+/**
+ * Whether a reply is waiting on the socket, which also rearms GetFd.
+ * @return 
+ */
+bool BoomStick::IsReadable() {
+   return CZMQToolkit::IsReadable(mChamber);
+}
+
 /**
  * Swap internals
  * @param other
@@ -92,6 +145,10 @@ void BoomStick::Swap(BoomStick& other) {
    mUnreadAlert = other.mUnreadAlert;
    mPendingAlert = other.mPendingAlert;
    mUtilizedThread = other.mUtilizedThread;
+   mContextName = other.mContextName;
+   mAffinity = other.mAffinity;
+   mRequestTtl = other.mRequestTtl;
+   mUnreadReplies.SetLimits(other.mUnreadReplies.GetMaxEntries(), other.mUnreadReplies.GetMaxBytes());
    
    //   other.mBinding.clear();  Allow it to be initialized again
    other.mPendingAlertSize = 0;
@@ -119,12 +176,68 @@ void BoomStick::SetRecvHWM(const int hwm) {
    mRecvHWM = hwm;
 }
 
+/**
+ * Create the socket on a context shared with other queues of the same name
+ * instead of a private one, only works before Initialize
+ * @param name
+ *   The ContextRegistry name, empty for a private context
+ * @param affinity
+ *   Bit mask of the shared context's IO threads to use, 0 for any
+ */
+void BoomStick::SetSharedContext(const std::string& name, const uint64_t affinity) {
+   mContextName = name;
+   mAffinity = affinity;
+}
+
+/**
+ * How long a request waits for its reply before it is forgotten, along with
+ * a reply that came but was never read. Applies to requests sent after.
+ * @param seconds
+ */
+void BoomStick::SetRequestTtl(const unsigned int seconds) {
+   mRequestTtl = seconds;
+}
+
+/**
+ * @return seconds a request waits for its reply, 5 minutes by default
+ */
+unsigned int BoomStick::GetRequestTtl() const {
+   return mRequestTtl;
+}
+
+/**
+ * Bound the replies that were read while looking for another one and wait
+ * for GetAsyncReply, the oldest are dropped to make room
+ * @param maxEntries
+ *   100000 by default
+ * @param maxBytes
+ *   64 MB by default
+ */
+void BoomStick::SetUnreadLimits(const size_t maxEntries, const size_t maxBytes) {
+   mUnreadReplies.SetLimits(maxEntries, maxBytes);
+}
+
+/**
+ * @return replies dropped to stay within SetUnreadLimits, so far
+ */
+uint64_t BoomStick::GetEvictedReplies() const {
+   return mUnreadReplies.GetEvictedEntries();
+}
+
+/**
+ * @return bytes of the replies dropped to stay within SetUnreadLimits, so far
+ */
+uint64_t BoomStick::GetEvictedReplyBytes() const {
+   return mUnreadReplies.GetEvictedBytes();
+}
+
 /**
  * Move constructor
  * @param other
  *   A BoomStick that is presumably setup already
  */
-BoomStick::BoomStick(BoomStick&& other) {
+BoomStick::BoomStick(BoomStick&& other) :
+mUnreadReplies(kDefaultUnreadEntries, kDefaultUnreadBytes), mReportedEvictions(0) {
    Swap(other);
 }
 
@@ -138,7 +251,7 @@ BoomStick::BoomStick(BoomStick&& other) {
 BoomStick& BoomStick::operator=(BoomStick&& other) {
    if (this != &other) {
       if (nullptr != mCtx) {
-         zctx_destroy(&mCtx);
+         ContextRegistry::Instance().Release(mCtx);
       }
       Swap(other);
    }
@@ -146,11 +259,14 @@ BoomStick& BoomStick::operator=(BoomStick&& other) {
 }
 
 /**
- * Get a brand new ZMQ context
+ * Get a brand new ZMQ context, or a shadow of the shared one
  * @return 
  *   A pointer to the context
  */
 zctx_t* BoomStick::GetNewContext() {
+   if (!mContextName.empty()) {
+      return ContextRegistry::Instance().Acquire(mContextName);
+   }
    zctx_t* context = zctx_new();
    return context;
 }
@@ -166,16 +282,135 @@ void* BoomStick::GetNewSocket(zctx_t* ctx) {
    if (nullptr == ctx) {
       return nullptr;
    }
-   return zsocket_new(ctx, ZMQ_DEALER);
+   void* socket = zsocket_new(ctx, ZMQ_DEALER);
+   if (nullptr != socket && mAffinity) {
+      CZMQToolkit::SetAffinity(socket, mAffinity);
+   }
+   return socket;
 }
 
+/**
+ * A new random id for SendAsync
+ * @return 
+ *   The canonical text form of a UUID
+ */
 std::string BoomStick::GetUuid() {
-   boost::uuids::uuid u1 = m_uuidGen();
+   return FormatUuid(m_uuidGen());
+}
 
-   std::stringstream ss;
-   ss << u1;
+/**
+ * Read the canonical text form of a UUID, in either case
+ * @param text
+ * @param uuid
+ * @return 
+ *   false if the text is not a UUID
+ */
+bool BoomStick::ParseUuid(const std::string& text, boost::uuids::uuid& uuid) {
+   if (text.size() != kUuidTextSize) {
+      return false;
+   }
+   size_t byte = 0;
+   for (size_t position = 0; position < kUuidTextSize; position += 2) {
+      if (IsDashPosition(position)) {
+         if (text[position] != '-') {
+            return false;
+         }
+         ++position;
+      }
+      const int high = HexValue(text[position]);
+      const int low = HexValue(text[position + 1]);
+      if (high < 0 || low < 0) {
+         return false;
+      }
+      uuid.data[byte++] = static_cast<uint8_t> ((high << 4) | low);
+   }
+   return true;
+}
+
+/**
+ * Write the canonical text form of a UUID, in lower case
+ * @param uuid
+ * @return 
+ */
+std::string BoomStick::FormatUuid(const boost::uuids::uuid& uuid) {
+   std::string text(kUuidTextSize, '-');
+   size_t byte = 0;
+   for (size_t position = 0; position < kUuidTextSize; position += 2) {
+      if (IsDashPosition(position)) {
+         ++position;
+      }
+      text[position] = kHexDigits[uuid.data[byte] >> 4];
+      text[position + 1] = kHexDigits[uuid.data[byte] & 0x0f];
+      ++byte;
+   }
+   return text;
+}
+
+/**
+ * The binary id that a public id travels as
+ * @param uuid
+ *   A UUID, or any other id an earlier SendAsync was given
+ * @param id
+ * @return 
+ *   false if it is neither
+ */
+bool BoomStick::FindId(const std::string& uuid, RequestId& id) const {
+   if (ParseUuid(uuid, id)) {
+      return true;
+   }
+   auto named = mNamedIds.find(uuid);
+   if (named == mNamedIds.end()) {
+      return false;
+   }
+   id = named->second;
+   return true;
+}
+
+/**
+ * The binary id to send a public id as, ids that are not UUIDs get a random
+ * one that is remembered until the request is done with
+ * @param uuid
+ * @return 
+ */
+BoomStick::RequestId BoomStick::IdForSend(const std::string& uuid) {
+   RequestId id;
+   if (FindId(uuid, id)) {
+      return id;
+   }
+   id = m_uuidGen();
+   mNamedIds[uuid] = id;
+   mIdNames[id] = uuid;
+   return id;
+}
+
+/**
+ * Drop every trace of a request
+ * @param id
+ */
+void BoomStick::Forget(const RequestId& id) {
+   PendingRequest* pending = mPendingReplies.Find(id);
+   if (pending != nullptr) {
+      mExpiry.Cancel(pending->timer);
+      mPendingReplies.Erase(id);
+   }
+   mUnreadReplies.Erase(id);
+   if (mIdNames.Empty()) {
+      return;
+   }
+   const std::string* name = mIdNames.Find(id);
+   if (name != nullptr) {
+      mNamedIds.erase(*name);
+      mIdNames.Erase(id);
+   }
+}
 
-   return ss.str();
+/**
+ * @param id
+ * @return the id as the public API knows it, for logging
+ */
+std::string BoomStick::DescribeId(const RequestId& id) const {
+   const std::string* name = mIdNames.Find(id);
+   return name != nullptr ? *name : FormatUuid(id);
 }
 
 /**
@@ -203,7 +438,7 @@ bool BoomStick::ConnectToBinding(void* socket, const std::string& binding) {
  */
 void BoomStick::SetBinding(const std::string& binding) {
    if (nullptr != mCtx) {
-      zctx_destroy(&mCtx);
+      ContextRegistry::Instance().Release(mCtx);
       mCtx = nullptr;
       mChamber = nullptr;
    }
@@ -228,13 +463,13 @@ bool BoomStick::Initialize() {
    // The memory in this pointer is managed by the context and should not be deleted
    if (nullptr == mChamber) {
       LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
-      zctx_destroy(&mCtx);
+      ContextRegistry::Instance().Release(mCtx);
       mCtx = nullptr;
       return false;
    }
    if (!ConnectToBinding(mChamber, mBinding)) {
 
-      zctx_destroy(&mCtx);
+      ContextRegistry::Instance().Release(mCtx);
       mChamber = nullptr;
       mCtx = nullptr;
       return false;
@@ -248,7 +483,8 @@ bool BoomStick::Initialize() {
  * @return 
  */
 bool BoomStick::FindPendingUuid(const std::string& uuid) const {
-   return mPendingReplies.find(uuid) != mPendingReplies.end();
+   RequestId id;
+   return FindId(uuid, id) && mPendingReplies.Find(id) != nullptr;
 }
 
 /**
@@ -257,7 +493,8 @@ bool BoomStick::FindPendingUuid(const std::string& uuid) const {
  * @return 
  */
 bool BoomStick::FindUnreadUuid(const std::string& uuid) const {
-   return mUnreadReplies.find(uuid) != mUnreadReplies.end();
+   RequestId id;
+   return FindId(uuid, id) && mUnreadReplies.Contains(id);
 }
 
 /**
@@ -269,19 +506,19 @@ bool BoomStick::FindUnreadUuid(const std::string& uuid) const {
  *   The reply received
  */
 std::string BoomStick::Send(const std::string& command) {
-   const std::string uuid = GetUuid();
+   const RequestId id = m_uuidGen();
    if (mUtilizedThread == 0) {
       mUtilizedThread = pthread_self();
    } else {
       CHECK(mUtilizedThread == pthread_self());
    }
-   if (!SendAsync(uuid, command)) {
+   if (!SendRequest(id, command)) {
       return
       {
       };
    }
    std::string returnString;
-   if (!GetAsyncReply(uuid, 30000, returnString)) {
+   if (!GetReply(id, 30000, returnString)) {
       return
       {
       };
@@ -304,15 +541,36 @@ bool BoomStick::SendAsync(const std::string& uuid, const std::string& command) {
    } else {
       CHECK(pthread_self() == mUtilizedThread);
    }
+   if (nullptr == mCtx || nullptr == mChamber) {
+      return false;
+   }
+   const RequestId id = IdForSend(uuid);
+   if (!SendRequest(id, command)) {
+      if (mPendingReplies.Find(id) == nullptr) {
+         Forget(id);
+      }
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Send a request with a binary id as its first frame
+ * @param id
+ * @param command
+ * @return 
+ *   If the send was successful, or the id was already pending
+ */
+bool BoomStick::SendRequest(const RequestId& id, const std::string& command) {
    if (nullptr == mCtx || nullptr == mChamber) {
       return false;
    }
    bool success = true;
-   if (FindPendingUuid(uuid)) {
+   if (mPendingReplies.Find(id) != nullptr) {
       return true;
    }
    zmsg_t* msg = zmsg_new();
-   if (zmsg_addmem(msg, uuid.c_str(), uuid.size()) < 0) {
+   if (zmsg_addmem(msg, id.data, id.size()) < 0) {
       success = false;
       LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
    } else if (zmsg_addmem(msg, command.c_str(), command.size()) < 0) {
@@ -337,7 +595,8 @@ bool BoomStick::SendAsync(const std::string& uuid, const std::string& command) {
             success = false;
          } else if (zmsg_send(&msg, mChamber) == 0) {
             success = true;
-            mPendingReplies[uuid] = std::time(NULL);
+            const time_t now = std::time(NULL);
+            mPendingReplies[id] = {now, mExpiry.Add(id, now + mRequestTtl)};
          } else {
             LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
             success = false;
@@ -358,31 +617,27 @@ bool BoomStick::SendAsync(const std::string& uuid, const std::string& command) {
 /**
  * Attempt to grab the reply from the previously read messages
  * 
- * @param messageHash
+ * @param id
  * @param reply
  * @return 
  */
-bool BoomStick::GetReplyFromCache(const std::string& messageHash, std::string& reply) {
-   if (mUnreadReplies.find(messageHash) != mUnreadReplies.end()) {
-      reply = mUnreadReplies[messageHash];
-      mUnreadReplies.erase(messageHash);
-      if (mPendingReplies.find(messageHash) != mPendingReplies.end()) {
-         mPendingReplies.erase(messageHash);
-      } else {
-
-         LOG(WARNING) << "Found reply in cache, but it was never pending" << messageHash;
-      }
-      return true;
+bool BoomStick::GetReplyFromCache(const RequestId& id, std::string& reply) {
+   if (!mUnreadReplies.Take(id, reply)) {
+      return false;
    }
-   return false;
+   if (mPendingReplies.Find(id) == nullptr) {
+      LOG(WARNING) << "Found reply in cache, but it was never pending" << DescribeId(id);
+   }
+   Forget(id);
+   return true;
 }
 
 /**
  * Poll the socket, fail after timeout and log
- * @param messageHash
+ * @param id
  * @return 
  */
-bool BoomStick::CheckForMessagePending(const std::string& messageHash, const unsigned int msToWait, std::string& reply) {
+bool BoomStick::CheckForMessagePending(const RequestId& id, const unsigned int msToWait, std::string& reply) {
    if (0 == mUtilizedThread) {
       mUtilizedThread = pthread_self();
    } else {
@@ -400,12 +655,13 @@ bool BoomStick::CheckForMessagePending(const std::string& messageHash, const uns
 }
 
 /**
- * 
+ * Read one reply, a 16 byte id frame and the reply frame
  * @param foundId
  * @param foundReply
+ *   The reply, or what went wrong
  * @return 
  */
-bool BoomStick::ReadFromReadySocket(std::string& foundId, std::string& foundReply) {
+bool BoomStick::ReadFromReadySocket(RequestId& foundId, std::string& foundReply) {
    if (0 == mUtilizedThread) {
       mUtilizedThread = pthread_self();
    } else {
@@ -420,14 +676,15 @@ bool BoomStick::ReadFromReadySocket(std::string& foundId, std::string& foundRepl
    if (!msg) {
       foundReply = zmq_strerror(zmq_errno());
    } else if (zmsg_size(msg) == 2) {
-      char* msgChar;
-      msgChar = zmsg_popstr(msg);
-      foundId = msgChar;
-      free(msgChar);
-      msgChar = zmsg_popstr(msg);
-      foundReply = msgChar;
-      free(msgChar);
-      success = true;
+      zframe_t* idFrame = zmsg_first(msg);
+      zframe_t* replyFrame = zmsg_next(msg);
+      if (zframe_size(idFrame) != foundId.size()) {
+         foundReply = "Malformed reply, expecting a 16 byte id";
+      } else {
+         memcpy(foundId.data, zframe_data(idFrame), foundId.size());
+         foundReply.assign(reinterpret_cast<const char*> (zframe_data(replyFrame)), zframe_size(replyFrame));
+         success = true;
+      }
    } else {
       foundReply = "Malformed reply, expecting 2 parts";
    }
@@ -456,6 +713,22 @@ bool BoomStick::GetAsyncReply(const std::string& uuid, const unsigned int msToWa
    } else {
       CHECK(pthread_self() == mUtilizedThread);
    }
+   RequestId id;
+   if (!FindId(uuid, id)) {
+      // never sent, still read what is on the socket until the wait is over
+      id = boost::uuids::uuid();
+   }
+   return GetReply(id, msToWait, reply);
+}
+
+/**
+ * Get the reply to a binary id, from the cache or the socket
+ * @param id
+ * @param msToWait
+ * @param reply
+ * @return 
+ */
+bool BoomStick::GetReply(const RequestId& id, const unsigned int msToWait, std::string& reply) {
    if (nullptr == mCtx || nullptr == mChamber) {
       LOG(WARNING) << "Invalid socket";
       reply = "No socket";
@@ -463,9 +736,9 @@ bool BoomStick::GetAsyncReply(const std::string& uuid, const unsigned int msToWa
       return false;
    }
 
-   bool found = GetReplyFromCache(uuid, reply);
+   bool found = GetReplyFromCache(id, reply);
    if (!found) {
-      found = GetReplyFromSocket(uuid, msToWait, reply);
+      found = GetReplyFromSocket(id, msToWait, reply);
    }
    CleanOldPendingData();
 
@@ -481,7 +754,7 @@ bool BoomStick::GetAsyncReply(const std::string& uuid, const unsigned int msToWa
  * @return 
  *   If the message was found
  */
-bool BoomStick::GetReplyFromSocket(const std::string& uuid, const unsigned int msToWait, std::string& reply) {
+bool BoomStick::GetReplyFromSocket(const RequestId& id, const unsigned int msToWait, std::string& reply) {
    if (0 == mUtilizedThread) {
       mUtilizedThread = pthread_self();
    } else {
@@ -489,28 +762,140 @@ bool BoomStick::GetReplyFromSocket(const std::string& uuid, const unsigned int m
    }
    bool found = false;
    reply = "Timed out searching for reply";
-   while (!zctx_interrupted && !found && CheckForMessagePending(uuid, msToWait, reply)) {
-      std::string foundId;
+   while (!zctx_interrupted && !found && CheckForMessagePending(id, msToWait, reply)) {
+      RequestId foundId;
       if (!ReadFromReadySocket(foundId, reply)) {
          break;
       }
-      if (uuid == foundId) {
+      if (id == foundId) {
          found = true;
-         mPendingReplies.erase(uuid);
+         Forget(id);
       } else {
-
-         mUnreadReplies[foundId] = reply;
+         KeepReply(foundId, reply);
       }
    }
    return found;
 }
 
 /**
- * Clean up pending sends/replies that are older than 5 minutes 
+ * Keep a reply that came while looking for another one, for GetAsyncReply
+ * @param id
+ * @param reply
+ *   Taken when the reply is kept
+ */
+void BoomStick::KeepReply(const RequestId& id, std::string& reply) {
+   if (mPendingReplies.Find(id) != nullptr) {
+      if (!mUnreadReplies.Put(id, reply)) {
+         LOG(WARNING) << "Dropped a reply of " << reply.size() << " bytes, over the limit for unread replies " << DescribeId(id);
+      }
+   } else {
+      LOG(WARNING) << "Found unmatched reply to unknown hash " << DescribeId(id);
+   }
+}
+
+/**
+ * Send every command in one pass, then hand the replies over in the order
+ * they arrive from a single poll loop. Replies to other requests seen on the
+ * way are kept for GetAsyncReply.
+ * @param commands
+ * @param msToWait
+ *   For the whole call, sending the commands and waiting for the replies.
+ * Commands that could not be sent by then are not sent.
+ * @param handler
+ *   Called with the index of the command and its reply
+ * @return 
+ *   The replies handed over, fewer than commands when a send failed or the
+ * wait ran out. Replies that come after that are dropped.
+ */
+size_t BoomStick::SendBatch(const std::vector<std::string>& commands, const unsigned int msToWait, BatchReplyHandler handler) {
+   if (0 == mUtilizedThread) {
+      mUtilizedThread = pthread_self();
+   } else {
+      CHECK(pthread_self() == mUtilizedThread);
+   }
+   if (nullptr == mCtx || nullptr == mChamber) {
+      LOG(WARNING) << "Invalid socket";
+      return 0;
+   }
+   using namespace std::chrono;
+   const steady_clock::time_point deadline = steady_clock::now() + milliseconds(msToWait);
+   size_t answered = 0;
+   size_t index = 0;
+   for (; index < commands.size() && !zctx_interrupted; ++index) {
+      // take in what already came back, so a big batch doesn't fill the receive queue
+      if (index % kBatchDrainInterval == kBatchDrainInterval - 1) {
+         DrainBatchReplies(handler, answered);
+      }
+      // SendRequest waits longer on a full pipe than what may be left
+      const long left = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+      zmq_pollitem_t items[] = {
+         { mChamber, 0, ZMQ_POLLOUT, 0}
+      };
+      if (left <= 0 || zmq_poll(items, 1, static_cast<int> (left)) <= 0) {
+         break;
+      }
+      const RequestId id = m_uuidGen();
+      if (SendRequest(id, commands[index])) {
+         mBatch[id] = index;
+      } else {
+         LOG(WARNING) << "SendBatch could not send command " << index;
+      }
+   }
+   if (index < commands.size()) {
+      LOG(WARNING) << "SendBatch ran out of time with " << commands.size() - index << " commands not sent";
+   }
+   while (!mBatch.Empty() && !zctx_interrupted) {
+      const long left = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+      if (left <= 0 || !zsocket_poll(mChamber, static_cast<int> (left))) {
+         break;
+      }
+      DrainBatchReplies(handler, answered);
+   }
+   if (!mBatch.Empty()) {
+      LOG(WARNING) << "SendBatch timed out with " << mBatch.Size() << " replies missing";
+      mBatch.ForEach([this](const RequestId& id, size_t&) {
+         Forget(id);
+      });
+   }
+   mBatch.Clear();
+   CleanOldPendingData();
+   return answered;
+}
+
+/**
+ * Read every reply waiting on the socket, handing over those of the batch
+ * @param handler
+ * @param answered
+ *   Counts the replies handed over
+ */
+void BoomStick::DrainBatchReplies(const BatchReplyHandler& handler, size_t& answered) {
+   std::string reply;
+   while (!mBatch.Empty() && IsReadable()) {
+      RequestId foundId;
+      if (!ReadFromReadySocket(foundId, reply)) {
+         LOG(WARNING) << reply;
+         return;
+      }
+      const size_t* index = mBatch.Find(foundId);
+      if (nullptr == index) {
+         KeepReply(foundId, reply);
+         continue;
+      }
+      const size_t position = *index;
+      mBatch.Erase(foundId);
+      Forget(foundId);
+      ++answered;
+      handler(position, reply);
+   }
+}
+
+/**
+ * Watch the number of outstanding requests and forget the ones past their
+ * TTL, at most once a second
  */
 void BoomStick::CleanOldPendingData() {
-   const auto unreadSize = mUnreadReplies.size();
-   const auto pendingSize = mPendingReplies.size();
+   const auto unreadSize = mUnreadReplies.Size();
+   const auto pendingSize = mPendingReplies.Size();
 
    if (!mUnreadAlert && unreadSize >= mUnreadAlertSize) {
       mUnreadAlert = true;
@@ -528,59 +913,41 @@ void BoomStick::CleanOldPendingData() {
       mPendingAlert = false;
       LOG(INFO) << "pending commands has dropped back below our max size " << mPendingAlertSize;
    }
-   CleanUnreadReplies();
    CleanPendingReplies();
 }
 
 /**
- * Cleanup pending replies that have exceeded our timeout.
+ * Forget pending requests that have exceeded their TTL, and their replies
+ * if they came but were never read. Only the expired ones are touched. The
+ * maps of pending requests give back their memory once a burst is over.
  */
 void BoomStick::CleanPendingReplies() {
    time_t now = time(NULL);
-   if (now < mLastGCTime + 5 * MINUTES_TO_SECONDS) {
+   if (now == mLastGCTime) {
       return;
    }
    mLastGCTime = now;
-   std::vector<std::string> uuidsToRemove;
-   for (auto pendingSend : mPendingReplies) {
-      if (pendingSend.second <= now - 5 * MINUTES_TO_SECONDS) {
-         LOG(DEBUG) << "Removed Pending Reply for " << pendingSend.first;
-         uuidsToRemove.push_back(pendingSend.first);
-      }
-   }
+   const uint64_t evicted = mUnreadReplies.GetEvictedEntries();
+   LOG_IF(WARNING, (evicted != mReportedEvictions)) << "Evicted " << evicted - mReportedEvictions
+           << " unread replies to stay within " << mUnreadReplies.GetMaxEntries() << " replies and "
+           << mUnreadReplies.GetMaxBytes() << " bytes";
+   mReportedEvictions = evicted;
    int deleteUnread = 0;
-   for (auto uuid : uuidsToRemove) {
-      mPendingReplies.erase(uuid);
-      if (mUnreadReplies.find(uuid) != mUnreadReplies.end()) {
-
-         deleteUnread++;
-         mUnreadReplies.erase(uuid);
+   mExpiry.Advance(now, [&](const RequestId& id) {
+      PendingRequest* pending = mPendingReplies.Find(id);
+      if (pending == nullptr) {
+         return;
       }
-   }
-   LOG_IF(INFO, (deleteUnread > 0)) << "Deleted " << deleteUnread << " unread replies that exceed the 5 minute timeout";
-   ShrinkToFit(mPendingReplies);
-   ShrinkToFit(mUnreadReplies);
-
-}
-
-/**
- * Cleanup unread replies that don't exist in pending.
- */
-void BoomStick::CleanUnreadReplies() {
-   std::vector<std::string> uuidsToRemove;
-   //check all unread replies and remove any that don't exist in pending.
-   for (auto unreadReply : mUnreadReplies) {
-      if (mPendingReplies.find(unreadReply.first) == mPendingReplies.end()) {
-         LOG(WARNING) << "Found unmatched reply to unknown hash " << unreadReply.first;
-         uuidsToRemove.push_back(unreadReply.first);
+      LOG(DEBUG) << "Removed Pending Reply for " << DescribeId(id);
+      // the timer is already gone
+      pending->timer = ExpiryWheel::kNoTimer;
+      if (mUnreadReplies.Contains(id)) {
+         deleteUnread++;
       }
-   }
-
-   int count = 0;
-   for (auto hash : uuidsToRemove) {
-      count++;
-      mUnreadReplies.erase(hash);
-   }
-   LOG_IF(INFO, (count > 0)) << "Deleted " << count << " replies that no longer exist in pending";
-
+      Forget(id);
+   });
+   LOG_IF(INFO, (deleteUnread > 0)) << "Deleted " << deleteUnread << " unread replies that exceed the " << mRequestTtl << " second timeout";
+   ShrinkIfSparse(mPendingReplies);
+   ShrinkIfSparse(mIdNames);
+   ShrinkIfSparse(mBatch);
 }
@@ -1,14 +1,23 @@
 #pragma once
 #include <string>
 #include <map>
+#include <cstdint>
+#include <functional>
+#include <vector>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/random/random_device.hpp>
+#include "UuidMap.h"
+#include "ExpiryWheel.h"
+#include "ReplyCache.h"
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
 
 class BoomStick {
 public:
+   /// Handed the position of a command in the batch and its reply
+   typedef std::function<void(const size_t index, std::string& reply)> BatchReplyHandler;
+
    explicit BoomStick(const std::string& binding);
    BoomStick(BoomStick&& other);
    virtual ~BoomStick();
@@ -18,13 +27,26 @@ public:
    virtual std::string Send(const std::string& command);
    virtual bool SendAsync(const std::string& uuid, const std::string& command);
    virtual bool GetAsyncReply(const std::string& uuid, const unsigned int msToWait, std::string& reply);
+   virtual size_t SendBatch(const std::vector<std::string>& commands, const unsigned int msToWait, BatchReplyHandler handler);
    std::string GetUuid();
    void Swap(BoomStick& other);
    void SetBinding(const std::string& binding);
    void SetSendHWM(const int hwm);
    void SetRecvHWM(const int hwm);
+   void SetSharedContext(const std::string& name, const uint64_t affinity = 0);
+   void SetRequestTtl(const unsigned int seconds);
+   unsigned int GetRequestTtl() const;
+   void SetUnreadLimits(const size_t maxEntries, const size_t maxBytes);
+   uint64_t GetEvictedReplies() const;
+   uint64_t GetEvictedReplyBytes() const;
    zctx_t* GetContext();
+   int GetFd() const;
+   bool IsReadable();
+   static bool ParseUuid(const std::string& text, boost::uuids::uuid& uuid);
+   static std::string FormatUuid(const boost::uuids::uuid& uuid);
 protected:
+   typedef boost::uuids::uuid RequestId;
+
    virtual zctx_t* GetNewContext();
    virtual void* GetNewSocket(zctx_t* ctx);
    virtual bool ConnectToBinding(void* socket, const std::string& binding);
@@ -32,16 +54,35 @@ protected:
    bool FindUnreadUuid(const std::string& uuid) const;
    virtual void CleanOldPendingData();
    virtual void CleanPendingReplies();
-   virtual void CleanUnreadReplies();
-   virtual bool GetReplyFromSocket(const std::string& uuid, const unsigned int msToWait, std::string& reply);
-   virtual bool GetReplyFromCache(const std::string& uuid, std::string& reply);
-   virtual bool CheckForMessagePending(const std::string& messageHash, const unsigned int msToWait, std::string& reply);
-   virtual bool ReadFromReadySocket(std::string& foundId, std::string& foundReply);
+   virtual bool GetReplyFromSocket(const RequestId& id, const unsigned int msToWait, std::string& reply);
+   virtual bool GetReplyFromCache(const RequestId& id, std::string& reply);
+   virtual bool CheckForMessagePending(const RequestId& id, const unsigned int msToWait, std::string& reply);
+   virtual bool ReadFromReadySocket(RequestId& foundId, std::string& foundReply);
 
-   std::map<std::string, std::string> mUnreadReplies;
+   ReplyCache mUnreadReplies;
    time_t mLastGCTime;
 private:
-   std::map<std::string, time_t> mPendingReplies;
+   bool SendRequest(const RequestId& id, const std::string& command);
+   bool GetReply(const RequestId& id, const unsigned int msToWait, std::string& reply);
+   bool FindId(const std::string& uuid, RequestId& id) const;
+   RequestId IdForSend(const std::string& uuid);
+   void Forget(const RequestId& id);
+   void KeepReply(const RequestId& id, std::string& reply);
+   void DrainBatchReplies(const BatchReplyHandler& handler, size_t& answered);
+   std::string DescribeId(const RequestId& id) const;
+
+   struct PendingRequest {
+      time_t sent;
+      ExpiryWheel::Handle timer;
+   };
+
+   UuidMap<PendingRequest> mPendingReplies;
+   ExpiryWheel mExpiry;
+   // ids handed to the public API that are not UUIDs travel as generated ones
+   std::map<std::string, RequestId> mNamedIds;
+   UuidMap<std::string> mIdNames;
+   // the commands of the running SendBatch, by id
+   UuidMap<size_t> mBatch;
    std::string mBinding;
    void *mChamber;
    zctx_t *mCtx;
@@ -55,4 +96,8 @@ private:
    bool mUnreadAlert;
    bool mPendingAlert;
    pthread_t mUtilizedThread;
+   std::string mContextName;
+   uint64_t mAffinity;
+   unsigned int mRequestTtl;
+   uint64_t mReportedEvictions;
 };
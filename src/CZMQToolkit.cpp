@@ -1,6 +1,12 @@
 #include "CZMQToolkit.h"
 #include "g3log/g3log.hpp"
 #include <czmq.h>
+#include <cstring>
+
+namespace {
+   // deflate never shrinks data by more than this, a larger claimed size is corrupt
+   const uint64_t kMaxDeflateRatio = 1032;
+}
 
 /**
  * Simple method to set all 4 variables needed to set our buffers and high water mark.
@@ -19,6 +25,138 @@ void CZMQToolkit::setHWMAndBuffer(void* socket, const int size) {
    //   zsocket_set_sndbuf(socket, size);
 }
 
+/**
+ * Pin the socket's connections to a subset of the context's IO threads.
+ * Must be called before the socket binds or connects.
+ * @param socket
+ * @param affinity
+ *   Bit mask of IO threads, 0 leaves it to ZeroMQ
+ * @return 
+ */
+bool CZMQToolkit::SetAffinity(void* socket, const uint64_t affinity) {
+   if (zmq_setsockopt(socket, ZMQ_AFFINITY, &affinity, sizeof (affinity)) != 0) {
+      LOG(WARNING) << "Could not set affinity " << affinity << " : " << zmq_strerror(zmq_errno());
+      return false;
+   }
+   return true;
+}
+
+/**
+ * The socket's ZMQ_FD, for waiting on the socket in an epoll or poll loop.
+ * It is edge triggered and only says that the socket's events may have
+ * changed, after it wakes receive until IsReadable is false.
+ * @param socket
+ * @return 
+ *   -1 if the socket is NULL or has no fd
+ */
+int CZMQToolkit::GetReadableFd(void* socket) {
+   if (socket == NULL) {
+      return -1;
+   }
+   int fd = -1;
+   size_t size = sizeof (fd);
+   if (zmq_getsockopt(socket, ZMQ_FD, &fd, &size) != 0) {
+      LOG(WARNING) << "Could not get the socket fd: " << zmq_strerror(zmq_errno());
+      return -1;
+   }
+   return fd;
+}
+
+/**
+ * Check ZMQ_EVENTS for a message to receive. Reading it also lets ZeroMQ
+ * process pending commands, which is what rearms the ZMQ_FD.
+ * @param socket
+ * @return 
+ *   false if there is nothing to receive or the socket is NULL
+ */
+bool CZMQToolkit::IsReadable(void* socket) {
+   if (socket == NULL) {
+      return false;
+   }
+   int events = 0;
+   size_t size = sizeof (events);
+   if (zmq_getsockopt(socket, ZMQ_EVENTS, &events, &size) != 0) {
+      return false;
+   }
+   return (events & ZMQ_POLLIN) != 0;
+}
+
+/**
+ * Send data that a Vampire has to decode, a one byte flag frame saying how
+ * (kZlibFrame, kBatchFrame) followed by the data, without waiting.
+ * @param flag
+ * @param data
+ * @param socket
+ * @return 
+ *   false if the pipe was full or the send failed, zmq_errno() has the reason
+ */
+bool CZMQToolkit::SendFlagged(const uint8_t flag, const std::string& data, void* socket) {
+   if (zmq_send(socket, &flag, sizeof (flag), ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) {
+      return false;
+   }
+   // the rest of a multi part message is always accepted once the first part is
+   return zmq_send(socket, data.data(), data.size(), ZMQ_DONTWAIT) >= 0;
+}
+
+/**
+ * Deflate data with zlib, prefixed with its uncompressed size.
+ * @param data
+ * @param size
+ * @param level
+ *   zlib level, 1 (fastest) to 9 (smallest)
+ * @param compressed
+ *   Replaced with the result, its capacity is reused between calls
+ * @return 
+ *   false if zlib failed
+ */
+bool CZMQToolkit::Compress(const void* data, const size_t size, const int level, std::string& compressed) {
+   const uint32_t originalSize = size;
+   if (originalSize != size) {
+      return false;
+   }
+   uLongf compressedSize = compressBound(size);
+   compressed.resize(sizeof (originalSize) + compressedSize);
+   memcpy(&compressed[0], &originalSize, sizeof (originalSize));
+   int result = compress2(reinterpret_cast<Bytef*> (&compressed[sizeof (originalSize)]), &compressedSize,
+           reinterpret_cast<const Bytef*> (data), size, level);
+   if (result != Z_OK) {
+      LOG(WARNING) << "Could not compress " << size << " bytes: " << zError(result);
+      compressed.clear();
+      return false;
+   }
+   compressed.resize(sizeof (originalSize) + compressedSize);
+   return true;
+}
+
+/**
+ * Inflate the output of Compress.
+ * @param data
+ * @param size
+ * @param uncompressed
+ *   Replaced with the original data, its capacity is reused between calls
+ * @return 
+ *   false if the data is not valid Compress output
+ */
+bool CZMQToolkit::Uncompress(const void* data, const size_t size, std::string& uncompressed) {
+   uint32_t originalSize = 0;
+   if (size <= sizeof (originalSize)) {
+      return false;
+   }
+   memcpy(&originalSize, data, sizeof (originalSize));
+   if (originalSize > (size * kMaxDeflateRatio)) {
+      return false;
+   }
+   uncompressed.resize(originalSize);
+   uLongf uncompressedSize = originalSize;
+   int result = uncompress(reinterpret_cast<Bytef*> (&uncompressed[0]), &uncompressedSize,
+           reinterpret_cast<const Bytef*> (data) + sizeof (originalSize), size - sizeof (originalSize));
+   if (result != Z_OK || uncompressedSize != originalSize) {
+      uncompressed.clear();
+      return false;
+   }
+   return true;
+}
+
 /**
  * Print the current HWM for the given socket.
  * @param socket
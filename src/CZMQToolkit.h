@@ -7,16 +7,112 @@
 
 #pragma once
 #include <string>
+#include <cerrno>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 #include <zlib.h>
+#include <zmq.h>
 
 struct _zmsg_t;
 typedef struct _zmsg_t zmsg_t;
 
 class CZMQToolkit {
 public:
+   /// First frame of a two frame message whose second frame is Compress output
+   static const uint8_t kZlibFrame = 0x01;
+   /// First frame of a two frame message whose second frame is a ShotBatch
+   static const uint8_t kBatchFrame = 0x02;
 
    static void setHWMAndBuffer(void* socket, const int size);
+   static bool SetAffinity(void* socket, const uint64_t affinity);
+   static int GetReadableFd(void* socket);
+   static bool IsReadable(void* socket);
    static void PrintCurrentHighWater(void* socket, const std::string& name);
    static bool SendExistingMessage(zmsg_t*& bullet, void* socket);
+   static bool SendFlagged(const uint8_t flag, const std::string& data, void* socket);
+   static bool Compress(const void* data, const size_t size, const int level, std::string& compressed);
+   static bool Uncompress(const void* data, const size_t size, std::string& uncompressed);
+   template<typename Container>
+   static bool InitMessageTakingOwnership(zmq_msg_t& message, Container&& data);
+   template<typename Container>
+   static bool SendTakingOwnership(Container& data, void* socket, const int flags);
+private:
+   template<typename Container>
+   static void DeleteOwnedData(void* data, void* hint);
 };
 
+/**
+ * Initialize a message that refers to the data without copying it. The
+ * container is moved to the heap and deleted by ZeroMQ once the last
+ * reference to the message is gone.
+ * 
+ * @param message
+ *   An uninitialized message
+ * @param data
+ *   A std::string or std::vector<uint8_t> (anything with operator[] and size()),
+ * left empty after the call
+ * @return 
+ *   If the message was initialized, when false the data has been released
+ */
+template<typename Container>
+bool CZMQToolkit::InitMessageTakingOwnership(zmq_msg_t& message, Container&& data) {
+   static_assert(!std::is_lvalue_reference<Container>::value, "ownership is taken, pass with std::move");
+   if (data.size() == 0) {
+      return zmq_msg_init(&message) == 0;
+   }
+   Container* owned = new Container(std::move(data));
+   if (zmq_msg_init_data(&message, &((*owned)[0]), owned->size() * sizeof ((*owned)[0]),
+      DeleteOwnedData<Container>, owned) != 0) {
+      delete owned;
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Send the data as one message without copying it, ZeroMQ deletes the buffer
+ * once it has gone out. When the message can't be made or sent the buffer is
+ * handed back untouched, so the send can be retried.
+ * 
+ * @param data
+ *   A std::string or std::vector<uint8_t> that is not empty, left empty when
+ * sent
+ * @param socket
+ * @param flags
+ *   For zmq_msg_send, ZMQ_DONTWAIT to not block
+ * @return 
+ *   If it was sent, zmq_errno() tells why not
+ */
+template<typename Container>
+bool CZMQToolkit::SendTakingOwnership(Container& data, void* socket, const int flags) {
+   Container* owned = new Container(std::move(data));
+   zmq_msg_t message;
+   if (zmq_msg_init_data(&message, &((*owned)[0]), owned->size() * sizeof ((*owned)[0]),
+      DeleteOwnedData<Container>, owned) != 0) {
+      data.swap(*owned);
+      delete owned;
+      return false;
+   }
+   if (zmq_msg_send(&message, socket, flags) < 0) {
+      const int err = zmq_errno();
+      // the buffer is taken back, ZeroMQ only deletes the emptied container
+      data.swap(*owned);
+      zmq_msg_close(&message);
+      errno = err;
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Free function handed to ZeroMQ for data owned through InitMessageTakingOwnership
+ * @param data
+ * @param hint
+ *   The heap allocated container
+ */
+template<typename Container>
+void CZMQToolkit::DeleteOwnedData(void*, void* hint) {
+   delete reinterpret_cast<Container*> (hint);
+}
+
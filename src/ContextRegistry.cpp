@@ -0,0 +1,101 @@
+#include "ContextRegistry.h"
+#include "czmq.h"
+#include "g3log/g3log.hpp"
+
+/**
+ * @return the registry shared by the whole process
+ */
+ContextRegistry& ContextRegistry::Instance() {
+   static ContextRegistry registry;
+   return registry;
+}
+
+/**
+ * Set the number of IO threads for a named context. Must be called before
+ * the first Acquire of that name (or after the last Release).
+ * 
+ * @param name
+ * @param ioThreads
+ * @return false if the context is already in use
+ */
+bool ContextRegistry::Configure(const std::string& name, const int ioThreads) {
+   std::lock_guard<std::mutex> lock(mMutex);
+   SharedContext& shared = mContexts[name];
+   if (shared.context != nullptr) {
+      LOG(WARNING) << "Context " << name << " is in use, IO threads stay at " << shared.ioThreads;
+      return false;
+   }
+   shared.ioThreads = ioThreads;
+   return true;
+}
+
+/**
+ * Get a shadow of the named context, creating the context on first use.
+ * The shadow must be given back with Release.
+ * 
+ * @param name
+ * @return a context for the caller's sockets, nullptr on failure
+ */
+zctx_t* ContextRegistry::Acquire(const std::string& name) {
+   std::lock_guard<std::mutex> lock(mMutex);
+   SharedContext& shared = mContexts[name];
+   if (shared.context == nullptr) {
+      shared.context = zctx_new();
+      if (shared.context == nullptr) {
+         LOG(WARNING) << "Failed to create context " << name;
+         return nullptr;
+      }
+      zctx_set_iothreads(shared.context, shared.ioThreads);
+   }
+   zctx_t* shadow = zctx_shadow(shared.context);
+   if (shadow == nullptr) {
+      LOG(WARNING) << "Failed to shadow context " << name;
+      if (shared.users == 0) {
+         zctx_destroy(&shared.context);
+         shared.context = nullptr;
+      }
+      return nullptr;
+   }
+   ++shared.users;
+   mShadows[shadow] = name;
+   return shadow;
+}
+
+/**
+ * Destroy a context and the sockets created on it. A shadow from Acquire
+ * drops its reference, the last one terminates the named context. Any other
+ * (private) context is destroyed outright.
+ * 
+ * @param context
+ *   set to nullptr
+ */
+void ContextRegistry::Release(zctx_t*& context) {
+   if (context == nullptr) {
+      return;
+   }
+   std::lock_guard<std::mutex> lock(mMutex);
+   auto shadow = mShadows.find(context);
+   if (shadow == mShadows.end()) {
+      zctx_destroy(&context);
+      context = nullptr;
+      return;
+   }
+   SharedContext& shared = mContexts[shadow->second];
+   mShadows.erase(shadow);
+   zctx_destroy(&context);
+   context = nullptr;
+   if (--shared.users == 0) {
+      zctx_destroy(&shared.context);
+      shared.context = nullptr;
+   }
+}
+
+/**
+ * @param name
+ * @return the number of shadows handed out for the named context
+ */
+size_t ContextRegistry::UseCount(const std::string& name) const {
+   std::lock_guard<std::mutex> lock(mMutex);
+   auto shared = mContexts.find(name);
+   return (shared == mContexts.end()) ? 0 : shared->second.users;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <map>
+#include <mutex>
+struct _zctx_t;
+typedef struct _zctx_t zctx_t;
+
+/**
+ * Process wide registry of named ZeroMQ contexts.
+ * 
+ * Queue objects that opt in share one context (and its IO threads) per name
+ * instead of creating their own. Each user is handed a shadow of the named
+ * context so that it keeps its own list of sockets, the named context is
+ * terminated when the last shadow is released.
+ */
+class ContextRegistry {
+public:
+   static ContextRegistry& Instance();
+
+   bool Configure(const std::string& name, const int ioThreads);
+   zctx_t* Acquire(const std::string& name);
+   void Release(zctx_t*& context);
+   size_t UseCount(const std::string& name) const;
+
+private:
+   ContextRegistry() = default;
+   ContextRegistry(const ContextRegistry&) = delete;
+   ContextRegistry& operator=(const ContextRegistry&) = delete;
+
+   struct SharedContext {
+      SharedContext() : context(nullptr), ioThreads(1), users(0) {
+      }
+      zctx_t* context;
+      int ioThreads;
+      size_t users;
+   };
+
+   std::map<std::string, SharedContext> mContexts;
+   std::map<zctx_t*, std::string> mShadows;
+   mutable std::mutex mMutex;
+};
@@ -188,6 +188,25 @@ bool Crowbar::BlockForKill(std::string& guts) {
 }
 
 bool Crowbar::BlockForKill(std::vector<std::string>& guts) {
+   std::vector<ZeroCopyMessage> allReplies;
+   if (!BlockForKill(allReplies)) {
+      return false;
+   }
+   guts.clear();
+   for (const auto& reply : allReplies) {
+      guts.push_back(reply.ToString());
+   }
+   return true;
+}
+
+/**
+ * Block for the reply, handing back each frame without copying it
+ * @param guts
+ *   One handle per frame, the frames are released with the handles
+ * @return 
+ *   If a reply was received
+ */
+bool Crowbar::BlockForKill(std::vector<ZeroCopyMessage>& guts) {
    if (!mTip) {
       return false;
    }
@@ -197,20 +216,25 @@ bool Crowbar::BlockForKill(std::vector<std::string>& guts) {
    }
    guts.clear();
    int msgSize = zmsg_size(message);
+   guts.reserve(msgSize);
    for (int i = 0; i < msgSize; i++) {
-      zframe_t* frame = zmsg_pop(message);
-      std::string aString;
-      aString.insert(0, reinterpret_cast<const char*> (zframe_data(frame)), zframe_size(frame));
-      guts.push_back(aString);
-      zframe_destroy(&frame);
-      //std::cout << guts[0] << " found " << aString << std::endl;
+      guts.emplace_back(zmsg_pop(message));
    }
 
-
    zmsg_destroy(&message);
    return true;
 }
 
+bool Crowbar::WaitForKill(std::vector<ZeroCopyMessage>& guts, const int timeout) {
+   if (!mTip) {
+      return false;
+   }
+   if (zsocket_poll(mTip, timeout)) {
+      return BlockForKill(guts);
+   }
+   return false;
+}
+
 bool Crowbar::WaitForKill(std::string& guts, const int timeout) {
    std::vector<std::string> allReplies;
    if (WaitForKill(allReplies, timeout) && !allReplies.empty()) {
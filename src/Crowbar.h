@@ -11,6 +11,7 @@
 #include <set>
 #include <vector>
 #include "Headcrab.h"
+#include "ZeroCopyMessage.h"
 
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
@@ -28,6 +29,8 @@ public:
    bool WaitForKill(std::vector<std::string>& guts, const int timeout);
    bool BlockForKill(std::string& gut);
    bool WaitForKill(std::string& gut,const int timeout);
+   bool BlockForKill(std::vector<ZeroCopyMessage>& guts);
+   bool WaitForKill(std::vector<ZeroCopyMessage>& guts, const int timeout);
    void* GetTip();
    static int GetHighWater();
    zctx_t* GetContext();
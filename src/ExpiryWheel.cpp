@@ -0,0 +1,118 @@
+#include "ExpiryWheel.h"
+#include <algorithm>
+
+const ExpiryWheel::Handle ExpiryWheel::kNoTimer;
+
+namespace {
+   size_t RoundUp(const size_t slots) {
+      size_t rounded = 1;
+      while (rounded < slots) {
+         rounded <<= 1;
+      }
+      return rounded;
+   }
+}
+
+/**
+ * An empty wheel.
+ * @param seconds
+ *   How far one turn of the wheel reaches, rounded up to a power of two
+ * @param now
+ *   Where the wheel starts
+ */
+ExpiryWheel::ExpiryWheel(const size_t seconds, const time_t now) :
+mSlots(RoundUp(seconds), kNoTimer),
+mMask(mSlots.size() - 1),
+mNow(now),
+mSize(0) {
+}
+
+/**
+ * Start a timer.
+ * @param key
+ *   Handed back when it expires
+ * @param expiry
+ *   Seconds, a time already passed expires on the next Advance
+ * @return
+ *   The handle to cancel it with
+ */
+ExpiryWheel::Handle ExpiryWheel::Add(const Key& key, const time_t expiry) {
+   Handle timer;
+   if (mFree.empty()) {
+      timer = static_cast<Handle> (mNodes.size());
+      mNodes.emplace_back();
+   } else {
+      timer = mFree.back();
+      mFree.pop_back();
+   }
+   Node& node = mNodes[timer];
+   node.key = key;
+   node.expiry = std::max(expiry, mNow + 1);
+   Link(timer);
+   ++mSize;
+   return timer;
+}
+
+/**
+ * Stop a timer that has not expired yet.
+ * @param timer
+ *   kNoTimer is ignored
+ */
+void ExpiryWheel::Cancel(const Handle timer) {
+   if (timer == kNoTimer || timer >= mNodes.size()) {
+      return;
+   }
+   Unlink(timer);
+   Release(timer);
+}
+
+/**
+ * @return the number of running timers
+ */
+size_t ExpiryWheel::Size() const {
+   return mSize;
+}
+
+/**
+ * Stop every timer.
+ */
+void ExpiryWheel::Clear() {
+   mNodes.clear();
+   mFree.clear();
+   std::fill(mSlots.begin(), mSlots.end(), kNoTimer);
+   mSize = 0;
+}
+
+/**
+ * Put a timer at the head of the slot of its expiry.
+ */
+void ExpiryWheel::Link(const Handle timer) {
+   Node& node = mNodes[timer];
+   Handle& head = mSlots[static_cast<size_t> (node.expiry) & mMask];
+   node.previous = kNoTimer;
+   node.next = head;
+   if (head != kNoTimer) {
+      mNodes[head].previous = timer;
+   }
+   head = timer;
+}
+
+/**
+ * Take a timer out of its slot.
+ */
+void ExpiryWheel::Unlink(const Handle timer) {
+   Node& node = mNodes[timer];
+   if (node.previous != kNoTimer) {
+      mNodes[node.previous].next = node.next;
+   } else {
+      mSlots[static_cast<size_t> (node.expiry) & mMask] = node.next;
+   }
+   if (node.next != kNoTimer) {
+      mNodes[node.next].previous = node.previous;
+   }
+}
+
+void ExpiryWheel::Release(const Handle timer) {
+   mFree.push_back(timer);
+   --mSize;
+}
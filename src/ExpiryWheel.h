@@ -0,0 +1,87 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#include <boost/uuid/uuid.hpp>
+
+/**
+ * A hashed timing wheel that expires ids by the second. Each second of the
+ * wheel is a slot holding an intrusive list of the timers due in it, so
+ * adding, cancelling and expiring a timer are O(1) and nothing ever walks all
+ * of them. A timer further away than the wheel is long stays in its slot for
+ * a few more turns.
+ *
+ * Timers are nodes in one array, reused through a free list, and addressed by
+ * the handle Add returns. A handle is only valid until its timer expires or
+ * is cancelled. Not thread safe.
+ */
+class ExpiryWheel {
+public:
+   typedef boost::uuids::uuid Key;
+   typedef uint32_t Handle;
+   static const Handle kNoTimer = UINT32_MAX;
+
+   explicit ExpiryWheel(const size_t seconds = 1024, const time_t now = time(NULL));
+   Handle Add(const Key& key, const time_t expiry);
+   void Cancel(const Handle timer);
+   template<typename Expired>
+   size_t Advance(const time_t now, Expired expired);
+   size_t Size() const;
+   void Clear();
+
+private:
+   struct Node {
+      Key key;
+      time_t expiry;
+      Handle previous;
+      Handle next;
+   };
+   void Link(const Handle timer);
+   void Unlink(const Handle timer);
+   void Release(const Handle timer);
+
+   std::vector<Node> mNodes;
+   std::vector<Handle> mFree;
+   std::vector<Handle> mSlots;
+   const size_t mMask;
+   time_t mNow;
+   size_t mSize;
+};
+
+/**
+ * Expire every timer due by now.
+ * @param now
+ *   Seconds, times before the last Advance are ignored
+ * @param expired
+ *   Called with the key of each expired timer, after it was removed. It must
+ * not add or cancel timers.
+ * @return
+ *   The number expired
+ */
+template<typename Expired>
+size_t ExpiryWheel::Advance(const time_t now, Expired expired) {
+   if (now <= mNow) {
+      return 0;
+   }
+   // a wheel idle for more than a turn only has to be visited once
+   const time_t steps = std::min<time_t>(now - mNow, mSlots.size());
+   size_t count = 0;
+   for (time_t step = 1; step <= steps; ++step) {
+      Handle timer = mSlots[static_cast<size_t> (mNow + step) & mMask];
+      while (timer != kNoTimer) {
+         const Handle next = mNodes[timer].next;
+         if (mNodes[timer].expiry <= now) {
+            const Key key = mNodes[timer].key;
+            Unlink(timer);
+            Release(timer);
+            expired(key);
+            ++count;
+         }
+         timer = next;
+      }
+   }
+   mNow = now;
+   return count;
+}
@@ -0,0 +1,290 @@
+#include "Gatling.h"
+#include <algorithm>
+#include <g3log/g3log.hpp>
+
+/**
+ * A Gatling with a barrel for each location, not yet aimed.
+ * @param locations
+ *   The Vampires to shoot at, duplicates are ignored
+ * @param pointsPerBarrel
+ *   Points each barrel gets on the hash ring, more spreads keys more evenly
+ */
+Gatling::Gatling(const std::vector<std::string>& locations, const size_t pointsPerBarrel) :
+mPointsPerBarrel(std::max<size_t>(pointsPerBarrel, 1)),
+mHwm(250),
+mOwnSocket(false),
+mInprocFastPath(false),
+mAimed(false),
+mFailovers(0) {
+   for (const auto& location : locations) {
+      AddBarrel(location);
+   }
+}
+
+/**
+ * Aim every barrel.
+ * @return
+ *   false if there are no barrels or one could not be aimed
+ */
+bool Gatling::Aim() {
+   if (mBarrels.empty()) {
+      LOG(WARNING) << "Gatling has no barrels to aim";
+      return false;
+   }
+   mAimed = true;
+   for (auto& barrel : mBarrels) {
+      barrel->SetHighWater(mHwm);
+      barrel->SetOwnSocket(mOwnSocket);
+      barrel->SetInprocFastPath(mInprocFastPath);
+      if (!mContextName.empty()) {
+         barrel->SetSharedContext(mContextName);
+      }
+      if (!barrel->Aim()) {
+         LOG(WARNING) << "Gatling can't aim at " << barrel->GetBinding();
+         mAimed = false;
+      }
+   }
+   return mAimed;
+}
+
+/**
+ * Add a barrel, only the keys that land on its points of the ring move to
+ * it. It is aimed right away if the Gatling already is.
+ * @param location
+ * @return
+ *   false if the location already has a barrel or could not be aimed
+ */
+bool Gatling::AddBarrel(const std::string& location) {
+   for (const auto& barrel : mBarrels) {
+      if (barrel->GetBinding() == location) {
+         return false;
+      }
+   }
+   std::unique_ptr<Rifle> barrel(new Rifle(location));
+   if (mAimed) {
+      barrel->SetHighWater(mHwm);
+      barrel->SetOwnSocket(mOwnSocket);
+      barrel->SetInprocFastPath(mInprocFastPath);
+      if (!mContextName.empty()) {
+         barrel->SetSharedContext(mContextName);
+      }
+      if (!barrel->Aim()) {
+         LOG(WARNING) << "Gatling can't aim at " << location;
+         return false;
+      }
+   }
+   mBarrels.push_back(std::move(barrel));
+   BuildRing();
+   return true;
+}
+
+/**
+ * Remove a barrel, its keys move to the barrels that follow its points on
+ * the ring and every other key stays where it was.
+ * @param location
+ * @return
+ *   false if there was no such barrel
+ */
+bool Gatling::RemoveBarrel(const std::string& location) {
+   auto barrel = std::find_if(mBarrels.begin(), mBarrels.end(),
+           [&location](const std::unique_ptr<Rifle>& rifle) {
+              return rifle->GetBinding() == location;
+           });
+   if (barrel == mBarrels.end()) {
+      return false;
+   }
+   mBarrels.erase(barrel);
+   BuildRing();
+   return true;
+}
+
+/**
+ * @return the location of every barrel
+ */
+std::vector<std::string> Gatling::GetBarrels() const {
+   std::vector<std::string> locations;
+   for (const auto& barrel : mBarrels) {
+      locations.push_back(barrel->GetBinding());
+   }
+   return locations;
+}
+
+/**
+ * @param key
+ * @return the location a key is fired at when nothing is full, empty when
+ * there are no barrels
+ */
+std::string Gatling::GetBarrel(const std::string& key) const {
+   if (mRing.empty()) {
+      return std::string();
+   }
+   return mBarrels[mRing[FindPoint(key)].second]->GetBinding();
+}
+
+/**
+ * Fire a bullet out of the key's barrel. If that barrel is at its high water
+ * mark the next barrels on the ring are tried without waiting, and only when
+ * all of them are full does it wait on the key's own barrel.
+ * @param key
+ *   Bullets with the same key reach the same Vampire while it keeps up
+ * @param bullet
+ * @param waitToFire in milliseconds
+ * @return
+ */
+bool Gatling::Fire(const std::string& key, const std::string& bullet, const int waitToFire) {
+   if (!mAimed || mRing.empty()) {
+      LOG(WARNING) << "Gatling is not aimed";
+      return false;
+   }
+   const size_t start = FindPoint(key);
+   const size_t primary = mRing[start].second;
+   if (mBarrels.size() == 1) {
+      return mBarrels[primary]->Fire(bullet, waitToFire);
+   }
+   if (mBarrels[primary]->Fire(bullet, 0)) {
+      return true;
+   }
+   std::vector<bool> tried(mBarrels.size(), false);
+   tried[primary] = true;
+   size_t triedCount = 1;
+   for (size_t i = 1; i < mRing.size() && triedCount < mBarrels.size(); ++i) {
+      const size_t barrel = mRing[(start + i) % mRing.size()].second;
+      if (tried[barrel]) {
+         continue;
+      }
+      tried[barrel] = true;
+      ++triedCount;
+      if (mBarrels[barrel]->Fire(bullet, 0)) {
+         ++mFailovers;
+         return true;
+      }
+   }
+   return mBarrels[primary]->Fire(bullet, waitToFire);
+}
+
+/**
+ * Get the high water mark of each barrel.
+ * @return
+ */
+int Gatling::GetHighWater() {
+   return mHwm;
+}
+
+/**
+ * Set the high water mark of each barrel. This must be called before Aim.
+ * @param hwm
+ */
+void Gatling::SetHighWater(const int hwm) {
+   mHwm = hwm;
+}
+
+/**
+ * Set if the barrels bind instead of connect, off by default as the
+ * Vampires usually own their sockets. This must be called before Aim.
+ * @param own
+ */
+void Gatling::SetOwnSocket(const bool own) {
+   mOwnSocket = own;
+}
+
+/**
+ * Get value for owning the sockets.
+ * @return bool
+ */
+bool Gatling::GetOwnSocket() {
+   return mOwnSocket;
+}
+
+/**
+ * Have barrels on inproc:// locations use the in process queue instead of
+ * ZeroMQ, see Rifle::SetInprocFastPath. This must be called before Aim.
+ * @param fastPath
+ */
+void Gatling::SetInprocFastPath(const bool fastPath) {
+   mInprocFastPath = fastPath;
+}
+
+/**
+ * Create every barrel's socket on one context from the ContextRegistry
+ * instead of a context each. This must be called before Aim.
+ * @param name
+ */
+void Gatling::SetSharedContext(const std::string& name) {
+   mContextName = name;
+}
+
+/**
+ * @param location
+ * @return the counters of one barrel, all zero for an unknown location
+ */
+QueueStatsSnapshot Gatling::GetStats(const std::string& location) const {
+   for (const auto& barrel : mBarrels) {
+      if (barrel->GetBinding() == location) {
+         return barrel->GetStats();
+      }
+   }
+   return QueueStatsSnapshot();
+}
+
+/**
+ * @return the number of bullets fired out of another barrel than their key's
+ * because it was full
+ */
+uint64_t Gatling::GetFailovers() const {
+   return mFailovers;
+}
+
+/**
+ * A hash that is the same in every process, so separate senders agree on
+ * where a key goes. FNV-1a with a final mix to spread similar strings.
+ * @param data
+ * @return
+ */
+uint64_t Gatling::Hash(const std::string& data) {
+   uint64_t hash = 14695981039346656037ULL;
+   for (const char c : data) {
+      hash ^= static_cast<uint8_t> (c);
+      hash *= 1099511628211ULL;
+   }
+   hash ^= hash >> 33;
+   hash *= 0xff51afd7ed558ccdULL;
+   hash ^= hash >> 33;
+   hash *= 0xc4ceb9fe1a85ec53ULL;
+   hash ^= hash >> 33;
+   return hash;
+}
+
+/**
+ * Place every barrel's points on the ring, a point depends only on the
+ * barrel's location so the other barrels keep theirs.
+ */
+void Gatling::BuildRing() {
+   mRing.clear();
+   mRing.reserve(mBarrels.size() * mPointsPerBarrel);
+   for (size_t barrel = 0; barrel < mBarrels.size(); ++barrel) {
+      const std::string& location = mBarrels[barrel]->GetBinding();
+      for (size_t point = 0; point < mPointsPerBarrel; ++point) {
+         mRing.emplace_back(Hash(location + "#" + std::to_string(point)), barrel);
+      }
+   }
+   std::sort(mRing.begin(), mRing.end());
+}
+
+/**
+ * @param key
+ * @return the index of the first ring point at or after the key's hash
+ */
+size_t Gatling::FindPoint(const std::string& key) const {
+   auto point = std::lower_bound(mRing.begin(), mRing.end(),
+           std::make_pair(Hash(key), size_t(0)));
+   if (point == mRing.end()) {
+      return 0;
+   }
+   return point - mRing.begin();
+}
+
+/**
+ * Every barrel is destroyed with its Rifle.
+ */
+Gatling::~Gatling() {
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Rifle.h"
+
+/**
+ * A Rifle with a barrel per Vampire. Each bullet is fired with a key, and
+ * every bullet with the same key goes out of the same barrel so one consumer
+ * sees a whole flow. Keys are placed on a consistent hash ring, adding or
+ * removing a barrel only moves the keys of that barrel.
+ *
+ * A barrel at its high water mark hands the bullet to the next barrel on the
+ * ring instead of blocking, affinity is traded for progress until it drains.
+ *
+ * Like a Rifle, a Gatling is used from one thread.
+ */
+class Gatling {
+public:
+   explicit Gatling(const std::vector<std::string>& locations, const size_t pointsPerBarrel = 64);
+   bool Aim();
+   bool AddBarrel(const std::string& location);
+   bool RemoveBarrel(const std::string& location);
+   std::vector<std::string> GetBarrels() const;
+   std::string GetBarrel(const std::string& key) const;
+   bool Fire(const std::string& key, const std::string& bullet, const int waitToFire = 10000);
+   int GetHighWater();
+   void SetHighWater(const int hwm);
+   void SetOwnSocket(const bool own);
+   bool GetOwnSocket();
+   void SetInprocFastPath(const bool fastPath);
+   void SetSharedContext(const std::string& name);
+   QueueStatsSnapshot GetStats(const std::string& location) const;
+   uint64_t GetFailovers() const;
+   static uint64_t Hash(const std::string& data);
+   virtual ~Gatling();
+
+private:
+   Rifle* NewBarrel(const std::string& location);
+   void BuildRing();
+   size_t FindPoint(const std::string& key) const;
+
+   const size_t mPointsPerBarrel;
+   std::vector<std::unique_ptr<Rifle> > mBarrels;
+   // sorted hash points, each owned by the barrel at the index
+   std::vector<std::pair<uint64_t, size_t> > mRing;
+   int mHwm;
+   bool mOwnSocket;
+   bool mInprocFastPath;
+   std::string mContextName;
+   bool mAimed;
+   uint64_t mFailovers;
+};
@@ -9,19 +9,30 @@
 #include <g3log/g3log.hpp>
 #include <algorithm>
 #include "Harpoon.h"
+#include "CZMQToolkit.h"
+#include "ContextRegistry.h"
 #include <chrono>
 
 
 /// Creates the client that is to connect to the server/Kraken
-Harpoon::Harpoon():
+Harpoon::Harpoon() : Harpoon(std::string()) {
+}
+
+/// Harpoon whose socket is created on a context shared through the ContextRegistry
+/// @param sharedContext the ContextRegistry name, empty for a private context
+/// @param affinity bit mask of the shared context's IO threads to use, 0 for any
+Harpoon::Harpoon(const std::string& sharedContext, const uint64_t affinity):
   mQueueLength(1), //Number of allowed messages in queue
    mTimeoutMs(300000), //5 minutes
    mOffset(0),
    mChunk(nullptr) {
-   mCtx = zctx_new();
+   mCtx = sharedContext.empty() ? zctx_new() : ContextRegistry::Instance().Acquire(sharedContext);
    CHECK(mCtx!=nullptr);
    mDealer = zsocket_new(mCtx, ZMQ_DEALER);
    CHECK(mDealer!=nullptr);
+   if (affinity) {
+      CZMQToolkit::SetAffinity(mDealer, affinity);
+   }
    mCredit = mQueueLength;
 }
 
@@ -31,6 +42,19 @@ Harpoon::Spear Harpoon::Aim(const std::string& location) {
    return (0 == result) ? Harpoon::Spear::IMPALED : Harpoon::Spear::MISS;
 }
 
+/// The socket's ZMQ_FD, to wait for chunks in an epoll or poll loop. Chunks are
+/// only asked for by Heave, so Heave once after Aim. The fd is edge triggered:
+/// when it polls readable, Heave with MaxWaitInMs(0) until IsReadable is false.
+/// Heave sends credit as well, which can use up the edge.
+int Harpoon::GetFd() const {
+   return CZMQToolkit::GetReadableFd(mDealer);
+}
+
+/// Whether a chunk can be heaved without waiting, which also rearms GetFd.
+bool Harpoon::IsReadable() {
+   return CZMQToolkit::IsReadable(mDealer);
+}
+
 /// Set the amount of time in MS the client should wait for new data.
 void Harpoon::MaxWaitInMs(const int timeoutMs) {
    mTimeoutMs = timeoutMs;
@@ -126,7 +150,7 @@ void Harpoon::FreeChunk() {
 Harpoon::~Harpoon() {
    FreeChunk();
    zsocket_destroy(mCtx, mDealer);
-   zctx_destroy(&mCtx);
+   ContextRegistry::Instance().Release(mCtx);
 }
 
 std::string Harpoon::EnumToString(Harpoon::Battling value) const {
@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 #include <czmq.h>
+#include <cstdint>
 
 /** Harpoon-Kraken is a PipeLine communication pattern used to
 *  stream files or plain data from a server to a client. 
@@ -30,11 +31,14 @@ public:
    enum class Battling : std::int8_t { TIMEOUT = -2, INTERRUPT = -1, VICTORIOUS = 0, CONTINUE = 1, CANCEL = 2 };
 
    Harpoon();
+   explicit Harpoon(const std::string& sharedContext, const uint64_t affinity = 0);
 
    Spear Aim(const std::string& location);
    void MaxWaitInMs(const int timeoutMs);
    Battling Heave(std::vector<uint8_t>& data);
    Battling Cancel();
+   int GetFd() const;
+   bool IsReadable();
    virtual ~Harpoon();
 
    std::string EnumToString(Battling type) const;
@@ -8,6 +8,7 @@
 #include "boost/thread.hpp"
 #include <g3log/g3log.hpp>
 #include "Death.h"
+#include "CZMQToolkit.h"
 
 
 /**
@@ -137,6 +138,36 @@ zctx_t* Headcrab::GetContext() const {
    return mContext;
 }
 
+/**
+ * The face we are hit through, to wait on it along with others. Unlike
+ * GetFace this never makes the socket. Only receive through the Headcrab.
+ * @return 
+ *   NULL if the headcrab is not alive
+ */
+void* Headcrab::GetSocket() const {
+   return mFace;
+}
+
+/**
+ * The face's ZMQ_FD, to wait on the Headcrab in an epoll or poll loop. It is
+ * edge triggered: when it polls readable, take hits with GetHitWait and a 0
+ * timeout, answering each, until IsReadable returns false. SendSplatter can
+ * use up the edge, so check IsReadable after answering too.
+ * @return 
+ *   -1 if the headcrab is not alive
+ */
+int Headcrab::GetFd() const {
+   return CZMQToolkit::GetReadableFd(mFace);
+}
+
+/**
+ * Whether a hit can be taken without waiting, which also rearms GetFd.
+ * @return 
+ */
+bool Headcrab::IsReadable() {
+   return CZMQToolkit::IsReadable(mFace);
+}
+
 bool Headcrab::GetHitBlock(std::string& theHit) {
    std::vector<std::string> hits;
    if (GetHitBlock(hits) && ! hits.empty()) {
@@ -147,6 +178,26 @@ bool Headcrab::GetHitBlock(std::string& theHit) {
 }
 
 bool Headcrab::GetHitBlock(std::vector<std::string>& theHits) {
+   std::vector<ZeroCopyMessage> hits;
+   if (! GetHitBlock(hits)) {
+      return false;
+   }
+   theHits.clear();
+   for (const auto& hit : hits) {
+      theHits.push_back(hit.ToString());
+   }
+   return true;
+}
+
+/**
+ * Block for a message, handing back each frame without copying it
+ * 
+ * @param theHits
+ *   One handle per frame, the frames are released with the handles
+ * @return 
+ *   If a message was received
+ */
+bool Headcrab::GetHitBlock(std::vector<ZeroCopyMessage>& theHits) {
    if (! mFace) {
       return false;
    }
@@ -154,22 +205,25 @@ bool Headcrab::GetHitBlock(std::vector<std::string>& theHits) {
    if (! message) {
       return false;
    }
-   //std::cout << "Got message with " << zmsg_size(message) << " parts" << std::endl;
    theHits.clear();
    int msgSize = zmsg_size(message);
+   theHits.reserve(msgSize);
    for (int i = 0; i < msgSize; i ++) {
-      zframe_t* frame = zmsg_pop(message);
-      std::string aFrame;
-      aFrame.insert(0, reinterpret_cast<const char*> (zframe_data(frame)), zframe_size(frame));
-      theHits.push_back(aFrame);
-      zframe_destroy(&frame);
-      //std::cout << "got string " << aFrame << " " << theHits[i] << std::endl;
+      theHits.emplace_back(zmsg_pop(message));
    }
 
    zmsg_destroy(&message);
-   //std::cout << "got " << theHits.size() << " hits" << std::endl;
    return true;
+}
 
+bool Headcrab::GetHitWait(std::vector<ZeroCopyMessage>& theHits, const int timeout) {
+   if (! mFace) {
+      return false;
+   }
+   if (zsocket_poll(mFace, timeout)) {
+      return GetHitBlock(theHits);
+   }
+   return false;
 }
 
 bool Headcrab::GetHitWait(std::string& theHit, const int timeout) {
@@ -9,6 +9,7 @@
 #include <map>
 #include <string>
 #include <vector>
+#include "ZeroCopyMessage.h"
 
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
@@ -18,11 +19,16 @@ public:
    virtual ~Headcrab();
    std::string GetBinding() const;
    zctx_t* GetContext() const;
+   int GetFd() const;
+   bool IsReadable();
    bool ComeToLife();
 
    void* GetFace(zctx_t* context);
+   void* GetSocket() const;
    bool GetHitBlock(std::vector<std::string>& theHits);
    bool GetHitWait(std::vector<std::string>& theHit,const int timeout);
+   bool GetHitBlock(std::vector<ZeroCopyMessage>& theHits);
+   bool GetHitWait(std::vector<ZeroCopyMessage>& theHits, const int timeout);
    bool SendSplatter(std::vector<std::string>& feedback);
    bool GetHitBlock(std::string& theHit);
    bool GetHitWait(std::string& theHit,const int timeout);
@@ -0,0 +1,183 @@
+#include "InprocPipe.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <czmq.h>
+#include "g3log/g3log.hpp"
+
+namespace {
+   const std::string kInprocPrefix = "inproc://";
+   // Longest single wait on the queue when the caller wants to block forever,
+   // so that interrupts are still noticed
+   const std::chrono::milliseconds kMaxSingleWait(1000);
+}
+
+/**
+ * @param location
+ * @return if the location is an inproc:// endpoint
+ */
+bool InprocPipe::IsInproc(const std::string& location) {
+   return location.compare(0, kInprocPrefix.size(), kInprocPrefix) == 0;
+}
+
+/**
+ * Find the channel for a location, creating it if nobody is attached.
+ * @param location
+ * @param capacity
+ *   Only used when the channel is created
+ * @return 
+ */
+std::shared_ptr<InprocPipe::Channel> InprocPipe::Attach(const std::string& location, const size_t capacity) {
+   static std::mutex channelsMutex;
+   static std::map<std::string, std::weak_ptr<Channel> > channels;
+   std::lock_guard<std::mutex> lock(channelsMutex);
+   std::shared_ptr<Channel> channel = channels[location].lock();
+   if (!channel) {
+      channel = std::make_shared<Channel>(capacity);
+      channels[location] = channel;
+   }
+   for (auto it = channels.begin(); it != channels.end();) {
+      if (it->second.expired()) {
+         it = channels.erase(it);
+      } else {
+         ++it;
+      }
+   }
+   return channel;
+}
+
+/**
+ * Attach to the shared queue for a location
+ * @param location
+ * @param capacity
+ *   Bullets that can be in flight, used if this is the first to attach
+ * @param receiver
+ *   A Vampire, Rifles wait for at least one before firing
+ */
+InprocPipe::InprocPipe(const std::string& location, const size_t capacity, const bool receiver) :
+mChannel(Attach(location, capacity)),
+mIsReceiver(receiver) {
+   if (mIsReceiver) {
+      std::lock_guard<std::mutex> lock(mChannel->attachMutex);
+      mChannel->receivers++;
+      mChannel->attached.notify_all();
+   }
+}
+
+/**
+ * Detach, the queue and any bullets left in it go away with the last user.
+ */
+InprocPipe::~InprocPipe() {
+   if (mIsReceiver) {
+      mChannel->receivers--;
+   }
+}
+
+/**
+ * Hand a bullet to whichever Vampire pops it first.
+ * @param bullet
+ *   Moved from when successful
+ * @param waitMs
+ *   How long to wait for room, and for a Vampire to attach, in milliseconds.
+ * Negative waits until interrupted.
+ * @return 
+ */
+bool InprocPipe::Push(std::string& bullet, const int waitMs) {
+   if (bullet.empty()) {
+      LOG(WARNING) << "Tried to send empty packet";
+      return false;
+   }
+   if (mChannel->receivers.load() == 0) {
+      if (!WaitForReceiver(waitMs)) {
+         return false;
+      }
+   } else if (mChannel->queue.TryPush(bullet)) {
+      return true;
+   }
+   using namespace std::chrono;
+   const steady_clock::time_point deadline = steady_clock::now() + milliseconds(waitMs);
+   while (!zctx_interrupted) {
+      long waitNow = kMaxSingleWait.count();
+      if (waitMs >= 0) {
+         waitNow = std::min<long>(waitNow, duration_cast<milliseconds>(deadline - steady_clock::now()).count());
+         waitNow = std::max(waitNow, 0L);
+      }
+      if (mChannel->queue.Push(bullet, waitNow)) {
+         return true;
+      }
+      if (waitMs >= 0 && steady_clock::now() >= deadline) {
+         return false;
+      }
+   }
+   return false;
+}
+
+/**
+ * Wait for the first Vampire to attach to the location
+ * @param waitMs
+ *   Negative waits until interrupted
+ * @return 
+ *   false if none did in time
+ */
+bool InprocPipe::WaitForReceiver(const int waitMs) {
+   using namespace std::chrono;
+   const steady_clock::time_point deadline = steady_clock::now() + milliseconds(waitMs);
+   std::unique_lock<std::mutex> lock(mChannel->attachMutex);
+   while (mChannel->receivers.load() == 0) {
+      if (zctx_interrupted || (waitMs >= 0 && steady_clock::now() >= deadline)) {
+         return false;
+      }
+      const steady_clock::time_point until = (waitMs >= 0) ?
+         std::min(deadline, steady_clock::now() + kMaxSingleWait) : steady_clock::now() + kMaxSingleWait;
+      mChannel->attached.wait_until(lock, until);
+   }
+   return true;
+}
+
+/**
+ * Take the next bullet
+ * @param bullet
+ *   Replaced by the bullet when successful
+ * @param waitMs
+ *   How long to wait for a bullet in milliseconds. Negative waits until
+ * interrupted.
+ * @return 
+ */
+bool InprocPipe::Pop(std::string& bullet, const int waitMs) {
+   if (waitMs >= 0) {
+      return mChannel->queue.Pop(bullet, waitMs);
+   }
+   while (!zctx_interrupted) {
+      if (mChannel->queue.Pop(bullet, kMaxSingleWait.count())) {
+         return true;
+      }
+   }
+   return false;
+}
+
+/**
+ * @return the most bullets that can be in flight
+ */
+size_t InprocPipe::Capacity() const {
+   return mChannel->queue.Capacity();
+}
+
+/**
+ * An eventfd that becomes readable when a bullet is pushed after ArmReadable,
+ * shared by every Vampire on the location.
+ * @return 
+ */
+int InprocPipe::GetReadableFd() const {
+   return mChannel->queue.GetReadableFd();
+}
+
+/**
+ * Clear the fd and have the next push write it. Call before going back to
+ * poll the fd, and drain again if it returns true.
+ * @return 
+ *   true if there are already bullets to pop
+ */
+bool InprocPipe::ArmReadable() {
+   return mChannel->queue.ArmReadable();
+}
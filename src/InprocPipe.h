@@ -0,0 +1,51 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "MpmcRing.h"
+
+/**
+ * In process transport for a Rifle / Vampire pair on an inproc:// location.
+ * 
+ * Every Rifle and Vampire in the process that uses the same location shares
+ * one lock-free MpmcRing, so bullets move between threads without ZeroMQ
+ * message allocation or pipes. A full or empty ring is waited on with its
+ * eventfd signals, not by spinning. Like PUSH / PULL, any number of Rifles and
+ * Vampires can share a location, each bullet is taken by a single Vampire.
+ * The queue lives as long as at least one of them is attached.
+ */
+class InprocPipe {
+public:
+   typedef MpmcRing<std::string> Queue;
+
+   static bool IsInproc(const std::string& location);
+
+   InprocPipe(const std::string& location, const size_t capacity, const bool receiver);
+   InprocPipe(const InprocPipe&) = delete;
+   InprocPipe& operator=(const InprocPipe&) = delete;
+   virtual ~InprocPipe();
+
+   bool Push(std::string& bullet, const int waitMs);
+   bool Pop(std::string& bullet, const int waitMs);
+   size_t Capacity() const;
+   int GetReadableFd() const;
+   bool ArmReadable();
+
+private:
+   struct Channel {
+      explicit Channel(const size_t capacity) : queue(capacity), receivers(0) {
+      }
+      Queue queue;
+      std::atomic<size_t> receivers;
+      // Rifles that fire before any Vampire attached wait on this
+      std::mutex attachMutex;
+      std::condition_variable attached;
+   };
+   static std::shared_ptr<Channel> Attach(const std::string& location, const size_t capacity);
+   bool WaitForReceiver(const int waitMs);
+
+   std::shared_ptr<Channel> mChannel;
+   const bool mIsReceiver;
+};
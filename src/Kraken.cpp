@@ -8,13 +8,21 @@
 #include <czmq.h>
 #include <g3log/g3log.hpp>
 #include "Kraken.h"
+#include "CZMQToolkit.h"
+#include "ContextRegistry.h"
 #include <chrono>
 
 namespace {
    const size_t kDefaultMaxChunkSize_10MB_inBytes = 10 * 1024 * 1024;
 }
 /// Constructing the server/Kraken that is about to be connected/impaled by the client/Harpoon
-Kraken::Kraken():
+Kraken::Kraken() : Kraken(std::string()) {
+}
+
+/// Kraken whose socket is created on a context shared through the ContextRegistry
+/// @param sharedContext the ContextRegistry name, empty for a private context
+/// @param affinity bit mask of the shared context's IO threads to use, 0 for any
+Kraken::Kraken(const std::string& sharedContext, const uint64_t affinity):
    mLocation(""),
    mQueueLength(1), //Number of allowed messages in queue
    mMaxChunkSize(kDefaultMaxChunkSize_10MB_inBytes), //10MB
@@ -22,10 +30,13 @@ Kraken::Kraken():
    mIdentity(nullptr),
    mTimeoutMs(300000), //5 Minutes
    mChunk(nullptr) {
-   mCtx = zctx_new();
+   mCtx = sharedContext.empty() ? zctx_new() : ContextRegistry::Instance().Acquire(sharedContext);
    CHECK(mCtx!=nullptr);
    mRouter = zsocket_new(mCtx, ZMQ_ROUTER);
    CHECK(mRouter!=nullptr);
+   if (affinity) {
+      CZMQToolkit::SetAffinity(mRouter, affinity);
+   }
 }
 
 /// Set location of the queue (TCP location)
@@ -196,7 +207,7 @@ Kraken::Battling Kraken::SendRawData(const uint8_t* data, int size) {
 Kraken::~Kraken() {
    zsocket_unbind(mRouter, mLocation.c_str());
    zsocket_destroy(mCtx, mRouter);
-   zctx_destroy(&mCtx);
+   ContextRegistry::Instance().Release(mCtx);
    mCtx = nullptr;
    FreeOldRequests();
    FreeChunk();
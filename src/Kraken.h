@@ -35,6 +35,7 @@ public:
 
 
    Kraken();
+   explicit Kraken(const std::string& sharedContext, const uint64_t affinity = 0);
    Spear SetLocation(const std::string& location);
    void MaxWaitInMs(const int timeout);
    void ChangeDefaultMaxChunkSizeInBytes(const size_t bytes);
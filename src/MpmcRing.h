@@ -0,0 +1,273 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include "SpscRing.h"
+
+/**
+ * A bounded ring that any number of producers and consumers share without a
+ * lock. Every slot carries a sequence number that tells whose turn it is, a
+ * producer or consumer claims a position with one compare and swap on the
+ * tail or head and then owns the slot until it publishes the new sequence.
+ * Values are moved in and out, so strings and other owning types work.
+ *
+ * Push and Pop block on a RingSignal once the ring is full or empty, with a
+ * timeout in milliseconds, -1 waits forever. The signal wakes one thread, so
+ * only the threads that have to sleep line up on a mutex and take turns
+ * waiting on it; pushing and popping never take the mutex. A consumer in
+ * someone else's poll loop watches GetReadableFd instead, see ArmReadable.
+ */
+template<typename T>
+class MpmcRing {
+public:
+   explicit MpmcRing(const size_t capacity);
+   MpmcRing(const MpmcRing&) = delete;
+   MpmcRing& operator=(const MpmcRing&) = delete;
+   bool IsValid() const;
+   size_t Capacity() const;
+   size_t Size() const;
+   bool Empty() const;
+   bool TryPush(T& item);
+   bool Push(T& item, const long timeoutMs);
+   bool TryPop(T& item);
+   bool Pop(T& item, const long timeoutMs);
+   int GetReadableFd() const;
+   bool ArmReadable();
+
+   static const size_t kCacheLine = 64;
+
+private:
+
+   struct Slot {
+      std::atomic<size_t> sequence;
+      T value;
+   };
+   static bool Wait(std::timed_mutex& waiters, RingSignal& signal,
+      const std::function<bool()>& ready, const long timeoutMs);
+
+   const size_t mCapacity;
+   std::unique_ptr<Slot[]> mSlots;
+   RingSignal mNotEmpty;
+   RingSignal mNotFull;
+   RingSignal mReadable;
+   std::timed_mutex mPushWaiters;
+   std::timed_mutex mPopWaiters;
+   char mPadding0[kCacheLine];
+   // claimed by consumers
+   std::atomic<size_t> mHead;
+   char mPadding1[kCacheLine];
+   // claimed by producers
+   std::atomic<size_t> mTail;
+   char mPadding2[kCacheLine];
+};
+
+template<typename T>
+const size_t MpmcRing<T>::kCacheLine;
+
+/**
+ * @param capacity
+ *   At least 2, a slot's sequence can't tell full from empty with only one
+ */
+template<typename T>
+MpmcRing<T>::MpmcRing(const size_t capacity) :
+mCapacity(std::max<size_t>(capacity, 2)),
+mSlots(new Slot[mCapacity]),
+mHead(0),
+mTail(0) {
+   for (size_t slot = 0; slot < mCapacity; ++slot) {
+      mSlots[slot].sequence.store(slot, std::memory_order_relaxed);
+   }
+}
+
+/**
+ * @return false if the signals could not be created
+ */
+template<typename T>
+bool MpmcRing<T>::IsValid() const {
+   return mNotEmpty.IsValid() && mNotFull.IsValid() && mReadable.IsValid();
+}
+
+template<typename T>
+size_t MpmcRing<T>::Capacity() const {
+   return mCapacity;
+}
+
+/**
+ * @return the items in the ring, a snapshot that may already be stale
+ */
+template<typename T>
+size_t MpmcRing<T>::Size() const {
+   const size_t head = mHead.load(std::memory_order_acquire);
+   const size_t tail = mTail.load(std::memory_order_acquire);
+   return (tail > head) ? std::min(tail - head, mCapacity) : 0;
+}
+
+/**
+ * @return if the next item to pop has not been published yet
+ */
+template<typename T>
+bool MpmcRing<T>::Empty() const {
+   const size_t head = mHead.load(std::memory_order_acquire);
+   return mSlots[head % mCapacity].sequence.load(std::memory_order_acquire) != head + 1;
+}
+
+/**
+ * Add an item without waiting.
+ * @param item
+ *   Moved from when successful
+ * @return
+ *   false if the ring is full
+ */
+template<typename T>
+bool MpmcRing<T>::TryPush(T& item) {
+   size_t tail = mTail.load(std::memory_order_relaxed);
+   Slot* slot;
+   while (true) {
+      slot = &mSlots[tail % mCapacity];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const intptr_t turn = static_cast<intptr_t> (sequence) - static_cast<intptr_t> (tail);
+      if (turn == 0) {
+         if (mTail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+            break;
+         }
+      } else if (turn < 0) {
+         // the slot still holds the item from a lap ago
+         return false;
+      } else {
+         tail = mTail.load(std::memory_order_relaxed);
+      }
+   }
+   slot->value = std::move(item);
+   slot->sequence.store(tail + 1, std::memory_order_release);
+   mNotEmpty.Notify();
+   mReadable.Notify();
+   return true;
+}
+
+/**
+ * Add an item, waiting for room.
+ * @param item
+ *   Moved from when successful
+ * @param timeoutMs
+ * @return
+ *   false if there was no room in time
+ */
+template<typename T>
+bool MpmcRing<T>::Push(T& item, const long timeoutMs) {
+   if (TryPush(item)) {
+      return true;
+   }
+   return Wait(mPushWaiters, mNotFull, [this, &item]() {
+      return TryPush(item);
+   }, timeoutMs);
+}
+
+/**
+ * Take an item without waiting.
+ * @param item
+ *   Replaced by the item when successful
+ * @return
+ *   false if the ring is empty
+ */
+template<typename T>
+bool MpmcRing<T>::TryPop(T& item) {
+   size_t head = mHead.load(std::memory_order_relaxed);
+   Slot* slot;
+   while (true) {
+      slot = &mSlots[head % mCapacity];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const intptr_t turn = static_cast<intptr_t> (sequence) - static_cast<intptr_t> (head + 1);
+      if (turn == 0) {
+         if (mHead.compare_exchange_weak(head, head + 1, std::memory_order_relaxed)) {
+            break;
+         }
+      } else if (turn < 0) {
+         // nothing published in the slot yet
+         return false;
+      } else {
+         head = mHead.load(std::memory_order_relaxed);
+      }
+   }
+   item = std::move(slot->value);
+   slot->sequence.store(head + mCapacity, std::memory_order_release);
+   mNotFull.Notify();
+   return true;
+}
+
+/**
+ * Take an item, waiting for one.
+ * @param item
+ *   Replaced by the item when successful
+ * @param timeoutMs
+ * @return
+ *   false if nothing came in time
+ */
+template<typename T>
+bool MpmcRing<T>::Pop(T& item, const long timeoutMs) {
+   if (TryPop(item)) {
+      return true;
+   }
+   return Wait(mPopWaiters, mNotEmpty, [this, &item]() {
+      return TryPop(item);
+   }, timeoutMs);
+}
+
+/**
+ * @return an eventfd that every push writes once armed, shared by all the
+ * consumers that poll it
+ */
+template<typename T>
+int MpmcRing<T>::GetReadableFd() const {
+   return mReadable.GetFd();
+}
+
+/**
+ * Clear GetReadableFd and have the next push write it. Call before going back
+ * to poll the fd, and drain again if it returns true.
+ * @return
+ *   true if there are already items to pop
+ */
+template<typename T>
+bool MpmcRing<T>::ArmReadable() {
+   mReadable.Arm();
+   return !Empty();
+}
+
+/**
+ * Take a turn on the signal, which wakes a single waiter, and wait on it
+ * until ready returns true.
+ * @param waiters
+ *   Held while waiting on the signal
+ * @param signal
+ * @param ready
+ * @param timeoutMs
+ *   Covers the wait for a turn too
+ * @return
+ *   false if ready did not return true in time
+ */
+template<typename T>
+bool MpmcRing<T>::Wait(std::timed_mutex& waiters, RingSignal& signal,
+   const std::function<bool()>& ready, const long timeoutMs) {
+   using namespace std::chrono;
+   if (timeoutMs == 0) {
+      return ready();
+   }
+   const steady_clock::time_point deadline = steady_clock::now() + milliseconds(std::max(timeoutMs, 0L));
+   std::unique_lock<std::timed_mutex> turn(waiters, std::defer_lock);
+   if (timeoutMs < 0) {
+      turn.lock();
+   } else if (!turn.try_lock_until(deadline)) {
+      return ready();
+   }
+   long left = -1;
+   if (timeoutMs >= 0) {
+      left = std::max(0L, static_cast<long> (duration_cast<milliseconds>(deadline - steady_clock::now()).count()));
+   }
+   return signal.Wait(ready, left);
+}
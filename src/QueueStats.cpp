@@ -0,0 +1,97 @@
+#include "QueueStats.h"
+#include <sstream>
+
+const size_t QueueStatsSnapshot::kLatencyBuckets;
+
+/**
+ * @return the number of calls recorded in the latency histogram
+ */
+uint64_t QueueStatsSnapshot::Calls() const {
+   uint64_t calls = 0;
+   for (auto count : latencyUs) {
+      calls += count;
+   }
+   return calls;
+}
+
+/**
+ * @return the share of spinning receives that found a message before
+ * falling back to a blocking poll, 0 when nothing spun
+ */
+double QueueStatsSnapshot::SpinHitRate() const {
+   const uint64_t spins = spinHits + spinMisses;
+   if (spins == 0) {
+      return 0;
+   }
+   return static_cast<double> (spinHits) / spins;
+}
+
+/**
+ * @param bucket
+ * @return the exclusive upper bound, in microseconds, of a latency bucket.
+ * Bucket 0 is under 1us, bucket i is [2^(i-1), 2^i) and the last bucket
+ * takes everything above.
+ */
+uint64_t QueueStatsSnapshot::BucketCeilingUs(const size_t bucket) {
+   return uint64_t(1) << bucket;
+}
+
+/**
+ * @return the counters and the non empty latency buckets on one line
+ */
+std::string QueueStatsSnapshot::ToString() const {
+   std::ostringstream out;
+   out << "messages: " << messages << ", bytes: " << bytes << ", poll timeouts: "
+           << pollTimeouts << ", hwm stalls: " << highWaterStalls << ", errors: " << errors
+           << ", drops: " << drops << ", spills: " << spills << ", spin hits: " << spinHits << ", spin misses: "
+           << spinMisses << ", latency:";
+   for (size_t bucket = 0; bucket < kLatencyBuckets; ++bucket) {
+      if (latencyUs[bucket] != 0) {
+         out << " <" << BucketCeilingUs(bucket) << "us: " << latencyUs[bucket];
+      }
+   }
+   return out.str();
+}
+
+QueueStats::QueueStats() : mMessages(0), mBytes(0), mPollTimeouts(0),
+mHighWaterStalls(0), mErrors(0), mDrops(0), mSpills(0), mSpinHits(0), mSpinMisses(0) {
+   for (auto& bucket : mLatencyUs) {
+      bucket.store(0, std::memory_order_relaxed);
+   }
+}
+
+/**
+ * Add a call that started at start and ended now to the histogram
+ * @param start
+ */
+void QueueStats::Latency(const Clock::time_point& start) {
+   uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+   size_t bucket = 0;
+   while (us != 0 && bucket < QueueStatsSnapshot::kLatencyBuckets - 1) {
+      us >>= 1;
+      ++bucket;
+   }
+   mLatencyUs[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Copy the counters, each is read atomically but they are not read as
+ * a group, so they may be a few calls apart under load.
+ * @return 
+ */
+QueueStatsSnapshot QueueStats::Snapshot() const {
+   QueueStatsSnapshot snapshot;
+   snapshot.messages = mMessages.load(std::memory_order_relaxed);
+   snapshot.bytes = mBytes.load(std::memory_order_relaxed);
+   snapshot.pollTimeouts = mPollTimeouts.load(std::memory_order_relaxed);
+   snapshot.highWaterStalls = mHighWaterStalls.load(std::memory_order_relaxed);
+   snapshot.errors = mErrors.load(std::memory_order_relaxed);
+   snapshot.drops = mDrops.load(std::memory_order_relaxed);
+   snapshot.spills = mSpills.load(std::memory_order_relaxed);
+   snapshot.spinHits = mSpinHits.load(std::memory_order_relaxed);
+   snapshot.spinMisses = mSpinMisses.load(std::memory_order_relaxed);
+   for (size_t bucket = 0; bucket < QueueStatsSnapshot::kLatencyBuckets; ++bucket) {
+      snapshot.latencyUs[bucket] = mLatencyUs[bucket].load(std::memory_order_relaxed);
+   }
+   return snapshot;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * A copy of the counters of a Rifle or Vampire at one point in time.
+ */
+struct QueueStatsSnapshot {
+   static const size_t kLatencyBuckets = 32;
+
+   QueueStatsSnapshot() : messages(0), bytes(0), pollTimeouts(0), highWaterStalls(0), errors(0),
+   drops(0), spills(0), spinHits(0), spinMisses(0) {
+      latencyUs.fill(0);
+   }
+   uint64_t Calls() const;
+   double SpinHitRate() const;
+   static uint64_t BucketCeilingUs(const size_t bucket);
+   std::string ToString() const;
+
+   uint64_t messages;
+   uint64_t bytes;
+   // nothing could be sent / received within the wait
+   uint64_t pollTimeouts;
+   // a send found the pipe full after the poll, the peer is not keeping up
+   uint64_t highWaterStalls;
+   // socket errors and invalid messages
+   uint64_t errors;
+   // messages thrown away by an overflow policy
+   uint64_t drops;
+   // messages written to a spill log because the pipe was full
+   uint64_t spills;
+   // receives that spun, and whether a message came before the spin window ran out
+   uint64_t spinHits;
+   uint64_t spinMisses;
+   // calls by how long they took, bucket i holds calls under BucketCeilingUs(i)
+   std::array<uint64_t, kLatencyBuckets> latencyUs;
+};
+
+/**
+ * Always on counters for a Rifle or Vampire. Updates are relaxed atomic
+ * increments so the queue's own thread never blocks, and Snapshot can be
+ * called from any thread.
+ */
+class QueueStats {
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   QueueStats();
+   QueueStats(const QueueStats&) = delete;
+   QueueStats& operator=(const QueueStats&) = delete;
+
+   void Message(const size_t bytes, const uint64_t count = 1) {
+      mMessages.fetch_add(count, std::memory_order_relaxed);
+      mBytes.fetch_add(bytes, std::memory_order_relaxed);
+   }
+
+   void PollTimeout() {
+      mPollTimeouts.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void HighWaterStall() {
+      mHighWaterStalls.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void Error() {
+      mErrors.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void Drop() {
+      mDrops.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void Spill() {
+      mSpills.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void SpinHit() {
+      mSpinHits.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void SpinMiss() {
+      mSpinMisses.fetch_add(1, std::memory_order_relaxed);
+   }
+
+   void Latency(const Clock::time_point& start);
+   QueueStatsSnapshot Snapshot() const;
+
+   /**
+    * Records the latency of a call when it goes out of scope.
+    */
+   class Timer {
+   public:
+
+      explicit Timer(QueueStats& stats) : mStats(stats), mStart(Clock::now()) {
+      }
+
+      ~Timer() {
+         mStats.Latency(mStart);
+      }
+   private:
+      QueueStats& mStats;
+      const Clock::time_point mStart;
+   };
+
+private:
+   std::atomic<uint64_t> mMessages;
+   std::atomic<uint64_t> mBytes;
+   std::atomic<uint64_t> mPollTimeouts;
+   std::atomic<uint64_t> mHighWaterStalls;
+   std::atomic<uint64_t> mErrors;
+   std::atomic<uint64_t> mDrops;
+   std::atomic<uint64_t> mSpills;
+   std::atomic<uint64_t> mSpinHits;
+   std::atomic<uint64_t> mSpinMisses;
+   std::array<std::atomic<uint64_t>, QueueStatsSnapshot::kLatencyBuckets> mLatencyUs;
+};
@@ -0,0 +1,241 @@
+#include "Reactor.h"
+#include <algorithm>
+#include <czmq.h>
+#include <g3log/g3log.hpp>
+#include "Vampire.h"
+#include "Alien.h"
+#include "Headcrab.h"
+
+namespace {
+   // how often an idle thread looks for Stop
+   const int kPollTimeoutMs = 100;
+}
+
+/**
+ * A reactor that is not yet running.
+ * @param threads
+ *   Threads to serve the queues with, queues are dealt out round robin
+ * @param batchSize
+ *   Most messages taken from one queue before the others get a turn
+ */
+Reactor::Reactor(const size_t threads, const size_t batchSize) :
+mBatchSize(std::max<size_t>(batchSize, 1)),
+mRegistrations(std::max<size_t>(threads, 1)),
+mQueueCount(0),
+mStop(false),
+mDispatched(0) {
+}
+
+/**
+ * Serve a Vampire, its bullets are handed over in batches. A batch frame
+ * from Rifle::FireBatched that holds more than a batch is unpacked off the
+ * socket, what is left of it is handed over on the next turns.
+ * @param vampire
+ *   Already prepared to be shot, with the inproc fast path off as there is
+ * no socket to poll on it
+ * @param handler
+ * @return
+ *   false if the vampire has no socket or the reactor is running
+ */
+bool Reactor::Add(Vampire& vampire, ShotsHandler handler) {
+   const size_t batchSize = mBatchSize;
+   return Add(vampire.GetSocket(), [&vampire, handler, batchSize]() {
+      thread_local std::vector<std::string> wounds;
+      size_t count = vampire.GetShots(wounds, batchSize, 0);
+      if (count != 0) {
+         handler(wounds, count);
+      }
+      return count;
+   }, [&vampire]() {
+      return vampire.IsReadable();
+   });
+}
+
+/**
+ * Serve an Alien, each published message is handed over on its own.
+ * @param alien
+ *   Already prepared to be shot
+ * @param handler
+ * @return
+ *   false if the reactor is running
+ */
+bool Reactor::Add(Alien& alien, BulletsHandler handler) {
+   const size_t batchSize = mBatchSize;
+   return Add(alien.GetSocket(), [&alien, handler, batchSize]() {
+      thread_local std::vector<std::string> bullets;
+      size_t count = 0;
+      for (; count < batchSize; ++count) {
+         alien.GetShot(0, bullets);
+         if (bullets.empty()) {
+            break;
+         }
+         handler(bullets);
+      }
+      return count;
+   });
+}
+
+/**
+ * Serve a Headcrab, each request is answered with what the handler puts in
+ * the splatter. An empty reply is sent if it puts nothing there, a Headcrab
+ * has to answer before it can take the next request.
+ * @param headcrab
+ *   Already come to life
+ * @param handler
+ * @return
+ *   false if the headcrab is not alive or the reactor is running
+ */
+bool Reactor::Add(Headcrab& headcrab, HitsHandler handler) {
+   const size_t batchSize = mBatchSize;
+   return Add(headcrab.GetSocket(), [&headcrab, handler, batchSize]() {
+      thread_local std::vector<std::string> hits;
+      thread_local std::vector<std::string> splatter;
+      size_t count = 0;
+      for (; count < batchSize && headcrab.GetHitWait(hits, 0); ++count) {
+         splatter.clear();
+         handler(hits, splatter);
+         if (splatter.empty()) {
+            splatter.emplace_back();
+         }
+         if (!headcrab.SendSplatter(splatter)) {
+            LOG(WARNING) << "Reactor could not answer " << headcrab.GetBinding();
+         }
+      }
+      return count;
+   });
+}
+
+/**
+ * Give a socket to the next thread, round robin.
+ * @param socket
+ * @param drain
+ * @param buffered
+ *   For queues that read ahead of the socket, checked after a drain
+ * @return
+ */
+bool Reactor::Add(void* socket, std::function<size_t()> drain, std::function<bool()> buffered) {
+   if (!socket) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return false;
+   }
+   std::lock_guard<std::mutex> lock(mMutex);
+   if (!mThreads.empty()) {
+      LOG(WARNING) << "Reactor is running, queues can only be added while it is stopped";
+      return false;
+   }
+   mRegistrations[mQueueCount % mRegistrations.size()].push_back({socket, std::move(drain), std::move(buffered)});
+   ++mQueueCount;
+   return true;
+}
+
+/**
+ * Start a thread per poll set.
+ * @return
+ *   false if already running
+ */
+bool Reactor::Start() {
+   std::lock_guard<std::mutex> lock(mMutex);
+   if (!mThreads.empty()) {
+      return false;
+   }
+   mStop.store(false);
+   for (size_t thread = 0; thread < mRegistrations.size(); ++thread) {
+      mThreads.emplace_back(&Reactor::Run, this, thread);
+   }
+   return true;
+}
+
+/**
+ * Stop and join the threads, the queues can be used directly again after.
+ */
+void Reactor::Stop() {
+   std::lock_guard<std::mutex> lock(mMutex);
+   mStop.store(true);
+   for (auto& thread : mThreads) {
+      thread.join();
+   }
+   mThreads.clear();
+}
+
+/**
+ * @return if the threads are started
+ */
+bool Reactor::IsRunning() const {
+   std::lock_guard<std::mutex> lock(mMutex);
+   return !mThreads.empty();
+}
+
+/**
+ * @return the number of threads serving the queues
+ */
+size_t Reactor::GetThreadCount() const {
+   return mRegistrations.size();
+}
+
+/**
+ * @return the number of queues registered
+ */
+size_t Reactor::GetQueueCount() const {
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mQueueCount;
+}
+
+/**
+ * @return the number of messages handed to callbacks so far
+ */
+uint64_t Reactor::GetDispatched() const {
+   return mDispatched.load(std::memory_order_relaxed);
+}
+
+/**
+ * Poll one thread's queues until stopped.
+ * @param thread
+ */
+void Reactor::Run(const size_t thread) {
+   std::vector<Registration>& registrations = mRegistrations[thread];
+   if (registrations.empty()) {
+      return;
+   }
+   std::vector<zmq_pollitem_t> items;
+   for (const auto& registration : registrations) {
+      items.push_back({registration.socket, 0, ZMQ_POLLIN, 0});
+   }
+   // a queue left messages the socket no longer shows, don't sleep on it
+   bool backlog = false;
+   while (!mStop.load() && !zctx_interrupted) {
+      int pollResult = zmq_poll(items.data(), items.size(), backlog ? 0 : kPollTimeoutMs);
+      if (pollResult < 0) {
+         int err = zmq_errno();
+         if (err == ETERM) {
+            LOG(INFO) << "Reactor context terminated";
+            return;
+         }
+         if (err != EINTR) {
+            LOG(WARNING) << "Reactor error in zmq_poll: " << zmq_strerror(err);
+         }
+         continue;
+      }
+      const bool lookAtBuffered = backlog;
+      backlog = false;
+      for (size_t i = 0; i < items.size(); ++i) {
+         const Registration& registration = registrations[i];
+         bool ready = (items[i].revents & ZMQ_POLLIN);
+         if (!ready && lookAtBuffered && registration.buffered) {
+            ready = registration.buffered();
+         }
+         if (ready) {
+            mDispatched.fetch_add(registration.drain(), std::memory_order_relaxed);
+            if (registration.buffered && registration.buffered()) {
+               backlog = true;
+            }
+         }
+      }
+   }
+}
+
+/**
+ * Stop serving, the queues themselves are not touched.
+ */
+Reactor::~Reactor() {
+   Stop();
+}
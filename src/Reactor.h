@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Vampire;
+class Alien;
+class Headcrab;
+
+/**
+ * Serves many Vampires, Aliens and Headcrabs from a few threads instead of
+ * one thread per queue. Each registered queue is given to one of the
+ * reactor's threads, which waits on all of its queues with a single zmq_poll
+ * and, when one is readable, drains up to a batch of messages into its
+ * callback before polling again.
+ *
+ * Queues are registered while the reactor is stopped, their sockets then
+ * belong to the reactor thread until Stop. Callbacks run on that thread and
+ * should not block, every other queue of the thread waits for them.
+ */
+class Reactor {
+public:
+   /// Handed the first count slots of a reused vector, as Vampire::GetShots
+   typedef std::function<void(std::vector<std::string>& wounds, const size_t count)> ShotsHandler;
+   /// Handed the frames of one published message, as Alien::GetShot
+   typedef std::function<void(std::vector<std::string>& bullets)> BulletsHandler;
+   /// Handed one request, fills in the reply that is sent back
+   typedef std::function<void(std::vector<std::string>& hits, std::vector<std::string>& splatter)> HitsHandler;
+
+   explicit Reactor(const size_t threads = 1, const size_t batchSize = 128);
+   Reactor(const Reactor&) = delete;
+   Reactor& operator=(const Reactor&) = delete;
+
+   bool Add(Vampire& vampire, ShotsHandler handler);
+   bool Add(Alien& alien, BulletsHandler handler);
+   bool Add(Headcrab& headcrab, HitsHandler handler);
+   bool Start();
+   void Stop();
+   bool IsRunning() const;
+   size_t GetThreadCount() const;
+   size_t GetQueueCount() const;
+   uint64_t GetDispatched() const;
+   virtual ~Reactor();
+
+private:
+
+   struct Registration {
+      void* socket;
+      // receive without waiting and call the handler, returns the messages handled
+      std::function<size_t()> drain;
+      // if set, tells if messages were left behind where polling can't see them
+      std::function<bool()> buffered;
+   };
+   bool Add(void* socket, std::function<size_t()> drain, std::function<bool()> buffered = nullptr);
+   void Run(const size_t thread);
+
+   const size_t mBatchSize;
+   std::vector<std::vector<Registration> > mRegistrations;
+   std::vector<std::thread> mThreads;
+   mutable std::mutex mMutex;
+   size_t mQueueCount;
+   std::atomic<bool> mStop;
+   std::atomic<uint64_t> mDispatched;
+};
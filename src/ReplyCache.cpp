@@ -0,0 +1,241 @@
+#include "ReplyCache.h"
+#include <algorithm>
+#include <cstring>
+
+const ReplyCache::Index ReplyCache::kNone;
+
+namespace {
+   // holes smaller than this are not worth a compaction
+   const size_t kMinimumCompaction = 64 * 1024;
+}
+
+/**
+ * An empty cache
+ * @param maxEntries
+ *   Most replies kept
+ * @param maxBytes
+ *   Most bytes of replies kept
+ */
+ReplyCache::ReplyCache(const size_t maxEntries, const size_t maxBytes) :
+mMaxEntries(maxEntries),
+mMaxBytes(maxBytes),
+mOldest(kNone),
+mNewest(kNone),
+mBytes(0),
+mEvictedEntries(0),
+mEvictedBytes(0) {
+}
+
+/**
+ * Change the budget, the oldest replies are evicted if they no longer fit
+ * @param maxEntries
+ * @param maxBytes
+ */
+void ReplyCache::SetLimits(const size_t maxEntries, const size_t maxBytes) {
+   mMaxEntries = maxEntries;
+   mMaxBytes = maxBytes;
+   EvictFor(0, 0);
+}
+
+size_t ReplyCache::GetMaxEntries() const {
+   return mMaxEntries;
+}
+
+size_t ReplyCache::GetMaxBytes() const {
+   return mMaxBytes;
+}
+
+/**
+ * Keep a reply, evicting the oldest ones until it fits
+ * @param key
+ *   A reply already kept under it is replaced
+ * @param reply
+ * @return
+ *   false if the reply is over the budget on its own, it is counted as
+ * evicted then
+ */
+bool ReplyCache::Put(const Key& key, const std::string& reply) {
+   Erase(key);
+   if (reply.size() > mMaxBytes || mMaxEntries == 0) {
+      ++mEvictedEntries;
+      mEvictedBytes += reply.size();
+      return false;
+   }
+   EvictFor(1, reply.size());
+   Index entry;
+   if (mFree.empty()) {
+      entry = static_cast<Index> (mEntries.size());
+      mEntries.emplace_back();
+   } else {
+      entry = mFree.back();
+      mFree.pop_back();
+   }
+   Entry& added = mEntries[entry];
+   added.key = key;
+   added.offset = mArena.size();
+   added.size = reply.size();
+   added.older = mNewest;
+   added.newer = kNone;
+   mArena.insert(mArena.end(), reply.begin(), reply.end());
+   if (mNewest != kNone) {
+      mEntries[mNewest].newer = entry;
+   } else {
+      mOldest = entry;
+   }
+   mNewest = entry;
+   mIndex[key] = entry;
+   mBytes += reply.size();
+   return true;
+}
+
+/**
+ * Hand over a reply and forget it
+ * @param key
+ * @param reply
+ * @return
+ *   false if there is no reply for the key
+ */
+bool ReplyCache::Take(const Key& key, std::string& reply) {
+   const Index* entry = mIndex.Find(key);
+   if (entry == nullptr) {
+      return false;
+   }
+   const Entry& taken = mEntries[*entry];
+   reply.assign(mArena.data() + taken.offset, taken.size);
+   Remove(*entry);
+   return true;
+}
+
+/**
+ * @param key
+ * @return if a reply is kept for the key
+ */
+bool ReplyCache::Contains(const Key& key) const {
+   return mIndex.Find(key) != nullptr;
+}
+
+/**
+ * Forget a reply without reading it
+ * @param key
+ * @return
+ *   false if there is no reply for the key
+ */
+bool ReplyCache::Erase(const Key& key) {
+   const Index* entry = mIndex.Find(key);
+   if (entry == nullptr) {
+      return false;
+   }
+   Remove(*entry);
+   return true;
+}
+
+/**
+ * @return the replies kept
+ */
+size_t ReplyCache::Size() const {
+   return mIndex.Size();
+}
+
+/**
+ * @return the bytes of the replies kept, without the holes in the arena
+ */
+size_t ReplyCache::Bytes() const {
+   return mBytes;
+}
+
+bool ReplyCache::Empty() const {
+   return mIndex.Empty();
+}
+
+/**
+ * Forget every reply and give back the memory, this is not an eviction.
+ */
+void ReplyCache::Clear() {
+   mIndex.Clear();
+   std::vector<Entry>().swap(mEntries);
+   std::vector<Index>().swap(mFree);
+   std::vector<char>().swap(mArena);
+   mOldest = kNone;
+   mNewest = kNone;
+   mBytes = 0;
+}
+
+/**
+ * @return the replies dropped to stay in the budget, so far
+ */
+uint64_t ReplyCache::GetEvictedEntries() const {
+   return mEvictedEntries;
+}
+
+/**
+ * @return the bytes of the replies dropped to stay in the budget, so far
+ */
+uint64_t ReplyCache::GetEvictedBytes() const {
+   return mEvictedBytes;
+}
+
+/**
+ * Unlink an entry and leave its bytes as a hole
+ * @param entry
+ */
+void ReplyCache::Remove(const Index entry) {
+   Entry& removed = mEntries[entry];
+   mIndex.Erase(removed.key);
+   if (removed.older != kNone) {
+      mEntries[removed.older].newer = removed.newer;
+   } else {
+      mOldest = removed.newer;
+   }
+   if (removed.newer != kNone) {
+      mEntries[removed.newer].older = removed.older;
+   } else {
+      mNewest = removed.older;
+   }
+   mBytes -= removed.size;
+   mFree.push_back(entry);
+   if (mIndex.Empty()) {
+      // nothing left to move, start over without giving the memory back
+      mArena.clear();
+      mEntries.clear();
+      mFree.clear();
+   } else if (mArena.size() - mBytes > std::max(mBytes, kMinimumCompaction)) {
+      Compact();
+   }
+}
+
+/**
+ * Evict the oldest replies until there is room
+ * @param entries
+ *   Replies about to be added
+ * @param bytes
+ *   Their size
+ */
+void ReplyCache::EvictFor(const size_t entries, const size_t bytes) {
+   while (mOldest != kNone && (mIndex.Size() + entries > mMaxEntries || mBytes + bytes > mMaxBytes)) {
+      ++mEvictedEntries;
+      mEvictedBytes += mEntries[mOldest].size;
+      Remove(mOldest);
+   }
+}
+
+/**
+ * Move the replies to the front of the arena over the holes. Replies are
+ * appended as they come and never move ahead of a newer one, so going from
+ * the oldest to the newest only ever moves bytes forward.
+ */
+void ReplyCache::Compact() {
+   size_t offset = 0;
+   for (Index entry = mOldest; entry != kNone; entry = mEntries[entry].newer) {
+      Entry& moved = mEntries[entry];
+      if (moved.offset != offset && moved.size != 0) {
+         memmove(mArena.data() + offset, mArena.data() + moved.offset, moved.size);
+      }
+      moved.offset = offset;
+      offset += moved.size;
+   }
+   mArena.resize(offset);
+   // a burst is over, don't hold on to memory for it
+   if (mArena.capacity() > 2 * offset + kMinimumCompaction) {
+      std::vector<char>(mArena).swap(mArena);
+   }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/uuid/uuid.hpp>
+#include "UuidMap.h"
+
+/**
+ * The replies a BoomStick read while looking for another one, kept within a
+ * budget of entries and bytes. The bytes of all replies are appended to one
+ * arena instead of a string each, and a reply that is taken or evicted only
+ * leaves a hole until the holes outweigh the live replies, then the arena is
+ * compacted in one pass.
+ *
+ * Replies are read once, so the least recently used is the oldest one kept,
+ * and that is evicted first when a new reply does not fit. Not thread safe.
+ */
+class ReplyCache {
+public:
+   typedef boost::uuids::uuid Key;
+
+   ReplyCache(const size_t maxEntries, const size_t maxBytes);
+   void SetLimits(const size_t maxEntries, const size_t maxBytes);
+   size_t GetMaxEntries() const;
+   size_t GetMaxBytes() const;
+   bool Put(const Key& key, const std::string& reply);
+   bool Take(const Key& key, std::string& reply);
+   bool Contains(const Key& key) const;
+   bool Erase(const Key& key);
+   size_t Size() const;
+   size_t Bytes() const;
+   bool Empty() const;
+   void Clear();
+   uint64_t GetEvictedEntries() const;
+   uint64_t GetEvictedBytes() const;
+   template<typename Visitor>
+   void ForEach(Visitor visitor) const;
+
+private:
+   typedef uint32_t Index;
+   static const Index kNone = UINT32_MAX;
+
+   struct Entry {
+      Key key;
+      size_t offset;
+      size_t size;
+      Index older;
+      Index newer;
+   };
+   void Remove(const Index entry);
+   void EvictFor(const size_t entries, const size_t bytes);
+   void Compact();
+
+   size_t mMaxEntries;
+   size_t mMaxBytes;
+   UuidMap<Index> mIndex;
+   std::vector<Entry> mEntries;
+   std::vector<Index> mFree;
+   Index mOldest;
+   Index mNewest;
+   std::vector<char> mArena;
+   size_t mBytes;
+   uint64_t mEvictedEntries;
+   uint64_t mEvictedBytes;
+};
+
+/**
+ * Call visitor(const Key&) for every reply kept, oldest first.
+ */
+template<typename Visitor>
+void ReplyCache::ForEach(Visitor visitor) const {
+   for (Index entry = mOldest; entry != kNone; entry = mEntries[entry].newer) {
+      visitor(mEntries[entry].key);
+   }
+}
@@ -1,10 +1,29 @@
 #define _OPEN_SYS
 #include <sys/stat.h>
+#include <cstring>
+#include <algorithm>
 
 #include "Rifle.h"
 #include "czmq.h"
 #include "g3log/g3log.hpp"
 #include "Death.h"
+#include "ContextRegistry.h"
+#include "InprocPipe.h"
+#include "ShotBatch.h"
+#include "SpillLog.h"
+
+namespace {
+   // Most bullets the async sender hands to FireBurst at once
+   const size_t kAsyncBatchSize = 128;
+   const std::chrono::milliseconds kAsyncIdleWait(100);
+   // How often FireAsync blocked on a full queue looks for StopAsync
+   const long kAsyncStopCheckMs = 10;
+   // How long the spill replayer and the batch flusher back off while the
+   // pipe is full
+   const std::chrono::milliseconds kRetryWait(1);
+   // Bullets sent as is after one did not compress before trying again
+   const size_t kCompressionBypass = 100;
+}
 /**
  * Construct our Rifle which is a push in our ZMQ push pull.
  */
@@ -15,7 +34,24 @@ mChamber(NULL),
 mContext(NULL),
 mLinger(10),
 mIOThredCount(1),
-mOwnSocket(true) {
+mOwnSocket(true),
+mAffinity(0),
+mInprocFastPath(false),
+mAsyncStop(true),
+mAsyncCallers(0),
+mOverflow(Overflow::BLOCK),
+mAsyncWait(10000),
+mSpillStop(false),
+mCompressionLevel(0),
+mCompressionMinimum(0),
+mCompressionBypass(0),
+mCompressedCount(0),
+mBatchBytes(0),
+mBatchDelay(0),
+mBatchCount(0),
+mBatchPayload(0),
+mBatchFlushing(false),
+mBatchStop(false) {
 }
 
 /**
@@ -74,25 +110,72 @@ bool Rifle::GetOwnSocket() {
    return mOwnSocket;
 }
 
+/**
+ * Create our socket on a context shared with other queues of the same name
+ * instead of a private one. This must be called before Aim.
+ * @param name
+ *   The ContextRegistry name, empty for a private context
+ * @param affinity
+ *   Bit mask of the shared context's IO threads to use, 0 for any
+ */
+void Rifle::SetSharedContext(const std::string& name, const uint64_t affinity) {
+   mContextName = name;
+   mAffinity = affinity;
+}
+
+/**
+ * Move bullets for an inproc:// location through an in process queue
+ * instead of ZeroMQ, off by default. The Rifle then has no ZeroMQ socket
+ * and plain ZeroMQ peers can't reach it. Every Rifle and Vampire on the
+ * location must agree. This must be called before Aim.
+ * @param fastPath
+ */
+void Rifle::SetInprocFastPath(const bool fastPath) {
+   mInprocFastPath = fastPath;
+}
+
+/**
+ * Get if the inproc fast path is used.
+ * @return bool
+ */
+bool Rifle::GetInprocFastPath() {
+   return mInprocFastPath;
+}
+
 /**
  * Set the location we want to shoot at.
  * @param location
  * @return 
  */
 bool Rifle::Aim() {
-   if (mChamber) {
+   if (mChamber || mInproc) {
+      return true;
+   }
+   if (GetInprocFastPath() && InprocPipe::IsInproc(mLocation)) {
+      mInproc.reset(new InprocPipe(mLocation, GetHighWater(), false));
       return true;
    }
    if (!mContext) {
-      mContext = zctx_new();
+      if (mContextName.empty()) {
+         mContext = zctx_new();
+         zctx_set_iothreads(mContext, mIOThredCount);
+      } else {
+         mContext = ContextRegistry::Instance().Acquire(mContextName);
+         if (!mContext) {
+            LOG(WARNING) << "Rifle can't get shared context : " << mContextName;
+            return false;
+         }
+      }
       zctx_set_sndhwm(mContext, GetHighWater());
       zctx_set_rcvhwm(mContext, GetHighWater());
       //zctx_set_linger(mContext, mLinger); // linger for a millisecond on close
-      zctx_set_iothreads(mContext, mIOThredCount);
    }
    if (!mChamber) {
       mChamber = zsocket_new(mContext, ZMQ_PUSH);
       CZMQToolkit::setHWMAndBuffer(mChamber, GetHighWater());
+      if (mAffinity) {
+         CZMQToolkit::SetAffinity(mChamber, mAffinity);
+      }
       if (GetOwnSocket()) {
          int result = zsocket_bind(mChamber, mLocation.c_str());
 
@@ -148,12 +231,33 @@ void Rifle::setIpcFilePermissions() {
  * @return 
  */
 bool Rifle::Fire(const std::string& bullet, const int waitToFire) {
+   QueueStats::Timer timer(mStats);
    //LOG(DEBUG) << "RifleFire";
+   if (mInproc) {
+      std::string copy(bullet);
+      return FireInproc(copy, waitToFire);
+   }
+   if (mSpill && !bullet.empty()) {
+      return FireOrSpill(bullet.data(), bullet.size());
+   }
+   std::unique_lock<std::mutex> chamber;
+   LockChamber(chamber);
+   return FireCopy(bullet.data(), bullet.size(), waitToFire);
+}
+
+/**
+ * Send a copy of the data as one bullet, compressed when that is on.
+ * @param data
+ * @param size
+ * @param waitToFire in milliseconds
+ * @return 
+ */
+bool Rifle::FireCopy(const void* data, const size_t size, const int waitToFire) {
    if (!mChamber) {
       LOG(WARNING) << "Socket uninitialized!";
       return false;
    }
-   if (bullet.empty()) {
+   if (size == 0) {
       LOG(WARNING) << "Tried to send empty packet";
       return false;
    }
@@ -163,19 +267,254 @@ bool Rifle::Fire(const std::string& bullet, const int waitToFire) {
 
    if (zmq_poll(items, 1, waitToFire) > 0) {
       if (items[0].revents & ZMQ_POLLOUT) {
+         if (Compress(data, size)) {
+            return FireCompressed(size);
+         }
          zmsg_t* message = zmsg_new();
-         zmsg_addmem(message, &(bullet[0]), bullet.size());
-         return CZMQToolkit::SendExistingMessage(message, mChamber);
+         zmsg_addmem(message, data, size);
+         return CountSend(CZMQToolkit::SendExistingMessage(message, mChamber), size);
       } else {
          LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
+         mStats.Error();
          return false;
       }
    } else {
       //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+      mStats.PollTimeout();
       return false;
    }
 }
 
+/**
+ * Shoot a bullet / message to the Vampires / pull, taking over the buffer
+ * instead of copying it.
+ *
+ * @param bullet
+ *   Moved from, the buffer is released by ZeroMQ once it has been sent. When
+ * the bullet was not sent it is left as it was, so it can be fired again.
+ * @param waitToFire in milliseconds
+ * @return 
+ */
+bool Rifle::Fire(std::string&& bullet, const int waitToFire) {
+   QueueStats::Timer timer(mStats);
+   if (mInproc) {
+      return FireInproc(bullet, waitToFire);
+   }
+   if (mSpill && !bullet.empty()) {
+      return FireOrSpill(bullet.data(), bullet.size());
+   }
+   std::unique_lock<std::mutex> chamber;
+   LockChamber(chamber);
+   return FireOwned(std::move(bullet), waitToFire);
+}
+
+/**
+ * Shoot a binary bullet / message to the Vampires / pull, taking over the 
+ * buffer instead of copying it.
+ *
+ * @param bullet
+ *   Moved from, the buffer is released by ZeroMQ once it has been sent. When
+ * the bullet was not sent it is left as it was, so it can be fired again.
+ * @param waitToFire in milliseconds
+ * @return 
+ */
+bool Rifle::Fire(std::vector<uint8_t>&& bullet, const int waitToFire) {
+   QueueStats::Timer timer(mStats);
+   if (mInproc) {
+      std::string copy(bullet.begin(), bullet.end());
+      if (!FireInproc(copy, waitToFire)) {
+         return false;
+      }
+      std::vector<uint8_t>().swap(bullet);
+      return true;
+   }
+   if (mSpill && !bullet.empty()) {
+      return FireOrSpill(bullet.data(), bullet.size());
+   }
+   std::unique_lock<std::mutex> chamber;
+   LockChamber(chamber);
+   return FireOwned(std::move(bullet), waitToFire);
+}
+
+/**
+ * Zero copy send of a container the caller has given up. The pipe is polled
+ * before ZeroMQ is given the buffer, and if the send still fails the buffer is
+ * handed back, so the caller keeps the bullet whenever false is returned.
+ */
+template<typename Container>
+bool Rifle::FireOwned(Container&& bullet, const int waitToFire) {
+   if (!mChamber) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return false;
+   }
+   if (bullet.empty()) {
+      LOG(WARNING) << "Tried to send empty packet";
+      return false;
+   }
+   zmq_pollitem_t items [] = {
+      { mChamber, 0, ZMQ_POLLOUT, 0}
+   };
+
+   if (zmq_poll(items, 1, waitToFire) > 0) {
+      if (items[0].revents & ZMQ_POLLOUT) {
+         const size_t size = bullet.size() * sizeof (bullet[0]);
+         if (Compress(&bullet[0], size)) {
+            if (!FireCompressed(size)) {
+               return false;
+            }
+            // released as if ZeroMQ had taken it
+            Container().swap(bullet);
+            return true;
+         }
+         if (!CZMQToolkit::SendTakingOwnership(bullet, mChamber, ZMQ_DONTWAIT)) {
+            int err = zmq_errno();
+            LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(err);
+            CountSendError(err);
+            return false;
+         }
+         mStats.Message(size);
+         return true;
+      } else {
+         LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
+         mStats.Error();
+         return false;
+      }
+   } else {
+      //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+      mStats.PollTimeout();
+      return false;
+   }
+}
+
+/**
+ * Shoot a burst of bullets / messages to the Vampires / pull.
+ * 
+ * A single poll is made for the whole burst, after which as many bullets as
+ * the pipe will accept are sent without waiting. 
+ *
+ * @param bullets
+ *
+ * @param waitToFire in milliseconds, applies to the single poll only
+ *
+ * @return the number of bullets, from the front of the vector, that were sent.
+ *   The caller should retry the remainder. Empty bullets can't be sent, they
+ *   are skipped and counted as an error and as sent, so retrying the remainder
+ *   never gets stuck on one. When spilling, the ones the pipe did not take are
+ *   spilled and count as sent.
+ */
+size_t Rifle::FireBurst(const std::vector<std::string>& bullets, const int waitToFire) {
+   QueueStats::Timer timer(mStats);
+   if (mInproc) {
+      size_t fired = 0;
+      bool waited = false;
+      for (const auto& bullet : bullets) {
+         if (bullet.empty()) {
+            SkipBlank();
+            ++fired;
+            continue;
+         }
+         std::string copy(bullet);
+         if (!FireInproc(copy, waited ? 0 : waitToFire)) {
+            break;
+         }
+         waited = true;
+         ++fired;
+      }
+      return fired;
+   }
+   if (mSpill && !bullets.empty()) {
+      std::unique_lock<std::mutex> lock(mChamberMutex);
+      // the pipe is not waited on, what it does not take now is spilled
+      size_t fired = mSpill->Empty() ? FireBurstCopy(bullets, 0) : 0;
+      while (fired < bullets.size()) {
+         if (bullets[fired].empty()) {
+            SkipBlank();
+         } else if (!Spill(bullets[fired].data(), bullets[fired].size())) {
+            break;
+         }
+         ++fired;
+      }
+      return fired;
+   }
+   std::unique_lock<std::mutex> chamber;
+   LockChamber(chamber);
+   return FireBurstCopy(bullets, waitToFire);
+}
+
+/**
+ * An empty bullet in a burst is passed over, not sent
+ */
+void Rifle::SkipBlank() {
+   LOG(WARNING) << "Tried to send empty packet";
+   mStats.Error();
+}
+
+/**
+ * Send as many bullets as the pipe takes after a single poll.
+ * @param bullets
+ * @param waitToFire in milliseconds, applies to the single poll only
+ * @return the number of bullets, from the front of the vector, that were sent
+ *   or skipped as empty
+ */
+size_t Rifle::FireBurstCopy(const std::vector<std::string>& bullets, const int waitToFire) {
+   if (!mChamber) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return 0;
+   }
+   if (bullets.empty()) {
+      LOG(WARNING) << "Tried to send nothing";
+      return 0;
+   }
+   zmq_pollitem_t items [] = {
+      { mChamber, 0, ZMQ_POLLOUT, 0}
+   };
+
+   if (zmq_poll(items, 1, waitToFire) <= 0) {
+      //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+      mStats.PollTimeout();
+      return 0;
+   }
+   if (!(items[0].revents & ZMQ_POLLOUT)) {
+      LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
+      mStats.Error();
+      return 0;
+   }
+   size_t fired = 0;
+   for (const auto& bullet : bullets) {
+      if (bullet.empty()) {
+         SkipBlank();
+         ++fired;
+         continue;
+      }
+      if (Compress(bullet.data(), bullet.size())) {
+         if (!FireCompressed(bullet.size())) {
+            break;
+         }
+         ++fired;
+         continue;
+      }
+      zmq_msg_t message;
+      if (zmq_msg_init_size(&message, bullet.size()) != 0) {
+         LOG(WARNING) << "Error on Zmq message init: " << zmq_strerror(zmq_errno());
+         mStats.Error();
+         break;
+      }
+      memcpy(zmq_msg_data(&message), bullet.data(), bullet.size());
+      if (zmq_msg_send(&message, mChamber, ZMQ_DONTWAIT) < 0) {
+         int err = zmq_errno();
+         zmq_msg_close(&message);
+         if (err != EAGAIN) {
+            LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(err);
+         }
+         CountSendError(err);
+         break;
+      }
+      mStats.Message(bullet.size());
+      ++fired;
+   }
+   return fired;
+}
+
 /**
  * Fire a string without copying it to zeromq. 
  * @param zero
@@ -185,30 +524,49 @@ bool Rifle::Fire(const std::string& bullet, const int waitToFire) {
  * @return 
  */
 bool Rifle::FireZeroCopy(std::string* zero, const size_t size, void (*FreeFunction)(void*, void*), const int waitToFire) {
+   QueueStats::Timer timer(mStats);
    bool success = false;
-   if (!mChamber) {
+   if (mInproc) {
+      std::string copy(zero->data(), std::min(size, zero->size()));
+      success = FireInproc(copy, waitToFire);
+      if (success) {
+         // handed over the same way ZeroMQ would once the copy is sent
+         if (FreeFunction) {
+            FreeFunction(&((*zero)[0]), zero);
+         }
+         zero = NULL;
+      }
+   } else if (!mChamber) {
       LOG(WARNING) << "Socket uninitialized!";
    } else if (size == 0) {
       LOG(WARNING) << "Tried to send empty packet";
    } else {
+      std::unique_lock<std::mutex> chamber;
       zmq_pollitem_t items [] = {
          { mChamber, 0, ZMQ_POLLOUT, 0}
       };
 
-      if (zmq_poll(items, 1, waitToFire) > 0) {
+      if (!HoldChamber(chamber)) {
+         // behind spilled bullets
+      } else if (zmq_poll(items, 1, waitToFire) > 0) {
          if (items[0].revents & ZMQ_POLLOUT) {
 
             zmq_msg_t message;
             zmq_msg_init_data(&message, &((*zero)[0]), size, FreeFunction, zero);
             if ((int) size == zmq_msg_send(&message, mChamber, ZMQ_DONTWAIT)) {
+               mStats.Message(size);
                success = true;
                zero = NULL;
+            } else {
+               CountSendError(zmq_errno());
             }
          } else {
             LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
+            mStats.Error();
          }
       } else {
          //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+         mStats.PollTimeout();
       }
    }
    if (!success && zero) {
@@ -224,6 +582,15 @@ bool Rifle::FireZeroCopy(std::string* zero, const size_t size, void (*FreeFuncti
  * @return 
  */
 bool Rifle::FireStake(const void* stake, const int waitToFire) {
+   QueueStats::Timer timer(mStats);
+   if (mInproc) {
+      if (stake == NULL) {
+         LOG(WARNING) << "Tried to send empty packet";
+         return false;
+      }
+      std::string bullet(reinterpret_cast<const char*> (&stake), sizeof (void*));
+      return FireInproc(bullet, waitToFire);
+   }
    if (!mChamber) {
       LOG(WARNING) << "Socket uninitialized!";
       return false;
@@ -232,6 +599,10 @@ bool Rifle::FireStake(const void* stake, const int waitToFire) {
       LOG(WARNING) << "Tried to send empty packet";
       return false;
    }
+   std::unique_lock<std::mutex> chamber;
+   if (!HoldChamber(chamber)) {
+      return false;
+   }
    zmq_pollitem_t items [] = {
       { mChamber, 0, ZMQ_POLLOUT, 0}
    };
@@ -240,14 +611,16 @@ bool Rifle::FireStake(const void* stake, const int waitToFire) {
       if (items[0].revents & ZMQ_POLLOUT) {
          zmsg_t* message = zmsg_new();
          zmsg_addmem(message, &(stake), sizeof (void*));
-         return CZMQToolkit::SendExistingMessage(message, mChamber);
+         return CountSend(CZMQToolkit::SendExistingMessage(message, mChamber), sizeof (void*));
       } else {
 
          LOG(WARNING) << "Error in zmq_pollout in " << GetBinding() << ": " << zmq_strerror(zmq_errno());
+         mStats.Error();
          return false;
       }
    } else {
       //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+      mStats.PollTimeout();
       return false;
    }
 }
@@ -262,40 +635,809 @@ bool Rifle::FireStake(const void* stake, const int waitToFire) {
  */
 bool Rifle::FireStakes(const std::vector<std::pair<void*, unsigned int> >
    & stakes, const int waitToFire) {
+   QueueStats::Timer timer(mStats);
    bool success = false;
+   if (mInproc) {
+      std::string bullet(reinterpret_cast<const char*> (stakes.data()),
+         stakes.size() * (sizeof (std::pair<void*, unsigned int>)));
+      return FireInproc(bullet, waitToFire);
+   }
    if (!mChamber) {
       LOG(WARNING) << "Socket uninitialized!";
    } else if (stakes.empty()) {
       LOG(WARNING) << "Tried to send nothing";
    } else {
+      std::unique_lock<std::mutex> chamber;
       zmq_pollitem_t items [] = {
          { mChamber, 0, ZMQ_POLLOUT, 0}
       };
 
-      if (zmq_poll(items, 1, waitToFire) > 0) {
+      if (!HoldChamber(chamber)) {
+         // behind spilled bullets
+      } else if (zmq_poll(items, 1, waitToFire) > 0) {
          if (items[0].revents & ZMQ_POLLOUT) {
             zmsg_t* message = zmsg_new();
             zmsg_addmem(message, &(stakes[0]),
                stakes.size() * (sizeof (std::pair<void*, unsigned int>)));
-            success = CZMQToolkit::SendExistingMessage(message, mChamber);
+            success = CountSend(CZMQToolkit::SendExistingMessage(message, mChamber),
+               stakes.size() * (sizeof (std::pair<void*, unsigned int>)));
          } else {
             LOG(WARNING) << "Error in zmq_pollout in " << GetBinding() << ": " << zmq_strerror(zmq_errno());
+            mStats.Error();
          }
       } else {
          //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+         mStats.PollTimeout();
       }
    }
    return success;
 }
 
+/**
+ * Copy raw bytes into a single message and shoot it.
+ * @param data
+ * @param size
+ * @param waitToFire in milliseconds
+ * @return 
+ *   false if something went wrong
+ */
+bool Rifle::FireBytes(const void* data, const size_t size, const int waitToFire) {
+   QueueStats::Timer timer(mStats);
+   if (mInproc) {
+      std::string bullet;
+      if (data != nullptr) {
+         bullet.assign(reinterpret_cast<const char*> (data), size);
+      }
+      return FireInproc(bullet, waitToFire);
+   }
+   if (!mChamber) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return false;
+   }
+   if (data == nullptr || size == 0) {
+      LOG(WARNING) << "Tried to send nothing";
+      return false;
+   }
+   std::unique_lock<std::mutex> chamber;
+   if (!HoldChamber(chamber)) {
+      return false;
+   }
+   zmq_pollitem_t items [] = {
+      { mChamber, 0, ZMQ_POLLOUT, 0}
+   };
+
+   if (zmq_poll(items, 1, waitToFire) > 0) {
+      if (items[0].revents & ZMQ_POLLOUT) {
+         zmq_msg_t message;
+         if (zmq_msg_init_size(&message, size) != 0) {
+            LOG(WARNING) << "Error on Zmq message init: " << zmq_strerror(zmq_errno());
+            mStats.Error();
+            return false;
+         }
+         memcpy(zmq_msg_data(&message), data, size);
+         if (zmq_msg_send(&message, mChamber, ZMQ_DONTWAIT) < 0) {
+            int err = zmq_errno();
+            LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(err);
+            CountSendError(err);
+            zmq_msg_close(&message);
+            return false;
+         }
+         mStats.Message(size);
+         return true;
+      } else {
+         LOG(WARNING) << "Error in zmq_pollout in " << GetBinding() << ": " << zmq_strerror(zmq_errno());
+         mStats.Error();
+         return false;
+      }
+   } else {
+      //      LOG(WARNING) << "timeout in zmq_pollout " << GetBinding();
+      mStats.PollTimeout();
+      return false;
+   }
+}
+
+/**
+ * Start a background thread that fires what FireAsync queues, so the caller
+ * never waits on the socket. After this only FireAsync may be used to shoot,
+ * from any number of threads. Aim must be called first.
+ *
+ * @param queueSize
+ *   Most bullets waiting for the sender thread
+ * @param policy
+ *   What FireAsync does when the queue is full, drops are counted in GetStats
+ * @param waitToFire
+ *   in milliseconds, how long the sender thread waits on a full pipe before
+ * it tries again
+ * @return 
+ *   false if the Rifle is not aimed or already async
+ */
+bool Rifle::StartAsync(const size_t queueSize, const Overflow policy, const int waitToFire) {
+   if (!mChamber && !mInproc) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return false;
+   }
+   if (mAsyncQueue) {
+      LOG(WARNING) << "Rifle is already async";
+      return false;
+   }
+   mAsyncQueue.reset(new MpmcRing<std::string>(queueSize));
+   mOverflow = policy;
+   mAsyncWait = waitToFire;
+   mAsyncStop.store(false);
+   mAsyncThread = std::thread(&Rifle::AsyncSender, this);
+   return true;
+}
+
+/**
+ * Queue a copy of the bullet for the sender thread.
+ * @param bullet
+ * @return 
+ *   If it was queued
+ */
+bool Rifle::FireAsync(const std::string& bullet) {
+   std::string copy(bullet);
+   return FireAsync(std::move(copy));
+}
+
+/**
+ * Queue a bullet for the sender thread, applying the overflow policy when
+ * the queue is full. Safe to call while another thread stops the Rifle, it
+ * fails once StopAsync started.
+ * @param bullet
+ *   Moved from when queued
+ * @return 
+ *   If it was queued, a dropped bullet returns false
+ */
+bool Rifle::FireAsync(std::string&& bullet) {
+   // announced before looking at the flag, StopAsync waits for us if it
+   // was not set yet
+   mAsyncCallers.fetch_add(1);
+   struct Leave {
+      Rifle& rifle;
+      ~Leave() {
+         rifle.LeaveAsync();
+      }
+   } leave{*this};
+   if (mAsyncStop.load()) {
+      LOG(WARNING) << "Rifle is not async";
+      return false;
+   }
+   if (bullet.empty()) {
+      LOG(WARNING) << "Tried to send empty packet";
+      return false;
+   }
+   while (!mAsyncQueue->TryPush(bullet)) {
+      if (mOverflow == Overflow::DROP_NEWEST) {
+         mStats.Drop();
+         return false;
+      } else if (mOverflow == Overflow::DROP_OLDEST) {
+         std::string oldest;
+         if (mAsyncQueue->TryPop(oldest)) {
+            mStats.Drop();
+         }
+      } else if (mAsyncQueue->Push(bullet, kAsyncStopCheckMs)) {
+         return true;
+      } else if (mAsyncStop.load() || zctx_interrupted) {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * @return the bullets waiting for the sender thread
+ */
+size_t Rifle::GetAsyncQueued() const {
+   return mAsyncQueue ? mAsyncQueue->Size() : 0;
+}
+
+/**
+ * Stop the sender thread. FireAsync fails from here on, calls already in it
+ * are waited for. Queued bullets get one more chance to go out within the
+ * async waitToFire, whatever is left after that is dropped.
+ */
+void Rifle::StopAsync() {
+   if (!mAsyncQueue) {
+      return;
+   }
+   mAsyncStop.store(true);
+   {
+      // callers blocked on a full queue see the flag within kAsyncStopCheckMs,
+      // the last one to leave wakes us
+      std::unique_lock<std::mutex> lock(mAsyncCallersMutex);
+      while (mAsyncCallers.load() != 0) {
+         mAsyncLeft.wait_for(lock, std::chrono::milliseconds(kAsyncStopCheckMs));
+      }
+   }
+   if (mAsyncThread.joinable()) {
+      mAsyncThread.join();
+   }
+   mAsyncQueue.reset();
+}
+
+/**
+ * A FireAsync call is done, the last one out while stopping wakes StopAsync.
+ */
+void Rifle::LeaveAsync() {
+   if (mAsyncCallers.fetch_sub(1) == 1 && mAsyncStop.load()) {
+      std::lock_guard<std::mutex> lock(mAsyncCallersMutex);
+      mAsyncLeft.notify_all();
+   }
+}
+
+/**
+ * The sender thread, drains the queue in batches of up to kAsyncBatchSize
+ * with a single poll per batch.
+ */
+void Rifle::AsyncSender() {
+   std::vector<std::string> batch;
+   batch.reserve(kAsyncBatchSize);
+   std::string bullet;
+   while (true) {
+      if (batch.empty()) {
+         if (!mAsyncQueue->Pop(bullet, kAsyncIdleWait.count())) {
+            if (mAsyncStop.load() && mAsyncCallers.load() == 0) {
+               break;
+            }
+            continue;
+         }
+         batch.push_back(std::move(bullet));
+      }
+      while (batch.size() < kAsyncBatchSize && mAsyncQueue->TryPop(bullet)) {
+         batch.push_back(std::move(bullet));
+      }
+      size_t fired = FireBurst(batch, mAsyncWait);
+      batch.erase(batch.begin(), batch.begin() + fired);
+      if (fired == 0 && ((mAsyncStop.load() && mAsyncCallers.load() == 0) || zctx_interrupted)) {
+         break;
+      }
+   }
+   for (size_t i = 0; i < batch.size(); ++i) {
+      mStats.Drop();
+   }
+   while (mAsyncQueue->TryPop(bullet)) {
+      mStats.Drop();
+   }
+}
+
+/**
+ * Spill the bullets the pipe does not take to memory mapped segment files
+ * instead of failing, see SpillLog. A background thread replays them in
+ * order as soon as the pipe has room, and while anything is spilled new
+ * bullets are spilled behind it so the order is kept. Aim must be called
+ * first.
+ *
+ * Fire and FireBurst spill, and don't wait on the pipe while spilling: what
+ * it does not take right away is spilled. The other ways to shoot don't
+ * spill. While spilling they share the socket with the replay thread under
+ * the chamber mutex, and they fail, as on a full pipe, while spilled bullets
+ * are waiting so they never overtake them.
+ *
+ * Unreplayed bullets stay on disk when spilling stops and are replayed by
+ * the next Rifle that spills to the same directory.
+ *
+ * @param directory
+ *   Only for this Rifle, created if missing
+ * @param segmentBytes
+ *   Size of each segment file, the largest bullet that can be spilled
+ * @param maxSegments
+ *   Most segment files, bullets that do not fit are dropped and Fire returns
+ * false
+ * @return 
+ *   false if the Rifle is not aimed, uses the inproc fast path, already
+ * spills or the directory can't be used
+ */
+bool Rifle::StartSpill(const std::string& directory, const size_t segmentBytes, const size_t maxSegments) {
+   if (!mChamber) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return false;
+   }
+   if (mSpill) {
+      LOG(WARNING) << "Rifle is already spilling to " << mSpill->GetDirectory();
+      return false;
+   }
+   std::unique_ptr<SpillLog> spill(new SpillLog(directory, segmentBytes, maxSegments));
+   if (!spill->Open()) {
+      return false;
+   }
+   {
+      // the batch flusher looks at it
+      std::lock_guard<std::mutex> lock(mChamberMutex);
+      mSpill = std::move(spill);
+   }
+   mSpillStop.store(false);
+   mSpillThread = std::thread(&Rifle::SpillReplayer, this);
+   return true;
+}
+
+/**
+ * Stop the replay thread and close the spill log.
+ */
+void Rifle::StopSpill() {
+   if (!mSpill) {
+      return;
+   }
+   mSpillStop.store(true);
+   mSpillReady.notify_all();
+   if (mSpillThread.joinable()) {
+      mSpillThread.join();
+   }
+   if (!mSpill->Empty()) {
+      LOG(INFO) << "Rifle left " << mSpill->Size() << " spilled bullets in " << mSpill->GetDirectory();
+   }
+   std::lock_guard<std::mutex> lock(mChamberMutex);
+   mSpill.reset();
+}
+
+/**
+ * @return the bullets spilled and not yet replayed
+ */
+size_t Rifle::GetSpilled() const {
+   if (!mSpill) {
+      return 0;
+   }
+   std::lock_guard<std::mutex> lock(mChamberMutex);
+   return mSpill->Size();
+}
+
+/**
+ * Send a bullet if the pipe takes it right now, spill it otherwise or if
+ * earlier bullets are still spilled. The pipe is not waited on, so neither
+ * the caller nor the replay thread is held up by a full pipe.
+ * @param data
+ * @param size
+ * @return 
+ *   false if it was neither sent nor spilled
+ */
+bool Rifle::FireOrSpill(const void* data, const size_t size) {
+   std::lock_guard<std::mutex> lock(mChamberMutex);
+   if (mSpill->Empty() && FireCopy(data, size, 0)) {
+      return true;
+   }
+   return Spill(data, size);
+}
+
+/**
+ * While spilling or batch flushing a background thread shares the socket
+ * and the batch, so hold the chamber mutex before using them.
+ * @param lock
+ *   Locked on the chamber mutex while shared, left alone otherwise
+ */
+void Rifle::LockChamber(std::unique_lock<std::mutex>& lock) const {
+   if (mSpill || mBatchFlushing.load()) {
+      lock = std::unique_lock<std::mutex>(mChamberMutex);
+   }
+}
+
+/**
+ * Lock the chamber for a bullet that can't be spilled. It must not overtake
+ * the spilled ones, so it is refused while any are waiting.
+ * @param lock
+ *   Locked on the chamber mutex while shared, left alone otherwise
+ * @return 
+ *   false if spilled bullets are waiting, counted as a high water stall
+ */
+bool Rifle::HoldChamber(std::unique_lock<std::mutex>& lock) {
+   LockChamber(lock);
+   if (!mSpill || mSpill->Empty()) {
+      return true;
+   }
+   mStats.HighWaterStall();
+   return false;
+}
+
+/**
+ * Append a bullet to the spill log and wake the replay thread, the spill
+ * mutex must be held.
+ * @param data
+ * @param size
+ * @return 
+ *   false if the log is full, the bullet is dropped
+ */
+bool Rifle::Spill(const void* data, const size_t size) {
+   if (!mSpill->Append(data, size)) {
+      LOG(WARNING) << "Rifle spill log in " << mSpill->GetDirectory() << " is full, dropping a bullet";
+      mStats.Drop();
+      return false;
+   }
+   mStats.Spill();
+   mSpillReady.notify_one();
+   return true;
+}
+
+/**
+ * The replay thread, sends spilled bullets without waiting for as long as
+ * the pipe takes them and backs off while it is full. The spill mutex is let
+ * go between rounds so Fire is held up by at most one round.
+ */
+void Rifle::SpillReplayer() {
+   std::unique_lock<std::mutex> lock(mChamberMutex);
+   while (!mSpillStop.load() && !zctx_interrupted) {
+      if (mSpill->Empty()) {
+         mSpillReady.wait_for(lock, kAsyncIdleWait);
+         continue;
+      }
+      size_t replayed = 0;
+      const uint8_t* data = nullptr;
+      size_t size = 0;
+      while (replayed < kAsyncBatchSize && mSpill->Front(data, size)) {
+         zmq_msg_t message;
+         if (zmq_msg_init_size(&message, size) != 0) {
+            LOG(WARNING) << "Error on Zmq message init: " << zmq_strerror(zmq_errno());
+            mStats.Error();
+            break;
+         }
+         memcpy(zmq_msg_data(&message), data, size);
+         if (zmq_msg_send(&message, mChamber, ZMQ_DONTWAIT) < 0) {
+            int err = zmq_errno();
+            zmq_msg_close(&message);
+            if (err != EAGAIN) {
+               LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(err);
+            }
+            CountSendError(err);
+            break;
+         }
+         mStats.Message(size);
+         mSpill->Pop();
+         ++replayed;
+      }
+      lock.unlock();
+      if (replayed == 0) {
+         std::this_thread::sleep_for(kRetryWait);
+      } else {
+         std::this_thread::yield();
+      }
+      lock.lock();
+   }
+}
+
+/**
+ * Push a bullet through the inproc fast path and count it.
+ * @param bullet
+ *   Moved from when successful
+ * @param waitToFire in milliseconds
+ * @return 
+ */
+bool Rifle::FireInproc(std::string& bullet, const int waitToFire) {
+   const size_t size = bullet.size();
+   if (mInproc->Push(bullet, waitToFire)) {
+      mStats.Message(size);
+      return true;
+   }
+   if (size != 0 && waitToFire == 0) {
+      mStats.HighWaterStall();
+   } else if (size != 0) {
+      mStats.PollTimeout();
+   }
+   return false;
+}
+
+/**
+ * Compress the bullets that ZeroMQ sends. A bullet of at least minimumSize
+ * bytes is deflated and sent as a flag frame and the compressed frame, which
+ * a Vampire turns back into the original bullet. When a bullet saves less
+ * than a tenth the data is taken to be incompressible and the next
+ * bullets are sent as is before another one is tried.
+ *
+ * Pays off on bandwidth bound tcp:// links, the inproc fast path never
+ * compresses. Stakes, structs and zero copy bullets are not compressed.
+ * @param level
+ *   zlib level from 1 (fastest) to 9 (smallest), 0 turns compression off
+ * @param minimumSize
+ *   Smaller bullets are sent as is
+ */
+void Rifle::SetCompression(const int level, const size_t minimumSize) {
+   mCompressionLevel = std::max(0, std::min(level, Z_BEST_COMPRESSION));
+   mCompressionMinimum = minimumSize;
+   mCompressionBypass = 0;
+}
+
+/**
+ * Get the compression level.
+ * @return 0 when off
+ */
+int Rifle::GetCompression() {
+   return mCompressionLevel;
+}
+
+/**
+ * @return the number of bullets that were sent compressed
+ */
+uint64_t Rifle::GetCompressedCount() const {
+   return mCompressedCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * Compress a bullet into mCompressed if compression is on, the bullet is
+ * large enough and the data has not recently shown to be incompressible.
+ * @param data
+ * @param size
+ * @return 
+ *   If mCompressed should be sent instead of the bullet
+ */
+bool Rifle::Compress(const void* data, const size_t size) {
+   if (mCompressionLevel == 0 || size < mCompressionMinimum) {
+      return false;
+   }
+   if (mCompressionBypass != 0) {
+      --mCompressionBypass;
+      return false;
+   }
+   if (!CZMQToolkit::Compress(data, size, mCompressionLevel, mCompressed)) {
+      return false;
+   }
+   if ((mCompressed.size() * 10) > (size * 9)) {
+      mCompressionBypass = kCompressionBypass;
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Send mCompressed, the socket must be ready for output.
+ * @param size
+ *   Of the original bullet, for the stats
+ * @return 
+ */
+bool Rifle::FireCompressed(const size_t size) {
+   if (CZMQToolkit::SendFlagged(CZMQToolkit::kZlibFrame, mCompressed, mChamber)) {
+      mStats.Message(size);
+      mCompressedCount.fetch_add(1, std::memory_order_relaxed);
+      return true;
+   }
+   int err = zmq_errno();
+   if (err != EAGAIN) {
+      LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(err);
+   }
+   CountSendError(err);
+   return false;
+}
+
+/**
+ * Pack small bullets fired with FireBatched into one frame, saving the per
+ * message cost of ZeroMQ. A Vampire unpacks them for GetShot and GetShots,
+ * or hands them out in place with GetBatch. The inproc fast path does not
+ * batch.
+ * @param maxBytes
+ *   The batch is sent once it holds this much, 0 turns batching off
+ *
+ * While batching is on a flusher thread sends batches that no FireBatched
+ * came along to send, and every way to shoot shares the socket with it under
+ * the chamber mutex. Turn batching off again to stop the thread.
+ * @param maxBytes
+ *   The batch is sent once it holds this much, 0 turns batching off
+ * @param maxDelayUs
+ *   The batch is sent this long after its first bullet, so a quiet producer
+ * does not hold bullets back
+ */
+void Rifle::SetBatching(const size_t maxBytes, const unsigned int maxDelayUs) {
+   StopBatchFlusher();
+   mBatchBytes = maxBytes;
+   mBatchDelay = std::chrono::microseconds(maxDelayUs);
+   if (mBatchBytes != 0) {
+      mBatchStop.store(false);
+      mBatchFlushing.store(true);
+      mBatchThread = std::thread(&Rifle::BatchFlusher, this);
+   }
+}
+
+/**
+ * Add a bullet to the batch, sending the batch when it is full or old
+ * enough. Falls back to Fire when batching is off.
+ * @param bullet
+ * @param waitToFire in milliseconds, for sending the batch
+ * @return 
+ *   false if the bullet could not be taken, because a full batch could not
+ * be sent. A taken bullet is sent with the batch later if it can't go now.
+ */
+bool Rifle::FireBatched(const std::string& bullet, const int waitToFire) {
+   if (mBatchBytes == 0 || mInproc) {
+      return Fire(bullet, waitToFire);
+   }
+   if (!mChamber) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return false;
+   }
+   if (bullet.empty()) {
+      LOG(WARNING) << "Tried to send empty packet";
+      return false;
+   }
+   QueueStats::Timer timer(mStats);
+   std::unique_lock<std::mutex> chamber;
+   LockChamber(chamber);
+   if (!mBatch.empty() && (mBatch.size() + bullet.size() + ShotBatch::kMaxVarintSize) > mBatchBytes
+      && !SendBatch(chamber, waitToFire)) {
+      return false;
+   }
+   const bool started = mBatch.empty();
+   if (started) {
+      mBatchStart = QueueStats::Clock::now();
+   }
+   ShotBatch::Append(mBatch, bullet.data(), bullet.size());
+   ++mBatchCount;
+   mBatchPayload += bullet.size();
+   if (mBatch.size() >= mBatchBytes || (QueueStats::Clock::now() - mBatchStart) >= mBatchDelay) {
+      // the bullet is taken, the flusher tries again if the pipe is full
+      SendBatch(chamber, 0);
+   } else if (started) {
+      mBatchReady.notify_one();
+   }
+   return true;
+}
+
+/**
+ * Send whatever is batched.
+ * @param waitToFire in milliseconds
+ * @return 
+ *   false if a batch is left
+ */
+bool Rifle::FlushBatch(const int waitToFire) {
+   std::unique_lock<std::mutex> chamber;
+   LockChamber(chamber);
+   if (mBatch.empty()) {
+      return true;
+   }
+   QueueStats::Timer timer(mStats);
+   return SendBatch(chamber, waitToFire);
+}
+
+/**
+ * @return the number of bullets waiting in the batch
+ */
+size_t Rifle::GetBatched() const {
+   std::unique_lock<std::mutex> chamber;
+   LockChamber(chamber);
+   return mBatchCount;
+}
+
+/**
+ * Send the batch as a kBatchFrame flag frame and the batch frame. The pipe
+ * is not waited on with the chamber held, while it is full the chamber is
+ * let go for kRetryWait at a time so the flusher and the spill replayer are
+ * not held up. Like the other bullets that can't be spilled the batch waits
+ * while spilled bullets do.
+ * @param chamber
+ *   From LockChamber, held again on return
+ * @param waitToFire in milliseconds
+ * @return 
+ *   If the batch went out, here or from another thread meanwhile. It is
+ * kept otherwise.
+ */
+bool Rifle::SendBatch(std::unique_lock<std::mutex>& chamber, const int waitToFire) {
+   if (!mChamber) {
+      LOG(WARNING) << "Socket uninitialized!";
+      return false;
+   }
+   const auto deadline = QueueStats::Clock::now() + std::chrono::milliseconds(std::max(waitToFire, 0));
+   while (!mBatch.empty()) {
+      if (mSpill && !mSpill->Empty()) {
+         mStats.HighWaterStall();
+         return false;
+      }
+      zmq_pollitem_t items [] = {
+         { mChamber, 0, ZMQ_POLLOUT, 0}
+      };
+      const int pollResult = zmq_poll(items, 1, 0);
+      if (pollResult < 0 || (pollResult > 0 && !(items[0].revents & ZMQ_POLLOUT))) {
+         LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(zmq_errno());
+         mStats.Error();
+         return false;
+      }
+      if (pollResult > 0) {
+         if (CZMQToolkit::SendFlagged(CZMQToolkit::kBatchFrame, mBatch, mChamber)) {
+            mStats.Message(mBatchPayload, mBatchCount);
+            mBatch.clear();
+            mBatchCount = 0;
+            mBatchPayload = 0;
+            return true;
+         }
+         int err = zmq_errno();
+         if (err != EAGAIN) {
+            LOG(WARNING) << "Error on Zmq socket send: " << zmq_strerror(err);
+            CountSendError(err);
+            return false;
+         }
+      }
+      if ((waitToFire >= 0 && QueueStats::Clock::now() >= deadline) || zctx_interrupted) {
+         mStats.PollTimeout();
+         return false;
+      }
+      if (chamber.owns_lock()) {
+         chamber.unlock();
+      }
+      std::this_thread::sleep_for(kRetryWait);
+      if (chamber.mutex()) {
+         chamber.lock();
+      }
+   }
+   return true;
+}
+
+/**
+ * Stop the flusher thread, what is batched stays batched.
+ */
+void Rifle::StopBatchFlusher() {
+   if (!mBatchFlushing.load()) {
+      return;
+   }
+   {
+      std::lock_guard<std::mutex> lock(mChamberMutex);
+      mBatchStop.store(true);
+   }
+   mBatchReady.notify_all();
+   mBatchThread.join();
+   mBatchFlushing.store(false);
+}
+
+/**
+ * The flusher thread, sends the batch once it is maxDelayUs old when no
+ * FireBatched came along to do it. While the pipe is full it tries again
+ * with the chamber let go in between.
+ */
+void Rifle::BatchFlusher() {
+   std::unique_lock<std::mutex> lock(mChamberMutex);
+   while (!mBatchStop.load() && !zctx_interrupted) {
+      if (mBatch.empty()) {
+         mBatchReady.wait_for(lock, kAsyncIdleWait);
+      } else if (QueueStats::Clock::now() < mBatchStart + mBatchDelay) {
+         mBatchReady.wait_until(lock, mBatchStart + mBatchDelay);
+      } else if (!SendBatch(lock, kAsyncIdleWait.count())) {
+         mBatchReady.wait_for(lock, kRetryWait);
+      }
+   }
+}
+
+/**
+ * Count the result of a blocking send.
+ * @param sent
+ * @param size
+ * @return sent
+ */
+bool Rifle::CountSend(const bool sent, const size_t size) {
+   if (sent) {
+      mStats.Message(size);
+   } else {
+      mStats.Error();
+   }
+   return sent;
+}
+
+/**
+ * Count a failed non blocking send, a full pipe is a high water stall.
+ * @param err
+ *   zmq_errno of the send
+ */
+void Rifle::CountSendError(const int err) {
+   if (err == EAGAIN) {
+      mStats.HighWaterStall();
+   } else {
+      mStats.Error();
+   }
+}
+
+/**
+ * A copy of the counters, cheap enough to take every second from any thread.
+ * @return 
+ */
+QueueStatsSnapshot Rifle::GetStats() const {
+   return mStats.Snapshot();
+}
+
 /**
  * Destroy the gun.
  */
 void Rifle::Destroy() {
+   StopAsync();
+   StopSpill();
+   StopBatchFlusher();
+   if (mChamber && !FlushBatch(mLinger)) {
+      LOG(WARNING) << "Rifle dropped " << GetBatched() << " batched bullets";
+   }
+   mInproc.reset();
    if (mContext != NULL) {
       //LOG(DEBUG) << "Rifle: destroying context";
       zsocket_destroy(mContext, mChamber);
-      zctx_destroy(&mContext);
+      ContextRegistry::Instance().Release(mContext);
       //zclock_sleep(mLinger * 2);
       mChamber = NULL;
       mContext = NULL;
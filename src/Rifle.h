@@ -1,20 +1,40 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <type_traits>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "CZMQToolkit.h"
+#include "MpmcRing.h"
+#include "QueueStats.h"
 
 #define SIZE_OF_STAKE_BUNDLE 500
+class InprocPipe;
+class SpillLog;
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
 class Rifle {
 public:
+   enum class Overflow : std::int8_t { BLOCK = 0, DROP_NEWEST = 1, DROP_OLDEST = 2 };
+
    explicit Rifle(const std::string& location);
    bool Aim();
    std::string GetBinding() const;
    bool Fire(const std::string& bullet, const int waitToFire = 10000);
+   bool Fire(std::string&& bullet, const int waitToFire = 10000);
+   bool Fire(std::vector<uint8_t>&& bullet, const int waitToFire = 10000);
+   size_t FireBurst(const std::vector<std::string>& bullets, const int waitToFire = 10000);
    bool FireStake(const void* stake,const int waitToFire = 10000);
    bool FireStakes(const std::vector<std::pair<void*, unsigned int> >& stakes,
            const int waitToFire = 10000);
+   template<typename T>
+   bool FireStructs(const T* structs, const size_t count, const int waitToFire = 10000);
+   template<typename T>
+   bool FireStructs(const std::vector<T>& structs, const int waitToFire = 10000);
 
    bool FireZeroCopy( std::string* zero, const size_t size, void (*FreeFunction)(void*,void*), const int waitToFire = 10000);
    int GetHighWater();
@@ -23,10 +43,52 @@ public:
    void SetIOThreads(const int count);
    void SetOwnSocket(const bool own);
    bool GetOwnSocket();
+   void SetSharedContext(const std::string& name, const uint64_t affinity = 0);
+   void SetInprocFastPath(const bool fastPath);
+   bool GetInprocFastPath();
+   QueueStatsSnapshot GetStats() const;
+   void SetCompression(const int level, const size_t minimumSize = 512);
+   int GetCompression();
+   uint64_t GetCompressedCount() const;
+   void SetBatching(const size_t maxBytes, const unsigned int maxDelayUs = 1000);
+   bool FireBatched(const std::string& bullet, const int waitToFire = 10000);
+   bool FlushBatch(const int waitToFire = 10000);
+   size_t GetBatched() const;
+   bool StartAsync(const size_t queueSize, const Overflow policy = Overflow::BLOCK,
+           const int waitToFire = 10000);
+   bool FireAsync(const std::string& bullet);
+   bool FireAsync(std::string&& bullet);
+   size_t GetAsyncQueued() const;
+   void StopAsync();
+   bool StartSpill(const std::string& directory, const size_t segmentBytes = 64 * 1024 * 1024,
+           const size_t maxSegments = 16);
+   void StopSpill();
+   size_t GetSpilled() const;
    virtual ~Rifle();
 protected:
    void Destroy();
 private:
+   template<typename Container>
+   bool FireOwned(Container&& bullet, const int waitToFire);
+   bool FireBytes(const void* data, const size_t size, const int waitToFire);
+   bool FireCopy(const void* data, const size_t size, const int waitToFire);
+   size_t FireBurstCopy(const std::vector<std::string>& bullets, const int waitToFire);
+   void SkipBlank();
+   bool FireOrSpill(const void* data, const size_t size);
+   void LockChamber(std::unique_lock<std::mutex>& lock) const;
+   bool HoldChamber(std::unique_lock<std::mutex>& lock);
+   bool Spill(const void* data, const size_t size);
+   void SpillReplayer();
+   bool FireInproc(std::string& bullet, const int waitToFire);
+   bool Compress(const void* data, const size_t size);
+   bool FireCompressed(const size_t size);
+   bool SendBatch(std::unique_lock<std::mutex>& chamber, const int waitToFire);
+   void StopBatchFlusher();
+   void BatchFlusher();
+   bool CountSend(const bool sent, const size_t size);
+   void CountSendError(const int err);
+   void LeaveAsync();
+   void AsyncSender();
    void setIpcFilePermissions();
    std::string mLocation;
    int mHwm;
@@ -35,4 +97,66 @@ private:
    int mLinger;
    int mIOThredCount;
    bool mOwnSocket;
+   std::string mContextName;
+   uint64_t mAffinity;
+   bool mInprocFastPath;
+   std::unique_ptr<InprocPipe> mInproc;
+   QueueStats mStats;
+   std::unique_ptr<MpmcRing<std::string> > mAsyncQueue;
+   std::thread mAsyncThread;
+   // set while not async, FireAsync calls in flight keep the queue alive
+   std::atomic<bool> mAsyncStop;
+   std::atomic<size_t> mAsyncCallers;
+   std::mutex mAsyncCallersMutex;
+   std::condition_variable mAsyncLeft;
+   Overflow mOverflow;
+   int mAsyncWait;
+   std::unique_ptr<SpillLog> mSpill;
+   // while spilling or batch flushing, guards the socket and the batch
+   // between the caller and the background threads
+   mutable std::mutex mChamberMutex;
+   std::condition_variable mSpillReady;
+   std::thread mSpillThread;
+   std::atomic<bool> mSpillStop;
+   int mCompressionLevel;
+   size_t mCompressionMinimum;
+   size_t mCompressionBypass;
+   std::string mCompressed;
+   std::atomic<uint64_t> mCompressedCount;
+   size_t mBatchBytes;
+   std::chrono::microseconds mBatchDelay;
+   std::string mBatch;
+   size_t mBatchCount;
+   size_t mBatchPayload;
+   QueueStats::Clock::time_point mBatchStart;
+   std::atomic<bool> mBatchFlushing;
+   std::condition_variable mBatchReady;
+   std::thread mBatchThread;
+   std::atomic<bool> mBatchStop;
 };
+
+/**
+ * Shoot an array of plain structs to the Vampires / pull as one message.
+ * @param structs
+ * @param count
+ * @param waitToFire in milliseconds
+ * @return 
+ *   false if something went wrong
+ */
+template<typename T>
+bool Rifle::FireStructs(const T* structs, const size_t count, const int waitToFire) {
+   static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be fired as structs");
+   return FireBytes(structs, count * sizeof (T), waitToFire);
+}
+
+/**
+ * Shoot a vector of plain structs to the Vampires / pull as one message.
+ * @param structs
+ * @param waitToFire in milliseconds
+ * @return 
+ *   false if something went wrong
+ */
+template<typename T>
+bool Rifle::FireStructs(const std::vector<T>& structs, const int waitToFire) {
+   return FireStructs(structs.data(), structs.size(), waitToFire);
+}
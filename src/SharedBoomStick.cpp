@@ -0,0 +1,415 @@
+#include "SharedBoomStick.h"
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <memory>
+#include <czmq.h>
+#include <boost/random/random_device.hpp>
+#include "g3log/g3log.hpp"
+#include "BoomStick.h"
+#include "CZMQToolkit.h"
+#include "ContextRegistry.h"
+
+namespace {
+   // how often an idle IO thread looks for Stop and expired requests
+   const int kPollTimeoutMs = 100;
+   // most replies read before the queued requests get a turn
+   const size_t kReadBatch = 256;
+   // the wait of BoomStick::Send
+   const unsigned int kDefaultTtlSeconds = 30;
+}
+
+/**
+ * Construct with a ZMQ socket binding
+ * @param binding
+ *   The binding is stored, Initialize connects to it and starts the IO thread
+ */
+SharedBoomStick::SharedBoomStick(const std::string& binding) :
+mBinding(binding),
+mSendHWM(1000),
+mRecvHWM(1000),
+mAffinity(0),
+mRequestTtl(kDefaultTtlSeconds),
+mCtx(nullptr),
+mChamber(nullptr),
+mAccepting(false),
+mStop(false),
+mOutstandingCount(0),
+mSendBatches(0),
+mSendingOffset(0),
+mRan(boost::random::random_device()()),
+mUuidGen(mRan) {
+}
+
+/**
+ * Set the High water for sending messages, only works before Initialize
+ * @param hwm
+ */
+void SharedBoomStick::SetSendHWM(const int hwm) {
+   mSendHWM = hwm;
+}
+
+/**
+ * Set the High water for receiving messages, only works before Initialize
+ * @param hwm
+ */
+void SharedBoomStick::SetRecvHWM(const int hwm) {
+   mRecvHWM = hwm;
+}
+
+/**
+ * Create the socket on a context shared with other queues of the same name
+ * instead of a private one, only works before Initialize
+ * @param name
+ *   The ContextRegistry name, empty for a private context
+ * @param affinity
+ *   Bit mask of the shared context's IO threads to use, 0 for any
+ */
+void SharedBoomStick::SetSharedContext(const std::string& name, const uint64_t affinity) {
+   mContextName = name;
+   mAffinity = affinity;
+}
+
+/**
+ * How long a request waits for its reply before it fails, only works before
+ * Initialize
+ * @param seconds
+ *   30 by default, the wait of BoomStick::Send
+ */
+void SharedBoomStick::SetRequestTtl(const unsigned int seconds) {
+   mRequestTtl = seconds;
+}
+
+/**
+ * Connect and start the IO thread
+ * @return
+ *   true when successful, or already running
+ */
+bool SharedBoomStick::Initialize() {
+   if (mThread.joinable()) {
+      return true;
+   }
+   if (nullptr == mCtx) {
+      if (!mWakeUp.IsValid()) {
+         return false;
+      }
+      mCtx = mContextName.empty() ? zctx_new() : ContextRegistry::Instance().Acquire(mContextName);
+      if (nullptr == mCtx) {
+         LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
+         return false;
+      }
+      mChamber = zsocket_new(mCtx, ZMQ_DEALER);
+      if (nullptr == mChamber) {
+         LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
+         ContextRegistry::Instance().Release(mCtx);
+         return false;
+      }
+      if (mAffinity) {
+         CZMQToolkit::SetAffinity(mChamber, mAffinity);
+      }
+      zsocket_set_sndhwm(mChamber, mSendHWM);
+      zsocket_set_rcvhwm(mChamber, mRecvHWM);
+      if (zsocket_connect(mChamber, mBinding.c_str()) < 0) {
+         LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
+         ContextRegistry::Instance().Release(mCtx);
+         mChamber = nullptr;
+         return false;
+      }
+   }
+   mExpiry.Clear();
+   mStop.store(false);
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mAccepting = true;
+   }
+   mThread = std::thread(&SharedBoomStick::Run, this);
+   return true;
+}
+
+/**
+ * Send from any thread, the future is ready when the reply comes
+ * @param command
+ * @return
+ *   The reply, empty if it could not be sent or did not come in time
+ */
+std::future<std::string> SharedBoomStick::Send(const std::string& command) {
+   // a std::function has to be copyable, a promise is not
+   auto promise = std::make_shared<std::promise<std::string> >();
+   std::future<std::string> reply = promise->get_future();
+   const bool queued = Send(command, [promise](const bool success, std::string& reply) {
+      if (success) {
+         promise->set_value(std::move(reply));
+      } else {
+         promise->set_value({});
+      }
+   });
+   if (!queued) {
+      promise->set_value({});
+   }
+   return reply;
+}
+
+/**
+ * Send from any thread, the handler is called on the IO thread with the reply
+ * or the reason it failed
+ * @param command
+ * @param handler
+ * @return
+ *   false if not running, the handler is not called then
+ */
+bool SharedBoomStick::Send(const std::string& command, ReplyHandler handler) {
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (!mAccepting) {
+         return false;
+      }
+      mQueued.push_back({command, std::move(handler)});
+   }
+   mWakeUp.Notify();
+   return true;
+}
+
+/**
+ * Stop the IO thread, requests still waiting fail with "Stopped". Initialize
+ * starts it again on the same connection.
+ */
+void SharedBoomStick::Stop() {
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mAccepting = false;
+   }
+   if (!mThread.joinable()) {
+      return;
+   }
+   mStop.store(true);
+   mWakeUp.Notify();
+   mThread.join();
+   FailAll("Stopped");
+}
+
+/**
+ * @return if the IO thread is started
+ */
+bool SharedBoomStick::IsRunning() const {
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mAccepting;
+}
+
+/**
+ * @return the requests sent that wait for their reply
+ */
+size_t SharedBoomStick::GetOutstanding() const {
+   return mOutstandingCount.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return how many times the IO thread sent, the requests sent per batch is
+ * a measure of how much the shared connection is saving
+ */
+uint64_t SharedBoomStick::GetSendBatches() const {
+   return mSendBatches.load(std::memory_order_relaxed);
+}
+
+/**
+ * The IO thread, sends and reads until there is nothing to do and then waits
+ * for either on one zmq_poll
+ */
+void SharedBoomStick::Run() {
+   zmq_pollitem_t items[2];
+   items[0] = {mChamber, 0, ZMQ_POLLIN, 0};
+   items[1] = {nullptr, mWakeUp.GetFd(), ZMQ_POLLIN, 0};
+   while (!mStop.load() && !zctx_interrupted) {
+      const size_t sent = SendQueued();
+      const size_t read = ReadReplies();
+      ExpireRequests();
+      if (sent != 0 || read != 0) {
+         continue;
+      }
+      mWakeUp.Arm();
+      if (HasQueued()) {
+         continue;
+      }
+      // wait for room too when the high water mark held requests back
+      items[0].events = ZMQ_POLLIN | (mSendingOffset < mSending.size() ? ZMQ_POLLOUT : 0);
+      if (zmq_poll(items, 2, kPollTimeoutMs) < 0) {
+         const int err = zmq_errno();
+         if (err == ETERM) {
+            LOG(INFO) << "SharedBoomStick context terminated";
+            return;
+         }
+         if (err != EINTR) {
+            LOG(WARNING) << "SharedBoomStick error in zmq_poll: " << zmq_strerror(err);
+         }
+      }
+   }
+}
+
+/**
+ * @return if senders queued requests since the last SendQueued
+ */
+bool SharedBoomStick::HasQueued() {
+   std::lock_guard<std::mutex> lock(mMutex);
+   return !mQueued.empty();
+}
+
+/**
+ * Take everything queued in one go and send it, as far as the high water
+ * mark allows
+ * @return
+ *   The requests sent
+ */
+size_t SharedBoomStick::SendQueued() {
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (mSending.empty()) {
+         // the two vectors trade buffers, neither allocates once warmed up
+         mSending.swap(mQueued);
+      } else {
+         std::move(mQueued.begin(), mQueued.end(), std::back_inserter(mSending));
+         mQueued.clear();
+      }
+   }
+   size_t sent = 0;
+   std::string error;
+   const time_t expiry = time(NULL) + mRequestTtl;
+   for (; mSendingOffset < mSending.size(); ++mSendingOffset) {
+      Request& request = mSending[mSendingOffset];
+      const RequestId id = mUuidGen();
+      if (zmq_send(mChamber, id.data, id.size(), ZMQ_SNDMORE | ZMQ_DONTWAIT) < 0) {
+         if (zmq_errno() == EAGAIN) {
+            break;
+         }
+         error = zmq_strerror(zmq_errno());
+         LOG(WARNING) << "queue error " << error;
+         request.handler(false, error);
+         continue;
+      }
+      // the rest of a message is always taken once its first frame was
+      if (zmq_send(mChamber, request.command.data(), request.command.size(), ZMQ_DONTWAIT) < 0) {
+         error = zmq_strerror(zmq_errno());
+         LOG(WARNING) << "queue error " << error;
+         request.handler(false, error);
+         continue;
+      }
+      Outstanding& outstanding = mOutstanding[id];
+      outstanding.handler = std::move(request.handler);
+      outstanding.timer = mExpiry.Add(id, expiry);
+      ++sent;
+   }
+   if (mSendingOffset == mSending.size()) {
+      mSending.clear();
+      mSendingOffset = 0;
+   }
+   if (sent != 0) {
+      mSendBatches.fetch_add(1, std::memory_order_relaxed);
+      mOutstandingCount.store(mOutstanding.Size(), std::memory_order_relaxed);
+   }
+   return sent;
+}
+
+/**
+ * Complete the requests whose replies are waiting on the socket
+ * @return
+ *   The replies read
+ */
+size_t SharedBoomStick::ReadReplies() {
+   size_t read = 0;
+   std::string reply;
+   while (read < kReadBatch && CZMQToolkit::IsReadable(mChamber)) {
+      zmsg_t* msg = zmsg_recv(mChamber);
+      if (!msg) {
+         break;
+      }
+      ++read;
+      zframe_t* idFrame = zmsg_first(msg);
+      zframe_t* replyFrame = zmsg_next(msg);
+      RequestId id;
+      if (zmsg_size(msg) != 2 || zframe_size(idFrame) != id.size()) {
+         LOG(WARNING) << "Malformed reply, expecting a 16 byte id and the reply";
+      } else {
+         memcpy(id.data, zframe_data(idFrame), id.size());
+         Outstanding* outstanding = mOutstanding.Find(id);
+         if (nullptr == outstanding) {
+            LOG(WARNING) << "Found unmatched reply to unknown hash " << BoomStick::FormatUuid(id);
+         } else {
+            ReplyHandler handler = std::move(outstanding->handler);
+            mExpiry.Cancel(outstanding->timer);
+            mOutstanding.Erase(id);
+            reply.assign(reinterpret_cast<const char*> (zframe_data(replyFrame)), zframe_size(replyFrame));
+            handler(true, reply);
+         }
+      }
+      zmsg_destroy(&msg);
+   }
+   if (read != 0) {
+      mOutstandingCount.store(mOutstanding.Size(), std::memory_order_relaxed);
+   }
+   return read;
+}
+
+/**
+ * Fail the requests past their TTL, a wheel turn at most once a second
+ */
+void SharedBoomStick::ExpireRequests() {
+   mExpiry.Advance(time(NULL), [this](const RequestId & id) {
+      Outstanding* outstanding = mOutstanding.Find(id);
+      if (nullptr != outstanding) {
+         mExpired.push_back(std::move(outstanding->handler));
+         mOutstanding.Erase(id);
+      }
+   });
+   if (mExpired.empty()) {
+      return;
+   }
+   LOG(WARNING) << "SharedBoomStick timed out " << mExpired.size() << " requests";
+   std::string reply;
+   for (auto& handler : mExpired) {
+      reply = "Timed out searching for reply";
+      handler(false, reply);
+   }
+   mExpired.clear();
+   mOutstandingCount.store(mOutstanding.Size(), std::memory_order_relaxed);
+}
+
+/**
+ * Fail every request not answered yet, with the IO thread stopped
+ * @param why
+ */
+void SharedBoomStick::FailAll(const std::string& why) {
+   std::vector<Request> queued;
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      queued.swap(mQueued);
+   }
+   std::vector<ReplyHandler> failed;
+   for (size_t i = mSendingOffset; i < mSending.size(); ++i) {
+      failed.push_back(std::move(mSending[i].handler));
+   }
+   mSending.clear();
+   mSendingOffset = 0;
+   for (auto& request : queued) {
+      failed.push_back(std::move(request.handler));
+   }
+   mOutstanding.ForEach([&failed](const RequestId&, Outstanding & outstanding) {
+      failed.push_back(std::move(outstanding.handler));
+   });
+   mOutstanding.Clear();
+   mExpiry.Clear();
+   mOutstandingCount.store(0, std::memory_order_relaxed);
+   std::string reply;
+   for (auto& handler : failed) {
+      reply = why;
+      handler(false, reply);
+   }
+}
+
+/**
+ * Stop and close the connection
+ */
+SharedBoomStick::~SharedBoomStick() {
+   Stop();
+   if (nullptr != mCtx) {
+      ContextRegistry::Instance().Release(mCtx);
+   }
+}
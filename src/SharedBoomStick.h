@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include "ExpiryWheel.h"
+#include "SpscRing.h"
+#include "UuidMap.h"
+struct _zctx_t;
+typedef struct _zctx_t zctx_t;
+
+/**
+ * One BoomStick connection for every thread of a process. Any thread sends
+ * a command and gets the reply through a future or a callback, while a single
+ * IO thread owns the DEALER socket: each time it wakes up it sends everything
+ * queued since, then completes requests in whatever order their replies come.
+ *
+ * Requests go out in the BoomStick format, so a Skelleton serves both.
+ * Callbacks run on the IO thread and should not block, every other reply
+ * waits for them. Initialize and Stop belong to the owner of the object.
+ */
+class SharedBoomStick {
+public:
+   /// Handed the reply, or what went wrong when success is false
+   typedef std::function<void(const bool success, std::string& reply)> ReplyHandler;
+
+   explicit SharedBoomStick(const std::string& binding);
+   SharedBoomStick(const SharedBoomStick&) = delete;
+   SharedBoomStick& operator=(const SharedBoomStick&) = delete;
+
+   void SetSendHWM(const int hwm);
+   void SetRecvHWM(const int hwm);
+   void SetSharedContext(const std::string& name, const uint64_t affinity = 0);
+   void SetRequestTtl(const unsigned int seconds);
+   bool Initialize();
+   std::future<std::string> Send(const std::string& command);
+   bool Send(const std::string& command, ReplyHandler handler);
+   void Stop();
+   bool IsRunning() const;
+   size_t GetOutstanding() const;
+   uint64_t GetSendBatches() const;
+   virtual ~SharedBoomStick();
+
+private:
+   typedef boost::uuids::uuid RequestId;
+
+   struct Request {
+      std::string command;
+      ReplyHandler handler;
+   };
+
+   struct Outstanding {
+      ReplyHandler handler;
+      ExpiryWheel::Handle timer;
+   };
+   void Run();
+   bool HasQueued();
+   size_t SendQueued();
+   size_t ReadReplies();
+   void ExpireRequests();
+   void FailAll(const std::string& why);
+
+   std::string mBinding;
+   int mSendHWM;
+   int mRecvHWM;
+   std::string mContextName;
+   uint64_t mAffinity;
+   unsigned int mRequestTtl;
+   zctx_t* mCtx;
+   void* mChamber;
+   std::thread mThread;
+
+   // guards the requests handed over by the senders
+   mutable std::mutex mMutex;
+   bool mAccepting;
+   std::vector<Request> mQueued;
+   RingSignal mWakeUp;
+   std::atomic<bool> mStop;
+   std::atomic<size_t> mOutstandingCount;
+   std::atomic<uint64_t> mSendBatches;
+
+   // only touched by the IO thread while it runs
+   std::vector<Request> mSending;
+   size_t mSendingOffset;
+   UuidMap<Outstanding> mOutstanding;
+   ExpiryWheel mExpiry;
+   std::vector<ReplyHandler> mExpired;
+   boost::mt19937 mRan;
+   boost::uuids::basic_random_generator<boost::mt19937> mUuidGen;
+};
@@ -0,0 +1,275 @@
+#include "ShotBatch.h"
+
+const size_t ShotBatch::kMaxVarintSize;
+
+/**
+ * @return a copy of the bullet
+ */
+std::string ShotBatch::Shot::ToString() const {
+   return std::string(reinterpret_cast<const char*> (data), size);
+}
+
+/**
+ * The end iterator.
+ */
+ShotBatch::const_iterator::const_iterator() : mPosition(nullptr), mEnd(nullptr), mSingle(false),
+mShot({nullptr, 0}) {
+}
+
+/**
+ * An iterator at a shot of a frame that has already been parsed.
+ * @param position
+ * @param end
+ * @param single
+ *   The frame is one plain bullet without a length prefix
+ */
+ShotBatch::const_iterator::const_iterator(const uint8_t* position, const uint8_t* end, const bool single) :
+mPosition(position), mEnd(end), mSingle(single), mShot({nullptr, 0}) {
+   Read();
+}
+
+const ShotBatch::Shot& ShotBatch::const_iterator::operator*() const {
+   return mShot;
+}
+
+const ShotBatch::Shot* ShotBatch::const_iterator::operator->() const {
+   return &mShot;
+}
+
+ShotBatch::const_iterator& ShotBatch::const_iterator::operator++() {
+   mPosition = mShot.data + mShot.size;
+   Read();
+   return *this;
+}
+
+ShotBatch::const_iterator ShotBatch::const_iterator::operator++(int) {
+   const_iterator before(*this);
+   ++(*this);
+   return before;
+}
+
+bool ShotBatch::const_iterator::operator==(const const_iterator& other) const {
+   return mPosition == other.mPosition;
+}
+
+bool ShotBatch::const_iterator::operator!=(const const_iterator& other) const {
+   return !(*this == other);
+}
+
+/**
+ * Decode the shot at the position, or become the end iterator past the last.
+ */
+void ShotBatch::const_iterator::Read() {
+   if (mPosition == nullptr || mPosition >= mEnd) {
+      mPosition = nullptr;
+      mShot = {nullptr, 0};
+      return;
+   }
+   uint64_t length = mEnd - mPosition;
+   if (!mSingle) {
+      ShotBatch::ReadLength(mPosition, mEnd, length);
+   }
+   mShot = {mPosition, static_cast<size_t> (length)};
+}
+
+/**
+ * An empty batch.
+ */
+ShotBatch::ShotBatch() : mOffset(0), mCount(0), mBytes(0), mSingle(false) {
+}
+
+/**
+ * Move constructor, other is left empty
+ * @param other
+ */
+ShotBatch::ShotBatch(ShotBatch&& other) : mFrame(std::move(other.mFrame)), mOffset(other.mOffset),
+mCount(other.mCount), mBytes(other.mBytes), mSingle(other.mSingle) {
+   other.Reset();
+}
+
+/**
+ * Move assignment, other is left empty
+ * @param other
+ * @return
+ */
+ShotBatch& ShotBatch::operator=(ShotBatch&& other) {
+   if (this != &other) {
+      mFrame = std::move(other.mFrame);
+      mOffset = other.mOffset;
+      mCount = other.mCount;
+      mBytes = other.mBytes;
+      mSingle = other.mSingle;
+      other.Reset();
+   }
+   return *this;
+}
+
+/**
+ * Hold a batch frame.
+ * @param frame
+ *   Moved from
+ * @return
+ *   false if the frame is not a valid batch, the batch is then empty
+ */
+bool ShotBatch::Assign(ZeroCopyMessage&& frame) {
+   Reset();
+   size_t count = 0;
+   size_t bytes = 0;
+   if (!Parse(frame.Data(), frame.Size(), count, bytes)) {
+      frame.Reset();
+      return false;
+   }
+   mFrame = std::move(frame);
+   mCount = count;
+   mBytes = bytes;
+   return true;
+}
+
+/**
+ * Hold a plain bullet as a batch of one.
+ * @param bullet
+ *   Moved from
+ */
+void ShotBatch::AssignSingle(ZeroCopyMessage&& bullet) {
+   Reset();
+   mFrame = std::move(bullet);
+   mSingle = true;
+   mCount = mFrame.Empty() ? 0 : 1;
+   mBytes = mFrame.Size();
+}
+
+/**
+ * Take the next shot off the front of the batch.
+ * @param shot
+ *   A view into the frame
+ * @return
+ *   false if the batch is empty
+ */
+bool ShotBatch::Next(Shot& shot) {
+   if (mCount == 0) {
+      return false;
+   }
+   const_iterator first(mFrame.Data() + mOffset, mFrame.Data() + mFrame.Size(), mSingle);
+   shot = *first;
+   mOffset = (shot.data + shot.size) - mFrame.Data();
+   --mCount;
+   mBytes -= shot.size;
+   return true;
+}
+
+/**
+ * @return the number of shots left
+ */
+size_t ShotBatch::Size() const {
+   return mCount;
+}
+
+/**
+ * @return the bytes of the shots left, without the length prefixes
+ */
+size_t ShotBatch::Bytes() const {
+   return mBytes;
+}
+
+/**
+ * @return if there are no shots left
+ */
+bool ShotBatch::Empty() const {
+   return mCount == 0;
+}
+
+/**
+ * @return an iterator at the first shot left
+ */
+ShotBatch::const_iterator ShotBatch::begin() const {
+   if (mCount == 0) {
+      return end();
+   }
+   return const_iterator(mFrame.Data() + mOffset, mFrame.Data() + mFrame.Size(), mSingle);
+}
+
+/**
+ * @return the iterator past the last shot
+ */
+ShotBatch::const_iterator ShotBatch::end() const {
+   return const_iterator();
+}
+
+/**
+ * Release the frame.
+ */
+void ShotBatch::Reset() {
+   mFrame.Reset();
+   mOffset = 0;
+   mCount = 0;
+   mBytes = 0;
+   mSingle = false;
+}
+
+/**
+ * Add a bullet to a batch frame.
+ * @param frame
+ * @param data
+ * @param size
+ */
+void ShotBatch::Append(std::string& frame, const void* data, const size_t size) {
+   uint64_t length = size;
+   while (length >= 0x80) {
+      frame.push_back(static_cast<char> ((length & 0x7f) | 0x80));
+      length >>= 7;
+   }
+   frame.push_back(static_cast<char> (length));
+   frame.append(reinterpret_cast<const char*> (data), size);
+}
+
+/**
+ * Check that a frame is made of whole, non empty, length prefixed bullets.
+ * @param data
+ * @param size
+ * @param count
+ *   Set to the number of bullets
+ * @param bytes
+ *   Set to the bytes of the bullets, without the prefixes
+ * @return
+ *   false if the frame is empty or malformed
+ */
+bool ShotBatch::Parse(const uint8_t* data, const size_t size, size_t& count, size_t& bytes) {
+   count = 0;
+   bytes = 0;
+   const uint8_t* position = data;
+   const uint8_t* end = data + size;
+   while (position < end) {
+      uint64_t length = 0;
+      if (!ReadLength(position, end, length) || length == 0 ||
+         length > static_cast<uint64_t> (end - position)) {
+         count = 0;
+         bytes = 0;
+         return false;
+      }
+      position += length;
+      bytes += length;
+      ++count;
+   }
+   return count != 0;
+}
+
+/**
+ * Decode a varint length prefix.
+ * @param position
+ *   Moved past the prefix
+ * @param end
+ * @param length
+ * @return
+ *   false if the prefix runs past the end or is too long
+ */
+bool ShotBatch::ReadLength(const uint8_t*& position, const uint8_t* end, uint64_t& length) {
+   length = 0;
+   for (size_t shift = 0; position < end && shift < (kMaxVarintSize * 7); shift += 7) {
+      const uint8_t byte = *position++;
+      length |= static_cast<uint64_t> (byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) {
+         return true;
+      }
+   }
+   return false;
+}
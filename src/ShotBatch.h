@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include "ZeroCopyMessage.h"
+
+/**
+ * Many small bullets packed into one frame, each prefixed with its length
+ * as a varint (7 bits a byte, low bits first). A Rifle fills the frame with
+ * FireBatched and a Vampire hands it out with GetBatch, where the bullets
+ * are read in place as views into the received frame.
+ *
+ * A plain single bullet can be held as well, it is then the only shot.
+ */
+class ShotBatch {
+public:
+   /// A view of one bullet, valid while the batch holds the frame and is not moved
+   struct Shot {
+      const uint8_t* data;
+      size_t size;
+      std::string ToString() const;
+   };
+
+   class const_iterator : public std::iterator<std::forward_iterator_tag, Shot> {
+   public:
+      const_iterator();
+      const_iterator(const uint8_t* position, const uint8_t* end, const bool single);
+      const Shot& operator*() const;
+      const Shot* operator->() const;
+      const_iterator& operator++();
+      const_iterator operator++(int);
+      bool operator==(const const_iterator& other) const;
+      bool operator!=(const const_iterator& other) const;
+   private:
+      void Read();
+      const uint8_t* mPosition;
+      const uint8_t* mEnd;
+      bool mSingle;
+      Shot mShot;
+   };
+
+   ShotBatch();
+   ShotBatch(ShotBatch&& other);
+   ShotBatch& operator=(ShotBatch&& other);
+   ShotBatch(const ShotBatch&) = delete;
+   ShotBatch& operator=(const ShotBatch&) = delete;
+
+   bool Assign(ZeroCopyMessage&& frame);
+   void AssignSingle(ZeroCopyMessage&& bullet);
+   bool Next(Shot& shot);
+   size_t Size() const;
+   size_t Bytes() const;
+   bool Empty() const;
+   const_iterator begin() const;
+   const_iterator end() const;
+   void Reset();
+
+   static const size_t kMaxVarintSize = 10;
+   static void Append(std::string& frame, const void* data, const size_t size);
+   static bool Parse(const uint8_t* data, const size_t size, size_t& count, size_t& bytes);
+
+private:
+   static bool ReadLength(const uint8_t*& position, const uint8_t* end, uint64_t& length);
+
+   ZeroCopyMessage mFrame;
+   // read position as an offset, the frame's data can move with the frame
+   size_t mOffset;
+   size_t mCount;
+   size_t mBytes;
+   bool mSingle;
+};
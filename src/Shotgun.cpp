@@ -5,13 +5,28 @@
 #include "g3log/g3log.hpp"
 #include "czmq.h"
 #include "Death.h"
+#include "CZMQToolkit.h"
+#include "ContextRegistry.h"
 /**
  * Shotgun class is a ZeroMQ Publisher.
  */
-Shotgun::Shotgun() {
-   mCtx = zctx_new();
+Shotgun::Shotgun() : Shotgun(std::string()) {
+}
+
+/**
+ * Shotgun whose socket is created on a context shared through the ContextRegistry.
+ * @param sharedContext
+ *   The ContextRegistry name, empty for a private context
+ * @param affinity
+ *   Bit mask of the shared context's IO threads to use, 0 for any
+ */
+Shotgun::Shotgun(const std::string& sharedContext, const uint64_t affinity) {
+   mCtx = sharedContext.empty() ? zctx_new() : ContextRegistry::Instance().Acquire(sharedContext);
    assert(mCtx);
    mGun = zsocket_new(mCtx, ZMQ_PUB);
+   if (affinity) {
+      CZMQToolkit::SetAffinity(mGun, affinity);
+   }
 }
 
 /**
@@ -63,6 +78,26 @@ void Shotgun::Fire(const std::string& bullet) {
    Fire(bullets);
 }
 
+/**
+ * Fire our shotgun without copying the bullet, the buffer is taken over and
+ * released by ZeroMQ once every subscriber has been sent it.
+ * @param msg
+ */
+void Shotgun::Fire(std::string&& bullet) {
+   static const char dummy[] = "dummy";
+   zmq_msg_t body;
+   if (!CZMQToolkit::InitMessageTakingOwnership(body, std::move(bullet))) {
+      LOG(WARNING) << "could not create message " << zmq_strerror(zmq_errno());
+      return;
+   }
+   if (zmq_send(mGun, "key", 0, ZMQ_SNDMORE) < 0 ||
+      zmq_send(mGun, dummy, sizeof (dummy) - 1, ZMQ_SNDMORE) < 0 ||
+      zmq_msg_send(&body, mGun, 0) < 0) {
+      LOG(WARNING) << "could not send message";
+   }
+   zmq_msg_close(&body);
+}
+
 /**
  * Fire our shotgun, hopefully we hit something.
  * @param msg
@@ -90,6 +125,6 @@ void Shotgun::Fire(const std::vector<std::string>& bullets) {
  */
 Shotgun::~ Shotgun() {
    zsocket_destroy(mCtx, mGun);
-   zctx_destroy(&mCtx);
+   ContextRegistry::Instance().Release(mCtx);
 }
 
@@ -4,13 +4,16 @@
 #include <stdlib.h>
 #include <vector>
 #include <string>
+#include <cstdint>
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
 class Shotgun {
 public:
    Shotgun();
+   explicit Shotgun(const std::string& sharedContext, const uint64_t affinity = 0);
    void Aim(const std::string& location);
    void Fire(const std::string& msg);
+   void Fire(std::string&& msg);
    void Fire(const std::vector<std::string>& bullets);
    virtual ~Shotgun();
 private:
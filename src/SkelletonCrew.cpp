@@ -0,0 +1,303 @@
+#include "SkelletonCrew.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+#include "g3log/g3log.hpp"
+#include "CZMQToolkit.h"
+
+const size_t SkelletonCrew::kMaxQueueDepth;
+
+namespace {
+   // how often an idle thread looks for Stop
+   const int kPollTimeoutMs = 100;
+   // most messages moved from one socket before the other gets a turn
+   const size_t kForwardBatch = 256;
+   // worker identities are this and the worker's number, never a 0 byte first
+   const char kWorkerPrefix = 'w';
+}
+
+/**
+ * A crew that is not yet serving
+ * @param binding
+ *   Bound on Initialize
+ * @param workers
+ *   Threads to run the handler on, at least one
+ * @param handler
+ */
+SkelletonCrew::SkelletonCrew(const std::string& binding, const size_t workers, CommandHandler handler) :
+Skelleton(binding),
+mWorkerCount(std::max<size_t>(workers, 1)),
+mHandler(std::move(handler)),
+mBackend(nullptr),
+mStats(mWorkerCount),
+mStop(false) {
+   for (auto& stats : mStats) {
+      stats.depth.store(0);
+      stats.handled.store(0);
+   }
+}
+
+/**
+ * Bind the ROUTER for clients, connect the workers and start the threads
+ * @return
+ *   true when successful, or already running
+ */
+bool SkelletonCrew::Initialize() {
+   if (!mThreads.empty()) {
+      return true;
+   }
+   mContext = zctx_new();
+   if (!mContext) {
+      LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
+      return false;
+   }
+   mFace = zsocket_new(mContext, ZMQ_ROUTER);
+   mBackend = zsocket_new(mContext, ZMQ_ROUTER);
+   std::stringstream backendBinding;
+   backendBinding << "inproc://skelletoncrew" << this;
+   if (!mFace || !mBackend || zsocket_bind(mFace, mBinding.c_str()) < 0
+      || zsocket_bind(mBackend, backendBinding.str().c_str()) < 0) {
+      LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
+      zctx_destroy(&mContext);
+      mFace = nullptr;
+      mBackend = nullptr;
+      return false;
+   }
+   mWorkerSockets.clear();
+   mIdentities.clear();
+   for (size_t worker = 0; worker < mWorkerCount; ++worker) {
+      mIdentities.push_back(kWorkerPrefix + std::to_string(worker));
+      void* socket = zsocket_new(mContext, ZMQ_DEALER);
+      if (!socket) {
+         LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
+         zctx_destroy(&mContext);
+         mFace = nullptr;
+         mBackend = nullptr;
+         return false;
+      }
+      zsocket_set_identity(socket, mIdentities.back().c_str());
+      if (zsocket_connect(socket, backendBinding.str().c_str()) < 0) {
+         LOG(WARNING) << "queue error " << zmq_strerror(zmq_errno());
+         zctx_destroy(&mContext);
+         mFace = nullptr;
+         mBackend = nullptr;
+         return false;
+      }
+      mWorkerSockets.push_back(socket);
+      mStats[worker].depth.store(0);
+   }
+   mStop.store(false);
+   // the sockets belong to their threads from here on
+   for (void* socket : mWorkerSockets) {
+      mThreads.emplace_back(&SkelletonCrew::RunWorker, this, socket);
+   }
+   mThreads.emplace_back(&SkelletonCrew::RunBroker, this);
+   return true;
+}
+
+/**
+ * Stop serving and unbind, requests not answered yet are dropped
+ */
+void SkelletonCrew::Stop() {
+   mStop.store(true);
+   for (auto& thread : mThreads) {
+      thread.join();
+   }
+   mThreads.clear();
+   if (mContext) {
+      zctx_destroy(&mContext);
+      mFace = nullptr;
+      mBackend = nullptr;
+      mWorkerSockets.clear();
+   }
+}
+
+/**
+ * @return if the threads are started
+ */
+bool SkelletonCrew::IsRunning() const {
+   return !mThreads.empty();
+}
+
+size_t SkelletonCrew::GetWorkerCount() const {
+   return mWorkerCount;
+}
+
+/**
+ * @param worker
+ * @return requests handed to the worker and not answered yet, 0 for a worker
+ * that does not exist
+ */
+size_t SkelletonCrew::GetQueueDepth(const size_t worker) const {
+   if (worker >= mWorkerCount) {
+      return 0;
+   }
+   return mStats[worker].depth.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return the queue depth of every worker
+ */
+std::vector<size_t> SkelletonCrew::GetQueueDepths() const {
+   std::vector<size_t> depths;
+   for (const auto& stats : mStats) {
+      depths.push_back(stats.depth.load(std::memory_order_relaxed));
+   }
+   return depths;
+}
+
+/**
+ * @param worker
+ * @return requests the worker has answered
+ */
+uint64_t SkelletonCrew::GetHandled(const size_t worker) const {
+   if (worker >= mWorkerCount) {
+      return 0;
+   }
+   return mStats[worker].handled.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return requests the crew has answered
+ */
+uint64_t SkelletonCrew::GetHandled() const {
+   uint64_t handled = 0;
+   for (const auto& stats : mStats) {
+      handled += stats.handled.load(std::memory_order_relaxed);
+   }
+   return handled;
+}
+
+/**
+ * Move replies out and requests in until stopped. Clients are only read
+ * while a worker has room.
+ */
+void SkelletonCrew::RunBroker() {
+   zmq_pollitem_t items[2];
+   items[0] = {mBackend, 0, ZMQ_POLLIN, 0};
+   items[1] = {mFace, 0, ZMQ_POLLIN, 0};
+   while (!mStop.load() && !zctx_interrupted) {
+      const bool room = GetQueueDepth(LeastLoaded()) < kMaxQueueDepth;
+      const int pollResult = zmq_poll(items, room ? 2 : 1, kPollTimeoutMs);
+      if (pollResult < 0) {
+         const int err = zmq_errno();
+         if (err == ETERM) {
+            LOG(INFO) << "SkelletonCrew context terminated";
+            return;
+         }
+         if (err != EINTR) {
+            LOG(WARNING) << "SkelletonCrew error in zmq_poll: " << zmq_strerror(err);
+         }
+         continue;
+      }
+      if (items[0].revents & ZMQ_POLLIN) {
+         ForwardReplies();
+      }
+      if (room && (items[1].revents & ZMQ_POLLIN)) {
+         DispatchRequests();
+      }
+   }
+}
+
+/**
+ * Send the replies waiting on the backend to their clients, without the
+ * worker's envelope
+ */
+void SkelletonCrew::ForwardReplies() {
+   for (size_t forwarded = 0; forwarded < kForwardBatch && CZMQToolkit::IsReadable(mBackend); ++forwarded) {
+      zmsg_t* msg = zmsg_recv(mBackend);
+      if (!msg) {
+         return;
+      }
+      zframe_t* worker = zmsg_pop(msg);
+      const size_t size = worker ? zframe_size(worker) : 0;
+      const char* identity = worker ? reinterpret_cast<const char*> (zframe_data(worker)) : nullptr;
+      if (size > 1 && identity[0] == kWorkerPrefix) {
+         const size_t index = strtoul(std::string(identity + 1, size - 1).c_str(), nullptr, 10);
+         if (index < mWorkerCount) {
+            mStats[index].depth.fetch_sub(1, std::memory_order_relaxed);
+            mStats[index].handled.fetch_add(1, std::memory_order_relaxed);
+         }
+      }
+      if (worker) {
+         zframe_destroy(&worker);
+      }
+      zmsg_send(&msg, mFace);
+   }
+}
+
+/**
+ * Hand the requests waiting on the client socket to the least loaded workers,
+ * while any of them has room
+ */
+void SkelletonCrew::DispatchRequests() {
+   for (size_t dispatched = 0; dispatched < kForwardBatch && CZMQToolkit::IsReadable(mFace); ++dispatched) {
+      const size_t worker = LeastLoaded();
+      if (mStats[worker].depth.load(std::memory_order_relaxed) >= kMaxQueueDepth) {
+         return;
+      }
+      zmsg_t* msg = zmsg_recv(mFace);
+      if (!msg) {
+         return;
+      }
+      // client envelope, id and command; anything shorter can't be answered
+      if (zmsg_size(msg) < 3) {
+         LOG(WARNING) << "Malformed request, expecting an id and a command";
+         zmsg_destroy(&msg);
+         continue;
+      }
+      zmsg_pushmem(msg, mIdentities[worker].data(), mIdentities[worker].size());
+      mStats[worker].depth.fetch_add(1, std::memory_order_relaxed);
+      zmsg_send(&msg, mBackend);
+   }
+}
+
+/**
+ * @return the worker with the fewest requests outstanding, the first on a tie
+ */
+size_t SkelletonCrew::LeastLoaded() const {
+   size_t least = 0;
+   size_t leastDepth = mStats[0].depth.load(std::memory_order_relaxed);
+   for (size_t worker = 1; worker < mWorkerCount && leastDepth != 0; ++worker) {
+      const size_t depth = mStats[worker].depth.load(std::memory_order_relaxed);
+      if (depth < leastDepth) {
+         least = worker;
+         leastDepth = depth;
+      }
+   }
+   return least;
+}
+
+/**
+ * Answer requests until stopped, the last frame is the command and is
+ * replaced by the reply, the frames before it go back as they came
+ * @param socket
+ *   The worker's DEALER
+ */
+void SkelletonCrew::RunWorker(void* socket) {
+   std::string command;
+   std::string reply;
+   while (!mStop.load() && !zctx_interrupted) {
+      if (!zsocket_poll(socket, kPollTimeoutMs)) {
+         continue;
+      }
+      zmsg_t* msg = zmsg_recv(socket);
+      if (!msg) {
+         continue;
+      }
+      zframe_t* commandFrame = zmsg_last(msg);
+      command.assign(reinterpret_cast<const char*> (zframe_data(commandFrame)), zframe_size(commandFrame));
+      reply.clear();
+      mHandler(command, reply);
+      zframe_reset(commandFrame, reply.data(), reply.size());
+      zmsg_send(&msg, socket);
+   }
+}
+
+/**
+ * Stop, the context goes with it
+ */
+SkelletonCrew::~SkelletonCrew() {
+   Stop();
+}
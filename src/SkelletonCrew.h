@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Skelleton.h"
+
+/**
+ * A Skelleton that serves BoomSticks from a crew of worker threads. One
+ * broker thread owns the ROUTER that clients connect to and hands each
+ * request to the worker with the fewest requests outstanding, over an inproc
+ * ROUTER that the workers' DEALERs connect to. Replies go back through the
+ * broker with the client's envelope untouched, so [id, command] comes back as
+ * [id, reply] as BoomStick expects.
+ *
+ * A worker is given at most a bounded number of requests at a time, when all
+ * of them are that busy the broker stops reading from clients until one
+ * catches up. The handler runs on the worker threads, at the same time.
+ */
+class SkelletonCrew : public Skelleton {
+public:
+   /// Turns a command into its reply, called on a worker thread
+   typedef std::function<void(const std::string& command, std::string& reply)> CommandHandler;
+
+   SkelletonCrew(const std::string& binding, const size_t workers, CommandHandler handler);
+   SkelletonCrew(const SkelletonCrew&) = delete;
+   SkelletonCrew& operator=(const SkelletonCrew&) = delete;
+
+   bool Initialize() override;
+   void Stop();
+   bool IsRunning() const;
+   size_t GetWorkerCount() const;
+   size_t GetQueueDepth(const size_t worker) const;
+   std::vector<size_t> GetQueueDepths() const;
+   uint64_t GetHandled(const size_t worker) const;
+   uint64_t GetHandled() const;
+   virtual ~SkelletonCrew();
+
+   static const size_t kMaxQueueDepth = 256;
+
+private:
+
+   struct WorkerStats {
+      // requests handed to the worker and not answered yet
+      std::atomic<size_t> depth;
+      std::atomic<uint64_t> handled;
+   };
+   void RunBroker();
+   void RunWorker(void* socket);
+   size_t LeastLoaded() const;
+   void ForwardReplies();
+   void DispatchRequests();
+
+   const size_t mWorkerCount;
+   CommandHandler mHandler;
+   void* mBackend;
+   std::vector<void*> mWorkerSockets;
+   std::vector<std::string> mIdentities;
+   std::vector<WorkerStats> mStats;
+   std::vector<std::thread> mThreads;
+   std::atomic<bool> mStop;
+};
@@ -0,0 +1,363 @@
+#include "SpillLog.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <g3log/g3log.hpp>
+
+const size_t SpillLog::kHeaderSize;
+const size_t SpillLog::kLengthSize;
+
+namespace {
+   // "QSPL", marks a file as a spill segment
+   const uint32_t kSegmentMagic = 0x4c505351;
+   const size_t kReadOffsetPosition = 8;
+   const size_t kMinimumSegmentBytes = 4096;
+   const char kSegmentPrefix[] = "spill.";
+}
+
+/**
+ * A log that is not yet open.
+ * @param directory
+ *   Where the segment files go, created if missing
+ * @param segmentBytes
+ *   Size of each segment file, the largest record has to fit in one
+ * @param maxSegments
+ *   Most segment files, Append fails when they are all full
+ */
+SpillLog::SpillLog(const std::string& directory, const size_t segmentBytes, const size_t maxSegments) :
+mDirectory(directory),
+mSegmentBytes(std::max(segmentBytes, kMinimumSegmentBytes)),
+mMaxSegments(std::max<size_t>(maxSegments, 1)),
+mNextSequence(0),
+mCount(0),
+mBytes(0) {
+}
+
+/**
+ * Create the directory, or pick up the unread records of the segments
+ * already in it.
+ * @return
+ *   false if the directory can't be used
+ */
+bool SpillLog::Open() {
+   Close();
+   if (mkdir(mDirectory.c_str(), 0755) != 0 && errno != EEXIST) {
+      LOG(WARNING) << "SpillLog can't create " << mDirectory << ": " << strerror(errno);
+      return false;
+   }
+   DIR* directory = opendir(mDirectory.c_str());
+   if (directory == nullptr) {
+      LOG(WARNING) << "SpillLog can't read " << mDirectory << ": " << strerror(errno);
+      return false;
+   }
+   std::vector<uint64_t> sequences;
+   const size_t prefixSize = sizeof (kSegmentPrefix) - 1;
+   while (dirent* entry = readdir(directory)) {
+      const std::string name(entry->d_name);
+      if (name.size() <= prefixSize || name.compare(0, prefixSize, kSegmentPrefix) != 0 ||
+         name.find_first_not_of("0123456789", prefixSize) != std::string::npos) {
+         continue;
+      }
+      sequences.push_back(std::stoull(name.substr(prefixSize)));
+   }
+   closedir(directory);
+   std::sort(sequences.begin(), sequences.end());
+
+   for (const uint64_t sequence : sequences) {
+      mNextSequence = sequence + 1;
+      Segment segment;
+      if (!OpenSegment(sequence, false, segment)) {
+         continue;
+      }
+      size_t offset = ReadOffset(segment);
+      if (offset < kHeaderSize || offset > segment.size) {
+         LOG(WARNING) << "SpillLog skipping damaged segment " << SegmentPath(sequence);
+         CloseSegment(segment, false);
+         continue;
+      }
+      size_t count = 0;
+      while (offset + kLengthSize <= segment.size) {
+         const uint32_t length = LengthAt(segment, offset);
+         if (length == 0 || offset + kLengthSize + length > segment.size) {
+            break;
+         }
+         offset += kLengthSize + length;
+         mBytes += length;
+         ++count;
+      }
+      segment.writeOffset = offset;
+      if (count == 0) {
+         CloseSegment(segment, true);
+         continue;
+      }
+      mCount += count;
+      mSegments.push_back(segment);
+   }
+   if (mCount != 0) {
+      LOG(INFO) << "SpillLog found " << mCount << " unread records in " << mDirectory;
+   }
+   return true;
+}
+
+/**
+ * Add a record at the back.
+ * @param data
+ * @param size
+ * @return
+ *   false if it is empty, too large for a segment or every segment is full
+ */
+bool SpillLog::Append(const void* data, const size_t size) {
+   if (size == 0 || size > std::numeric_limits<uint32_t>::max() ||
+      kHeaderSize + kLengthSize + size > mSegmentBytes) {
+      return false;
+   }
+   if (mSegments.empty() || mSegments.back().writeOffset + kLengthSize + size > mSegments.back().size) {
+      if (!NewSegment()) {
+         return false;
+      }
+   }
+   Segment& segment = mSegments.back();
+   const size_t offset = segment.writeOffset;
+   const size_t end = offset + kLengthSize + size;
+   memcpy(segment.map + offset + kLengthSize, data, size);
+   // end the records again, the space may hold records of an earlier round
+   if (end + kLengthSize <= segment.size) {
+      SetLengthAt(segment, end, 0);
+   }
+   SetLengthAt(segment, offset, static_cast<uint32_t> (size));
+   segment.writeOffset = end;
+   ++mCount;
+   mBytes += size;
+   return true;
+}
+
+/**
+ * Look at the record at the front.
+ * @param data
+ *   Points into the mapped segment until Pop
+ * @param size
+ * @return
+ *   false if the log is empty
+ */
+bool SpillLog::Front(const uint8_t*& data, size_t& size) const {
+   if (mCount == 0) {
+      return false;
+   }
+   const Segment& segment = mSegments.front();
+   const size_t offset = ReadOffset(segment);
+   data = segment.map + offset + kLengthSize;
+   size = LengthAt(segment, offset);
+   return true;
+}
+
+/**
+ * Drop the record at the front, deleting its segment if it was the last one
+ * there and a newer segment exists.
+ */
+void SpillLog::Pop() {
+   if (mCount == 0) {
+      return;
+   }
+   Segment& segment = mSegments.front();
+   const size_t offset = ReadOffset(segment);
+   const uint32_t length = LengthAt(segment, offset);
+   SetReadOffset(segment, offset + kLengthSize + length);
+   --mCount;
+   mBytes -= length;
+   if (ReadOffset(segment) < segment.writeOffset) {
+      return;
+   }
+   if (mSegments.size() > 1) {
+      CloseSegment(segment, true);
+      mSegments.pop_front();
+   } else {
+      // the only segment is written again from the start
+      SetLengthAt(segment, kHeaderSize, 0);
+      SetReadOffset(segment, kHeaderSize);
+      segment.writeOffset = kHeaderSize;
+   }
+}
+
+/**
+ * @return if there are no records
+ */
+bool SpillLog::Empty() const {
+   return mCount == 0;
+}
+
+/**
+ * @return the number of records
+ */
+size_t SpillLog::Size() const {
+   return mCount;
+}
+
+/**
+ * @return the bytes of the records, without their lengths
+ */
+size_t SpillLog::Bytes() const {
+   return mBytes;
+}
+
+/**
+ * @return the number of segment files in use
+ */
+size_t SpillLog::GetSegmentCount() const {
+   return mSegments.size();
+}
+
+/**
+ * @return where the segment files are
+ */
+std::string SpillLog::GetDirectory() const {
+   return mDirectory;
+}
+
+/**
+ * Unmap every segment, the ones with unread records are kept on disk.
+ */
+void SpillLog::Close() {
+   for (auto& segment : mSegments) {
+      CloseSegment(segment, ReadOffset(segment) >= segment.writeOffset);
+   }
+   mSegments.clear();
+   mCount = 0;
+   mBytes = 0;
+}
+
+/**
+ * Start a segment after the newest.
+ * @return
+ *   false if there are already maxSegments
+ */
+bool SpillLog::NewSegment() {
+   if (mSegments.size() >= mMaxSegments) {
+      return false;
+   }
+   Segment segment;
+   if (!OpenSegment(mNextSequence, true, segment)) {
+      return false;
+   }
+   ++mNextSequence;
+   mSegments.push_back(segment);
+   return true;
+}
+
+/**
+ * Map a segment file.
+ * @param sequence
+ * @param create
+ *   Make a new, empty segment instead of opening an existing one
+ * @param segment
+ * @return
+ */
+bool SpillLog::OpenSegment(const uint64_t sequence, const bool create, Segment& segment) {
+   const std::string path = SegmentPath(sequence);
+   int fd = open(path.c_str(), create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0644);
+   if (fd < 0) {
+      LOG(WARNING) << "SpillLog can't open " << path << ": " << strerror(errno);
+      return false;
+   }
+   size_t size = mSegmentBytes;
+   if (create) {
+      if (ftruncate(fd, size) != 0) {
+         LOG(WARNING) << "SpillLog can't size " << path << ": " << strerror(errno);
+         close(fd);
+         unlink(path.c_str());
+         return false;
+      }
+   } else {
+      struct stat status;
+      if (fstat(fd, &status) != 0 || static_cast<size_t> (status.st_size) < kHeaderSize + kLengthSize) {
+         LOG(WARNING) << "SpillLog skipping damaged segment " << path;
+         close(fd);
+         return false;
+      }
+      size = status.st_size;
+   }
+   void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (map == MAP_FAILED) {
+      LOG(WARNING) << "SpillLog can't map " << path << ": " << strerror(errno);
+      close(fd);
+      if (create) {
+         unlink(path.c_str());
+      }
+      return false;
+   }
+   segment.sequence = sequence;
+   segment.fd = fd;
+   segment.map = static_cast<uint8_t*> (map);
+   segment.size = size;
+   segment.writeOffset = kHeaderSize;
+   if (create) {
+      memcpy(segment.map, &kSegmentMagic, sizeof (kSegmentMagic));
+      SetReadOffset(segment, kHeaderSize);
+      SetLengthAt(segment, kHeaderSize, 0);
+   } else if (memcmp(segment.map, &kSegmentMagic, sizeof (kSegmentMagic)) != 0) {
+      LOG(WARNING) << "SpillLog skipping " << path << ", it is not a spill segment";
+      CloseSegment(segment, false);
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Unmap a segment file.
+ * @param segment
+ * @param remove
+ *   Delete the file as well
+ */
+void SpillLog::CloseSegment(Segment& segment, const bool remove) {
+   munmap(segment.map, segment.size);
+   close(segment.fd);
+   if (remove) {
+      unlink(SegmentPath(segment.sequence).c_str());
+   }
+   segment.map = nullptr;
+   segment.fd = -1;
+}
+
+/**
+ * @param sequence
+ * @return the file of a segment, zero padded so they sort by name
+ */
+std::string SpillLog::SegmentPath(const uint64_t sequence) const {
+   char name[32];
+   snprintf(name, sizeof (name), "%s%020llu", kSegmentPrefix, static_cast<unsigned long long> (sequence));
+   return mDirectory + "/" + name;
+}
+
+uint64_t SpillLog::ReadOffset(const Segment& segment) {
+   uint64_t offset;
+   memcpy(&offset, segment.map + kReadOffsetPosition, sizeof (offset));
+   return offset;
+}
+
+void SpillLog::SetReadOffset(Segment& segment, const uint64_t offset) {
+   memcpy(segment.map + kReadOffsetPosition, &offset, sizeof (offset));
+}
+
+uint32_t SpillLog::LengthAt(const Segment& segment, const size_t offset) {
+   uint32_t length;
+   memcpy(&length, segment.map + offset, sizeof (length));
+   return length;
+}
+
+void SpillLog::SetLengthAt(Segment& segment, const size_t offset, const uint32_t length) {
+   memcpy(segment.map + offset, &length, sizeof (length));
+}
+
+/**
+ * Unmap the segments, unread records stay on disk.
+ */
+SpillLog::~SpillLog() {
+   Close();
+}
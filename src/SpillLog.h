@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+/**
+ * An on disk FIFO of messages for a Rifle whose Vampires fall behind. It is
+ * a chain of fixed size segment files in one directory, each memory mapped,
+ * so appending is a memcpy into the page cache. Records are appended to the
+ * newest segment and read from the oldest, a segment is deleted once it has
+ * been read to the end.
+ *
+ * A segment starts with a header holding how far it has been read, followed
+ * by records of a 32 bit length and the data. A zero length ends the records.
+ * What is left unread when the log is closed is found again by the next log
+ * opened on the same directory. Nothing is synced, what is in the page cache
+ * survives the process but not the machine.
+ *
+ * A SpillLog is not thread safe, the Rifle guards it with a mutex.
+ */
+class SpillLog {
+public:
+   SpillLog(const std::string& directory, const size_t segmentBytes, const size_t maxSegments);
+   SpillLog(const SpillLog&) = delete;
+   SpillLog& operator=(const SpillLog&) = delete;
+   bool Open();
+   bool Append(const void* data, const size_t size);
+   bool Front(const uint8_t*& data, size_t& size) const;
+   void Pop();
+   bool Empty() const;
+   size_t Size() const;
+   size_t Bytes() const;
+   size_t GetSegmentCount() const;
+   std::string GetDirectory() const;
+   void Close();
+   virtual ~SpillLog();
+
+   static const size_t kHeaderSize = 16;
+   static const size_t kLengthSize = sizeof (uint32_t);
+
+private:
+   struct Segment {
+      uint64_t sequence;
+      int fd;
+      uint8_t* map;
+      size_t size;
+      size_t writeOffset;
+   };
+   bool NewSegment();
+   bool OpenSegment(const uint64_t sequence, const bool create, Segment& segment);
+   void CloseSegment(Segment& segment, const bool remove);
+   std::string SegmentPath(const uint64_t sequence) const;
+   static uint64_t ReadOffset(const Segment& segment);
+   static void SetReadOffset(Segment& segment, const uint64_t offset);
+   static uint32_t LengthAt(const Segment& segment, const size_t offset);
+   static void SetLengthAt(Segment& segment, const size_t offset, const uint32_t length);
+
+   const std::string mDirectory;
+   const size_t mSegmentBytes;
+   const size_t mMaxSegments;
+   std::deque<Segment> mSegments;
+   uint64_t mNextSequence;
+   size_t mCount;
+   size_t mBytes;
+};
@@ -0,0 +1,128 @@
+#include "SpscRing.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <thread>
+#include <g3log/g3log.hpp>
+
+namespace {
+   // checks before going to sleep on the eventfd
+   const size_t kSpinTries = 64;
+}
+
+RingSignal::RingSignal() : mFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), mWaiting(false) {
+   if (mFd < 0) {
+      LOG(WARNING) << "RingSignal can't create eventfd: " << strerror(errno);
+   }
+}
+
+/**
+ * @return false if the eventfd could not be created
+ */
+bool RingSignal::IsValid() const {
+   return mFd >= 0;
+}
+
+/**
+ * @return the eventfd, readable after a Notify that found a waiter
+ */
+int RingSignal::GetFd() const {
+   return mFd;
+}
+
+/**
+ * Wake the waiting thread, if there is one. Called after the state it waits
+ * on was published.
+ */
+void RingSignal::Notify() {
+   // pairs with the fence in Wait, either the waiter sees the new state or
+   // we see it waiting
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+   // one write per wait, the eventfd stays readable until the waiter reads it
+   if (mWaiting.load(std::memory_order_relaxed) && mWaiting.exchange(false, std::memory_order_relaxed)) {
+      const uint64_t one = 1;
+      if (write(mFd, &one, sizeof (one)) < 0 && errno != EAGAIN) {
+         LOG(WARNING) << "RingSignal can't notify: " << strerror(errno);
+      }
+   }
+}
+
+/**
+ * For a waiter that polls GetFd itself: clear the eventfd and have the next
+ * Notify write it. Check the state it waits on after arming, a Notify before
+ * it is not seen on the fd.
+ */
+void RingSignal::Arm() {
+   uint64_t count;
+   if (read(mFd, &count, sizeof (count)) < 0 && errno != EAGAIN) {
+      LOG(WARNING) << "RingSignal can't read: " << strerror(errno);
+   }
+   mWaiting.store(true, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+/**
+ * Check ready for a few rounds, then sleep on the eventfd until it returns
+ * true.
+ * @param ready
+ *   Checked after announcing the wait, and after each wake up
+ * @param timeoutMs
+ *   -1 waits forever, 0 only checks once
+ * @return
+ *   false if ready did not return true in time
+ */
+bool RingSignal::Wait(const std::function<bool()>& ready, const long timeoutMs) {
+   using namespace std::chrono;
+   if (timeoutMs == 0) {
+      return ready();
+   }
+   // the other side is usually a moment away, a sleep costs both sides a system call
+   for (size_t spin = 0; spin < kSpinTries; ++spin) {
+      if (ready()) {
+         return true;
+      }
+      std::this_thread::yield();
+   }
+   const steady_clock::time_point deadline = steady_clock::now() + milliseconds(std::max(timeoutMs, 0L));
+   while (true) {
+      mWaiting.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (ready()) {
+         mWaiting.store(false, std::memory_order_relaxed);
+         return true;
+      }
+      int waitMs = -1;
+      if (timeoutMs >= 0) {
+         const long left = duration_cast<milliseconds>(deadline - steady_clock::now()).count();
+         waitMs = static_cast<int> (std::max(left, 0L));
+      }
+      pollfd item = {mFd, POLLIN, 0};
+      const int pollResult = poll(&item, 1, waitMs);
+      mWaiting.store(false, std::memory_order_relaxed);
+      if (pollResult > 0) {
+         uint64_t count;
+         if (read(mFd, &count, sizeof (count)) < 0 && errno != EAGAIN) {
+            LOG(WARNING) << "RingSignal can't read: " << strerror(errno);
+         }
+      } else if (pollResult < 0 && errno != EINTR) {
+         LOG(WARNING) << "RingSignal can't poll: " << strerror(errno);
+         return ready();
+      }
+      if (ready()) {
+         return true;
+      }
+      if (timeoutMs >= 0 && steady_clock::now() >= deadline) {
+         return false;
+      }
+   }
+}
+
+RingSignal::~RingSignal() {
+   if (mFd >= 0) {
+      close(mFd);
+   }
+}
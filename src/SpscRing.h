@@ -0,0 +1,321 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+/**
+ * A wake up signal on an eventfd for one waiting thread. The other side only
+ * pays for a system call when someone actually waits.
+ */
+class RingSignal {
+public:
+   RingSignal();
+   RingSignal(const RingSignal&) = delete;
+   RingSignal& operator=(const RingSignal&) = delete;
+   bool IsValid() const;
+   int GetFd() const;
+   void Notify();
+   void Arm();
+   bool Wait(const std::function<bool()>& ready, const long timeoutMs);
+   virtual ~RingSignal();
+
+private:
+   int mFd;
+   std::atomic<bool> mWaiting;
+};
+
+/**
+ * A bounded single producer, single consumer ring of plain values. The
+ * producer and consumer indexes are padded onto their own cache lines, and
+ * each side keeps a cached copy of the other's index so the shared line is
+ * only read when the ring looks full or empty.
+ *
+ * Push and Pop block on a RingSignal once the ring is full or empty, with a
+ * timeout in milliseconds, -1 waits forever. A consumer in someone else's
+ * poll loop watches GetReadableFd instead, see ArmReadable.
+ */
+template<typename T>
+class SpscRing {
+   static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types go in a SpscRing");
+public:
+   explicit SpscRing(const size_t capacity);
+   SpscRing(const SpscRing&) = delete;
+   SpscRing& operator=(const SpscRing&) = delete;
+   bool IsValid() const;
+   size_t Capacity() const;
+   size_t Size() const;
+   bool TryPush(const T& item);
+   bool Push(const T& item, const long timeoutMs);
+   bool TryPop(T& item);
+   bool Pop(T& item, const long timeoutMs);
+   size_t TryPushMany(const T* items, const size_t count);
+   size_t PushMany(const T* items, const size_t count, const long timeoutMs);
+   size_t TryPopMany(T* items, const size_t maxItems);
+   size_t PopMany(T* items, const size_t maxItems, const long timeoutMs);
+   int GetReadableFd() const;
+   bool ArmReadable();
+
+   static const size_t kCacheLine = 64;
+
+private:
+   static size_t RoundUp(const size_t capacity);
+
+   const size_t mMask;
+   std::vector<T> mSlots;
+   RingSignal mNotEmpty;
+   RingSignal mNotFull;
+   // a full line between the groups keeps them apart without over aligned new
+   char mPadding0[kCacheLine];
+   // written by the consumer
+   std::atomic<size_t> mHead;
+   size_t mCachedTail;
+   char mPadding1[kCacheLine];
+   // written by the producer
+   std::atomic<size_t> mTail;
+   size_t mCachedHead;
+   char mPadding2[kCacheLine];
+};
+
+template<typename T>
+const size_t SpscRing<T>::kCacheLine;
+
+/**
+ * @param capacity
+ *   Rounded up to a power of two
+ */
+template<typename T>
+SpscRing<T>::SpscRing(const size_t capacity) :
+mMask(RoundUp(capacity) - 1),
+mSlots(mMask + 1),
+mHead(0),
+mCachedTail(0),
+mTail(0),
+mCachedHead(0) {
+}
+
+/**
+ * @return false if the signals could not be created
+ */
+template<typename T>
+bool SpscRing<T>::IsValid() const {
+   return mNotEmpty.IsValid() && mNotFull.IsValid();
+}
+
+template<typename T>
+size_t SpscRing<T>::Capacity() const {
+   return mMask + 1;
+}
+
+/**
+ * @return the items in the ring, exact only from the producer or consumer
+ */
+template<typename T>
+size_t SpscRing<T>::Size() const {
+   return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+}
+
+/**
+ * Add an item without waiting, producer only.
+ * @param item
+ * @return
+ *   false if the ring is full
+ */
+template<typename T>
+bool SpscRing<T>::TryPush(const T& item) {
+   const size_t tail = mTail.load(std::memory_order_relaxed);
+   if (tail - mCachedHead > mMask) {
+      mCachedHead = mHead.load(std::memory_order_acquire);
+      if (tail - mCachedHead > mMask) {
+         return false;
+      }
+   }
+   mSlots[tail & mMask] = item;
+   mTail.store(tail + 1, std::memory_order_release);
+   mNotEmpty.Notify();
+   return true;
+}
+
+/**
+ * Add an item, waiting for room, producer only.
+ * @param item
+ * @param timeoutMs
+ * @return
+ *   false if there was no room in time
+ */
+template<typename T>
+bool SpscRing<T>::Push(const T& item, const long timeoutMs) {
+   if (TryPush(item)) {
+      return true;
+   }
+   return mNotFull.Wait([this, &item]() {
+      return TryPush(item);
+   }, timeoutMs);
+}
+
+/**
+ * Take an item without waiting, consumer only.
+ * @param item
+ * @return
+ *   false if the ring is empty
+ */
+template<typename T>
+bool SpscRing<T>::TryPop(T& item) {
+   const size_t head = mHead.load(std::memory_order_relaxed);
+   if (head == mCachedTail) {
+      mCachedTail = mTail.load(std::memory_order_acquire);
+      if (head == mCachedTail) {
+         return false;
+      }
+   }
+   item = mSlots[head & mMask];
+   mHead.store(head + 1, std::memory_order_release);
+   mNotFull.Notify();
+   return true;
+}
+
+/**
+ * Take an item, waiting for one, consumer only.
+ * @param item
+ * @param timeoutMs
+ * @return
+ *   false if nothing came in time
+ */
+template<typename T>
+bool SpscRing<T>::Pop(T& item, const long timeoutMs) {
+   if (TryPop(item)) {
+      return true;
+   }
+   return mNotEmpty.Wait([this, &item]() {
+      return TryPop(item);
+   }, timeoutMs);
+}
+
+/**
+ * Add as many items as there is room for with one index update, producer
+ * only.
+ * @param items
+ * @param count
+ * @return
+ *   The number added, from the front of items
+ */
+template<typename T>
+size_t SpscRing<T>::TryPushMany(const T* items, const size_t count) {
+   const size_t tail = mTail.load(std::memory_order_relaxed);
+   size_t room = Capacity() - (tail - mCachedHead);
+   if (room < count) {
+      mCachedHead = mHead.load(std::memory_order_acquire);
+      room = Capacity() - (tail - mCachedHead);
+   }
+   const size_t pushed = std::min(room, count);
+   for (size_t i = 0; i < pushed; ++i) {
+      mSlots[(tail + i) & mMask] = items[i];
+   }
+   if (pushed != 0) {
+      mTail.store(tail + pushed, std::memory_order_release);
+      mNotEmpty.Notify();
+   }
+   return pushed;
+}
+
+/**
+ * Add all items, waiting for room as needed, producer only.
+ * @param items
+ * @param count
+ * @param timeoutMs
+ * @return
+ *   The number added, less than count if there was no room in time
+ */
+template<typename T>
+size_t SpscRing<T>::PushMany(const T* items, const size_t count, const long timeoutMs) {
+   size_t pushed = TryPushMany(items, count);
+   if (pushed == count) {
+      return pushed;
+   }
+   mNotFull.Wait([this, items, count, &pushed]() {
+      pushed += TryPushMany(items + pushed, count - pushed);
+      return pushed == count;
+   }, timeoutMs);
+   return pushed;
+}
+
+/**
+ * Take up to maxItems with one index update, consumer only.
+ * @param items
+ *   Room for maxItems
+ * @param maxItems
+ * @return
+ *   The number taken
+ */
+template<typename T>
+size_t SpscRing<T>::TryPopMany(T* items, const size_t maxItems) {
+   const size_t head = mHead.load(std::memory_order_relaxed);
+   size_t available = mCachedTail - head;
+   if (available < maxItems) {
+      mCachedTail = mTail.load(std::memory_order_acquire);
+      available = mCachedTail - head;
+   }
+   const size_t popped = std::min(available, maxItems);
+   for (size_t i = 0; i < popped; ++i) {
+      items[i] = mSlots[(head + i) & mMask];
+   }
+   if (popped != 0) {
+      mHead.store(head + popped, std::memory_order_release);
+      mNotFull.Notify();
+   }
+   return popped;
+}
+
+/**
+ * Take up to maxItems, waiting for at least one, consumer only.
+ * @param items
+ *   Room for maxItems
+ * @param maxItems
+ * @param timeoutMs
+ * @return
+ *   The number taken, 0 if nothing came in time
+ */
+template<typename T>
+size_t SpscRing<T>::PopMany(T* items, const size_t maxItems, const long timeoutMs) {
+   size_t popped = TryPopMany(items, maxItems);
+   if (popped != 0 || maxItems == 0) {
+      return popped;
+   }
+   mNotEmpty.Wait([this, items, maxItems, &popped]() {
+      popped = TryPopMany(items, maxItems);
+      return popped != 0;
+   }, timeoutMs);
+   return popped;
+}
+
+/**
+ * @return an eventfd the producer writes once armed, consumer only
+ */
+template<typename T>
+int SpscRing<T>::GetReadableFd() const {
+   return mNotEmpty.GetFd();
+}
+
+/**
+ * Clear GetReadableFd and have the next push write it, consumer only. Call
+ * before going back to poll the fd, and drain again if it returns true.
+ * @return
+ *   true if there are already items to pop
+ */
+template<typename T>
+bool SpscRing<T>::ArmReadable() {
+   mNotEmpty.Arm();
+   return mTail.load(std::memory_order_acquire) != mHead.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+size_t SpscRing<T>::RoundUp(const size_t capacity) {
+   size_t rounded = 1;
+   while (rounded < capacity) {
+      rounded <<= 1;
+   }
+   return rounded;
+}
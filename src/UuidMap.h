@@ -0,0 +1,227 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <boost/uuid/uuid.hpp>
+
+/**
+ * A flat hash map from 128 bit ids to values, for the request bookkeeping of
+ * a BoomStick. Entries live in one array with linear probing, a lookup is a
+ * hash of the 16 bytes and a short scan of neighbouring slots, nothing is
+ * allocated per entry. Erase shifts the following entries back instead of
+ * leaving tombstones, so lookups stay short however many requests come and
+ * go.
+ *
+ * Not thread safe. Pointers to values are only valid until the next Insert
+ * or Erase.
+ */
+template<typename Value>
+class UuidMap {
+public:
+   typedef boost::uuids::uuid Key;
+
+   UuidMap();
+   Value* Find(const Key& key);
+   const Value* Find(const Key& key) const;
+   Value& operator[](const Key& key);
+   bool Erase(const Key& key);
+   size_t Size() const;
+   size_t Capacity() const;
+   bool Empty() const;
+   void Clear();
+   void ShrinkToFit();
+   template<typename Visitor>
+   void ForEach(Visitor visitor);
+
+   static const size_t kMinimumSlots = 16;
+
+private:
+   struct Slot {
+      Key key;
+      Value value;
+      bool used;
+   };
+   static size_t Hash(const Key& key);
+   size_t Locate(const Key& key) const;
+   void Rehash(const size_t slots);
+
+   std::vector<Slot> mSlots;
+   size_t mMask;
+   size_t mSize;
+};
+
+template<typename Value>
+const size_t UuidMap<Value>::kMinimumSlots;
+
+template<typename Value>
+UuidMap<Value>::UuidMap() : mSlots(kMinimumSlots), mMask(kMinimumSlots - 1), mSize(0) {
+}
+
+/**
+ * @param key
+ * @return the value, nullptr if the key is not there
+ */
+template<typename Value>
+Value* UuidMap<Value>::Find(const Key& key) {
+   const size_t index = Locate(key);
+   return mSlots[index].used ? &mSlots[index].value : nullptr;
+}
+
+template<typename Value>
+const Value* UuidMap<Value>::Find(const Key& key) const {
+   const size_t index = Locate(key);
+   return mSlots[index].used ? &mSlots[index].value : nullptr;
+}
+
+/**
+ * @param key
+ * @return the value, a default one is added if the key is not there
+ */
+template<typename Value>
+Value& UuidMap<Value>::operator[](const Key& key) {
+   size_t index = Locate(key);
+   if (mSlots[index].used) {
+      return mSlots[index].value;
+   }
+   // keep at least a quarter of the slots free, probes get long after that
+   if ((mSize + 1) * 4 > mSlots.size() * 3) {
+      Rehash(mSlots.size() * 2);
+      index = Locate(key);
+   }
+   Slot& slot = mSlots[index];
+   slot.key = key;
+   slot.value = Value();
+   slot.used = true;
+   ++mSize;
+   return slot.value;
+}
+
+/**
+ * @param key
+ * @return false if the key was not there
+ */
+template<typename Value>
+bool UuidMap<Value>::Erase(const Key& key) {
+   size_t hole = Locate(key);
+   if (!mSlots[hole].used) {
+      return false;
+   }
+   // move back every following entry whose home is not between the hole and it
+   for (size_t next = (hole + 1) & mMask; mSlots[next].used; next = (next + 1) & mMask) {
+      const size_t home = Hash(mSlots[next].key) & mMask;
+      const bool stays = (hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next);
+      if (!stays) {
+         mSlots[hole] = std::move(mSlots[next]);
+         hole = next;
+      }
+   }
+   mSlots[hole].used = false;
+   mSlots[hole].value = Value();
+   --mSize;
+   return true;
+}
+
+/**
+ * @return the number of entries
+ */
+template<typename Value>
+size_t UuidMap<Value>::Size() const {
+   return mSize;
+}
+
+/**
+ * @return the slots allocated, grown for the most entries held so far until
+ * ShrinkToFit
+ */
+template<typename Value>
+size_t UuidMap<Value>::Capacity() const {
+   return mSlots.size();
+}
+
+template<typename Value>
+bool UuidMap<Value>::Empty() const {
+   return mSize == 0;
+}
+
+/**
+ * Remove every entry and give back the memory.
+ */
+template<typename Value>
+void UuidMap<Value>::Clear() {
+   std::vector<Slot>(kMinimumSlots).swap(mSlots);
+   mMask = kMinimumSlots - 1;
+   mSize = 0;
+}
+
+/**
+ * Give back the memory of slots that a burst of entries left behind.
+ */
+template<typename Value>
+void UuidMap<Value>::ShrinkToFit() {
+   size_t slots = kMinimumSlots;
+   while (mSize * 4 > slots * 3) {
+      slots <<= 1;
+   }
+   if (slots < mSlots.size()) {
+      Rehash(slots);
+   }
+}
+
+/**
+ * Call visitor(const Key&, Value&) for every entry. The map must not be
+ * changed from the visitor.
+ */
+template<typename Value>
+template<typename Visitor>
+void UuidMap<Value>::ForEach(Visitor visitor) {
+   for (auto& slot : mSlots) {
+      if (slot.used) {
+         visitor(static_cast<const Key&> (slot.key), slot.value);
+      }
+   }
+}
+
+/**
+ * Mix both halves, ids handed to the public API are not always random.
+ */
+template<typename Value>
+size_t UuidMap<Value>::Hash(const Key& key) {
+   uint64_t high;
+   uint64_t low;
+   memcpy(&high, key.data, sizeof (high));
+   memcpy(&low, key.data + sizeof (high), sizeof (low));
+   uint64_t hash = high ^ (low * 0x9e3779b97f4a7c15ULL);
+   hash ^= hash >> 32;
+   hash *= 0xd6e8feb86659fd93ULL;
+   hash ^= hash >> 32;
+   return static_cast<size_t> (hash);
+}
+
+/**
+ * @return the slot holding the key, or the free slot where it would go
+ */
+template<typename Value>
+size_t UuidMap<Value>::Locate(const Key& key) const {
+   size_t index = Hash(key) & mMask;
+   while (mSlots[index].used && mSlots[index].key != key) {
+      index = (index + 1) & mMask;
+   }
+   return index;
+}
+
+template<typename Value>
+void UuidMap<Value>::Rehash(const size_t slots) {
+   std::vector<Slot> old(slots);
+   old.swap(mSlots);
+   mMask = slots - 1;
+   for (auto& slot : old) {
+      if (slot.used) {
+         Slot& moved = mSlots[Locate(slot.key)];
+         moved.key = slot.key;
+         moved.value = std::move(slot.value);
+         moved.used = true;
+      }
+   }
+}
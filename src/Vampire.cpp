@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <boost/thread.hpp>
 #define _OPEN_SYS
 #include <sys/stat.h>
@@ -6,7 +7,37 @@
 #include "czmq.h"
 #include "g3log/g3log.hpp"
 #include "Death.h"
+#include "ContextRegistry.h"
+#include "InprocPipe.h"
 
+namespace {
+   /**
+    * How long to spin before blocking, never longer than the caller's timeout.
+    * @param window in microseconds
+    * @param timeout in milliseconds, negative for forever
+    * @return 
+    */
+   std::chrono::microseconds SpinFor(const unsigned int window, const int timeout) {
+      if (timeout >= 0 && static_cast<int64_t> (timeout) * 1000 < window) {
+         return std::chrono::milliseconds(timeout);
+      }
+      return std::chrono::microseconds(window);
+   }
+
+   /**
+    * What is left of the caller's timeout after spinning.
+    * @param timeout in milliseconds, negative for forever
+    * @param start when the spin began
+    * @return in milliseconds, timeout itself when negative
+    */
+   int TimeLeft(const int timeout, const QueueStats::Clock::time_point& start) {
+      if (timeout < 0) {
+         return timeout;
+      }
+      const auto spun = std::chrono::duration_cast<std::chrono::milliseconds>(QueueStats::Clock::now() - start);
+      return std::max(0, timeout - static_cast<int> (spun.count()));
+   }
+}
 
 /**
  * Construct our Vampire which is a pull in our ZMQ push pull.
@@ -18,7 +49,10 @@ mBody(NULL),
 mContext(NULL),
 mLinger(10),
 mIOThredCount(1),
-mOwnSocket(false) {
+mOwnSocket(false),
+mAffinity(0),
+mInprocFastPath(false),
+mSpinWindow(0) {
 }
 
 /**
@@ -29,6 +63,45 @@ std::string Vampire::GetBinding() const {
    return mLocation;
 }
 
+/**
+ * The ZeroMQ socket we are shot through, to wait on it along with others.
+ * Only receive through the Vampire.
+ * @return 
+ *   NULL before PrepareToBeShot or on the inproc fast path
+ */
+void* Vampire::GetSocket() const {
+   return mBody;
+}
+
+/**
+ * A file descriptor to wait on the Vampire in an epoll or poll loop, the
+ * ZMQ_FD of the socket or an eventfd on the inproc fast path. It is edge
+ * triggered: when it polls readable, get shots with a 0 timeout until
+ * IsReadable returns false, only then is it certain to fire again.
+ * @return 
+ *   -1 before PrepareToBeShot
+ */
+int Vampire::GetFd() const {
+   if (mInproc) {
+      return mInproc->GetReadableFd();
+   }
+   return CZMQToolkit::GetReadableFd(mBody);
+}
+
+/**
+ * Whether a shot can be taken without waiting, which also rearms GetFd.
+ * @return 
+ */
+bool Vampire::IsReadable() {
+   if (!mPending.Empty()) {
+      return true;
+   }
+   if (mInproc) {
+      return mInproc->ArmReadable();
+   }
+   return CZMQToolkit::IsReadable(mBody);
+}
+
 /**
  * Get our high water mark.
  * @return 
@@ -69,6 +142,19 @@ bool Vampire::GetOwnSocket() {
    return mOwnSocket;
 }
 
+/**
+ * Create our socket on a context shared with other queues of the same name
+ * instead of a private one. This must be called before PrepareToBeShot.
+ * @param name
+ *   The ContextRegistry name, empty for a private context
+ * @param affinity
+ *   Bit mask of the shared context's IO threads to use, 0 for any
+ */
+void Vampire::SetSharedContext(const std::string& name, const uint64_t affinity) {
+   mContextName = name;
+   mAffinity = affinity;
+}
+
 /**
  * Get IO thread count;
  * @param count
@@ -77,25 +163,79 @@ int Vampire::GetIOThreads() {
    return mIOThredCount;
 }
 
+/**
+ * Receive bullets for an inproc:// location through an in process queue
+ * instead of ZeroMQ, off by default. The Vampire then has no ZeroMQ socket,
+ * GetSocket returns nothing and plain ZeroMQ peers can't reach it.
+ * Every Rifle and Vampire on the location must agree. This must be called
+ * before PrepareToBeShot.
+ * @param fastPath
+ */
+void Vampire::SetInprocFastPath(const bool fastPath) {
+   mInprocFastPath = fastPath;
+}
+
+/**
+ * Get if the inproc fast path is used.
+ * @return bool
+ */
+bool Vampire::GetInprocFastPath() {
+   return mInprocFastPath;
+}
+
+/**
+ * Trade CPU for wakeup latency. Each receive first busy polls the socket
+ * with non blocking receives for up to this long, and only then falls back
+ * to a blocking poll for the rest of the timeout. Off (0) by default, the
+ * spin hit rate in GetStats shows if the window suits the traffic.
+ * @param microseconds
+ */
+void Vampire::SetSpinWindow(const unsigned int microseconds) {
+   mSpinWindow = microseconds;
+}
+
+/**
+ * Get the busy poll window.
+ * @return microseconds, 0 when off
+ */
+unsigned int Vampire::GetSpinWindow() {
+   return mSpinWindow;
+}
+
 /**
  * Set the location we are going to be shot at.
  * @param location
  * @return 
  */
 bool Vampire::PrepareToBeShot() {
-   if (mBody) {
+   if (mBody || mInproc) {
+      return true;
+   }
+   if (GetInprocFastPath() && InprocPipe::IsInproc(mLocation)) {
+      mInproc.reset(new InprocPipe(mLocation, GetHighWater(), true));
       return true;
    }
    if (!mContext) {
-      mContext = zctx_new();
+      if (mContextName.empty()) {
+         mContext = zctx_new();
+         zctx_set_iothreads(mContext, GetIOThreads());
+      } else {
+         mContext = ContextRegistry::Instance().Acquire(mContextName);
+         if (!mContext) {
+            LOG(WARNING) << "Vampire can't get shared context : " << mContextName;
+            return false;
+         }
+      }
       zctx_set_sndhwm(mContext, GetHighWater());
       zctx_set_rcvhwm(mContext, GetHighWater());// HWM on internal thread communication
       //zctx_set_linger(mContext, mLinger); // linger for a millisecond on close
-      zctx_set_iothreads(mContext, GetIOThreads());
    }
    if (!mBody) {
       mBody = zsocket_new(mContext, ZMQ_PULL);
       CZMQToolkit::setHWMAndBuffer(mBody, GetHighWater());
+      if (mAffinity) {
+         CZMQToolkit::SetAffinity(mBody, mAffinity);
+      }
       if (GetOwnSocket()) {
          int result = zsocket_bind(mBody, mLocation.c_str());
 
@@ -147,87 +287,392 @@ void Vampire::setIpcFilePermissions() {
  * @return 
  */
 bool Vampire::GetShot(std::string& wound, const int timeout) {
+   if (mInproc) {
+      QueueStats::Timer timer(mStats);
+      return GetInproc(wound, timeout);
+   }
+   ZeroCopyMessage message;
+   if (!GetShot(message, timeout)) {
+      return false;
+   }
+   wound.assign(reinterpret_cast<const char*> (message.Data()), message.Size());
+   return true;
+}
+
+/**
+ * Get shot by the rifle without copying the bullet out of ZeroMQ.
+ * @param wound
+ *   Replaced with the received message, only valid when true is returned
+ * @param timeout
+ * @return 
+ */
+bool Vampire::GetShot(ZeroCopyMessage& wound, const int timeout) {
+   QueueStats::Timer timer(mStats);
+   return ReceiveShot(wound, timeout);
+}
+
+/**
+ * Get shot by a batch of bullets, see Rifle::FireBatched, read in place
+ * without copying them out of the received frame. A bullet that was not
+ * batched comes as a batch of one.
+ * @param batch
+ *   Replaced with what was received, empty when false is returned
+ * @param timeout in milliseconds
+ * @return 
+ */
+bool Vampire::GetBatch(ShotBatch& batch, const int timeout) {
+   QueueStats::Timer timer(mStats);
+   if (mPending.Empty()) {
+      ZeroCopyMessage wound;
+      if (!ReceiveMessage(wound, timeout)) {
+         batch.Reset();
+         return false;
+      }
+      if (mPending.Empty()) {
+         batch.AssignSingle(std::move(wound));
+         return true;
+      }
+   }
+   batch = std::move(mPending);
+   return true;
+}
+
+/**
+ * Receive one bullet, from the rest of a received batch first.
+ * @param wound
+ *   Replaced with the received bullet, empty when false is returned
+ * @param timeout in milliseconds
+ * @return 
+ */
+bool Vampire::ReceiveShot(ZeroCopyMessage& wound, const int timeout) {
+   if (TakePending(wound)) {
+      return true;
+   }
+   if (!ReceiveMessage(wound, timeout)) {
+      return false;
+   }
+   return mPending.Empty() || TakePending(wound);
+}
+
+/**
+ * Receive one message, spinning first when a window is set.
+ * @param wound
+ *   Replaced with the received bullet, empty when false is returned or when
+ * a batch was received into mPending instead
+ * @param timeout in milliseconds
+ * @return 
+ */
+bool Vampire::ReceiveMessage(ZeroCopyMessage& wound, const int timeout) {
+   if (mInproc) {
+      std::string bullet;
+      if (!GetInproc(bullet, timeout)) {
+         wound.Reset();
+         return false;
+      }
+      wound.Adopt(std::move(bullet));
+      return true;
+   }
    if (!mBody) {
       LOG(WARNING) << "Socket uninitialized!";
       boost::this_thread::sleep(boost::posix_time::seconds(1));
       return false;
    }
-   bool success = false;
-   zmsg_t* message = NULL;
-   zmq_pollitem_t items [] = {
-      { mBody, 0, ZMQ_POLLIN, 0}
-   };
-   int pollResult = zmq_poll(items, 1, timeout);
-   if (pollResult > 0) {
-      if (items[0].revents & ZMQ_POLLIN) {
-         message = zmsg_recv(mBody);
-         if (message && zmsg_size(message) == 1) {
-            zframe_t* frame = zmsg_last(message);
-            wound.clear();
-            wound.append(reinterpret_cast<char*> (zframe_data(frame)), zframe_size(frame));
-            success = true;
+   const auto start = QueueStats::Clock::now();
+   bool received = (mSpinWindow != 0) && SpinForShot(wound, timeout);
+   if (!received) {
+      zmq_pollitem_t items [] = {
+         { mBody, 0, ZMQ_POLLIN, 0}
+      };
+      int pollResult = zmq_poll(items, 1, TimeLeft(timeout, start));
+      if (pollResult > 0) {
+         if (!(items[0].revents & ZMQ_POLLIN)) {
+            LOG(WARNING) << "Error in zmq_pollin " << GetBinding();
+            mStats.Error();
+         } else if (wound.Receive(mBody, 0) < 0) {
+            LOG(INFO) << "received null message, time for shutdown.";
+            mStats.Error();
          } else {
-            if (!message) {
-               LOG(INFO) << "received null message, time for shutdown.";
-            } else {
-               LOG(WARNING) << "Received invalid sized message of size: " << zmsg_size(message);
-            }
+            received = true;
          }
+      } else if (pollResult < 0) {
+         LOG(WARNING) << "Error on zmq socket receiving " << GetBinding() << ": " << zmq_strerror(zmq_errno());
+         mStats.Error();
       } else {
-         LOG(WARNING) << "Error in zmq_pollin " << GetBinding();
+         //socket timed out
+         mStats.PollTimeout();
       }
+   }
+   bool success = false;
+   if (received && !wound.More()) {
+      mStats.Message(wound.Size());
+      success = true;
+   } else if (received) {
+      success = Decode(wound);
+   }
+   if (!success) {
+      wound.Reset();
+   }
+   return success;
+}
 
-   } else if (pollResult < 0) {
+/**
+ * Receive the rest of a flagged message and decode it, see
+ * CZMQToolkit::SendFlagged. A compressed bullet is uncompressed into the
+ * wound, a batch goes to mPending.
+ * @param wound
+ *   Holds the first frame of a multi part message
+ * @return 
+ *   false if the message was not a valid flagged message
+ */
+bool Vampire::Decode(ZeroCopyMessage& wound) {
+   if (wound.Size() != 1) {
+      DiscardParts(wound, 1);
+      return false;
+   }
+   const uint8_t flag = wound.Data()[0];
+   if (wound.Receive(mBody, 0) < 0) {
       LOG(WARNING) << "Error on zmq socket receiving " << GetBinding() << ": " << zmq_strerror(zmq_errno());
-   } else {
-      //socket timed out
+      mStats.Error();
+      return false;
    }
-   if (message) {
-      zmsg_destroy(&message);
+   if (wound.More()) {
+      DiscardParts(wound, 2);
+      return false;
    }
-   return success;
+   if (flag == CZMQToolkit::kZlibFrame) {
+      std::string bullet;
+      if (!CZMQToolkit::Uncompress(wound.Data(), wound.Size(), bullet)) {
+         LOG(WARNING) << "Received a compressed message that could not be uncompressed";
+         mStats.Error();
+         return false;
+      }
+      mStats.Message(bullet.size());
+      wound.Adopt(std::move(bullet));
+      return true;
+   }
+   if (flag == CZMQToolkit::kBatchFrame) {
+      if (!mPending.Assign(std::move(wound))) {
+         LOG(WARNING) << "Received an invalid batch";
+         mStats.Error();
+         return false;
+      }
+      mStats.Message(mPending.Bytes(), mPending.Size());
+      return true;
+   }
+   LOG(WARNING) << "Received a message with unknown flag " << static_cast<int> (flag);
+   mStats.Error();
+   return false;
 }
 
 /**
- * Get a pointer from the rifle
- * @param stake
- *   A void* that the caller needs to already know how to cast
+ * Throw away the rest of an invalid multi part message.
+ * @param wound
+ *   Holds the last part received
+ * @param parts
+ *   Parts received so far
+ */
+void Vampire::DiscardParts(ZeroCopyMessage& wound, size_t parts) {
+   while (wound.More() && wound.Receive(mBody, 0) >= 0) {
+      ++parts;
+   }
+   LOG(WARNING) << "Received invalid sized message of size: " << parts;
+   mStats.Error();
+}
+
+/**
+ * Take the next bullet of a received batch.
+ * @param wound
+ *   Replaced with a copy of the bullet
  * @return 
- *   If something was found
+ *   false if there is no batch left
  */
-bool Vampire::GetStake(void*& stake, const int timeout) {
+bool Vampire::TakePending(ZeroCopyMessage& wound) {
+   ShotBatch::Shot shot;
+   if (!mPending.Next(shot)) {
+      return false;
+   }
+   wound.Adopt(shot.ToString());
+   if (mPending.Empty()) {
+      mPending.Reset();
+   }
+   return true;
+}
+
+/**
+ * Copy bullets of a received batch into the caller's slots.
+ * @param wounds
+ * @param received
+ *   Slots already filled
+ * @param maxShots
+ * @return 
+ *   Slots filled now
+ */
+size_t Vampire::TakePending(std::vector<std::string>& wounds, size_t received, const size_t maxShots) {
+   ShotBatch::Shot shot;
+   while (received < maxShots && mPending.Next(shot)) {
+      wounds[received].assign(reinterpret_cast<const char*> (shot.data), shot.size);
+      ++received;
+   }
+   if (mPending.Empty()) {
+      mPending.Reset();
+   }
+   return received;
+}
+
+/**
+ * Busy poll the socket with non blocking receives for up to the spin window.
+ * @param wound
+ *   Holds the first frame when true is returned
+ * @param timeout in milliseconds, caps the window
+ * @return 
+ *   false if nothing came, the caller should block
+ */
+bool Vampire::SpinForShot(ZeroCopyMessage& wound, const int timeout) {
+   const auto deadline = QueueStats::Clock::now() + SpinFor(mSpinWindow, timeout);
+   do {
+      if (wound.Receive(mBody, ZMQ_DONTWAIT) >= 0) {
+         mStats.SpinHit();
+         return true;
+      }
+      if (zmq_errno() != EAGAIN) {
+         break;
+      }
+   } while (!zctx_interrupted && QueueStats::Clock::now() < deadline);
+   mStats.SpinMiss();
+   return false;
+}
+
+/**
+ * Get shot by up to maxShots bullets with a single wait.
+ *
+ * After one successful poll everything already pending on the socket is
+ * drained without waiting, up to maxShots. The vector is grown to maxShots
+ * slots and never shrunk, and each slot is assigned in place, so a caller that
+ * reuses the same vector does no allocations once the strings have grown to
+ * the message size.
+ *
+ * @param wounds
+ *   Caller owned storage, only the first N (the return value) slots are valid
+ * @param maxShots
+ * @param timeout
+ *   in milliseconds, applies to the wait for the first bullet only
+ * @return 
+ *   The number of bullets received
+ */
+size_t Vampire::GetShots(std::vector<std::string>& wounds, const size_t maxShots, const int timeout) {
+   QueueStats::Timer timer(mStats);
+   if (mInproc) {
+      if (maxShots == 0) {
+         return 0;
+      }
+      if (wounds.size() < maxShots) {
+         wounds.resize(maxShots);
+      }
+      if (!GetInproc(wounds[0], timeout)) {
+         return 0;
+      }
+      size_t received = 1;
+      while (received < maxShots && mInproc->Pop(wounds[received], 0)) {
+         mStats.Message(wounds[received].size());
+         ++received;
+      }
+      return received;
+   }
    if (!mBody) {
       LOG(WARNING) << "Socket uninitialized!";
       boost::this_thread::sleep(boost::posix_time::seconds(1));
-      return false;
+      return 0;
    }
-   bool success = false;
-   zmsg_t* message = NULL;
-   if (zsocket_poll(mBody, timeout)) {
-      message = zmsg_recv(mBody);
-      if (message && (zmsg_size(message) == 1)) {
-         zframe_t* frame = zmsg_pop(message);
-         if (frame && zframe_size(frame) != sizeof (void*)) {
-            LOG(WARNING) << "Received non-pointer message.";
-         } else if(frame) {
-            stake = *reinterpret_cast<void**> (zframe_data(frame));
-            success = true;
+   if (maxShots == 0) {
+      return 0;
+   }
+   if (wounds.size() < maxShots) {
+      wounds.resize(maxShots);
+   }
+   if (!mPending.Empty()) {
+      return TakePending(wounds, 0, maxShots);
+   }
+   const auto start = QueueStats::Clock::now();
+   if (mSpinWindow != 0) {
+      const auto deadline = start + SpinFor(mSpinWindow, timeout);
+      do {
+         size_t received = DrainShots(wounds, maxShots);
+         if (received != 0) {
+            mStats.SpinHit();
+            return received;
          }
-         //always delete frame if it exists
-         if (frame) {
-            zframe_destroy(&frame);
+      } while (!zctx_interrupted && QueueStats::Clock::now() < deadline);
+      mStats.SpinMiss();
+   }
+   zmq_pollitem_t items [] = {
+      { mBody, 0, ZMQ_POLLIN, 0}
+   };
+   int pollResult = zmq_poll(items, 1, TimeLeft(timeout, start));
+   if (pollResult < 0) {
+      LOG(WARNING) << "Error on zmq socket receiving " << GetBinding() << ": " << zmq_strerror(zmq_errno());
+      mStats.Error();
+      return 0;
+   } else if (pollResult == 0) {
+      //socket timed out
+      mStats.PollTimeout();
+      return 0;
+   } else if (!(items[0].revents & ZMQ_POLLIN)) {
+      LOG(WARNING) << "Error in zmq_pollin " << GetBinding();
+      mStats.Error();
+      return 0;
+   }
+   return DrainShots(wounds, maxShots);
+}
+
+/**
+ * Receive everything already pending on the socket without waiting.
+ * @param wounds
+ *   At least maxShots slots
+ * @param maxShots
+ * @return 
+ *   The number of bullets received
+ */
+size_t Vampire::DrainShots(std::vector<std::string>& wounds, const size_t maxShots) {
+   size_t received = 0;
+   ZeroCopyMessage message;
+   while (received < maxShots && message.Receive(mBody, ZMQ_DONTWAIT) >= 0) {
+      if (!message.More()) {
+         wounds[received].assign(reinterpret_cast<const char*> (message.Data()), message.Size());
+         mStats.Message(message.Size());
+         ++received;
+      } else if (Decode(message)) {
+         if (mPending.Empty()) {
+            wounds[received].assign(reinterpret_cast<const char*> (message.Data()), message.Size());
+            ++received;
+         } else {
+            received = TakePending(wounds, received, maxShots);
          }
-      } else if (message) {
-         LOG(WARNING) << "Received an invalid message";
       }
    }
-   if (message) {
-      zmsg_destroy(&message);
+   return received;
+}
+
+/**
+ * Get a pointer from the rifle
+ * @param stake
+ *   A void* that the caller needs to already know how to cast
+ * @return 
+ *   If something was found
+ */
+bool Vampire::GetStake(void*& stake, const int timeout) {
+   QueueStats::Timer timer(mStats);
+   stake = NULL;
+   ZeroCopyMessage wound;
+   if (!ReceiveShot(wound, timeout)) {
+      return false;
    }
-   if (!success) {
-      stake = NULL;
+   if (wound.Size() != sizeof (void*)) {
+      LOG(WARNING) << "Received non-pointer message.";
+      mStats.Error();
+      return false;
    }
-   return success;
+   memcpy(&stake, wound.Data(), sizeof (void*));
+   return true;
 }
 
 /**
@@ -251,41 +696,87 @@ bool Vampire::GetStakeNoWait(void*& stake) {
  */
 bool Vampire::GetStakes(std::vector<std::pair<void*, unsigned int> >& stakes,
    const int timeout) {
-   if (!mBody) {
-      LOG(WARNING) << "Socket uninitialized!";
-      boost::this_thread::sleep(boost::posix_time::seconds(1));
+   QueueStats::Timer timer(mStats);
+   stakes.clear();
+   ZeroCopyMessage wound;
+   if (!ReceiveShot(wound, timeout)) {
       return false;
    }
-   bool success = false;
-   zmsg_t* message = NULL;
-   if (zsocket_poll(mBody, timeout)) {
-      message = zmsg_recv(mBody);
-      if (message && zmsg_size(message) == 1) {
-         zframe_t* frame = zmsg_pop(message);
-         if (frame && zframe_size(frame) < (sizeof (std::pair<void*, unsigned int>))) {
-            LOG(WARNING) << "Received non-pointer message.";
-         } else if (frame) {
-            stakes.clear();
-            stakes.assign(reinterpret_cast<std::pair<void*, unsigned int>*> (zframe_data(frame)),
-               reinterpret_cast<std::pair<void*, unsigned int>*> (zframe_data(frame))
-               + (zframe_size(frame) / sizeof (std::pair<void*, unsigned int>)));
-            success = true;
-         }
-         //always delete frame if it exists
-         if (frame) {
-            zframe_destroy(&frame);
-         }
-      } else if (!message || (zmsg_size(message) != 1)) {
-         LOG(WARNING) << "Received invalid message.";
-      }
+   if (wound.Size() < (sizeof (std::pair<void*, unsigned int>))) {
+      LOG(WARNING) << "Received non-pointer message.";
+      mStats.Error();
+      return false;
    }
-   if (message) {
-      zmsg_destroy(&message);
+   const std::pair<void*, unsigned int>* first = reinterpret_cast<const std::pair<void*, unsigned int>*> (wound.Data());
+   stakes.assign(first, first + (wound.Size() / sizeof (std::pair<void*, unsigned int>)));
+   return true;
+}
+
+/**
+ * Get shot by a single message holding a whole number of structs.
+ * @param wound
+ * @param structSize
+ * @param alignment
+ *   Required alignment of the data, 1 when it will be copied out
+ * @param maxStructs
+ *   Most structs the caller has room for
+ * @param timeout in milliseconds
+ * @return 
+ *   false on timeout or if the message does not fit, wound is then empty
+ */
+bool Vampire::GetStructBytes(ZeroCopyMessage& wound, const size_t structSize, const size_t alignment,
+   const size_t maxStructs, const int timeout) {
+   if (!GetShot(wound, timeout)) {
+      return false;
    }
-   if (!success) {
-      stakes.clear();
+   if ((wound.Size() % structSize) != 0) {
+      LOG(WARNING) << "Received " << wound.Size() << " bytes, not a multiple of struct size " << structSize;
+   } else if ((wound.Size() / structSize) > maxStructs) {
+      LOG(WARNING) << "Received " << wound.Size() / structSize << " structs, room for " << maxStructs;
+   } else if ((reinterpret_cast<uintptr_t> (wound.Data()) % alignment) != 0) {
+      LOG(WARNING) << "Received structs are not aligned to " << alignment << " for use in place";
+   } else {
+      return true;
    }
-   return success;
+   mStats.Error();
+   wound.Reset();
+   return false;
+}
+
+/**
+ * Pop a bullet from the inproc fast path, spinning first when a window is
+ * set, and count it.
+ * @param bullet
+ * @param timeout in milliseconds
+ * @return 
+ */
+bool Vampire::GetInproc(std::string& bullet, const int timeout) {
+   const auto start = QueueStats::Clock::now();
+   if (mSpinWindow != 0) {
+      const auto deadline = start + SpinFor(mSpinWindow, timeout);
+      do {
+         if (mInproc->Pop(bullet, 0)) {
+            mStats.SpinHit();
+            mStats.Message(bullet.size());
+            return true;
+         }
+      } while (!zctx_interrupted && QueueStats::Clock::now() < deadline);
+      mStats.SpinMiss();
+   }
+   if (mInproc->Pop(bullet, TimeLeft(timeout, start))) {
+      mStats.Message(bullet.size());
+      return true;
+   }
+   mStats.PollTimeout();
+   return false;
+}
+
+/**
+ * A copy of the counters, cheap enough to take every second from any thread.
+ * @return 
+ */
+QueueStatsSnapshot Vampire::GetStats() const {
+   return mStats.Snapshot();
 }
 
 /**
@@ -293,10 +784,12 @@ bool Vampire::GetStakes(std::vector<std::pair<void*, unsigned int> >& stakes,
  * @return 
  */
 void Vampire::Destroy() {
+   mInproc.reset();
+   mPending.Reset();
    if (mContext != NULL) {
       //LOG(DEBUG) << "Vampire: destroying context";
       zsocket_destroy(mContext, mBody);
-      zctx_destroy(&mContext);
+      ContextRegistry::Instance().Release(mContext);
       //zclock_sleep(mLinger * 2);
       mContext = NULL;
       mBody = NULL;
@@ -1,7 +1,16 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <cstring>
+#include <type_traits>
+#include <limits>
+#include <memory>
+#include <cstdint>
 #include "CZMQToolkit.h"
+#include "ZeroCopyMessage.h"
+#include "QueueStats.h"
+#include "ShotBatch.h"
+class InprocPipe;
 struct _zctx_t;
 typedef struct _zctx_t zctx_t;
 class Vampire {
@@ -9,21 +18,50 @@ public:
    explicit Vampire(const std::string& location);
    bool PrepareToBeShot();
    std::string GetBinding() const;
+   void* GetSocket() const;
+   int GetFd() const;
+   bool IsReadable();
    bool GetShot(std::string& wound, const int timeout);
+   bool GetShot(ZeroCopyMessage& wound, const int timeout);
+   bool GetBatch(ShotBatch& batch, const int timeout);
+   size_t GetShots(std::vector<std::string>& wounds, const size_t maxShots, const int timeout);
    bool GetStake(void*& stake, const int timeout=1000);
    bool GetStakeNoWait(void*& stake);
    bool GetStakes(std::vector<std::pair<void*, unsigned int> >& stakes,
            const int timeout=1000);
+   template<typename T>
+   size_t GetStructs(T* structs, const size_t maxStructs, const int timeout);
+   template<typename T>
+   bool GetStructs(std::vector<T>& structs, const int timeout);
+   template<typename T>
+   const T* GetStructs(ZeroCopyMessage& wound, size_t& count, const int timeout);
    int GetHighWater();
    void SetHighWater(const int hwm);
    int GetIOThreads();
    void SetIOThreads(const int count);
    void SetOwnSocket(const bool own);
    bool GetOwnSocket();
+   void SetSharedContext(const std::string& name, const uint64_t affinity = 0);
+   void SetInprocFastPath(const bool fastPath);
+   bool GetInprocFastPath();
+   void SetSpinWindow(const unsigned int microseconds);
+   unsigned int GetSpinWindow();
+   QueueStatsSnapshot GetStats() const;
    virtual ~Vampire();
 protected:
    void Destroy();
 private:
+   bool GetStructBytes(ZeroCopyMessage& wound, const size_t structSize, const size_t alignment,
+           const size_t maxStructs, const int timeout);
+   bool ReceiveShot(ZeroCopyMessage& wound, const int timeout);
+   bool ReceiveMessage(ZeroCopyMessage& wound, const int timeout);
+   bool SpinForShot(ZeroCopyMessage& wound, const int timeout);
+   bool Decode(ZeroCopyMessage& wound);
+   void DiscardParts(ZeroCopyMessage& wound, size_t parts);
+   bool TakePending(ZeroCopyMessage& wound);
+   size_t TakePending(std::vector<std::string>& wounds, size_t received, const size_t maxShots);
+   size_t DrainShots(std::vector<std::string>& wounds, const size_t maxShots);
+   bool GetInproc(std::string& bullet, const int timeout);
    void setIpcFilePermissions();
    std::string mLocation;
    int mHwm;
@@ -32,4 +70,76 @@ private:
    int mLinger;
    int mIOThredCount;
    bool mOwnSocket;
+   std::string mContextName;
+   uint64_t mAffinity;
+   bool mInprocFastPath;
+   std::unique_ptr<InprocPipe> mInproc;
+   unsigned int mSpinWindow;
+   // the rest of a received batch, handed out before the socket is read again
+   ShotBatch mPending;
+   QueueStats mStats;
 };
+
+/**
+ * Get shot by an array of plain structs, decoded into the caller's buffer.
+ * @param structs
+ *   Room for at least maxStructs
+ * @param maxStructs
+ * @param timeout in milliseconds
+ * @return 
+ *   The number of structs written, 0 on timeout or if the message did not
+ * hold a whole number of T that fit the buffer
+ */
+template<typename T>
+size_t Vampire::GetStructs(T* structs, const size_t maxStructs, const int timeout) {
+   static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be received as structs");
+   ZeroCopyMessage wound;
+   if (!GetStructBytes(wound, sizeof (T), 1, maxStructs, timeout)) {
+      return 0;
+   }
+   memcpy(structs, wound.Data(), wound.Size());
+   return wound.Size() / sizeof (T);
+}
+
+/**
+ * Get shot by an array of plain structs, decoded into the caller's vector.
+ * The vector is resized to what was received, reusing its capacity.
+ * @param structs
+ * @param timeout in milliseconds
+ * @return 
+ *   false on timeout or if the message did not hold a whole number of T
+ */
+template<typename T>
+bool Vampire::GetStructs(std::vector<T>& structs, const int timeout) {
+   static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be received as structs");
+   ZeroCopyMessage wound;
+   if (!GetStructBytes(wound, sizeof (T), 1, structs.max_size(), timeout)) {
+      structs.clear();
+      return false;
+   }
+   structs.resize(wound.Size() / sizeof (T));
+   memcpy(structs.data(), wound.Data(), wound.Size());
+   return true;
+}
+
+/**
+ * Get shot by an array of plain structs and view them in place, without
+ * copying them out of the message.
+ * @param wound
+ *   Holds the message, the view is valid for as long as it does
+ * @param count
+ *   Set to the number of structs in the view
+ * @param timeout in milliseconds
+ * @return 
+ *   nullptr on timeout or if the message did not hold a whole number of T
+ * or is not aligned for T
+ */
+template<typename T>
+const T* Vampire::GetStructs(ZeroCopyMessage& wound, size_t& count, const int timeout) {
+   static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be received as structs");
+   count = 0;
+   if (!GetStructBytes(wound, sizeof (T), alignof (T), std::numeric_limits<size_t>::max(), timeout)) {
+      return nullptr;
+   }
+   return wound.View<T>(count);
+}
@@ -0,0 +1,141 @@
+#include "ZeroCopyMessage.h"
+#include "CZMQToolkit.h"
+#include <czmq.h>
+
+/**
+ * Construct an empty message, ready to be received into.
+ */
+ZeroCopyMessage::ZeroCopyMessage() : mFrame(nullptr) {
+   zmq_msg_init(&mMessage);
+}
+
+/**
+ * Take ownership of a frame, it will be destroyed with the handle.
+ * @param frame
+ */
+ZeroCopyMessage::ZeroCopyMessage(zframe_t* frame) : mFrame(frame) {
+   zmq_msg_init(&mMessage);
+}
+
+/**
+ * Move constructor, other is left empty
+ * @param other
+ */
+ZeroCopyMessage::ZeroCopyMessage(ZeroCopyMessage&& other) : mFrame(other.mFrame) {
+   zmq_msg_init(&mMessage);
+   zmq_msg_move(&mMessage, &other.mMessage);
+   other.mFrame = nullptr;
+}
+
+/**
+ * Move assignment, the current contents are released and other is left empty
+ * @param other
+ * @return 
+ *   A reference to this
+ */
+ZeroCopyMessage& ZeroCopyMessage::operator=(ZeroCopyMessage&& other) {
+   if (this != &other) {
+      Reset();
+      zmq_msg_move(&mMessage, &other.mMessage);
+      mFrame = other.mFrame;
+      other.mFrame = nullptr;
+   }
+   return *this;
+}
+
+/**
+ * Release the underlying ZeroMQ memory
+ */
+ZeroCopyMessage::~ZeroCopyMessage() {
+   if (mFrame) {
+      zframe_destroy(&mFrame);
+   }
+   zmq_msg_close(&mMessage);
+}
+
+/**
+ * Release what is held and go back to an empty message
+ */
+void ZeroCopyMessage::Reset() {
+   if (mFrame) {
+      zframe_destroy(&mFrame);
+      mFrame = nullptr;
+   }
+   zmq_msg_close(&mMessage);
+   zmq_msg_init(&mMessage);
+}
+
+/**
+ * Receive the next frame from the socket, replacing anything held.
+ * @param socket
+ * @param flags
+ *   zmq_msg_recv flags, i.e. ZMQ_DONTWAIT
+ * @return 
+ *   The size of the frame or -1 on failure, zmq_errno() has the reason
+ */
+int ZeroCopyMessage::Receive(void* socket, const int flags) {
+   if (mFrame) {
+      zframe_destroy(&mFrame);
+      mFrame = nullptr;
+   }
+   return zmq_msg_recv(&mMessage, socket, flags);
+}
+
+/**
+ * @return if more frames of the same message are waiting on the socket
+ */
+bool ZeroCopyMessage::More() {
+   if (mFrame) {
+      return zframe_more(mFrame) != 0;
+   }
+   return zmq_msg_more(&mMessage) != 0;
+}
+
+/**
+ * @return a view of the message data, valid for the life of the handle
+ */
+const uint8_t* ZeroCopyMessage::Data() const {
+   if (mFrame) {
+      return reinterpret_cast<const uint8_t*> (zframe_data(mFrame));
+   }
+   return reinterpret_cast<const uint8_t*> (zmq_msg_data(&mMessage));
+}
+
+/**
+ * @return the number of bytes in the view
+ */
+size_t ZeroCopyMessage::Size() const {
+   if (mFrame) {
+      return zframe_size(mFrame);
+   }
+   return zmq_msg_size(&mMessage);
+}
+
+/**
+ * @return if there is nothing in the view
+ */
+bool ZeroCopyMessage::Empty() const {
+   return Size() == 0;
+}
+
+/**
+ * Convenience copy of the data
+ * @return 
+ */
+std::string ZeroCopyMessage::ToString() const {
+   return std::string(reinterpret_cast<const char*> (Data()), Size());
+}
+
+/**
+ * Replace the contents with a string that was never in ZeroMQ, taking over
+ * its buffer instead of copying it.
+ * @param data
+ *   Moved from
+ */
+void ZeroCopyMessage::Adopt(std::string&& data) {
+   Reset();
+   zmq_msg_close(&mMessage);
+   if (!CZMQToolkit::InitMessageTakingOwnership(mMessage, std::move(data))) {
+      zmq_msg_init(&mMessage);
+   }
+}
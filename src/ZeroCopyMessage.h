@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <zmq.h>
+
+struct _zframe_t;
+typedef struct _zframe_t zframe_t;
+
+/**
+ * A move-only handle to a received message that has not been copied out of
+ * ZeroMQ. The underlying zmq_msg_t or zframe_t is released when the handle is
+ * destroyed or reset, so the view from Data() is only valid for that long.
+ */
+class ZeroCopyMessage {
+public:
+   ZeroCopyMessage();
+   explicit ZeroCopyMessage(zframe_t* frame);
+   ZeroCopyMessage(ZeroCopyMessage&& other);
+   ZeroCopyMessage& operator=(ZeroCopyMessage&& other);
+   ZeroCopyMessage(const ZeroCopyMessage&) = delete;
+   ZeroCopyMessage& operator=(const ZeroCopyMessage&) = delete;
+   virtual ~ZeroCopyMessage();
+
+   int Receive(void* socket, const int flags);
+   bool More();
+   const uint8_t* Data() const;
+   size_t Size() const;
+   bool Empty() const;
+   std::string ToString() const;
+   template<typename T>
+   const T* View(size_t& count) const;
+   void Reset();
+   void Adopt(std::string&& data);
+private:
+   mutable zmq_msg_t mMessage;
+   zframe_t* mFrame;
+};
+
+/**
+ * An in place view of the message as an array of T, valid as long as the
+ * handle holds the message.
+ * @param count
+ *   Set to the number of T in the view, 0 when the message does not hold T
+ * @return 
+ *   nullptr if the size is not a multiple of T or the data is not aligned for T
+ */
+template<typename T>
+const T* ZeroCopyMessage::View(size_t& count) const {
+   static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be viewed in place");
+   count = 0;
+   const size_t size = Size();
+   const uint8_t* data = Data();
+   if (size == 0 || (size % sizeof (T)) != 0 ||
+      (reinterpret_cast<uintptr_t> (data) % alignof (T)) != 0) {
+      return nullptr;
+   }
+   count = size / sizeof (T);
+   return reinterpret_cast<const T*> (data);
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 
 #include "ZeroMQ.h"
@@ -23,10 +24,12 @@ using namespace boost;
  * @param $first
  *   An integer id number for the process that will own this queue, such as
  * the child thread number.
+ * @param $second
+ *   How the pointers travel, a socket by default
  */
-ZeroMQ<void*>::ZeroMQ(const unsigned int id) :
+ZeroMQ<void*>::ZeroMQ(const unsigned int id, const Backend backend) :
 IComponentQueue::IComponentQueue(), mId(id), mOwnsContext(
-true), mContext(NULL), mSocket(NULL) {
+true), mContext(NULL), mSocket(NULL), mBackend(backend), mPendingOffset(0) {
    stringstream bindingStream;
    bindingStream << "inproc://voidstar_" << getpid() << "_" << mId;
    mBinding = bindingStream.str();
@@ -41,7 +44,7 @@ true), mContext(NULL), mSocket(NULL) {
 ZeroMQ<void*>::ZeroMQ(const ZeroMQ<void*>& that) :
 IComponentQueue::IComponentQueue(), mId(that.mId), mBinding(
 that.mBinding), mOwnsContext(false), mContext(that.mContext), mSocket(
-NULL) {
+NULL), mBackend(that.mBackend), mRing(that.mRing), mClientReady(that.mClientReady), mPendingOffset(0) {
 
 }
 
@@ -53,7 +56,7 @@ NULL) {
 ZeroMQ<void*>::ZeroMQ(const ZeroMQ<void*>* that) :
 IComponentQueue::IComponentQueue(), mId(that->mId), mBinding(
 that->mBinding), mOwnsContext(false), mContext(that->mContext), mSocket(
-NULL) {
+NULL), mBackend(that->mBackend), mRing(that->mRing), mClientReady(that->mClientReady), mPendingOffset(0) {
 
 }
 
@@ -103,6 +106,16 @@ void ZeroMQ<void*>::CloseContext() {
  *   false is something goes wrong, if a client has no context
  */
 bool ZeroMQ<void*>::Initialize() {
+   if (mBackend == Backend::RING) {
+      if (mOwnsContext && !mRing) {
+         std::shared_ptr<SpscRing<void*> > ring(new SpscRing<void*>(GetHighWater()));
+         if (ring->IsValid()) {
+            mRing = ring;
+            mClientReady.reset(new std::atomic<bool>(false));
+         }
+      }
+      return mRing != nullptr;
+   }
    if (mOwnsContext) {
       mContext = GetContext();
       mSocket = GetSocket(mContext);
@@ -116,6 +129,51 @@ bool ZeroMQ<void*>::Initialize() {
 
 }
 
+/**
+ * @return how the pointers travel
+ */
+ZeroMQ<void*>::Backend ZeroMQ<void*>::GetBackend() const {
+   return mBackend;
+}
+
+/**
+ * A file descriptor to wait on the receiving copy in an epoll or poll loop,
+ * the ZMQ_FD of the socket or the ring's eventfd. It is edge triggered:
+ * when it polls readable, get pointers with a 0 timeout until IsReadable
+ * returns false, only then is it certain to fire again.
+ *
+ * @return
+ *   -1 on the sending side or before Initialize
+ */
+int ZeroMQ<void*>::GetFd() const {
+   if (mOwnsContext) {
+      return -1;
+   }
+   if (mBackend == Backend::RING) {
+      return mRing ? mRing->GetReadableFd() : -1;
+   }
+   return CZMQToolkit::GetReadableFd(mSocket);
+}
+
+/**
+ * Whether a pointer can be taken without waiting, which also rearms GetFd
+ *
+ * @return
+ *   false on the sending side
+ */
+bool ZeroMQ<void*>::IsReadable() {
+   if (mOwnsContext) {
+      return false;
+   }
+   if (mPendingOffset < mPending.size()) {
+      return true;
+   }
+   if (mBackend == Backend::RING) {
+      return mRing && mRing->ArmReadable();
+   }
+   return CZMQToolkit::IsReadable(mSocket);
+}
+
 /**
  * Abstraction of the ZMQ context initializer
  *
@@ -209,6 +267,15 @@ bool ZeroMQ<void*>::WaitForClient(int microseconds) {
    if (!mOwnsContext) {
       return false;
    }
+   if (mBackend == Backend::RING) {
+      if (!mClientReady) {
+         return false;
+      }
+      while (!mClientReady->load(std::memory_order_acquire)) {
+         boost::this_thread::sleep(boost::posix_time::microseconds(100));
+      }
+      return true;
+   }
    zmq_msg_t msg;
    if (!InitializeMsg(msg)) {
       return false;
@@ -269,6 +336,13 @@ bool ZeroMQ<void*>::SendClientReady() {
    if (mOwnsContext) {
       return false;
    }
+   if (mBackend == Backend::RING) {
+      if (!mClientReady) {
+         return false;
+      }
+      mClientReady->store(true, std::memory_order_release);
+      return true;
+   }
    if (!mSocket) {
       if (!Initialize()) {
          return false;
@@ -298,6 +372,17 @@ void* ZeroMQ<void*>::GetPointer(long timeout) {
    if (mOwnsContext) {
       return NULL;
    }
+   if (mBackend == Backend::RING) {
+      void* result = NULL;
+      if (mRing && mRing->Pop(result, timeout)) {
+         return result;
+      }
+      return NULL;
+   }
+   void* result = NULL;
+   if (TakePending(&result, 1) != 0) {
+      return result;
+   }
    zmq_msg_t msg;
    if (!InitializeMsg(msg)) {
       return NULL;
@@ -305,16 +390,14 @@ void* ZeroMQ<void*>::GetPointer(long timeout) {
 
 
    if ((zmq_recvmsg(mSocket, &msg, ZMQ_DONTWAIT)) >= 0) {
-      void * result = *(void**) zmq_msg_data(&msg);
-      zmq_msg_close(&msg);
+      Unpack(msg, &result, 1);
       return result;
    } else if (zmq_errno() == EAGAIN) {
       if (PollForReceiveSocketReady(timeout) < 0) {
          return NULL;
       }
       if ((zmq_recvmsg(mSocket, &msg, ZMQ_DONTWAIT)) >= 0) {
-         void * result = *(void**) zmq_msg_data(&msg);
-         zmq_msg_close(&msg);
+         Unpack(msg, &result, 1);
          return result;
       }
    }
@@ -322,6 +405,118 @@ void* ZeroMQ<void*>::GetPointer(long timeout) {
    return NULL;
 }
 
+/**
+ * Get up to maxPackets pointers from the queue, waiting only for the first
+ *
+ * @param packets
+ *   Room for maxPackets pointers
+ * @param maxPackets
+ * @param timeout
+ *   Timeout in ms
+ * @return
+ *   The number of pointers received, 0 if there wasn't one to find
+ */
+size_t ZeroMQ<void*>::GetPointers(void** packets, const size_t maxPackets, long timeout) {
+   if (mOwnsContext || maxPackets == 0) {
+      return 0;
+   }
+   if (mBackend == Backend::RING) {
+      return mRing ? mRing->PopMany(packets, maxPackets, timeout) : 0;
+   }
+   size_t count = TakePending(packets, maxPackets);
+   while (count < maxPackets) {
+      zmq_msg_t msg;
+      if (!InitializeMsg(msg)) {
+         break;
+      }
+      if (zmq_recvmsg(mSocket, &msg, ZMQ_DONTWAIT) >= 0) {
+         count += Unpack(msg, packets + count, maxPackets - count);
+         continue;
+      }
+      zmq_msg_close(&msg);
+      // only an empty batch is worth waiting for
+      if (count != 0 || zmq_errno() != EAGAIN || PollForReceiveSocketReady(timeout) <= 0) {
+         break;
+      }
+   }
+   return count;
+}
+
+/**
+ * Send a batch of void* pointers to the other thread, as one message or one
+ * ring update when there is room
+ *
+ * @param packets
+ * @param count
+ * @return
+ *   If the send was successful
+ */
+bool ZeroMQ<void*>::SendPointers(void* const* packets, const size_t count) {
+   if (!mOwnsContext) {
+      return false;
+   }
+   if (count == 0) {
+      return true;
+   }
+   if (mBackend == Backend::RING) {
+      return mRing && mRing->PushMany(packets, count, -1) == count;
+   }
+   const size_t bytes = count * sizeof (void*);
+   zmq_msg_t msg;
+   if (zmq_msg_init_size(&msg, bytes) != 0) {
+      return false;
+   }
+   memcpy(zmq_msg_data(&msg), packets, bytes);
+   bool result = (zmq_sendmsg(mSocket, &msg, 0) > 0);
+   zmq_msg_close(&msg);
+   return result;
+}
+
+/**
+ * Copy the pointers out of a received message, keeping what does not fit
+ *
+ * @param msg
+ *   Closed when done
+ * @param packets
+ * @param maxPackets
+ * @return
+ *   The number copied into packets
+ */
+size_t ZeroMQ<void*>::Unpack(zmq_msg_t& msg, void** packets, const size_t maxPackets) {
+   const size_t available = zmq_msg_size(&msg) / sizeof (void*);
+   void* const* data = static_cast<void* const*> (zmq_msg_data(&msg));
+   const size_t count = std::min(available, maxPackets);
+   memcpy(packets, data, count * sizeof (void*));
+   if (count < available) {
+      mPending.assign(data + count, data + available);
+      mPendingOffset = 0;
+   }
+   zmq_msg_close(&msg);
+   return count;
+}
+
+/**
+ * Hand out pointers left over from an earlier message
+ *
+ * @param packets
+ * @param maxPackets
+ * @return
+ *   The number copied into packets
+ */
+size_t ZeroMQ<void*>::TakePending(void** packets, const size_t maxPackets) {
+   const size_t count = std::min(mPending.size() - mPendingOffset, maxPackets);
+   if (count == 0) {
+      return 0;
+   }
+   memcpy(packets, mPending.data() + mPendingOffset, count * sizeof (void*));
+   mPendingOffset += count;
+   if (mPendingOffset == mPending.size()) {
+      mPending.clear();
+      mPendingOffset = 0;
+   }
+   return count;
+}
+
 /**
  * Send a void* pointer to the other thread
  *
@@ -332,6 +527,10 @@ bool ZeroMQ<void*>::SendPointer(void* packet) {
    if (!mOwnsContext) {
       return false;
    }
+   if (mBackend == Backend::RING) {
+      // blocks on a full ring like the socket send does at the high water mark
+      return mRing && mRing->Push(packet, -1);
+   }
    zmq_msg_t msg;
    zmq_msg_init_size(&msg, sizeof (void*));
    memcpy(zmq_msg_data(&msg), &packet, sizeof (void*));
@@ -2,25 +2,44 @@
 #include <stdint.h>
 #include <zmq.h>
 #include <zlib.h>
+#include <cstring>
 #include <map>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
 #include "IComponentQueue.h"
+#include "CZMQToolkit.h"
+#include "SpscRing.h"
 #include <boost/thread.hpp>
+#include <g3log/g3log.hpp>
 
 
 template<class dataType>
-class ZeroMQ : public IComponentQueue {
-public:
-   ZeroMQ();
-   ZeroMQ(const ZeroMQ<dataType>& that);
-   virtual ~ZeroMQ();
-
-};
+class ZeroMQ;
 
+/**
+ * Hands pointers from one thread to another. The thread that creates the
+ * queue sends, a copy of it made after Initialize receives.
+ *
+ * The SOCKET backend sends each pointer as a message on an inproc ZMQ_PAIR.
+ * The RING backend puts them in a SpscRing shared by the two copies, which
+ * is a store and a load in the common case.
+ *
+ * SendPointers and GetPointers move a batch at a time, one message or one
+ * ring index update for the lot. A message holding more pointers than the
+ * receiver asked for is kept, the rest come out of the next Get calls.
+ *
+ * The receiving copy can be waited on in an epoll or poll loop through
+ * GetFd, see there for how it has to be drained.
+ */
 template<>
 class ZeroMQ<void*> : public IComponentQueue {
 public:
-   explicit ZeroMQ(const unsigned int id);
+   enum class Backend : std::int8_t { SOCKET = 0, RING = 1 };
+
+   explicit ZeroMQ(const unsigned int id, const Backend backend = Backend::SOCKET);
    ZeroMQ(const ZeroMQ<void*>& that);
    ZeroMQ(const ZeroMQ<void*>* that);
    virtual ~ZeroMQ();
@@ -31,6 +50,11 @@ public:
    bool SendClientReady();
    void* GetPointer(long timeout);
    bool SendPointer(void* packet);
+   size_t GetPointers(void** packets, const size_t maxPackets, long timeout);
+   bool SendPointers(void* const* packets, const size_t count);
+   Backend GetBackend() const;
+   int GetFd() const;
+   bool IsReadable();
 protected:
    virtual void* GetContext();
    virtual void* GetSocket(void* context);
@@ -47,11 +71,335 @@ protected:
    const bool mOwnsContext;
    void* mContext;
    void* mSocket;
+   const Backend mBackend;
+   std::shared_ptr<SpscRing<void*> > mRing;
+   std::shared_ptr<std::atomic<bool> > mClientReady;
 private:
    
    int PollForSendSocketReady(long timeout);
    int PollForReceiveSocketReady(long timeout);
+   size_t Unpack(zmq_msg_t& msg, void** packets, const size_t maxPackets);
+   size_t TakePending(void** packets, const size_t maxPackets);
+
+   // pointers of a received message that did not fit the caller's batch
+   std::vector<void*> mPending;
+   size_t mPendingOffset;
 };
 
 #define ZeroMQ_HEADER_SIZE 0
 
+
+/**
+ * Hands plain values from one thread to another by copy, so small structs
+ * need no heap allocation of their own. Works like ZeroMQ<void*>: the thread
+ * that creates the queue sends, a copy of it made after Initialize receives.
+ *
+ * On the SOCKET backend a value is sent from and received into the caller's
+ * variable with one copy into and out of the message. On the RING backend
+ * values are copied into the SpscRing slots.
+ */
+template<class dataType>
+class ZeroMQ : public IComponentQueue {
+   static_assert(std::is_trivially_copyable<dataType>::value,
+           "values are copied bytewise, use ZeroMQ<void*> for anything else");
+public:
+   typedef ZeroMQ<void*>::Backend Backend;
+
+   explicit ZeroMQ(const unsigned int id, const Backend backend = Backend::SOCKET);
+   ZeroMQ(const ZeroMQ<dataType>& that);
+   ZeroMQ(const ZeroMQ<dataType>* that);
+   virtual ~ZeroMQ();
+
+   bool Initialize();
+   int GetHighWater();
+   bool WaitForClient(int microseconds);
+   bool SendClientReady();
+   bool GetValue(dataType& value, long timeout);
+   bool SendValue(const dataType& value);
+   Backend GetBackend() const;
+   int GetFd() const;
+   bool IsReadable();
+
+private:
+   bool ReceiveValue(dataType& value);
+   void CloseSocket();
+
+   unsigned int mId;
+   std::string mBinding;
+   const bool mOwnsContext;
+   void* mContext;
+   void* mSocket;
+   const Backend mBackend;
+   std::shared_ptr<SpscRing<dataType> > mRing;
+   std::shared_ptr<std::atomic<bool> > mClientReady;
+};
+
+/**
+ * A queue for values, the sending side.
+ * @param id
+ *   An integer id number for the process that will own this queue, such as
+ * the child thread number.
+ * @param backend
+ *   How the values travel, a socket by default
+ */
+template<class dataType>
+ZeroMQ<dataType>::ZeroMQ(const unsigned int id, const Backend backend) :
+IComponentQueue(), mId(id), mOwnsContext(true), mContext(NULL), mSocket(NULL), mBackend(backend) {
+   mBinding = "inproc://value_" + std::to_string(sizeof (dataType)) + "_" + std::to_string(getpid()) +
+           "_" + std::to_string(mId);
+}
+
+/**
+ * The receiving side, sharing the context or ring of the source queue.
+ */
+template<class dataType>
+ZeroMQ<dataType>::ZeroMQ(const ZeroMQ<dataType>& that) :
+IComponentQueue(), mId(that.mId), mBinding(that.mBinding), mOwnsContext(false),
+mContext(that.mContext), mSocket(NULL), mBackend(that.mBackend), mRing(that.mRing),
+mClientReady(that.mClientReady) {
+}
+
+/**
+ * The receiving side, sharing the context or ring of the source queue.
+ */
+template<class dataType>
+ZeroMQ<dataType>::ZeroMQ(const ZeroMQ<dataType>* that) : ZeroMQ(*that) {
+}
+
+/**
+ * Will destroy the context if it was the creator
+ */
+template<class dataType>
+ZeroMQ<dataType>::~ZeroMQ() {
+   boost::recursive_mutex::scoped_lock lock(mMutex);
+   CloseSocket();
+   if (mContext != NULL && mOwnsContext) {
+      if (zmq_term(mContext) != 0) {
+         LOG(WARNING) << "failed to terminate context " << mBinding;
+      }
+      mContext = NULL;
+   }
+}
+
+/**
+ * Setup the ring, or the client/server sockets and a context
+ * @return
+ *   false is something goes wrong, if a client has no context
+ */
+template<class dataType>
+bool ZeroMQ<dataType>::Initialize() {
+   if (mBackend == Backend::RING) {
+      if (mOwnsContext && !mRing) {
+         std::shared_ptr<SpscRing<dataType> > ring(new SpscRing<dataType>(GetHighWater()));
+         if (ring->IsValid()) {
+            mRing = ring;
+            mClientReady.reset(new std::atomic<bool>(false));
+         }
+      }
+      return mRing != nullptr;
+   }
+   if (mOwnsContext && mContext == NULL) {
+      mContext = zmq_init(1);
+   }
+   if (mContext == NULL || mSocket != NULL) {
+      return mSocket != NULL;
+   }
+   mSocket = zmq_socket(mContext, ZMQ_PAIR);
+   if (mSocket == NULL) {
+      return false;
+   }
+   int hwm = GetHighWater();
+   if (zmq_setsockopt(mSocket, ZMQ_SNDHWM, &hwm, sizeof (hwm)) != 0 ||
+      zmq_setsockopt(mSocket, ZMQ_RCVHWM, &hwm, sizeof (hwm)) != 0) {
+      CloseSocket();
+      return false;
+   }
+   int result = mOwnsContext ? zmq_bind(mSocket, mBinding.c_str()) : zmq_connect(mSocket, mBinding.c_str());
+   if (result != 0) {
+      CloseSocket();
+      return false;
+   }
+   return true;
+}
+
+/**
+ * @return the number of values that will be queued before SendValue blocks
+ */
+template<class dataType>
+int ZeroMQ<dataType>::GetHighWater() {
+   return 2048;
+}
+
+/**
+ * Wait for the client to start up
+ * @param microseconds
+ *   Not used, it waits until the client is ready like ZeroMQ<void*>
+ * @return
+ *   If the client ever responded that it was ready
+ */
+template<class dataType>
+bool ZeroMQ<dataType>::WaitForClient(int microseconds) {
+   if (!mOwnsContext) {
+      return false;
+   }
+   if (mBackend == Backend::RING) {
+      if (!mClientReady) {
+         return false;
+      }
+      while (!mClientReady->load(std::memory_order_acquire)) {
+         boost::this_thread::sleep(boost::posix_time::microseconds(100));
+      }
+      return true;
+   }
+   if (mSocket == NULL) {
+      return false;
+   }
+   zmq_pollitem_t items [] = {
+      { mSocket, 0, ZMQ_POLLIN, 0}
+   };
+   if (zmq_poll(items, 1, -1) < 0) {
+      return false;
+   }
+   char ready;
+   return zmq_recv(mSocket, &ready, sizeof (ready), ZMQ_DONTWAIT) >= 0;
+}
+
+/**
+ * Send ready signal to server
+ * @return
+ *   if the ready message was successfully queued
+ */
+template<class dataType>
+bool ZeroMQ<dataType>::SendClientReady() {
+   if (mOwnsContext) {
+      return false;
+   }
+   if (mBackend == Backend::RING) {
+      if (!mClientReady) {
+         return false;
+      }
+      mClientReady->store(true, std::memory_order_release);
+      return true;
+   }
+   if (mSocket == NULL && !Initialize()) {
+      return false;
+   }
+   return zmq_send(mSocket, NULL, 0, 0) >= 0;
+}
+
+/**
+ * Get a value from the queue, if there is one
+ * @param value
+ *   Set to the value received
+ * @param timeout
+ *   Timeout in ms
+ * @return
+ *   false if there isn't one to find
+ */
+template<class dataType>
+bool ZeroMQ<dataType>::GetValue(dataType& value, long timeout) {
+   if (mOwnsContext) {
+      return false;
+   }
+   if (mBackend == Backend::RING) {
+      return mRing && mRing->Pop(value, timeout);
+   }
+   if (mSocket == NULL) {
+      return false;
+   }
+   if (ReceiveValue(value)) {
+      return true;
+   }
+   if (zmq_errno() != EAGAIN) {
+      return false;
+   }
+   zmq_pollitem_t items [] = {
+      { mSocket, 0, ZMQ_POLLIN, 0}
+   };
+   if (zmq_poll(items, 1, timeout) <= 0) {
+      return false;
+   }
+   return ReceiveValue(value);
+}
+
+/**
+ * Send a copy of the value to the other thread, blocking at the high water
+ * mark.
+ * @param value
+ * @return
+ *   If the send was successful
+ */
+template<class dataType>
+bool ZeroMQ<dataType>::SendValue(const dataType& value) {
+   if (!mOwnsContext) {
+      return false;
+   }
+   if (mBackend == Backend::RING) {
+      return mRing && mRing->Push(value, -1);
+   }
+   if (mSocket == NULL) {
+      return false;
+   }
+   return zmq_send(mSocket, &value, sizeof (dataType), 0) == static_cast<int> (sizeof (dataType));
+}
+
+/**
+ * @return how the values travel
+ */
+template<class dataType>
+typename ZeroMQ<dataType>::Backend ZeroMQ<dataType>::GetBackend() const {
+   return mBackend;
+}
+
+/**
+ * A file descriptor to wait on the receiving copy in an epoll or poll loop,
+ * as ZeroMQ<void*>::GetFd.
+ * @return
+ *   -1 on the sending side or before Initialize
+ */
+template<class dataType>
+int ZeroMQ<dataType>::GetFd() const {
+   if (mOwnsContext) {
+      return -1;
+   }
+   if (mBackend == Backend::RING) {
+      return mRing ? mRing->GetReadableFd() : -1;
+   }
+   return CZMQToolkit::GetReadableFd(mSocket);
+}
+
+/**
+ * Whether a value can be taken without waiting, which also rearms GetFd.
+ * @return
+ */
+template<class dataType>
+bool ZeroMQ<dataType>::IsReadable() {
+   if (mOwnsContext) {
+      return false;
+   }
+   if (mBackend == Backend::RING) {
+      return mRing && mRing->ArmReadable();
+   }
+   return CZMQToolkit::IsReadable(mSocket);
+}
+
+/**
+ * Receive a value without waiting.
+ */
+template<class dataType>
+bool ZeroMQ<dataType>::ReceiveValue(dataType& value) {
+   return zmq_recv(mSocket, &value, sizeof (dataType), ZMQ_DONTWAIT) == static_cast<int> (sizeof (dataType));
+}
+
+/**
+ * Clean up the socket
+ */
+template<class dataType>
+void ZeroMQ<dataType>::CloseSocket() {
+   if (mSocket != NULL) {
+      if (zmq_close(mSocket) != 0) {
+         LOG(WARNING) << "failed to terminate socket " << mBinding;
+      }
+      mSocket = NULL;
+   }
+}
@@ -2,6 +2,7 @@
 #include "BoomStickTest.h"
 #include "MockSkelleton.h"
 #include "MockBoomStick.h"
+#include "SharedBoomStick.h"
 #include "FileIO.h"
 #include "Death.h"
 #include <set>
@@ -53,6 +54,49 @@ namespace {
       }
    }
 
+   std::vector<std::string> batchCommands(const size_t size) {
+      std::vector<std::string> commands;
+      for (size_t i = 0; i < size; ++i) {
+         commands.push_back("request " + std::to_string(i));
+      }
+      return commands;
+   }
+
+   /**
+    * SendAsync every command, then GetAsyncReply each in the order sent
+    * @return microseconds taken
+    */
+   long timeAsyncLoop(BoomStick& stick, const std::vector<std::string>& commands) {
+      auto start = std::chrono::steady_clock::now();
+      std::vector<std::string> ids;
+      for (const auto& command : commands) {
+         ids.push_back(stick.GetUuid());
+         EXPECT_TRUE(stick.SendAsync(ids.back(), command));
+      }
+      std::string reply;
+      for (size_t i = 0; i < ids.size(); ++i) {
+         EXPECT_TRUE(stick.GetAsyncReply(ids[i], 5000, reply));
+         EXPECT_EQ(commands[i] + " reply", reply);
+      }
+      return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+   }
+
+   /**
+    * The same through SendBatch
+    * @return microseconds taken
+    */
+   long timeSendBatch(BoomStick& stick, const std::vector<std::string>& commands) {
+      auto start = std::chrono::steady_clock::now();
+      size_t matched = 0;
+      EXPECT_EQ(commands.size(), stick.SendBatch(commands, 5000, [&commands, &matched](const size_t index, std::string& reply) {
+         if (reply == commands[index] + " reply") {
+            ++matched;
+         }
+      }));
+      EXPECT_EQ(commands.size(), matched);
+      return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+   }
+
    void Shooter(int threadId, int repitions, const std::string& address) {
       BoomStick stick{address};
       ASSERT_TRUE(stick.Initialize());
@@ -468,6 +512,260 @@ TEST_F(BoomStickTest, DontSearchSocketForever) {
 
 }
 
+TEST_F(BoomStickTest, UuidTextRoundTrip) {
+   BoomStick stick{mAddress};
+   boost::uuids::uuid id;
+   std::set<std::string> seen;
+   for (int i = 0; i < 100; ++i) {
+      std::string text = stick.GetUuid();
+      EXPECT_TRUE(seen.insert(text).second);
+      ASSERT_TRUE(BoomStick::ParseUuid(text, id));
+      EXPECT_EQ(text, BoomStick::FormatUuid(id));
+   }
+   ASSERT_TRUE(BoomStick::ParseUuid("0123ABCD-4567-89ab-CDEF-0123456789ab", id));
+   EXPECT_EQ("0123abcd-4567-89ab-cdef-0123456789ab", BoomStick::FormatUuid(id));
+   EXPECT_EQ(0x01, id.data[0]);
+   EXPECT_EQ(0xab, id.data[15]);
+   EXPECT_FALSE(BoomStick::ParseUuid("foo", id));
+   EXPECT_FALSE(BoomStick::ParseUuid("0123abcd-4567-89ab-cdef-0123456789a", id));
+   EXPECT_FALSE(BoomStick::ParseUuid("0123abcd_4567-89ab-cdef-0123456789ab", id));
+   EXPECT_FALSE(BoomStick::ParseUuid("0123abcd-4567-89ab-cdef-0123456789ag", id));
+}
+
+TEST_F(BoomStickTest, AnyIdCanBeUsed) {
+   BoomStick stick{mAddress};
+   MockSkelleton target{mAddress};
+
+   ASSERT_TRUE(target.Initialize());
+   ASSERT_TRUE(stick.Initialize());
+
+   target.BeginListenAndRepeat();
+   // only UUIDs go on the wire as they are, the rest are mapped to one
+   const std::vector<std::string> ids = {"foo", "0123456789abcdef", stick.GetUuid(), "",
+      "an id that is a good deal longer than any uuid would be"};
+   for (size_t i = 0; i < ids.size(); ++i) {
+      ASSERT_TRUE(stick.SendAsync(ids[i], "request " + std::to_string(i)));
+   }
+   for (size_t i = ids.size(); i-- > 0;) {
+      std::string reply;
+      ASSERT_TRUE(stick.GetAsyncReply(ids[i], 1000, reply));
+      EXPECT_EQ("request " + std::to_string(i) + " reply", reply);
+   }
+   std::string reply;
+   EXPECT_FALSE(stick.GetAsyncReply("foo", 10, reply));
+   ASSERT_TRUE(stick.SendAsync("foo", "again"));
+   ASSERT_TRUE(stick.GetAsyncReply("foo", 1000, reply));
+   EXPECT_EQ("again reply", reply);
+
+   target.EndListendAndRepeat();
+}
+
+TEST_F(BoomStickTest, RequestTtlForgetsReplies) {
+   MockBoomStick stick{mAddress};
+   MockSkelleton target{mAddress};
+
+   ASSERT_TRUE(target.Initialize());
+   ASSERT_TRUE(stick.Initialize());
+   EXPECT_EQ(5 * 60, stick.GetRequestTtl());
+   stick.SetRequestTtl(1);
+   EXPECT_EQ(1, stick.GetRequestTtl());
+
+   target.BeginListenAndRepeat();
+   ASSERT_TRUE(stick.SendAsync("kept", "first"));
+   ASSERT_TRUE(stick.SendAsync("dropped", "second"));
+   std::string reply;
+   // the second reply is left unread until it is past its TTL
+   ASSERT_TRUE(stick.GetAsyncReply("kept", 1000, reply));
+   EXPECT_EQ("first reply", reply);
+   std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+   stick.ForceGC();
+   stick.CleanOldPendingData();
+   EXPECT_FALSE(stick.GetAsyncReply("dropped", 10, reply));
+
+   target.EndListendAndRepeat();
+}
+
+TEST_F(BoomStickTest, SharedStickFromManyThreads) {
+   SharedBoomStick stick{mAddress};
+   MockSkelleton target{mAddress};
+   std::string reply;
+   bool called = false;
+   EXPECT_FALSE(stick.Send("too early", [&called](const bool, std::string&) {
+      called = true;
+   }));
+   EXPECT_EQ("", stick.Send("too early").get());
+   EXPECT_FALSE(called);
+
+   ASSERT_TRUE(target.Initialize());
+   ASSERT_TRUE(stick.Initialize());
+   ASSERT_TRUE(stick.IsRunning());
+   target.BeginListenAndRepeat();
+
+   const int kThreads = 4;
+   const int kRequests = 500;
+   std::atomic<int> matched{0};
+   std::vector<std::thread> threads;
+   for (int thread = 0; thread < kThreads; ++thread) {
+      threads.emplace_back([&stick, &matched, thread, kRequests]() {
+         std::vector<std::future<std::string> > replies;
+         for (int i = 0; i < kRequests; ++i) {
+            replies.push_back(stick.Send(std::to_string(thread) + " " + std::to_string(i)));
+         }
+         for (int i = 0; i < kRequests; ++i) {
+            if (replies[i].get() == std::to_string(thread) + " " + std::to_string(i) + " reply") {
+               ++matched;
+            }
+         }
+      });
+   }
+   for (auto& thread : threads) {
+      thread.join();
+   }
+   EXPECT_EQ(kThreads * kRequests, matched.load());
+   EXPECT_EQ(0, stick.GetOutstanding());
+   // requests queued while the IO thread was busy went out together
+   EXPECT_LT(stick.GetSendBatches(), kThreads * kRequests);
+
+   std::promise<std::string> promisedReply;
+   ASSERT_TRUE(stick.Send("callback", [&promisedReply](const bool success, std::string& reply) {
+      EXPECT_TRUE(success);
+      promisedReply.set_value(reply);
+   }));
+   EXPECT_EQ("callback reply", promisedReply.get_future().get());
+
+   target.EndListendAndRepeat();
+}
+
+TEST_F(BoomStickTest, SharedStickFailsUnanswered) {
+   SharedBoomStick stick{mAddress};
+   MockSkelleton target{mAddress};
+   stick.SetRequestTtl(1);
+   ASSERT_TRUE(target.Initialize());
+   ASSERT_TRUE(stick.Initialize());
+
+   // nobody is listening, the request expires
+   std::future<std::string> expired = stick.Send("expires");
+   ASSERT_TRUE(expired.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+   EXPECT_EQ("", expired.get());
+
+   stick.Stop();
+
+   SharedBoomStick patient{mAddress};
+   ASSERT_TRUE(patient.Initialize());
+   std::promise<std::string> promisedError;
+   ASSERT_TRUE(patient.Send("stopped", [&promisedError](const bool success, std::string& reply) {
+      EXPECT_FALSE(success);
+      promisedError.set_value(reply);
+   }));
+   std::this_thread::sleep_for(std::chrono::milliseconds(100));
+   EXPECT_EQ(1, patient.GetOutstanding());
+   patient.Stop();
+   EXPECT_FALSE(patient.IsRunning());
+   EXPECT_EQ("Stopped", promisedError.get_future().get());
+   EXPECT_EQ(0, patient.GetOutstanding());
+   EXPECT_FALSE(patient.Send("stopped", [](const bool, std::string&) {
+   }));
+}
+
+TEST_F(BoomStickTest, SendBatchInCompletionOrder) {
+   BoomStick stick{mAddress};
+   MockSkelleton target{mAddress};
+   const std::vector<std::string> commands = batchCommands(100);
+   EXPECT_EQ(0, stick.SendBatch(commands, 10, [](const size_t, std::string&) {
+      FAIL();
+   }));
+
+   ASSERT_TRUE(target.Initialize());
+   ASSERT_TRUE(stick.Initialize());
+   target.BeginListenAndRepeat();
+
+   // a reply to an earlier request that comes during the batch is kept
+   const std::string other = stick.GetUuid();
+   ASSERT_TRUE(stick.SendAsync(other, "other"));
+   std::vector<int> seen(commands.size(), 0);
+   EXPECT_EQ(commands.size(), stick.SendBatch(commands, 1000, [&](const size_t index, std::string& reply) {
+      ASSERT_LT(index, commands.size());
+      ++seen[index];
+      EXPECT_EQ(commands[index] + " reply", reply);
+   }));
+   EXPECT_EQ(std::vector<int>(commands.size(), 1), seen);
+   std::string reply;
+   ASSERT_TRUE(stick.GetAsyncReply(other, 1000, reply));
+   EXPECT_EQ("other reply", reply);
+   EXPECT_EQ(0, stick.SendBatch({}, 10, [](const size_t, std::string&) {
+      FAIL();
+   }));
+
+   target.EndListendAndRepeat();
+}
+
+TEST_F(BoomStickTest, SendBatchWithinTheWait) {
+   using namespace std::chrono;
+   BoomStick stick{mAddress};
+   // nobody answers and the pipe fills up after a few commands
+   stick.SetSendHWM(10);
+   ASSERT_TRUE(stick.Initialize());
+   const std::vector<std::string> commands = batchCommands(100);
+   const unsigned int msToWait = 100;
+   const steady_clock::time_point start = steady_clock::now();
+   EXPECT_EQ(0, stick.SendBatch(commands, msToWait, [](const size_t, std::string&) {
+      FAIL();
+   }));
+   const long elapsedMs = duration_cast<milliseconds>(steady_clock::now() - start).count();
+   EXPECT_LE(msToWait, elapsedMs);
+   // with slack for a busy machine
+   EXPECT_GT(msToWait + 400, elapsedMs);
+}
+
+TEST_F(BoomStickTest, SendBatchVersusAsyncLoop) {
+   BoomStick stick{mAddress};
+   MockSkelleton target{mAddress};
+   // the async loop leaves every reply on the socket until the sends are done
+   stick.SetRecvHWM(20000);
+   stick.SetSendHWM(20000);
+   ASSERT_TRUE(target.Initialize());
+   ASSERT_TRUE(stick.Initialize());
+   target.BeginListenAndRepeat();
+
+   for (size_t size : {10, 100, 1000, 10000}) {
+      const std::vector<std::string> commands = batchCommands(size);
+      const long loopUs = timeAsyncLoop(stick, commands);
+      const long batchUs = timeSendBatch(stick, commands);
+      std::cout << size << " requests, SendAsync loop " << loopUs << "us, SendBatch " << batchUs
+              << "us, " << (loopUs * 1.0) / std::max(batchUs, 1L) << "x" << std::endl;
+   }
+
+   target.EndListendAndRepeat();
+}
+
+TEST_F(BoomStickTest, UnreadRepliesEvicted) {
+   MockBoomStick stick{mAddress};
+   MockSkelleton target{mAddress};
+   stick.SetUnreadLimits(2, 1024);
+   ASSERT_TRUE(target.Initialize());
+   ASSERT_TRUE(stick.Initialize());
+   target.BeginListenAndRepeat();
+
+   std::vector<std::string> ids;
+   for (int i = 0; i < 5; ++i) {
+      ids.push_back(stick.GetUuid());
+      ASSERT_TRUE(stick.SendAsync(ids.back(), "request " + std::to_string(i)));
+   }
+   // the first four are read while looking for the last, only two are kept
+   std::string reply;
+   ASSERT_TRUE(stick.GetAsyncReply(ids[4], 1000, reply));
+   EXPECT_EQ(2, stick.GetEvictedReplies());
+   EXPECT_EQ(2 * std::string("request 0 reply").size(), stick.GetEvictedReplyBytes());
+   EXPECT_FALSE(stick.GetAsyncReply(ids[0], 10, reply));
+   EXPECT_FALSE(stick.GetAsyncReply(ids[1], 10, reply));
+   ASSERT_TRUE(stick.GetAsyncReply(ids[2], 10, reply));
+   EXPECT_EQ("request 2 reply", reply);
+   ASSERT_TRUE(stick.GetAsyncReply(ids[3], 10, reply));
+   EXPECT_EQ("request 3 reply", reply);
+
+   target.EndListendAndRepeat();
+}
+
 #else 
 
 TEST_F(BoomStickTest, emptyTest) {
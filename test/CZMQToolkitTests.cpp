@@ -45,3 +45,28 @@ TEST_F(CZMQToolkitTests, SendExistingMessage) {
    zmsg_destroy(&message);
 }
 
+
+TEST_F(CZMQToolkitTests, CompressAndUncompress) {
+   std::string original;
+   for (int i = 0; i < 100; ++i) {
+      original += "<13>Oct 16 12:00:00 host sshd[42]: Accepted publickey for user from 10.0.0.1\n";
+   }
+   std::string compressed;
+   ASSERT_TRUE(CZMQToolkit::Compress(original.data(), original.size(), 6, compressed));
+   EXPECT_LT(compressed.size(), original.size() / 10);
+   std::string uncompressed("reused");
+   ASSERT_TRUE(CZMQToolkit::Uncompress(compressed.data(), compressed.size(), uncompressed));
+   EXPECT_EQ(original, uncompressed);
+}
+
+TEST_F(CZMQToolkitTests, UncompressRejectsGarbage) {
+   std::string uncompressed;
+   EXPECT_FALSE(CZMQToolkit::Uncompress("abc", 3, uncompressed));
+   std::string garbage(64, 'g');
+   EXPECT_FALSE(CZMQToolkit::Uncompress(garbage.data(), garbage.size(), uncompressed));
+   EXPECT_TRUE(uncompressed.empty());
+   std::string compressed;
+   ASSERT_TRUE(CZMQToolkit::Compress(garbage.data(), garbage.size(), 1, compressed));
+   compressed.resize(compressed.size() - 1);
+   EXPECT_FALSE(CZMQToolkit::Uncompress(compressed.data(), compressed.size(), uncompressed));
+}
@@ -0,0 +1,131 @@
+#include "ContextRegistryTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+#include "Shotgun.h"
+#include "Alien.h"
+#include "BoomStick.h"
+#include <unistd.h>
+#include <memory>
+
+std::string ContextRegistryTests::GetIpcLocation() {
+   int pid = getpid();
+   std::string ipcLocation("ipc:///tmp/");
+   ipcLocation.append("ContextRegistryTests");
+   ipcLocation.append(std::to_string(pid));
+   ipcLocation.append(".ipc");
+   return ipcLocation;
+}
+
+TEST_F(ContextRegistryTests, AcquireAndRelease) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   const std::string name = "AcquireAndRelease";
+   EXPECT_EQ(0, registry.UseCount(name));
+   zctx_t* first = registry.Acquire(name);
+   zctx_t* second = registry.Acquire(name);
+   ASSERT_NE(nullptr, first);
+   ASSERT_NE(nullptr, second);
+   EXPECT_NE(first, second);
+   EXPECT_EQ(2, registry.UseCount(name));
+   EXPECT_EQ(0, registry.UseCount("SomethingElse"));
+
+   registry.Release(first);
+   EXPECT_EQ(nullptr, first);
+   EXPECT_EQ(1, registry.UseCount(name));
+   registry.Release(second);
+   EXPECT_EQ(nullptr, second);
+   EXPECT_EQ(0, registry.UseCount(name));
+
+   // released contexts are created again on demand
+   zctx_t* third = registry.Acquire(name);
+   ASSERT_NE(nullptr, third);
+   EXPECT_EQ(1, registry.UseCount(name));
+   registry.Release(third);
+   EXPECT_EQ(0, registry.UseCount(name));
+}
+
+TEST_F(ContextRegistryTests, ConfigureOnlyWhenIdle) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   const std::string name = "ConfigureOnlyWhenIdle";
+   EXPECT_TRUE(registry.Configure(name, 2));
+   zctx_t* context = registry.Acquire(name);
+   ASSERT_NE(nullptr, context);
+   EXPECT_FALSE(registry.Configure(name, 4));
+   registry.Release(context);
+   EXPECT_TRUE(registry.Configure(name, 4));
+}
+
+TEST_F(ContextRegistryTests, ReleasePrivateContext) {
+   zctx_t* context = zctx_new();
+   ASSERT_NE(nullptr, context);
+   ASSERT_NE(nullptr, zsocket_new(context, ZMQ_PUSH));
+   ContextRegistry::Instance().Release(context);
+   EXPECT_EQ(nullptr, context);
+   zctx_t* nothing = nullptr;
+   ContextRegistry::Instance().Release(nothing);
+   EXPECT_EQ(nullptr, nothing);
+}
+
+TEST_F(ContextRegistryTests, RifleVampireShareContext) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   const std::string name = "RifleVampireShareContext";
+   ASSERT_TRUE(registry.Configure(name, 2));
+   std::string location = GetIpcLocation();
+   {
+      Rifle rifle(location);
+      rifle.SetSharedContext(name, 1);
+      Vampire vampire(location);
+      vampire.SetSharedContext(name, 2);
+      ASSERT_TRUE(rifle.Aim());
+      ASSERT_TRUE(vampire.PrepareToBeShot());
+      EXPECT_EQ(2, registry.UseCount(name));
+
+      ASSERT_TRUE(rifle.Fire("shared", 100));
+      std::string bullet;
+      ASSERT_TRUE(vampire.GetShot(bullet, 100));
+      EXPECT_EQ("shared", bullet);
+   }
+   EXPECT_EQ(0, registry.UseCount(name));
+}
+
+/**
+ * inproc sockets only reach each other on the same context, so this only
+ * works if the context is really shared.
+ */
+TEST_F(ContextRegistryTests, RifleVampireShareInproc) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   const std::string name = "RifleVampireShareInproc";
+   std::string location = "inproc://RifleVampireShareInproc";
+   std::unique_ptr<Vampire> vampire(new Vampire(location));
+   vampire->SetSharedContext(name);
+   vampire->SetOwnSocket(true);
+   ASSERT_TRUE(vampire->PrepareToBeShot());
+   {
+      Rifle rifle(location);
+      rifle.SetSharedContext(name);
+      rifle.SetOwnSocket(false);
+      ASSERT_TRUE(rifle.Aim());
+      EXPECT_EQ(2, registry.UseCount(name));
+      ASSERT_TRUE(rifle.Fire("inproc", 100));
+   }
+   // teardown order does not matter, the vampire keeps the context alive
+   EXPECT_EQ(1, registry.UseCount(name));
+   std::string bullet;
+   ASSERT_TRUE(vampire->GetShot(bullet, 100));
+   EXPECT_EQ("inproc", bullet);
+   vampire.reset();
+   EXPECT_EQ(0, registry.UseCount(name));
+}
+
+TEST_F(ContextRegistryTests, EveryQueueCanShare) {
+   ContextRegistry& registry = ContextRegistry::Instance();
+   const std::string name = "EveryQueueCanShare";
+   {
+      Shotgun shotgun(name);
+      Alien alien(name, 1);
+      BoomStick stick("tcp://127.0.0.1:13579");
+      stick.SetSharedContext(name);
+      ASSERT_TRUE(stick.Initialize());
+      EXPECT_EQ(3, registry.UseCount(name));
+   }
+   EXPECT_EQ(0, registry.UseCount(name));
+}
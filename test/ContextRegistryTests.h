@@ -0,0 +1,23 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "ContextRegistry.h"
+#include <czmq.h>
+
+class ContextRegistryTests : public ::testing::Test {
+public:
+
+   ContextRegistryTests() {
+   };
+   static std::string GetIpcLocation();
+
+protected:
+
+   virtual void SetUp() {
+      zctx_interrupted = false;
+   };
+
+   virtual void TearDown() {
+      zctx_interrupted = false;
+   };
+};
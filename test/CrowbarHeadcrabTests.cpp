@@ -206,6 +206,43 @@ TEST_F(CrowbarHeadcrabTests, SmashAHeadcrabMulti) {
 
 }
 
+TEST_F(CrowbarHeadcrabTests, SmashAHeadcrabZeroCopy) {
+
+   Headcrab target(mTarget);
+   ASSERT_TRUE(target.ComeToLife());
+   Crowbar shooter(target);
+   ASSERT_TRUE(shooter.Wield());
+
+   std::string expected("abc123");
+   std::vector<std::string> data;
+   data.push_back(expected);
+   data.push_back(expected + "again");
+   std::vector<ZeroCopyMessage> wounds;
+   ASSERT_FALSE(target.GetHitWait(wounds, 100));
+   ASSERT_TRUE(shooter.Flurry(data));
+   ASSERT_TRUE(target.GetHitWait(wounds, 1000));
+   ASSERT_EQ(2, wounds.size());
+   ASSERT_EQ(expected.size(), wounds[0].Size());
+   EXPECT_EQ(0, memcmp(expected.data(), wounds[0].Data(), wounds[0].Size()));
+   EXPECT_EQ(data[1], wounds[1].ToString());
+   ASSERT_TRUE(target.SendSplatter(data));
+
+   std::vector<ZeroCopyMessage> guts;
+   ASSERT_TRUE(shooter.WaitForKill(guts, 1000));
+   ASSERT_EQ(2, guts.size());
+   EXPECT_EQ(data[0], guts[0].ToString());
+   EXPECT_EQ(data[1], guts[1].ToString());
+
+   ASSERT_TRUE(shooter.Flurry(data));
+   ASSERT_TRUE(target.GetHitBlock(wounds));
+   ASSERT_EQ(2, wounds.size());
+   ASSERT_TRUE(target.SendSplatter(data));
+   ASSERT_TRUE(shooter.BlockForKill(guts));
+   ASSERT_EQ(2, guts.size());
+   EXPECT_EQ(data[1], guts[1].ToString());
+   zclock_sleep(100);
+}
+
 TEST_F(CrowbarHeadcrabTests, SmashAHeadcrabBlockingMulti) {
 
    Headcrab target(mTarget);
@@ -0,0 +1,86 @@
+#include "ExpiryWheelTests.h"
+#include <cstring>
+#include <set>
+#include <vector>
+
+TEST_F(ExpiryWheelTests, ExpiresInOrder) {
+   ExpiryWheel wheel(16, 1000);
+   wheel.Add(MakeKey(1), 1001);
+   wheel.Add(MakeKey(2), 1003);
+   wheel.Add(MakeKey(3), 1003);
+   EXPECT_EQ(3, wheel.Size());
+   std::vector<boost::uuids::uuid> expired;
+   auto collect = [&expired](const boost::uuids::uuid & key) {
+      expired.push_back(key);
+   };
+   EXPECT_EQ(0, wheel.Advance(1000, collect));
+   EXPECT_EQ(1, wheel.Advance(1001, collect));
+   ASSERT_EQ(1, expired.size());
+   EXPECT_EQ(MakeKey(1), expired[0]);
+   EXPECT_EQ(0, wheel.Advance(1002, collect));
+   // going back in time does nothing
+   EXPECT_EQ(0, wheel.Advance(900, collect));
+   EXPECT_EQ(2, wheel.Advance(1003, collect));
+   EXPECT_EQ(3, expired.size());
+   EXPECT_EQ(0, wheel.Size());
+}
+
+TEST_F(ExpiryWheelTests, CancelAndReuse) {
+   ExpiryWheel wheel(16, 1000);
+   const ExpiryWheel::Handle first = wheel.Add(MakeKey(1), 1002);
+   const ExpiryWheel::Handle second = wheel.Add(MakeKey(2), 1002);
+   wheel.Add(MakeKey(3), 1002);
+   wheel.Cancel(second);
+   wheel.Cancel(ExpiryWheel::kNoTimer);
+   EXPECT_EQ(2, wheel.Size());
+   // the cancelled node is the next one handed out
+   EXPECT_EQ(second, wheel.Add(MakeKey(4), 1005));
+   wheel.Cancel(first);
+   std::set<uint64_t> expired;
+   auto collect = [&expired](const boost::uuids::uuid & key) {
+      uint64_t number;
+      memcpy(&number, key.data + 8, sizeof (number));
+      expired.insert(number);
+   };
+   EXPECT_EQ(1, wheel.Advance(1004, collect));
+   EXPECT_EQ(std::set<uint64_t>({3}), expired);
+   EXPECT_EQ(1, wheel.Advance(1005, collect));
+   EXPECT_EQ(std::set<uint64_t>({3, 4}), expired);
+   wheel.Add(MakeKey(5), 1010);
+   wheel.Clear();
+   EXPECT_EQ(0, wheel.Size());
+   EXPECT_EQ(0, wheel.Advance(1020, collect));
+}
+
+TEST_F(ExpiryWheelTests, TimersPastOneTurn) {
+   ExpiryWheel wheel(16, 1000);
+   // both land in the same slot, one a turn later than the other
+   wheel.Add(MakeKey(1), 1004);
+   wheel.Add(MakeKey(2), 1020);
+   // already due, expires on the next advance
+   wheel.Add(MakeKey(3), 10);
+   size_t count = 0;
+   auto counter = [&count](const boost::uuids::uuid&) {
+      ++count;
+   };
+   EXPECT_EQ(1, wheel.Advance(1001, counter));
+   EXPECT_EQ(1, wheel.Advance(1004, counter));
+   EXPECT_EQ(1, wheel.Size());
+   EXPECT_EQ(0, wheel.Advance(1019, counter));
+   EXPECT_EQ(1, wheel.Advance(1020, counter));
+   EXPECT_EQ(3, count);
+}
+
+TEST_F(ExpiryWheelTests, LongIdleVisitsEachSlotOnce) {
+   ExpiryWheel wheel(16, 0);
+   for (uint64_t i = 0; i < 1000; ++i) {
+      wheel.Add(MakeKey(i), 1 + static_cast<time_t> (i % 100));
+   }
+   EXPECT_EQ(1000, wheel.Size());
+   size_t count = 0;
+   EXPECT_EQ(1000, wheel.Advance(1000000, [&count](const boost::uuids::uuid&) {
+      ++count;
+   }));
+   EXPECT_EQ(1000, count);
+   EXPECT_EQ(0, wheel.Size());
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "ExpiryWheel.h"
+#include "UuidKeyHelper.h"
+
+class ExpiryWheelTests : public ::testing::Test {
+public:
+
+   ExpiryWheelTests() {
+   };
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+};
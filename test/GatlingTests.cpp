@@ -0,0 +1,157 @@
+#include "GatlingTests.h"
+#include "Vampire.h"
+#include <unistd.h>
+#include <map>
+#include <memory>
+
+std::string GatlingTests::GetIpcLocation(const int barrel) {
+   int pid = getpid();
+   std::string ipcLocation("ipc:///tmp/");
+   ipcLocation.append("GatlingTests");
+   ipcLocation.append(std::to_string(pid));
+   ipcLocation.append("_");
+   ipcLocation.append(std::to_string(barrel));
+   ipcLocation.append(".ipc");
+   return ipcLocation;
+}
+
+std::string GatlingTests::GetInprocLocation(const int barrel) {
+   std::string inprocLocation("inproc://GatlingTests");
+   inprocLocation.append(std::to_string(rand()));
+   inprocLocation.append("_");
+   inprocLocation.append(std::to_string(barrel));
+   return inprocLocation;
+}
+
+TEST_F(GatlingTests, HashIsStable) {
+   // every sender process must put a key in the same place
+   EXPECT_EQ(17280346270528514342ULL, Gatling::Hash(""));
+   EXPECT_EQ(7388865426424784868ULL, Gatling::Hash("flow"));
+}
+
+TEST_F(GatlingTests, Barrels) {
+   Gatling gatling({"ipc:///tmp/a", "ipc:///tmp/b", "ipc:///tmp/a"});
+   EXPECT_EQ(2, gatling.GetBarrels().size());
+   EXPECT_FALSE(gatling.AddBarrel("ipc:///tmp/b"));
+   EXPECT_TRUE(gatling.AddBarrel("ipc:///tmp/c"));
+   EXPECT_TRUE(gatling.RemoveBarrel("ipc:///tmp/a"));
+   EXPECT_FALSE(gatling.RemoveBarrel("ipc:///tmp/a"));
+   EXPECT_EQ(std::vector<std::string>({"ipc:///tmp/b", "ipc:///tmp/c"}), gatling.GetBarrels());
+   EXPECT_FALSE(gatling.Fire("key", "not aimed", 0));
+
+   Gatling empty({});
+   EXPECT_FALSE(empty.Aim());
+   EXPECT_TRUE(empty.GetBarrel("key").empty());
+}
+
+TEST_F(GatlingTests, ReshardingMovesFewKeys) {
+   const int kKeys = 10000;
+   Gatling gatling({"ipc:///tmp/a", "ipc:///tmp/b", "ipc:///tmp/c", "ipc:///tmp/d"});
+   std::vector<std::string> before;
+   std::map<std::string, int> spread;
+   for (int key = 0; key < kKeys; ++key) {
+      before.push_back(gatling.GetBarrel(std::to_string(key)));
+      spread[before.back()]++;
+   }
+   for (const auto& barrel : spread) {
+      // a quarter each, give or take
+      EXPECT_LT(kKeys / 8, barrel.second) << barrel.first;
+      EXPECT_GT(kKeys / 2, barrel.second) << barrel.first;
+   }
+
+   ASSERT_TRUE(gatling.AddBarrel("ipc:///tmp/e"));
+   int moved = 0;
+   for (int key = 0; key < kKeys; ++key) {
+      std::string after = gatling.GetBarrel(std::to_string(key));
+      if (after != before[key]) {
+         EXPECT_EQ("ipc:///tmp/e", after);
+         ++moved;
+      }
+   }
+   // about a fifth should move to the new barrel, a modulo hash moves 4/5
+   EXPECT_LT(kKeys / 10, moved);
+   EXPECT_GT(kKeys * 3 / 10, moved);
+
+   ASSERT_TRUE(gatling.RemoveBarrel("ipc:///tmp/e"));
+   ASSERT_TRUE(gatling.RemoveBarrel("ipc:///tmp/b"));
+   for (int key = 0; key < kKeys; ++key) {
+      if (before[key] != "ipc:///tmp/b") {
+         EXPECT_EQ(before[key], gatling.GetBarrel(std::to_string(key)));
+      }
+   }
+}
+
+TEST_F(GatlingTests, SameKeySameVampire) {
+   const int kBarrels = 4;
+   const int kKeys = 100;
+   const int kShotsPerKey = 10;
+   std::vector<std::string> locations;
+   std::vector<std::unique_ptr<Vampire> > vampires;
+   for (int barrel = 0; barrel < kBarrels; ++barrel) {
+      locations.push_back(GetIpcLocation(barrel));
+      vampires.emplace_back(new Vampire(locations.back()));
+      vampires.back()->SetOwnSocket(true);
+      ASSERT_TRUE(vampires.back()->PrepareToBeShot());
+   }
+   Gatling gatling(locations);
+   gatling.SetSharedContext("GatlingTests");
+   ASSERT_TRUE(gatling.Aim());
+   for (int shot = 0; shot < kShotsPerKey; ++shot) {
+      for (int key = 0; key < kKeys; ++key) {
+         ASSERT_TRUE(gatling.Fire(std::to_string(key), std::to_string(key), 1000));
+      }
+   }
+   int received = 0;
+   std::vector<std::string> wounds;
+   for (int barrel = 0; barrel < kBarrels; ++barrel) {
+      size_t count = 0;
+      while ((count = vampires[barrel]->GetShots(wounds, 100, 100)) > 0) {
+         for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(locations[barrel], gatling.GetBarrel(wounds[i]));
+         }
+         received += count;
+      }
+      EXPECT_EQ(vampires[barrel]->GetStats().messages, gatling.GetStats(locations[barrel]).messages);
+   }
+   EXPECT_EQ(kKeys * kShotsPerKey, received);
+   EXPECT_EQ(0, gatling.GetFailovers());
+}
+
+TEST_F(GatlingTests, FailoverAtHighWater) {
+   std::vector<std::string> locations = {GetInprocLocation(0), GetInprocLocation(1)};
+   std::map<std::string, std::unique_ptr<Vampire> > vampires;
+   for (const auto& location : locations) {
+      vampires[location].reset(new Vampire(location));
+      vampires[location]->SetHighWater(2);
+      vampires[location]->SetInprocFastPath(true);
+      ASSERT_TRUE(vampires[location]->PrepareToBeShot());
+   }
+   Gatling gatling(locations);
+   gatling.SetInprocFastPath(true);
+   ASSERT_TRUE(gatling.Aim());
+   const std::string key = "flow";
+   const std::string primary = gatling.GetBarrel(key);
+   const std::string sibling = (primary == locations[0]) ? locations[1] : locations[0];
+
+   EXPECT_TRUE(gatling.Fire(key, "1", 10));
+   EXPECT_TRUE(gatling.Fire(key, "2", 10));
+   EXPECT_EQ(0, gatling.GetFailovers());
+   // the key's vampire is full, the sibling takes over
+   EXPECT_TRUE(gatling.Fire(key, "3", 10));
+   EXPECT_TRUE(gatling.Fire(key, "4", 10));
+   EXPECT_EQ(2, gatling.GetFailovers());
+   // everything is full
+   EXPECT_FALSE(gatling.Fire(key, "5", 10));
+
+   std::vector<std::string> wounds;
+   ASSERT_EQ(2, vampires[primary]->GetShots(wounds, 10, 100));
+   EXPECT_EQ("1", wounds[0]);
+   EXPECT_EQ("2", wounds[1]);
+   ASSERT_EQ(2, vampires[sibling]->GetShots(wounds, 10, 100));
+   EXPECT_EQ("3", wounds[0]);
+   EXPECT_EQ("4", wounds[1]);
+   // back to its own vampire once there is room
+   EXPECT_TRUE(gatling.Fire(key, "6", 10));
+   ASSERT_TRUE(vampires[primary]->GetShot(wounds[0], 100));
+   EXPECT_EQ("6", wounds[0]);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "Gatling.h"
+#include <czmq.h>
+
+class GatlingTests : public ::testing::Test {
+public:
+
+   GatlingTests() {
+   };
+   static std::string GetIpcLocation(const int barrel);
+   static std::string GetInprocLocation(const int barrel);
+
+protected:
+
+   virtual void SetUp() {
+      zctx_interrupted = false;
+   };
+
+   virtual void TearDown() {
+      zctx_interrupted = false;
+   };
+};
@@ -0,0 +1,173 @@
+#include "MpmcRingTests.h"
+#include <chrono>
+#include <poll.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_F(MpmcRingTests, CapacityIsKept) {
+   MpmcRing<std::string> ring(10);
+   ASSERT_TRUE(ring.IsValid());
+   EXPECT_EQ(10, ring.Capacity());
+   EXPECT_EQ(0, ring.Size());
+   EXPECT_TRUE(ring.Empty());
+   MpmcRing<std::string> tiny(0);
+   EXPECT_EQ(2, tiny.Capacity());
+}
+
+TEST_F(MpmcRingTests, FullAndEmpty) {
+   MpmcRing<std::string> ring(3);
+   std::string item;
+   EXPECT_FALSE(ring.TryPop(item));
+   for (int i = 0; i < 3; ++i) {
+      item = std::to_string(i);
+      EXPECT_TRUE(ring.TryPush(item));
+   }
+   item = "full";
+   EXPECT_FALSE(ring.TryPush(item));
+   // not moved from when it did not fit
+   EXPECT_EQ("full", item);
+   EXPECT_EQ(3, ring.Size());
+   for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(ring.TryPop(item));
+      EXPECT_EQ(std::to_string(i), item);
+   }
+   EXPECT_FALSE(ring.TryPop(item));
+   EXPECT_TRUE(ring.Empty());
+   // around the end of the slots
+   for (int i = 0; i < 10; ++i) {
+      item = std::to_string(i);
+      ASSERT_TRUE(ring.TryPush(item));
+      ASSERT_TRUE(ring.TryPop(item));
+      EXPECT_EQ(std::to_string(i), item);
+   }
+}
+
+TEST_F(MpmcRingTests, TimeoutsWait) {
+   using namespace std::chrono;
+   MpmcRing<int> ring(2);
+   int item = 0;
+   steady_clock::time_point start = steady_clock::now();
+   EXPECT_FALSE(ring.Pop(item, 50));
+   EXPECT_LE(40, duration_cast<milliseconds>(steady_clock::now() - start).count());
+   EXPECT_FALSE(ring.Pop(item, 0));
+   item = 1;
+   ASSERT_TRUE(ring.Push(item, 0));
+   ASSERT_TRUE(ring.Push(item, 0));
+   start = steady_clock::now();
+   EXPECT_FALSE(ring.Push(item, 50));
+   EXPECT_LE(40, duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+TEST_F(MpmcRingTests, BlockedSidesWakeUp) {
+   MpmcRing<int> ring(2);
+   int item = 0;
+   std::thread producer([&ring]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      int pushed = 7;
+      ring.Push(pushed, -1);
+   });
+   ASSERT_TRUE(ring.Pop(item, 5000));
+   EXPECT_EQ(7, item);
+   producer.join();
+
+   item = 1;
+   ASSERT_TRUE(ring.TryPush(item));
+   ASSERT_TRUE(ring.TryPush(item));
+   std::thread consumer([&ring]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      int popped = 0;
+      ring.Pop(popped, -1);
+   });
+   EXPECT_TRUE(ring.Push(item, 5000));
+   consumer.join();
+}
+
+/**
+ * Every waiting consumer should be woken for the item meant for it, not only
+ * the one that happens to be asleep on the signal.
+ */
+TEST_F(MpmcRingTests, ManyWaitersWakeUp) {
+   const int kConsumers = 4;
+   MpmcRing<int> ring(16);
+   std::atomic<int> received(0);
+   std::vector<std::thread> consumers;
+   for (int i = 0; i < kConsumers; ++i) {
+      consumers.emplace_back([&ring, &received]() {
+         int item = 0;
+         if (ring.Pop(item, 5000)) {
+            received++;
+         }
+      });
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   for (int i = 0; i < kConsumers; ++i) {
+      int item = i;
+      ASSERT_TRUE(ring.Push(item, 100));
+   }
+   for (auto& consumer : consumers) {
+      consumer.join();
+   }
+   EXPECT_EQ(kConsumers, received);
+}
+
+TEST_F(MpmcRingTests, ManyProducersManyConsumers) {
+   const int kThreads = 4;
+   const uint64_t kItems = 100000;
+   MpmcRing<uint64_t> ring(64);
+   std::vector<std::thread> producers;
+   for (int producer = 0; producer < kThreads; ++producer) {
+      producers.emplace_back([&ring, producer, kItems]() {
+         for (uint64_t i = 0; i < kItems; ++i) {
+            uint64_t item = (static_cast<uint64_t> (producer) << 32) | i;
+            ring.Push(item, -1);
+         }
+      });
+   }
+   std::atomic<uint64_t> total(0);
+   std::vector<std::thread> consumers;
+   for (int consumer = 0; consumer < kThreads; ++consumer) {
+      consumers.emplace_back([&ring, &total, kItems, kThreads]() {
+         // each producer's items come out in order to any single consumer
+         std::vector<uint64_t> next(kThreads, 0);
+         uint64_t item = 0;
+         while (total.load() < kItems * kThreads) {
+            if (!ring.Pop(item, 10)) {
+               continue;
+            }
+            const uint64_t producer = item >> 32;
+            const uint64_t sequence = item & 0xffffffff;
+            EXPECT_LE(next[producer], sequence);
+            next[producer] = sequence + 1;
+            total++;
+         }
+      });
+   }
+   for (auto& producer : producers) {
+      producer.join();
+   }
+   for (auto& consumer : consumers) {
+      consumer.join();
+   }
+   EXPECT_EQ(kItems * kThreads, total);
+   EXPECT_TRUE(ring.Empty());
+}
+
+TEST_F(MpmcRingTests, ReadableFdAfterArming) {
+   MpmcRing<int> ring(8);
+   pollfd item = {ring.GetReadableFd(), POLLIN, 0};
+   EXPECT_FALSE(ring.ArmReadable());
+   EXPECT_EQ(0, poll(&item, 1, 0));
+   int value = 1;
+   EXPECT_TRUE(ring.TryPush(value));
+   EXPECT_TRUE(ring.TryPush(value));
+   EXPECT_EQ(1, poll(&item, 1, 0));
+   // draining does not clear the fd, arming does
+   while (ring.TryPop(value)) {
+   }
+   EXPECT_FALSE(ring.ArmReadable());
+   EXPECT_EQ(0, poll(&item, 1, 0));
+   EXPECT_TRUE(ring.TryPush(value));
+   EXPECT_TRUE(ring.ArmReadable());
+   EXPECT_EQ(0, poll(&item, 1, 0));
+}
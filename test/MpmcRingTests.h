@@ -0,0 +1,19 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "MpmcRing.h"
+
+class MpmcRingTests : public ::testing::Test {
+public:
+
+   MpmcRingTests() {
+   };
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+};
@@ -0,0 +1,106 @@
+#include "QueueStatsTests.h"
+#include <thread>
+#include <vector>
+
+TEST_F(QueueStatsTests, StartsEmpty) {
+   QueueStats stats;
+   QueueStatsSnapshot snapshot = stats.Snapshot();
+   EXPECT_EQ(0, snapshot.messages);
+   EXPECT_EQ(0, snapshot.bytes);
+   EXPECT_EQ(0, snapshot.pollTimeouts);
+   EXPECT_EQ(0, snapshot.highWaterStalls);
+   EXPECT_EQ(0, snapshot.errors);
+   EXPECT_EQ(0, snapshot.drops);
+   EXPECT_EQ(0, snapshot.spills);
+   EXPECT_EQ(0, snapshot.spinHits);
+   EXPECT_EQ(0, snapshot.spinMisses);
+   EXPECT_EQ(0, snapshot.SpinHitRate());
+   EXPECT_EQ(0, snapshot.Calls());
+}
+
+TEST_F(QueueStatsTests, Counters) {
+   QueueStats stats;
+   stats.Message(10);
+   stats.Message(20);
+   stats.PollTimeout();
+   stats.HighWaterStall();
+   stats.HighWaterStall();
+   stats.Error();
+   stats.Drop();
+   stats.Spill();
+   stats.Spill();
+   QueueStatsSnapshot snapshot = stats.Snapshot();
+   EXPECT_EQ(2, snapshot.messages);
+   EXPECT_EQ(30, snapshot.bytes);
+   EXPECT_EQ(1, snapshot.pollTimeouts);
+   EXPECT_EQ(2, snapshot.highWaterStalls);
+   EXPECT_EQ(1, snapshot.errors);
+   EXPECT_EQ(1, snapshot.drops);
+   EXPECT_EQ(2, snapshot.spills);
+   EXPECT_NE(std::string::npos, snapshot.ToString().find("messages: 2"));
+}
+
+TEST_F(QueueStatsTests, SpinHitRate) {
+   QueueStats stats;
+   stats.SpinHit();
+   stats.SpinHit();
+   stats.SpinHit();
+   stats.SpinMiss();
+   QueueStatsSnapshot snapshot = stats.Snapshot();
+   EXPECT_EQ(3, snapshot.spinHits);
+   EXPECT_EQ(1, snapshot.spinMisses);
+   EXPECT_DOUBLE_EQ(0.75, snapshot.SpinHitRate());
+   EXPECT_NE(std::string::npos, snapshot.ToString().find("spin hits: 3"));
+}
+
+TEST_F(QueueStatsTests, LatencyBuckets) {
+   QueueStats stats;
+   QueueStats::Clock::time_point now = QueueStats::Clock::now();
+   stats.Latency(now + std::chrono::hours(1));
+   stats.Latency(now - std::chrono::microseconds(1000));
+   stats.Latency(now - std::chrono::hours(24 * 365));
+   QueueStatsSnapshot snapshot = stats.Snapshot();
+   EXPECT_EQ(3, snapshot.Calls());
+   // a start in the future is under 1us
+   EXPECT_EQ(1, snapshot.latencyUs[0]);
+   // 1000us and a bit, [512, 1024) or [1024, 2048)
+   EXPECT_EQ(1, snapshot.latencyUs[10] + snapshot.latencyUs[11]);
+   // everything too large ends up in the last bucket
+   EXPECT_EQ(1, snapshot.latencyUs[QueueStatsSnapshot::kLatencyBuckets - 1]);
+   EXPECT_EQ(1, QueueStatsSnapshot::BucketCeilingUs(0));
+   EXPECT_EQ(1024, QueueStatsSnapshot::BucketCeilingUs(10));
+}
+
+TEST_F(QueueStatsTests, Timer) {
+   QueueStats stats;
+   {
+      QueueStats::Timer timer(stats);
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+   }
+   QueueStatsSnapshot snapshot = stats.Snapshot();
+   EXPECT_EQ(1, snapshot.Calls());
+   EXPECT_EQ(0, snapshot.latencyUs[0]);
+}
+
+TEST_F(QueueStatsTests, ManyWriters) {
+   QueueStats stats;
+   const int kThreads = 4;
+   const int kCount = 100000;
+   std::vector<std::thread> writers;
+   for (int i = 0; i < kThreads; ++i) {
+      writers.emplace_back([&stats]() {
+         for (int j = 0; j < kCount; ++j) {
+            stats.Message(1);
+         }
+      });
+   }
+   for (int i = 0; i < 10; ++i) {
+      stats.Snapshot();
+   }
+   for (auto& writer : writers) {
+      writer.join();
+   }
+   QueueStatsSnapshot snapshot = stats.Snapshot();
+   EXPECT_EQ(kThreads * kCount, snapshot.messages);
+   EXPECT_EQ(kThreads * kCount, snapshot.bytes);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "QueueStats.h"
+
+class QueueStatsTests : public ::testing::Test {
+public:
+
+   QueueStatsTests() {
+   };
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+};
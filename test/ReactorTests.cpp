@@ -0,0 +1,183 @@
+#include "ReactorTests.h"
+#include "Rifle.h"
+#include "Vampire.h"
+#include "Shotgun.h"
+#include "Alien.h"
+#include "Crowbar.h"
+#include "Headcrab.h"
+#include <unistd.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+   /**
+    * Wait for the reactor to hand over a number of messages.
+    */
+   bool WaitForDispatched(const Reactor& reactor, const uint64_t expected) {
+      for (int i = 0; i < 500 && reactor.GetDispatched() < expected && !zctx_interrupted; ++i) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      return reactor.GetDispatched() == expected;
+   }
+}
+
+std::string ReactorTests::GetIpcLocation(const int queue) {
+   int pid = getpid();
+   std::string ipcLocation("ipc:///tmp/");
+   ipcLocation.append("ReactorTests");
+   ipcLocation.append(std::to_string(pid));
+   ipcLocation.append("_");
+   ipcLocation.append(std::to_string(queue));
+   ipcLocation.append(".ipc");
+   return ipcLocation;
+}
+
+TEST_F(ReactorTests, StartAndStop) {
+   Reactor reactor(2, 10);
+   EXPECT_EQ(2, reactor.GetThreadCount());
+   EXPECT_FALSE(reactor.IsRunning());
+   ASSERT_TRUE(reactor.Start());
+   EXPECT_TRUE(reactor.IsRunning());
+   EXPECT_FALSE(reactor.Start());
+   reactor.Stop();
+   EXPECT_FALSE(reactor.IsRunning());
+   reactor.Stop();
+}
+
+TEST_F(ReactorTests, AddOnlyWhenStopped) {
+   std::string location = GetIpcLocation(0);
+   Reactor reactor;
+   Vampire unprepared(location);
+   EXPECT_FALSE(reactor.Add(unprepared, [](std::vector<std::string>&, const size_t) {
+   }));
+   Vampire inproc("inproc://ReactorTests");
+   inproc.SetInprocFastPath(true);
+   ASSERT_TRUE(inproc.PrepareToBeShot());
+   // the fast path has no socket to poll
+   EXPECT_FALSE(reactor.Add(inproc, [](std::vector<std::string>&, const size_t) {
+   }));
+   // a headcrab is not brought to life by registering it
+   Headcrab unborn(GetIpcLocation(3));
+   EXPECT_FALSE(reactor.Add(unborn, [](std::vector<std::string>&, std::vector<std::string>&) {
+   }));
+   EXPECT_EQ(nullptr, unborn.GetSocket());
+   EXPECT_EQ(nullptr, unborn.GetContext());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   ASSERT_TRUE(reactor.Start());
+   EXPECT_FALSE(reactor.Add(vampire, [](std::vector<std::string>&, const size_t) {
+   }));
+   reactor.Stop();
+   EXPECT_TRUE(reactor.Add(vampire, [](std::vector<std::string>&, const size_t) {
+   }));
+   EXPECT_EQ(1, reactor.GetQueueCount());
+}
+
+TEST_F(ReactorTests, ManyVampiresFewThreads) {
+   const int kQueues = 20;
+   const int kShots = 1000;
+   std::vector<std::unique_ptr<Vampire> > vampires;
+   std::vector<std::unique_ptr<Rifle> > rifles;
+   std::vector<int> received(kQueues, 0);
+   Reactor reactor(2, 64);
+   for (int queue = 0; queue < kQueues; ++queue) {
+      std::string location = GetIpcLocation(queue);
+      vampires.emplace_back(new Vampire(location));
+      ASSERT_TRUE(vampires.back()->PrepareToBeShot());
+      rifles.emplace_back(new Rifle(location));
+      ASSERT_TRUE(rifles.back()->Aim());
+      int* count = &received[queue];
+      std::string expected = std::to_string(queue);
+      ASSERT_TRUE(reactor.Add(*vampires.back(), [count, expected](std::vector<std::string>& wounds, const size_t size) {
+         for (size_t i = 0; i < size; ++i) {
+            EXPECT_EQ(expected, wounds[i]);
+         }
+         *count += size;
+      }));
+   }
+   EXPECT_EQ(kQueues, reactor.GetQueueCount());
+   ASSERT_TRUE(reactor.Start());
+   for (int shot = 0; shot < kShots; ++shot) {
+      for (int queue = 0; queue < kQueues; ++queue) {
+         ASSERT_TRUE(rifles[queue]->Fire(std::to_string(queue), 1000));
+      }
+   }
+   EXPECT_TRUE(WaitForDispatched(reactor, kQueues * kShots));
+   reactor.Stop();
+   for (int queue = 0; queue < kQueues; ++queue) {
+      EXPECT_EQ(kShots, received[queue]);
+   }
+}
+
+/**
+ * A batch frame holding more bullets than the reactor's batch should be
+ * handed over in full, without waiting for another message to wake the poll.
+ */
+TEST_F(ReactorTests, BatchLargerThanReactorBatch) {
+   const size_t kBatch = 4;
+   const int kShots = 50;
+   std::string location = GetIpcLocation(0);
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   rifle.SetBatching(64 * 1024, 1000000);
+   std::vector<std::string> received;
+   Reactor reactor(1, kBatch);
+   ASSERT_TRUE(reactor.Add(vampire, [&received, kBatch](std::vector<std::string>& wounds, const size_t size) {
+      EXPECT_GE(kBatch, size);
+      received.insert(received.end(), wounds.begin(), wounds.begin() + size);
+   }));
+   ASSERT_TRUE(reactor.Start());
+   for (int shot = 0; shot < kShots; ++shot) {
+      ASSERT_TRUE(rifle.FireBatched(std::to_string(shot), 1000));
+   }
+   // one frame, and nothing after it
+   ASSERT_TRUE(rifle.FlushBatch(1000));
+   EXPECT_TRUE(WaitForDispatched(reactor, kShots));
+   reactor.Stop();
+   ASSERT_EQ(kShots, received.size());
+   for (int shot = 0; shot < kShots; ++shot) {
+      EXPECT_EQ(std::to_string(shot), received[shot]);
+   }
+}
+
+TEST_F(ReactorTests, AlienAndHeadcrab) {
+   std::string shotgunLocation = GetIpcLocation(1);
+   std::string headcrabLocation = GetIpcLocation(2);
+   Shotgun shotgun;
+   shotgun.Aim(shotgunLocation);
+   Alien alien;
+   alien.PrepareToBeShot(shotgunLocation);
+   Headcrab headcrab(headcrabLocation);
+   ASSERT_TRUE(headcrab.ComeToLife());
+   Crowbar crowbar(headcrab);
+   ASSERT_TRUE(crowbar.Wield());
+
+   Reactor reactor;
+   std::atomic<int> published(0);
+   ASSERT_TRUE(reactor.Add(alien, [&published](std::vector<std::string>& bullets) {
+      EXPECT_EQ(2, bullets.size());
+      ++published;
+   }));
+   ASSERT_TRUE(reactor.Add(headcrab, [](std::vector<std::string>& hits, std::vector<std::string>& splatter) {
+      splatter.push_back("splat " + hits[0]);
+   }));
+   ASSERT_TRUE(reactor.Start());
+
+   // subscriptions take a moment to reach the shotgun
+   for (int i = 0; i < 100 && published.load() == 0; ++i) {
+      shotgun.Fire("probe");
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   ASSERT_LT(0, published.load());
+   for (int i = 0; i < 10; ++i) {
+      ASSERT_TRUE(crowbar.Swing(std::to_string(i)));
+      std::vector<std::string> guts;
+      ASSERT_TRUE(crowbar.WaitForKill(guts, 1000));
+      ASSERT_EQ(1, guts.size());
+      EXPECT_EQ("splat " + std::to_string(i), guts[0]);
+   }
+   reactor.Stop();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "Reactor.h"
+#include <czmq.h>
+
+class ReactorTests : public ::testing::Test {
+public:
+
+   ReactorTests() {
+   };
+   static std::string GetIpcLocation(const int queue);
+
+protected:
+
+   virtual void SetUp() {
+      zctx_interrupted = false;
+   };
+
+   virtual void TearDown() {
+      zctx_interrupted = false;
+   };
+};
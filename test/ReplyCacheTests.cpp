@@ -0,0 +1,112 @@
+#include "ReplyCacheTests.h"
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+TEST_F(ReplyCacheTests, PutTakeErase) {
+   ReplyCache cache(10, 1000);
+   std::string reply;
+   EXPECT_TRUE(cache.Empty());
+   EXPECT_FALSE(cache.Take(MakeKey(1), reply));
+   EXPECT_TRUE(cache.Put(MakeKey(1), "one"));
+   EXPECT_TRUE(cache.Put(MakeKey(2), ""));
+   EXPECT_TRUE(cache.Put(MakeKey(3), "three"));
+   EXPECT_EQ(3, cache.Size());
+   EXPECT_EQ(8, cache.Bytes());
+   EXPECT_TRUE(cache.Contains(MakeKey(2)));
+   // replacing keeps one entry
+   EXPECT_TRUE(cache.Put(MakeKey(1), "uno"));
+   EXPECT_EQ(3, cache.Size());
+   ASSERT_TRUE(cache.Take(MakeKey(1), reply));
+   EXPECT_EQ("uno", reply);
+   EXPECT_FALSE(cache.Contains(MakeKey(1)));
+   ASSERT_TRUE(cache.Take(MakeKey(2), reply));
+   EXPECT_EQ("", reply);
+   EXPECT_TRUE(cache.Erase(MakeKey(3)));
+   EXPECT_FALSE(cache.Erase(MakeKey(3)));
+   EXPECT_TRUE(cache.Empty());
+   EXPECT_EQ(0, cache.Bytes());
+   EXPECT_EQ(0, cache.GetEvictedEntries());
+}
+
+TEST_F(ReplyCacheTests, EvictsOldestFirst) {
+   ReplyCache cache(3, 10);
+   std::string reply;
+   EXPECT_TRUE(cache.Put(MakeKey(1), "aa"));
+   EXPECT_TRUE(cache.Put(MakeKey(2), "bb"));
+   EXPECT_TRUE(cache.Put(MakeKey(3), "cc"));
+   // over the entries
+   EXPECT_TRUE(cache.Put(MakeKey(4), "dd"));
+   EXPECT_FALSE(cache.Contains(MakeKey(1)));
+   EXPECT_EQ(1, cache.GetEvictedEntries());
+   EXPECT_EQ(2, cache.GetEvictedBytes());
+   // over the bytes, 2 and 3 make room
+   EXPECT_TRUE(cache.Put(MakeKey(5), "eeeeeee"));
+   EXPECT_FALSE(cache.Contains(MakeKey(2)));
+   EXPECT_FALSE(cache.Contains(MakeKey(3)));
+   EXPECT_EQ(3, cache.GetEvictedEntries());
+   EXPECT_EQ(9, cache.Bytes());
+   // too big on its own
+   EXPECT_FALSE(cache.Put(MakeKey(6), std::string(11, 'f')));
+   EXPECT_EQ(4, cache.GetEvictedEntries());
+   EXPECT_EQ(17, cache.GetEvictedBytes());
+   ASSERT_TRUE(cache.Take(MakeKey(4), reply));
+   EXPECT_EQ("dd", reply);
+   ASSERT_TRUE(cache.Take(MakeKey(5), reply));
+   EXPECT_EQ("eeeeeee", reply);
+   // tighter limits evict right away
+   EXPECT_TRUE(cache.Put(MakeKey(7), "g"));
+   EXPECT_TRUE(cache.Put(MakeKey(8), "h"));
+   cache.SetLimits(1, 10);
+   EXPECT_FALSE(cache.Contains(MakeKey(7)));
+   EXPECT_TRUE(cache.Contains(MakeKey(8)));
+   EXPECT_EQ(1, cache.GetMaxEntries());
+   EXPECT_EQ(10, cache.GetMaxBytes());
+}
+
+TEST_F(ReplyCacheTests, MatchesStdMapThroughCompactions) {
+   ReplyCache cache(500, 200 * 1024);
+   std::map<uint64_t, std::string> expected;
+   std::vector<uint64_t> order;
+   std::mt19937 random(42);
+   std::string reply;
+   for (uint64_t number = 0; number < 20000; ++number) {
+      const std::string value(random() % 2000, static_cast<char> ('a' + number % 26));
+      cache.Put(MakeKey(number), value);
+      expected[number] = value;
+      order.push_back(number);
+      // the same eviction by hand, oldest first
+      size_t bytes = 0;
+      for (const auto& kept : expected) {
+         bytes += kept.second.size();
+      }
+      size_t oldest = 0;
+      while (expected.size() > 500 || bytes > 200 * 1024) {
+         auto evicted = expected.find(order[oldest++]);
+         if (evicted != expected.end()) {
+            bytes -= evicted->second.size();
+            expected.erase(evicted);
+         }
+      }
+      order.erase(order.begin(), order.begin() + oldest);
+      if (random() % 3 != 0) {
+         const uint64_t taken = order[random() % order.size()];
+         auto found = expected.find(taken);
+         if (found != expected.end()) {
+            ASSERT_TRUE(cache.Take(MakeKey(taken), reply));
+            ASSERT_EQ(found->second, reply);
+            expected.erase(found);
+         } else {
+            ASSERT_FALSE(cache.Take(MakeKey(taken), reply));
+         }
+      }
+      ASSERT_EQ(expected.size(), cache.Size());
+   }
+   for (const auto& kept : expected) {
+      ASSERT_TRUE(cache.Take(MakeKey(kept.first), reply));
+      EXPECT_EQ(kept.second, reply);
+   }
+   EXPECT_TRUE(cache.Empty());
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "ReplyCache.h"
+#include "UuidKeyHelper.h"
+
+class ReplyCacheTests : public ::testing::Test {
+public:
+
+   ReplyCacheTests() {
+   };
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+};
@@ -13,6 +13,9 @@
 #include <future>
 #include <QueueNadoMacros.h>
 #include <limits>
+#include "ContextRegistry.h"
+#include <unistd.h>
+#include <sys/epoll.h>
 
 namespace {
    const int kNoWaitTimeMs = 0;
@@ -27,6 +30,48 @@ void TestDeleteString(void*, void* data) {
    delete theString;
 }
 
+/**
+ * A fixed layout record, as pushed by FireStructs.
+ */
+struct FlowRecord {
+   uint64_t session;
+   uint32_t packets;
+   uint16_t port;
+   uint8_t flags[6];
+};
+
+/**
+ * Counts when the buffer that ZeroMQ was given is released, moved from
+ * copies are not counted.
+ */
+class CountedBullet {
+ public:
+
+   explicit CountedBullet(const std::string& data) : mData(data), mLive(true) {
+   }
+
+   CountedBullet(CountedBullet&& other) : mData(std::move(other.mData)), mLive(other.mLive) {
+      other.mLive = false;
+   }
+
+   ~CountedBullet() {
+      if (mLive) {
+         RifleVampireTests::mShotsDeleted++;
+      }
+   }
+
+   char& operator[](size_t index) {
+      return mData[index];
+   }
+
+   size_t size() const {
+      return mData.size();
+   }
+ private:
+   std::string mData;
+   bool mLive;
+};
+
 /**
  * Used to call shutdown just for test.
  * @param location
@@ -75,6 +120,12 @@ std::string RifleVampireTests::GetIpcLocation() {
    return ipcLocation;
 }
 
+std::string RifleVampireTests::GetInprocLocation() {
+   std::string inprocLocation("inproc://RifleVampireTests");
+   inprocLocation.append(std::to_string(rand()));
+   return inprocLocation;
+}
+
 
 void RifleVampireTests::RifleThread(int numberOfMessages,
                                     std::string& location, std::string& exampleData, int hwm,
@@ -617,6 +668,317 @@ void RifleVampireTests::NRiflesOneVampireBenchmark(int nRifles, int nIOThreads,
    EXPECT_TRUE(TimedSectionPassed());
 }
 
+/**
+ * Compare one poll per message (Fire) against one poll per burst (FireBurst)
+ * with a single Vampire draining the queue.
+ */
+void RifleVampireTests::FireVersusFireBurstBenchmark(int dataSize, int nShots, int burstSize,
+      int hwm, int waitTimeMs) {
+   using namespace std::chrono;
+   std::string location = GetIpcLocation();
+   std::string exampleData(dataSize, 'b');
+   Rifle rifle(location);
+   rifle.SetHighWater(hwm);
+   rifle.SetOwnSocket(true);
+   ASSERT_TRUE(rifle.Aim());
+
+   boost::thread fireVampire(&RifleVampireTests::VampireThread, this, nShots, location,
+         exampleData, hwm, 1, false, waitTimeMs);
+   steady_clock::time_point start = steady_clock::now();
+   for (int i = 0; i < nShots && !zctx_interrupted; i++) {
+      ASSERT_TRUE(rifle.Fire(exampleData, waitTimeMs));
+   }
+   auto fireUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+   fireVampire.interrupt();
+   fireVampire.join();
+
+   boost::thread burstVampire(&RifleVampireTests::VampireThread, this, nShots, location,
+         exampleData, hwm, 1, false, waitTimeMs);
+   const std::vector<std::string> fullBurst(burstSize, exampleData);
+   start = steady_clock::now();
+   int fired = 0;
+   while (fired < nShots && !zctx_interrupted) {
+      std::vector<std::string> remainder;
+      const std::vector<std::string>* burst = &fullBurst;
+      if (nShots - fired < burstSize) {
+         remainder.assign(nShots - fired, exampleData);
+         burst = &remainder;
+      }
+      size_t sent = rifle.FireBurst(*burst, waitTimeMs);
+      ASSERT_LT(0u, sent);
+      fired += sent;
+   }
+   auto burstUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+   burstVampire.interrupt();
+   burstVampire.join();
+
+   std::cout << "Fire      : " << nShots << " shots of " << dataSize << " bytes in "
+           << fireUs << "us, " << (nShots * 1000000.0) / std::max(fireUs, 1L) << " msgs/s" << std::endl;
+   std::cout << "FireBurst : " << nShots << " shots of " << dataSize << " bytes (burst "
+           << burstSize << ") in " << burstUs << "us, "
+           << (nShots * 1000000.0) / std::max(burstUs, 1L) << " msgs/s" << std::endl;
+}
+
+/**
+ * Time nShots from a Rifle to a Vampire on an inproc location, either
+ * through the in process queue or through ZeroMQ on a shared context.
+ * @return the time taken in microseconds
+ */
+long RifleVampireTests::InprocBenchmark(bool fastPath, int dataSize, int nShots, int hwm, int waitTimeMs) {
+   using namespace std::chrono;
+   std::string location = GetInprocLocation();
+   const std::string exampleData(dataSize, 'i');
+   Vampire vampire(location);
+   vampire.SetHighWater(hwm);
+   vampire.SetOwnSocket(true);
+   vampire.SetInprocFastPath(fastPath);
+   vampire.SetSharedContext("InprocBenchmark");
+   EXPECT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetHighWater(hwm);
+   rifle.SetOwnSocket(false);
+   rifle.SetInprocFastPath(fastPath);
+   rifle.SetSharedContext("InprocBenchmark");
+   EXPECT_TRUE(rifle.Aim());
+
+   steady_clock::time_point start = steady_clock::now();
+   auto received = std::async(std::launch::async, [&]() {
+      int count = 0;
+      std::string bullet;
+      while (count < nShots && !zctx_interrupted) {
+         if (vampire.GetShot(bullet, waitTimeMs)) {
+            ++count;
+         }
+      }
+      return count;
+   });
+   for (int i = 0; i < nShots && !zctx_interrupted; i++) {
+      EXPECT_TRUE(rifle.Fire(exampleData, waitTimeMs));
+   }
+   EXPECT_EQ(nShots, received.get());
+   long elapsedUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+   std::cout << (fastPath ? "inproc queue : " : "inproc zmq   : ") << nShots << " shots of "
+           << dataSize << " bytes in " << elapsedUs << "us, "
+           << (nShots * 1000000.0) / std::max(elapsedUs, 1L) << " msgs/s" << std::endl;
+   return elapsedUs;
+}
+
+/**
+ * Text that compresses about as well as our syslog payloads.
+ */
+std::string RifleVampireTests::MakeLogLines(size_t size) {
+   static const char* kPrograms[] = {"sshd", "kernel", "crond", "sudo", "postfix/smtpd"};
+   std::string lines;
+   for (int line = 0; lines.size() < size; ++line) {
+      lines += "<" + std::to_string(rand() % 192) + ">Oct 16 12:" + std::to_string(10 + rand() % 50)
+              + ":" + std::to_string(10 + rand() % 50) + " host" + std::to_string(rand() % 16) + " "
+              + kPrograms[rand() % 5] + "[" + std::to_string(rand() % 65536)
+              + "]: session opened for user u" + std::to_string(rand() % 1000)
+              + " from 10.0." + std::to_string(rand() % 256) + "." + std::to_string(rand() % 256) + "\n";
+   }
+   lines.resize(size);
+   return lines;
+}
+
+void RifleVampireTests::CompressionBenchmark(int level, int dataSize, int nShots, int hwm, int waitTimeMs) {
+   using namespace std::chrono;
+   std::string location = GetTcpLocation();
+   std::vector<std::string> payloads;
+   for (int i = 0; i < 16; ++i) {
+      payloads.push_back(MakeLogLines(dataSize));
+   }
+   Vampire vampire(location);
+   vampire.SetHighWater(hwm);
+   vampire.SetOwnSocket(true);
+   EXPECT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetHighWater(hwm);
+   rifle.SetOwnSocket(false);
+   rifle.SetCompression(level, 0);
+   EXPECT_TRUE(rifle.Aim());
+
+   size_t compressedBytes = 0;
+   std::string compressed;
+   for (const auto& payload : payloads) {
+      if (level == 0) {
+         compressedBytes += payload.size();
+      } else if (CZMQToolkit::Compress(payload.data(), payload.size(), level, compressed)) {
+         compressedBytes += compressed.size();
+      }
+   }
+   steady_clock::time_point start = steady_clock::now();
+   auto received = std::async(std::launch::async, [&]() {
+      int count = 0;
+      std::string bullet;
+      while (count < nShots && vampire.GetShot(bullet, waitTimeMs)) {
+         EXPECT_EQ(payloads[count % payloads.size()].size(), bullet.size());
+         ++count;
+      }
+      return count;
+   });
+   for (int i = 0; i < nShots && !zctx_interrupted; i++) {
+      EXPECT_TRUE(rifle.Fire(payloads[i % payloads.size()], waitTimeMs));
+   }
+   EXPECT_EQ(nShots, received.get());
+   long elapsedUs = std::max(1L, static_cast<long> (duration_cast<microseconds>(steady_clock::now() - start).count()));
+   std::cout << "compression level " << level << ": " << nShots << " shots of " << dataSize << " bytes in "
+           << elapsedUs << "us, " << (nShots * 1000000.0) / elapsedUs << " msgs/s, "
+           << (nShots * static_cast<double> (dataSize)) / elapsedUs << " MB/s, ratio "
+           << static_cast<double> (compressedBytes) / (payloads.size() * dataSize) << std::endl;
+}
+
+/**
+ * Time nShots small bullets from a Rifle to a Vampire, fired one by one
+ * when batchBytes is 0 and in micro-batches of up to batchBytes otherwise.
+ * @return the time taken in microseconds, until the last bullet is read
+ */
+long RifleVampireTests::BatchingBenchmark(size_t batchBytes, int dataSize, int nShots, int hwm, int waitTimeMs) {
+   using namespace std::chrono;
+   std::string location = GetTcpLocation();
+   const std::string exampleData(dataSize, 'b');
+   Vampire vampire(location);
+   vampire.SetHighWater(hwm);
+   vampire.SetOwnSocket(true);
+   EXPECT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetHighWater(hwm);
+   rifle.SetOwnSocket(false);
+   rifle.SetBatching(batchBytes);
+   EXPECT_TRUE(rifle.Aim());
+
+   steady_clock::time_point start = steady_clock::now();
+   auto received = std::async(std::launch::async, [&]() {
+      int count = 0;
+      ShotBatch batch;
+      while (count < nShots && vampire.GetBatch(batch, waitTimeMs)) {
+         for (const auto& shot : batch) {
+            EXPECT_EQ(static_cast<size_t> (dataSize), shot.size);
+            ++count;
+         }
+      }
+      return count;
+   });
+   for (int i = 0; i < nShots && !zctx_interrupted; i++) {
+      EXPECT_TRUE(rifle.FireBatched(exampleData, waitTimeMs));
+   }
+   EXPECT_TRUE(rifle.FlushBatch(waitTimeMs));
+   EXPECT_EQ(nShots, received.get());
+   long elapsedUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+   std::cout << (batchBytes == 0 ? "Fire        : " : "FireBatched : ") << nShots << " shots of "
+           << dataSize << " bytes";
+   if (batchBytes != 0) {
+      std::cout << " (batch " << batchBytes << " bytes)";
+   }
+   std::cout << " in " << elapsedUs << "us, " << (nShots * 1000000.0) / std::max(elapsedUs, 1L)
+           << " msgs/s" << std::endl;
+   return elapsedUs;
+}
+
+/**
+ * Fire a burst of nShots at a Vampire that reads with a small high water
+ * mark, with the producer either waiting on the pipe or spilling.
+ */
+void RifleVampireTests::SpillBenchmark(bool spill, int dataSize, int nShots, int hwm, int waitTimeMs) {
+   using namespace std::chrono;
+   std::string location = GetTcpLocation();
+   const std::string directory = "/tmp/RifleVampireTests.SpillBenchmark." + std::to_string(getpid());
+   const std::string exampleData(dataSize, 's');
+   Vampire vampire(location);
+   vampire.SetHighWater(hwm);
+   vampire.SetOwnSocket(true);
+   EXPECT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetHighWater(hwm);
+   rifle.SetOwnSocket(false);
+   EXPECT_TRUE(rifle.Aim());
+   if (spill) {
+      EXPECT_TRUE(rifle.StartSpill(directory));
+   }
+
+   steady_clock::time_point start = steady_clock::now();
+   auto received = std::async(std::launch::async, [&]() {
+      int count = 0;
+      std::vector<std::string> wounds;
+      while (count < nShots && !zctx_interrupted) {
+         size_t shots = vampire.GetShots(wounds, 128, waitTimeMs);
+         if (shots == 0) {
+            break;
+         }
+         count += shots;
+      }
+      return count;
+   });
+   for (int i = 0; i < nShots && !zctx_interrupted; i++) {
+      EXPECT_TRUE(rifle.Fire(exampleData, spill ? 0 : waitTimeMs));
+   }
+   auto producerUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+   EXPECT_EQ(nShots, received.get());
+   auto totalUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+   std::cout << (spill ? "Fire with spill : " : "Fire            : ") << nShots << " shots of "
+           << dataSize << " bytes, producer done in " << producerUs << "us ("
+           << (nShots * 1000000.0) / std::max(producerUs, 1L) << " msgs/s), all received in "
+           << totalUs << "us, spilled " << rifle.GetStats().spills << std::endl;
+   rifle.StopSpill();
+   rmdir(directory.c_str());
+}
+
+/**
+ * Receive shots numbered from 0 through an edge triggered epoll on the
+ * Vampire's fd, draining until IsReadable is false before each wait.
+ * @return the number received in order, stops after a second of silence
+ */
+int RifleVampireTests::EpollShots(Vampire& vampire, int nShots) {
+   int epollFd = epoll_create1(0);
+   epoll_event event = {};
+   event.events = EPOLLIN | EPOLLET;
+   EXPECT_EQ(0, epoll_ctl(epollFd, EPOLL_CTL_ADD, vampire.GetFd(), &event));
+   int count = 0;
+   int idleWaits = 0;
+   std::vector<std::string> wounds;
+   while (count < nShots && idleWaits < 10 && !zctx_interrupted) {
+      while (vampire.IsReadable()) {
+         size_t shots = vampire.GetShots(wounds, 128, 0);
+         for (size_t i = 0; i < shots; ++i) {
+            EXPECT_EQ(std::to_string(count), wounds[i]);
+            ++count;
+         }
+      }
+      if (count < nShots) {
+         epoll_event ready;
+         idleWaits = (epoll_wait(epollFd, &ready, 1, 100) > 0) ? 0 : idleWaits + 1;
+      }
+   }
+   close(epollFd);
+   return count;
+}
+
+void RifleVampireTests::EpollRoundTrip(const std::string& location, int nShots, bool inprocFastPath) {
+   Vampire vampire(location);
+   vampire.SetInprocFastPath(inprocFastPath);
+   EXPECT_EQ(-1, vampire.GetFd());
+   EXPECT_FALSE(vampire.IsReadable());
+   vampire.SetOwnSocket(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   ASSERT_LE(0, vampire.GetFd());
+   Rifle rifle(location);
+   rifle.SetOwnSocket(false);
+   rifle.SetInprocFastPath(inprocFastPath);
+   ASSERT_TRUE(rifle.Aim());
+   EXPECT_FALSE(vampire.IsReadable());
+   auto fired = std::async(std::launch::async, [&rifle, nShots]() {
+      for (int i = 0; i < nShots && !zctx_interrupted; ++i) {
+         EXPECT_TRUE(rifle.Fire(std::to_string(i), kWaitTimeMs));
+         // let the Vampire run dry and go back to epoll now and then
+         if (i % 1000 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+         }
+      }
+   });
+   EXPECT_EQ(nShots, EpollShots(vampire, nShots));
+   fired.get();
+   EXPECT_FALSE(vampire.IsReadable());
+}
+
 TEST_F(RifleVampireTests, ipcFilesCleanedOnNormalExitRifleOwner) {
    std::string target("ipc:///rifleVampireExit");
    std::string addressRealPath(target, target.find("ipc://") + 6);
@@ -2110,6 +2472,1209 @@ TEST_F(RifleVampireTests, StakesVampireMoreThenHeCanHandle) {
    EXPECT_EQ(failed, rFailed);
 }
 
+TEST_F(RifleVampireTests, FireBurstInTheDark) {
+   Rifle rifle(GetIpcLocation());
+   rifle.Aim();
+   std::vector<std::string> bullets(10, "Fire!");
+   //should fail without someone to shoot.
+   EXPECT_EQ(0, rifle.FireBurst(bullets, 1));
+}
+
+TEST_F(RifleVampireTests, FireBurstEmpty) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::vector<std::string> bullets;
+   EXPECT_EQ(0, rifle.FireBurst(bullets, 100));
+   std::string bullet;
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+}
+
+TEST_F(RifleVampireTests, FireBurstSkipsBlank) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::vector<std::string> bullets{"one", "two", "", "four", ""};
+   EXPECT_EQ(bullets.size(), rifle.FireBurst(bullets, 100));
+   EXPECT_EQ(2, rifle.GetStats().errors);
+   std::string bullet;
+   EXPECT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("one", bullet);
+   EXPECT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("two", bullet);
+   EXPECT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("four", bullet);
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+}
+
+TEST_F(RifleVampireTests, FireBurstSkipsBlankInproc) {
+   std::string location = GetInprocLocation();
+   Vampire vampire(location);
+   vampire.SetInprocFastPath(true);
+   vampire.PrepareToBeShot();
+   Rifle rifle(location);
+   rifle.SetInprocFastPath(true);
+   rifle.Aim();
+   std::vector<std::string> bullets{"", "one", "", "two"};
+   EXPECT_EQ(bullets.size(), rifle.FireBurst(bullets, 100));
+   std::string bullet;
+   EXPECT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("one", bullet);
+   EXPECT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("two", bullet);
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+}
+
+TEST_F(RifleVampireTests, FireBurstInOrder) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::vector<std::string> bullets;
+   for (int i = 0; i < 50; i++) {
+      bullets.push_back(std::to_string(i));
+   }
+   ASSERT_EQ(bullets.size(), rifle.FireBurst(bullets, 100));
+   std::string bullet;
+   for (const auto& expected : bullets) {
+      EXPECT_TRUE(vampire.GetShot(bullet, 100));
+      EXPECT_EQ(expected, bullet);
+   }
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+}
+
+/**
+ * A burst larger than the pipe should send as many as possible and let the
+ * caller know how many went out.
+ */
+TEST_F(RifleVampireTests, FireBurstMoreThenHeCanHandle) {
+   std::string location = GetIpcLocation();
+   int hwm = 100;
+   int shots = (hwm * 10);
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.SetHighWater(hwm);
+   vampire.SetHighWater(hwm);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::vector<std::string> bullets(shots, "woo");
+   size_t success = rifle.FireBurst(bullets, 100);
+   EXPECT_LT(0u, success);
+   std::string bullet;
+   size_t rSuccess = 0;
+   while (vampire.GetShot(bullet, 10)) {
+      rSuccess++;
+   }
+   std::cout << "Unable to shoot " << (bullets.size() - success) << " bullet(s)" << std::endl;
+   EXPECT_EQ(success, rSuccess);
+}
+
+TEST_F(RifleVampireTests, FireVersusFireBurstSmallSize) {
+   int dataSize = 100;
+   int nShots = 100000;
+   int burstSize = 100;
+   int hwm = 10000;
+   FireVersusFireBurstBenchmark(dataSize, nShots, burstSize, hwm, kWaitTimeMs);
+}
+
+TEST_F(RifleVampireTests, InprocFastPathVersusZeroMQSmallSize) {
+   int dataSize = 100;
+   int nShots = 100000;
+   int hwm = 10000;
+   InprocBenchmark(false, dataSize, nShots, hwm, kWaitTimeMs);
+   InprocBenchmark(true, dataSize, nShots, hwm, kWaitTimeMs);
+}
+
+TEST_F(RifleVampireTests, InprocFastPathVersusZeroMQLargeSize) {
+   int dataSize = 64 * 1024;
+   int nShots = 10000;
+   int hwm = 1000;
+   InprocBenchmark(false, dataSize, nShots, hwm, kWaitTimeMs);
+   InprocBenchmark(true, dataSize, nShots, hwm, kWaitTimeMs);
+}
+
+TEST_F(RifleVampireTests, InprocFastPath) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   rifle.SetInprocFastPath(true);
+   ASSERT_TRUE(rifle.Aim());
+   // nobody to shoot yet
+   EXPECT_FALSE(rifle.Fire("dark", 1));
+   Vampire vampire(location);
+   EXPECT_FALSE(vampire.GetInprocFastPath());
+   vampire.SetInprocFastPath(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   EXPECT_TRUE(vampire.GetInprocFastPath());
+
+   ASSERT_TRUE(rifle.Fire("first", 100));
+   ASSERT_TRUE(rifle.Fire(std::string("second"), 100));
+   std::string bullet;
+   ASSERT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("first", bullet);
+   ZeroCopyMessage wound;
+   ASSERT_TRUE(vampire.GetShot(wound, 100));
+   EXPECT_EQ("second", wound.ToString());
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+   EXPECT_FALSE(rifle.Fire("", 1));
+
+   std::vector<std::string> bullets = {"a", "b", "c"};
+   ASSERT_EQ(bullets.size(), rifle.FireBurst(bullets, 100));
+   std::vector<std::string> wounds;
+   ASSERT_EQ(bullets.size(), vampire.GetShots(wounds, 10, 100));
+   EXPECT_EQ("c", wounds[2]);
+
+   int value = 42;
+   ASSERT_TRUE(rifle.FireStake(&value, 100));
+   void* stake = nullptr;
+   ASSERT_TRUE(vampire.GetStake(stake, 100));
+   EXPECT_EQ(&value, stake);
+
+   std::vector<std::pair<void*, unsigned int> > stakes = {{&value, 1}, {&stake, 2}};
+   ASSERT_TRUE(rifle.FireStakes(stakes, 100));
+   std::vector<std::pair<void*, unsigned int> > gotStakes;
+   ASSERT_TRUE(vampire.GetStakes(gotStakes, 100));
+   EXPECT_EQ(stakes, gotStakes);
+
+   std::vector<FlowRecord> records(3);
+   records[2].session = 7;
+   ASSERT_TRUE(rifle.FireStructs(records, 100));
+   std::vector<FlowRecord> gotRecords;
+   ASSERT_TRUE(vampire.GetStructs(gotRecords, 100));
+   ASSERT_EQ(3, gotRecords.size());
+   EXPECT_EQ(7, gotRecords[2].session);
+
+   mShotsDeleted.store(0);
+   std::string* zero = new std::string("zero");
+   ASSERT_TRUE(rifle.FireZeroCopy(zero, zero->size(), TestDeleteString, 100));
+   EXPECT_EQ(1, mShotsDeleted);
+   ASSERT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("zero", bullet);
+}
+
+TEST_F(RifleVampireTests, InprocFastPathHighWater) {
+   std::string location = GetInprocLocation();
+   Vampire vampire(location);
+   vampire.SetInprocFastPath(true);
+   vampire.SetHighWater(10);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetInprocFastPath(true);
+   ASSERT_TRUE(rifle.Aim());
+   int fired = 0;
+   while (rifle.Fire("full", 1) && fired < 100) {
+      ++fired;
+   }
+   EXPECT_EQ(10, fired);
+   std::vector<std::string> wounds;
+   EXPECT_EQ(10, vampire.GetShots(wounds, 100, 100));
+   EXPECT_TRUE(rifle.Fire("room", 1));
+}
+
+TEST_F(RifleVampireTests, InprocFastPathManyVampires) {
+   std::string location = GetInprocLocation();
+   Rifle rifle(location);
+   rifle.SetInprocFastPath(true);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire first(location);
+   Vampire second(location);
+   first.SetInprocFastPath(true);
+   second.SetInprocFastPath(true);
+   ASSERT_TRUE(first.PrepareToBeShot());
+   ASSERT_TRUE(second.PrepareToBeShot());
+   ASSERT_TRUE(rifle.Fire("one", 100));
+   ASSERT_TRUE(rifle.Fire("two", 100));
+   std::string bullet;
+   EXPECT_TRUE(first.GetShot(bullet, 100));
+   EXPECT_TRUE(second.GetShot(bullet, 100));
+   EXPECT_FALSE(first.GetShot(bullet, 1));
+   EXPECT_FALSE(second.GetShot(bullet, 1));
+}
+
+TEST_F(RifleVampireTests, StatsCountWhyFireFailed) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetHighWater(1);
+   ASSERT_TRUE(rifle.Aim());
+   // nobody to shoot
+   EXPECT_FALSE(rifle.Fire("dark", 1));
+   QueueStatsSnapshot stats = rifle.GetStats();
+   EXPECT_EQ(0, stats.messages);
+   EXPECT_EQ(1, stats.pollTimeouts);
+   EXPECT_EQ(1, stats.Calls());
+
+   Vampire vampire(location);
+   vampire.SetHighWater(1);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   ASSERT_TRUE(rifle.Fire("light", 1000));
+   std::string bullet;
+   ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+   stats = rifle.GetStats();
+   EXPECT_EQ(1, stats.messages);
+   EXPECT_EQ(5, stats.bytes);
+   EXPECT_EQ(0, stats.errors);
+   EXPECT_EQ(2, stats.Calls());
+
+   QueueStatsSnapshot vampireStats = vampire.GetStats();
+   EXPECT_EQ(1, vampireStats.messages);
+   EXPECT_EQ(5, vampireStats.bytes);
+   EXPECT_EQ(1, vampireStats.pollTimeouts);
+   EXPECT_EQ(2, vampireStats.Calls());
+
+   // a burst into a pipe that is too small stalls on the high water mark
+   std::vector<std::string> bullets(10000, std::string(1000, 's'));
+   size_t fired = rifle.FireBurst(bullets, 1000);
+   ASSERT_LT(fired, bullets.size());
+   stats = rifle.GetStats();
+   EXPECT_EQ(1 + fired, stats.messages);
+   EXPECT_EQ(1, stats.highWaterStalls);
+}
+
+TEST_F(RifleVampireTests, StatsInprocFastPath) {
+   std::string location = GetInprocLocation();
+   Vampire vampire(location);
+   vampire.SetInprocFastPath(true);
+   vampire.SetHighWater(2);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetInprocFastPath(true);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(rifle.Fire("one", 100));
+   ASSERT_TRUE(rifle.FireStake(&rifle, 100));
+   EXPECT_FALSE(rifle.Fire("full", 0));
+   EXPECT_FALSE(rifle.Fire("full", 1));
+   QueueStatsSnapshot stats = rifle.GetStats();
+   EXPECT_EQ(2, stats.messages);
+   EXPECT_EQ(3 + sizeof (void*), stats.bytes);
+   EXPECT_EQ(1, stats.highWaterStalls);
+   EXPECT_EQ(1, stats.pollTimeouts);
+
+   std::vector<std::string> wounds;
+   EXPECT_EQ(2, vampire.GetShots(wounds, 10, 100));
+   EXPECT_EQ(0, vampire.GetShots(wounds, 10, 1));
+   QueueStatsSnapshot vampireStats = vampire.GetStats();
+   EXPECT_EQ(2, vampireStats.messages);
+   EXPECT_EQ(1, vampireStats.pollTimeouts);
+}
+
+TEST_F(RifleVampireTests, FireAsyncNotStarted) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   EXPECT_FALSE(rifle.FireAsync("not started"));
+   EXPECT_FALSE(rifle.StartAsync(10));
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(rifle.StartAsync(10));
+   EXPECT_FALSE(rifle.StartAsync(10));
+   EXPECT_FALSE(rifle.FireAsync(""));
+   rifle.StopAsync();
+   EXPECT_FALSE(rifle.FireAsync("stopped"));
+}
+
+TEST_F(RifleVampireTests, FireAsyncDelivers) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   ASSERT_TRUE(rifle.StartAsync(100, Rifle::Overflow::BLOCK, 100));
+   const int kShots = 10000;
+   auto received = std::async(std::launch::async, [&]() {
+      int count = 0;
+      std::string bullet;
+      while (count < kShots && vampire.GetShot(bullet, 1000)) {
+         EXPECT_EQ(std::to_string(count), bullet);
+         ++count;
+      }
+      return count;
+   });
+   for (int i = 0; i < kShots; ++i) {
+      ASSERT_TRUE(rifle.FireAsync(std::to_string(i)));
+   }
+   EXPECT_EQ(kShots, received.get());
+   rifle.StopAsync();
+   EXPECT_EQ(0, rifle.GetAsyncQueued());
+   QueueStatsSnapshot stats = rifle.GetStats();
+   EXPECT_EQ(kShots, stats.messages);
+   EXPECT_EQ(0, stats.drops);
+}
+
+TEST_F(RifleVampireTests, FireAsyncDropNewest) {
+   Rifle rifle(GetIpcLocation());
+   ASSERT_TRUE(rifle.Aim());
+   // nobody to shoot, so everything piles up
+   ASSERT_TRUE(rifle.StartAsync(10, Rifle::Overflow::DROP_NEWEST, 10));
+   const int kShots = 1000;
+   int refused = 0;
+   for (int i = 0; i < kShots; ++i) {
+      if (!rifle.FireAsync("newest")) {
+         ++refused;
+      }
+   }
+   EXPECT_LT(0, refused);
+   EXPECT_EQ(refused, rifle.GetStats().drops);
+   rifle.StopAsync();
+   QueueStatsSnapshot stats = rifle.GetStats();
+   EXPECT_EQ(0, stats.messages);
+   EXPECT_EQ(kShots, stats.drops);
+}
+
+TEST_F(RifleVampireTests, FireAsyncDropOldest) {
+   Rifle rifle(GetIpcLocation());
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(rifle.StartAsync(10, Rifle::Overflow::DROP_OLDEST, 10));
+   const int kShots = 1000;
+   for (int i = 0; i < kShots; ++i) {
+      EXPECT_TRUE(rifle.FireAsync("oldest"));
+   }
+   EXPECT_GE(10, rifle.GetAsyncQueued());
+   EXPECT_LT(0, rifle.GetStats().drops);
+   rifle.StopAsync();
+   QueueStatsSnapshot stats = rifle.GetStats();
+   EXPECT_EQ(0, stats.messages);
+   EXPECT_EQ(kShots, stats.drops);
+}
+
+TEST_F(RifleVampireTests, FireAsyncManyThreads) {
+   std::string location = GetInprocLocation();
+   Vampire vampire(location);
+   vampire.SetInprocFastPath(true);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetInprocFastPath(true);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(rifle.StartAsync(1000));
+   const int kThreads = 4;
+   const int kShots = 1000;
+   std::vector<std::thread> shooters;
+   for (int i = 0; i < kThreads; ++i) {
+      shooters.emplace_back([&rifle]() {
+         for (int j = 0; j < kShots; ++j) {
+            EXPECT_TRUE(rifle.FireAsync("many"));
+         }
+      });
+   }
+   int count = 0;
+   std::string bullet;
+   while (count < kThreads * kShots && vampire.GetShot(bullet, 1000)) {
+      ++count;
+   }
+   for (auto& shooter : shooters) {
+      shooter.join();
+   }
+   EXPECT_EQ(kThreads * kShots, count);
+}
+
+/**
+ * Threads still firing, and blocked on a full queue, while the Rifle stops
+ * should get false back instead of touching a queue that is gone.
+ */
+TEST_F(RifleVampireTests, FireAsyncWhileStopping) {
+   Rifle rifle(GetIpcLocation());
+   ASSERT_TRUE(rifle.Aim());
+   // nobody to shoot, the queue fills up and the shooters block
+   ASSERT_TRUE(rifle.StartAsync(10, Rifle::Overflow::BLOCK, 10));
+   const int kThreads = 4;
+   std::atomic<int> queued(0);
+   std::vector<std::thread> shooters;
+   for (int i = 0; i < kThreads; ++i) {
+      shooters.emplace_back([&rifle, &queued]() {
+         while (rifle.FireAsync("stopping")) {
+            queued++;
+         }
+      });
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(50));
+   rifle.StopAsync();
+   for (auto& shooter : shooters) {
+      shooter.join();
+   }
+   EXPECT_FALSE(rifle.FireAsync("stopped"));
+   EXPECT_EQ(0, rifle.GetAsyncQueued());
+   EXPECT_EQ(queued, rifle.GetStats().drops);
+}
+
+TEST_F(RifleVampireTests, SpinWindow) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   EXPECT_EQ(0, vampire.GetSpinWindow());
+   vampire.SetSpinWindow(500);
+   EXPECT_EQ(500, vampire.GetSpinWindow());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   std::string bullet;
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+   QueueStatsSnapshot stats = vampire.GetStats();
+   EXPECT_EQ(0, stats.spinHits);
+   EXPECT_EQ(1, stats.spinMisses);
+   EXPECT_EQ(1, stats.pollTimeouts);
+   EXPECT_EQ(0, stats.SpinHitRate());
+
+   ASSERT_TRUE(rifle.Fire("spin", 100));
+   ASSERT_TRUE(rifle.FireStake(&rifle, 100));
+   // let the bullets land so the spin finds them
+   std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   ASSERT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("spin", bullet);
+   void* stake = NULL;
+   ASSERT_TRUE(vampire.GetStake(stake, 100));
+   EXPECT_EQ(&rifle, stake);
+   stats = vampire.GetStats();
+   EXPECT_EQ(2, stats.spinHits);
+   EXPECT_EQ(1, stats.spinMisses);
+   EXPECT_EQ(2, stats.messages);
+   EXPECT_DOUBLE_EQ(2.0 / 3.0, stats.SpinHitRate());
+}
+
+TEST_F(RifleVampireTests, SpinWindowGetShots) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   vampire.SetSpinWindow(500);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::vector<std::string> wounds;
+   EXPECT_EQ(0, vampire.GetShots(wounds, 10, 1));
+   for (int i = 0; i < 5; ++i) {
+      ASSERT_TRUE(rifle.Fire(std::to_string(i), 100));
+   }
+   std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   ASSERT_EQ(5, vampire.GetShots(wounds, 10, 100));
+   EXPECT_EQ("4", wounds[4]);
+   QueueStatsSnapshot stats = vampire.GetStats();
+   EXPECT_EQ(1, stats.spinHits);
+   EXPECT_EQ(1, stats.spinMisses);
+}
+
+TEST_F(RifleVampireTests, SpinWindowInproc) {
+   std::string location = GetInprocLocation();
+   Vampire vampire(location);
+   vampire.SetInprocFastPath(true);
+   vampire.SetSpinWindow(500);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   Rifle rifle(location);
+   rifle.SetInprocFastPath(true);
+   ASSERT_TRUE(rifle.Aim());
+   std::string bullet;
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+   ASSERT_TRUE(rifle.Fire("spin", 100));
+   ASSERT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ("spin", bullet);
+   QueueStatsSnapshot stats = vampire.GetStats();
+   EXPECT_EQ(1, stats.spinHits);
+   EXPECT_EQ(1, stats.spinMisses);
+}
+
+TEST_F(RifleVampireTests, SpinWindowWithinTimeout) {
+   using namespace std::chrono;
+   const int timeout = 100;
+   // a window longer than the timeout spins for all of it
+   const unsigned int window = 2 * timeout * 1000;
+   // well below a second timeout spent over again
+   const long slackMs = 60;
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   vampire.SetSpinWindow(window);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::string inprocLocation = GetInprocLocation();
+   Vampire inproc(inprocLocation);
+   inproc.SetInprocFastPath(true);
+   inproc.SetSpinWindow(window);
+   ASSERT_TRUE(inproc.PrepareToBeShot());
+
+   std::string bullet;
+   std::vector<std::string> wounds;
+   steady_clock::time_point start = steady_clock::now();
+   EXPECT_FALSE(vampire.GetShot(bullet, timeout));
+   EXPECT_GT(timeout + slackMs, duration_cast<milliseconds>(steady_clock::now() - start).count());
+   start = steady_clock::now();
+   EXPECT_EQ(0, vampire.GetShots(wounds, 10, timeout));
+   EXPECT_GT(timeout + slackMs, duration_cast<milliseconds>(steady_clock::now() - start).count());
+   start = steady_clock::now();
+   EXPECT_FALSE(inproc.GetShot(bullet, timeout));
+   EXPECT_GT(timeout + slackMs, duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+TEST_F(RifleVampireTests, SpinWindowLightLoadLatency) {
+   using namespace std::chrono;
+   const int kShots = 1000;
+   for (unsigned int window :{0, 50, 200}) {
+      std::string location = GetIpcLocation();
+      Rifle rifle(location);
+      ASSERT_TRUE(rifle.Aim());
+      Vampire vampire(location);
+      vampire.SetSpinWindow(window);
+      ASSERT_TRUE(vampire.PrepareToBeShot());
+      std::atomic<long> totalUs(0);
+      auto received = std::async(std::launch::async, [&]() {
+         int count = 0;
+         std::string bullet;
+         while (count < kShots && vampire.GetShot(bullet, 1000)) {
+            uint64_t sent = std::stoull(bullet);
+            uint64_t now = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+            totalUs += (now - sent);
+            ++count;
+         }
+         return count;
+      });
+      for (int i = 0; i < kShots; ++i) {
+         // a trickle of traffic, the vampire is usually waiting
+         std::this_thread::sleep_for(microseconds(100));
+         uint64_t sent = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+         ASSERT_TRUE(rifle.Fire(std::to_string(sent), 100));
+      }
+      ASSERT_EQ(kShots, received.get());
+      std::cout << "spin window " << window << "us: mean one way latency "
+              << totalUs.load() / kShots << "us, spin hit rate "
+              << vampire.GetStats().SpinHitRate() << std::endl;
+   }
+}
+
+TEST_F(RifleVampireTests, FireCompressed) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   EXPECT_EQ(0, rifle.GetCompression());
+   rifle.SetCompression(6, 100);
+   EXPECT_EQ(6, rifle.GetCompression());
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   const std::string text = MakeLogLines(10000);
+   ASSERT_TRUE(rifle.Fire(text, 100));
+   ASSERT_TRUE(rifle.Fire("too small to bother", 100));
+   std::string moved = text;
+   ASSERT_TRUE(rifle.Fire(std::move(moved), 100));
+   EXPECT_TRUE(moved.empty());
+   ASSERT_EQ(2, rifle.FireBurst({text, text}, 100));
+   EXPECT_EQ(4, rifle.GetCompressedCount());
+
+   std::string bullet;
+   ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+   EXPECT_EQ(text, bullet);
+   ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+   EXPECT_EQ("too small to bother", bullet);
+   ZeroCopyMessage wound;
+   ASSERT_TRUE(vampire.GetShot(wound, 1000));
+   EXPECT_EQ(text, wound.ToString());
+   std::vector<std::string> wounds;
+   size_t count = 0;
+   for (int i = 0; i < 10 && count < 2; ++i) {
+      count += vampire.GetShots(wounds, 2 - count, 100);
+   }
+   ASSERT_EQ(2, count);
+   EXPECT_EQ(text, wounds[0]);
+   EXPECT_EQ(text, wounds[1]);
+
+   QueueStatsSnapshot stats = vampire.GetStats();
+   EXPECT_EQ(5, stats.messages);
+   EXPECT_EQ(text.size() * 4 + bullet.size(), stats.bytes);
+   EXPECT_EQ(0, stats.errors);
+   EXPECT_EQ(rifle.GetStats().bytes, stats.bytes);
+}
+
+TEST_F(RifleVampireTests, FireIncompressible) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   rifle.SetCompression(1, 0);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   std::string noise(4096, 0);
+   for (auto& c : noise) {
+      c = static_cast<char> (rand());
+   }
+   const std::string text = MakeLogLines(4096);
+   std::string bullet;
+   ASSERT_TRUE(rifle.Fire(noise, 100));
+   ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+   EXPECT_EQ(noise, bullet);
+   // the noise sample turns compression off for a while, even for text
+   ASSERT_TRUE(rifle.Fire(text, 100));
+   ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+   EXPECT_EQ(text, bullet);
+   EXPECT_EQ(0, rifle.GetCompressedCount());
+   for (int i = 0; i < 200; ++i) {
+      ASSERT_TRUE(rifle.Fire(text, 100));
+      ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+      ASSERT_EQ(text, bullet);
+   }
+   EXPECT_LT(0, rifle.GetCompressedCount());
+}
+
+TEST_F(RifleVampireTests, CompressionLevelThroughput) {
+   const int dataSize = 4096;
+   const int nShots = 20000;
+   const int hwm = 1000;
+   for (int level : {0, 1, 3, 6, 9}) {
+      CompressionBenchmark(level, dataSize, nShots, hwm, kWaitTimeMs);
+   }
+}
+
+TEST_F(RifleVampireTests, FireBatched) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   // no time bound to speak of, only size and FlushBatch send
+   rifle.SetBatching(64, 10000000);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   std::vector<std::string> bullets;
+   for (int i = 0; i < 20; ++i) {
+      bullets.push_back("bullet " + std::to_string(i));
+   }
+   size_t bytes = 0;
+   for (const auto& bullet : bullets) {
+      ASSERT_TRUE(rifle.FireBatched(bullet, 100));
+      bytes += bullet.size();
+   }
+   EXPECT_LT(0, rifle.GetBatched());
+   EXPECT_FALSE(rifle.FireBatched("", 100));
+   ASSERT_TRUE(rifle.FlushBatch(100));
+   EXPECT_EQ(0, rifle.GetBatched());
+   EXPECT_TRUE(rifle.FlushBatch(100));
+   QueueStatsSnapshot rifleStats = rifle.GetStats();
+   EXPECT_EQ(bullets.size(), rifleStats.messages);
+   EXPECT_EQ(bytes, rifleStats.bytes);
+
+   // single bullets, the rest of a batch waits for the next call
+   std::string bullet;
+   ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+   EXPECT_EQ(bullets[0], bullet);
+   ZeroCopyMessage wound;
+   ASSERT_TRUE(vampire.GetShot(wound, 1000));
+   EXPECT_EQ(bullets[1], wound.ToString());
+   // a few at a time
+   std::vector<std::string> wounds;
+   ASSERT_EQ(3, vampire.GetShots(wounds, 3, 1000));
+   EXPECT_EQ(bullets[2], wounds[0]);
+   EXPECT_EQ(bullets[4], wounds[2]);
+   // whole batches as views
+   size_t index = 5;
+   ShotBatch batch;
+   while (index < bullets.size() && vampire.GetBatch(batch, 1000)) {
+      ASSERT_FALSE(batch.Empty());
+      for (const auto& shot : batch) {
+         ASSERT_LT(index, bullets.size());
+         EXPECT_EQ(bullets[index], shot.ToString());
+         ++index;
+      }
+   }
+   EXPECT_EQ(bullets.size(), index);
+   EXPECT_FALSE(vampire.GetBatch(batch, 10));
+   EXPECT_TRUE(batch.Empty());
+
+   QueueStatsSnapshot stats = vampire.GetStats();
+   EXPECT_EQ(bullets.size(), stats.messages);
+   EXPECT_EQ(bytes, stats.bytes);
+   EXPECT_EQ(0, stats.errors);
+}
+
+TEST_F(RifleVampireTests, FireBatchedTimeBound) {
+   using namespace std::chrono;
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   const long maxDelayUs = 50000;
+   rifle.SetBatching(65536, maxDelayUs);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+
+   // nothing else is fired, the flusher sends the lone bullet
+   const steady_clock::time_point fired = steady_clock::now();
+   ASSERT_TRUE(rifle.FireBatched("lone", 100));
+   ShotBatch batch;
+   ASSERT_TRUE(vampire.GetBatch(batch, 1000));
+   const long waitedUs = duration_cast<microseconds>(steady_clock::now() - fired).count();
+   EXPECT_LE(maxDelayUs, waitedUs);
+   // with slack for a busy machine
+   EXPECT_GT(maxDelayUs + 100000, waitedUs);
+   ASSERT_EQ(1, batch.Size());
+   EXPECT_EQ("lone", batch.begin()->ToString());
+   EXPECT_EQ(0, rifle.GetBatched());
+
+   // bullets within the delay go together
+   ASSERT_TRUE(rifle.FireBatched("first", 100));
+   ASSERT_TRUE(rifle.FireBatched("second", 100));
+   ASSERT_TRUE(vampire.GetBatch(batch, 1000));
+   ASSERT_EQ(2, batch.Size());
+   ShotBatch::Shot shot;
+   ASSERT_TRUE(batch.Next(shot));
+   EXPECT_EQ("first", shot.ToString());
+   ASSERT_TRUE(batch.Next(shot));
+   EXPECT_EQ("second", shot.ToString());
+   EXPECT_EQ(0, rifle.GetBatched());
+}
+
+TEST_F(RifleVampireTests, FireBatchedOff) {
+   std::string location = GetIpcLocation();
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   Vampire vampire(location);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   ASSERT_TRUE(rifle.FireBatched("plain", 100));
+   EXPECT_EQ(0, rifle.GetBatched());
+   // a plain bullet comes as a batch of one
+   ShotBatch batch;
+   ASSERT_TRUE(vampire.GetBatch(batch, 1000));
+   ASSERT_EQ(1, batch.Size());
+   EXPECT_EQ("plain", batch.begin()->ToString());
+
+   std::string inproc = GetInprocLocation();
+   Vampire inprocVampire(inproc);
+   inprocVampire.SetOwnSocket(true);
+   inprocVampire.SetInprocFastPath(true);
+   inprocVampire.SetSharedContext("FireBatchedOff");
+   ASSERT_TRUE(inprocVampire.PrepareToBeShot());
+   Rifle inprocRifle(inproc);
+   inprocRifle.SetOwnSocket(false);
+   inprocRifle.SetInprocFastPath(true);
+   inprocRifle.SetSharedContext("FireBatchedOff");
+   inprocRifle.SetBatching(1024);
+   ASSERT_TRUE(inprocRifle.Aim());
+   // the in process queue has no frames to batch into
+   ASSERT_TRUE(inprocRifle.FireBatched("fast", 100));
+   EXPECT_EQ(0, inprocRifle.GetBatched());
+   ASSERT_TRUE(inprocVampire.GetBatch(batch, 1000));
+   ASSERT_EQ(1, batch.Size());
+   EXPECT_EQ("fast", batch.begin()->ToString());
+}
+
+TEST_F(RifleVampireTests, FireVersusFireBatched) {
+   const int dataSize = 32;
+   const int nShots = 200000;
+   const int hwm = 1000;
+   long fireUs = BatchingBenchmark(0, dataSize, nShots, hwm, kWaitTimeMs);
+   for (size_t batchBytes : {512, 4096, 16384}) {
+      long batchedUs = BatchingBenchmark(batchBytes, dataSize, nShots, hwm, kWaitTimeMs);
+      std::cout << "speedup with " << batchBytes << " byte batches: "
+              << static_cast<double> (fireUs) / std::max(batchedUs, 1L) << "x" << std::endl;
+   }
+}
+
+TEST_F(RifleVampireTests, FireSpillsWhenFull) {
+   std::string location = GetIpcLocation();
+   const std::string directory = "/tmp/RifleVampireTests.FireSpillsWhenFull." + std::to_string(getpid());
+   Rifle rifle(location);
+   EXPECT_FALSE(rifle.StartSpill(directory));
+   rifle.SetHighWater(10);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(rifle.StartSpill(directory, 64 * 1024));
+   EXPECT_FALSE(rifle.StartSpill(directory));
+
+   // nobody is connected, everything is spilled
+   const int nShots = 1000;
+   for (int i = 0; i < nShots; ++i) {
+      ASSERT_TRUE(rifle.Fire("bullet " + std::to_string(i), 0));
+   }
+   EXPECT_EQ(nShots, rifle.GetSpilled());
+   EXPECT_EQ(nShots, rifle.GetStats().spills);
+   EXPECT_EQ(0, rifle.GetStats().messages);
+
+   Vampire vampire(location);
+   vampire.SetOwnSocket(false);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::string bullet;
+   for (int i = 0; i < nShots; ++i) {
+      ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+      ASSERT_EQ("bullet " + std::to_string(i), bullet);
+   }
+   for (int i = 0; i < 100 && rifle.GetSpilled() != 0; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   EXPECT_EQ(0, rifle.GetSpilled());
+   // with nothing spilled bullets go straight out again
+   ASSERT_TRUE(rifle.Fire("direct", 100));
+   ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+   EXPECT_EQ("direct", bullet);
+   EXPECT_EQ(nShots, rifle.GetStats().spills);
+   EXPECT_EQ(nShots + 1, rifle.GetStats().messages);
+   rifle.StopSpill();
+   rmdir(directory.c_str());
+}
+
+/**
+ * Ways to shoot that don't spill must not overtake spilled bullets, nor use
+ * the socket while the replay thread does.
+ */
+TEST_F(RifleVampireTests, SpillKeepsStakesBehind) {
+   std::string location = GetIpcLocation();
+   const std::string directory = "/tmp/RifleVampireTests.SpillKeepsStakesBehind." + std::to_string(getpid());
+   Rifle rifle(location);
+   rifle.SetHighWater(10);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(rifle.StartSpill(directory, 64 * 1024));
+   const int nShots = 100;
+   for (int i = 0; i < nShots; ++i) {
+      ASSERT_TRUE(rifle.Fire("bullet " + std::to_string(i), 0));
+   }
+   ASSERT_EQ(nShots, rifle.GetSpilled());
+   // refused at once, as on a full pipe
+   const uint64_t stalls = rifle.GetStats().highWaterStalls;
+   EXPECT_FALSE(rifle.FireStake(&rifle, 1000));
+   EXPECT_EQ(stalls + 1, rifle.GetStats().highWaterStalls);
+
+   Vampire vampire(location);
+   vampire.SetOwnSocket(false);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::string bullet;
+   for (int i = 0; i < nShots; ++i) {
+      ASSERT_TRUE(vampire.GetShot(bullet, 1000));
+      ASSERT_EQ("bullet " + std::to_string(i), bullet);
+   }
+   for (int i = 0; i < 100 && rifle.GetSpilled() != 0; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   ASSERT_EQ(0, rifle.GetSpilled());
+   ASSERT_TRUE(rifle.FireStake(&rifle, 1000));
+   void* stake = nullptr;
+   ASSERT_TRUE(vampire.GetStake(stake, 1000));
+   EXPECT_EQ(&rifle, stake);
+   rifle.StopSpill();
+   rmdir(directory.c_str());
+}
+
+TEST_F(RifleVampireTests, SpillSurvivesTheRifle) {
+   std::string location = GetIpcLocation();
+   const std::string directory = "/tmp/RifleVampireTests.SpillSurvivesTheRifle." + std::to_string(getpid());
+   {
+      Rifle rifle(location);
+      ASSERT_TRUE(rifle.Aim());
+      ASSERT_TRUE(rifle.StartSpill(directory, 64 * 1024));
+      ASSERT_EQ(2, rifle.FireBurst({"first", "second"}, 0));
+      std::string third("third");
+      ASSERT_TRUE(rifle.Fire(std::move(third), 0));
+      EXPECT_EQ(3, rifle.GetSpilled());
+   }
+   Rifle rifle(location);
+   ASSERT_TRUE(rifle.Aim());
+   ASSERT_TRUE(rifle.StartSpill(directory, 64 * 1024));
+   ASSERT_TRUE(rifle.Fire("fourth", 0));
+   Vampire vampire(location);
+   vampire.SetOwnSocket(false);
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::vector<std::string> wounds;
+   size_t count = 0;
+   for (int i = 0; i < 100 && count < 4; ++i) {
+      size_t received = vampire.GetShots(wounds, 4 - count, 100);
+      for (size_t shot = 0; shot < received; ++shot) {
+         const char* expected[] = {"first", "second", "third", "fourth"};
+         EXPECT_EQ(expected[count + shot], wounds[shot]);
+      }
+      count += received;
+   }
+   EXPECT_EQ(4, count);
+   rifle.StopSpill();
+   rmdir(directory.c_str());
+}
+
+TEST_F(RifleVampireTests, SpillNotForInproc) {
+   Rifle rifle(GetInprocLocation());
+   rifle.SetInprocFastPath(true);
+   ASSERT_TRUE(rifle.Aim());
+   EXPECT_FALSE(rifle.StartSpill("/tmp/RifleVampireTests.SpillNotForInproc"));
+   EXPECT_EQ(0, rifle.GetSpilled());
+}
+
+TEST_F(RifleVampireTests, FireVersusSpillBurst) {
+   const int dataSize = 1024;
+   const int nShots = 100000;
+   const int hwm = 100;
+   SpillBenchmark(false, dataSize, nShots, hwm, kWaitTimeMs);
+   SpillBenchmark(true, dataSize, nShots, hwm, kWaitTimeMs);
+}
+
+TEST_F(RifleVampireTests, VampireFdWithEpoll) {
+   EpollRoundTrip(GetIpcLocation(), 20000);
+}
+
+TEST_F(RifleVampireTests, VampireFdWithEpollInproc) {
+   EpollRoundTrip(GetInprocLocation(), 20000, true);
+}
+
+TEST_F(RifleVampireTests, GetShotsNothingThere) {
+   Vampire vampire(GetIpcLocation());
+   ASSERT_TRUE(vampire.PrepareToBeShot());
+   std::vector<std::string> wounds;
+   EXPECT_EQ(0, vampire.GetShots(wounds, 10, 1));
+   EXPECT_EQ(0, vampire.GetShots(wounds, 0, 1));
+}
+
+TEST_F(RifleVampireTests, GetShotsDrainsUpToMax) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::vector<std::string> bullets;
+   for (int i = 0; i < 25; i++) {
+      bullets.push_back(std::to_string(i));
+      ASSERT_TRUE(rifle.Fire(bullets.back(), 100));
+   }
+   std::vector<std::string> wounds;
+   size_t total = 0;
+   while (total < bullets.size()) {
+      size_t received = vampire.GetShots(wounds, 10, 100);
+      ASSERT_LT(0u, received);
+      ASSERT_GE(10u, received);
+      EXPECT_EQ(10u, wounds.size());
+      for (size_t i = 0; i < received; i++) {
+         EXPECT_EQ(bullets[total + i], wounds[i]);
+      }
+      total += received;
+   }
+   EXPECT_EQ(bullets.size(), total);
+   EXPECT_EQ(0, vampire.GetShots(wounds, 10, 1));
+}
+
+/**
+ * Steady state consumers should not reallocate the strings they are given
+ */
+TEST_F(RifleVampireTests, GetShotsReusesBuffers) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::string msg(512, 'x');
+   std::vector<std::string> wounds;
+   ASSERT_TRUE(rifle.Fire(msg, 100));
+   ASSERT_EQ(1, vampire.GetShots(wounds, 4, 100));
+   const char* slot = wounds[0].data();
+   for (int i = 0; i < 10; i++) {
+      ASSERT_TRUE(rifle.Fire(std::string(100 + i, 'y'), 100));
+      ASSERT_EQ(1, vampire.GetShots(wounds, 4, 100));
+      EXPECT_EQ(std::string(100 + i, 'y'), wounds[0]);
+      EXPECT_EQ(slot, wounds[0].data());
+   }
+}
+
+TEST_F(RifleVampireTests, FireStructsInTheDark) {
+   Rifle rifle(GetIpcLocation());
+   std::vector<FlowRecord> records(2);
+   EXPECT_FALSE(rifle.FireStructs(records, 1));
+   rifle.Aim();
+   EXPECT_FALSE(rifle.FireStructs(records, 1));
+   EXPECT_FALSE(rifle.FireStructs(std::vector<FlowRecord>(), 1));
+   EXPECT_FALSE(rifle.FireStructs<FlowRecord>(nullptr, 2, 1));
+}
+
+TEST_F(RifleVampireTests, FireAndGetStructs) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::vector<FlowRecord> records(100);
+   for (size_t i = 0; i < records.size(); ++i) {
+      records[i].session = i;
+      records[i].packets = i * 2;
+      records[i].port = i % 65536;
+      memset(records[i].flags, i % 256, sizeof (records[i].flags));
+   }
+   ASSERT_TRUE(rifle.FireStructs(records, 100));
+   std::vector<FlowRecord> wounds(1);
+   ASSERT_TRUE(vampire.GetStructs(wounds, 100));
+   ASSERT_EQ(records.size(), wounds.size());
+   EXPECT_EQ(0, memcmp(records.data(), wounds.data(), records.size() * sizeof (FlowRecord)));
+
+   ASSERT_TRUE(rifle.FireStructs(&records[10], 5, 100));
+   FlowRecord buffer[5];
+   ASSERT_EQ(5, vampire.GetStructs(buffer, 5, 100));
+   EXPECT_EQ(10, buffer[0].session);
+   EXPECT_EQ(14, buffer[4].session);
+   EXPECT_EQ(28, buffer[4].packets);
+
+   ASSERT_TRUE(rifle.FireStructs(records, 100));
+   ZeroCopyMessage wound;
+   size_t count = 0;
+   const FlowRecord* view = vampire.GetStructs<FlowRecord>(wound, count, 100);
+   ASSERT_NE(nullptr, view);
+   ASSERT_EQ(records.size(), count);
+   EXPECT_EQ(wound.Data(), reinterpret_cast<const uint8_t*> (view));
+   EXPECT_EQ(99, view[99].session);
+   EXPECT_EQ(0, memcmp(records.data(), view, records.size() * sizeof (FlowRecord)));
+
+   EXPECT_EQ(0, vampire.GetStructs(buffer, 5, 1));
+   EXPECT_FALSE(vampire.GetStructs(wounds, 1));
+   EXPECT_TRUE(wounds.empty());
+}
+
+TEST_F(RifleVampireTests, GetStructsRejectsBadSizes) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::vector<FlowRecord> records(10);
+
+   // not a whole number of records
+   ASSERT_TRUE(rifle.Fire(std::string(sizeof (FlowRecord) + 1, 'x'), 100));
+   std::vector<FlowRecord> wounds;
+   EXPECT_FALSE(vampire.GetStructs(wounds, 100));
+   EXPECT_TRUE(wounds.empty());
+
+   // more records than the caller has room for
+   ASSERT_TRUE(rifle.FireStructs(records, 100));
+   FlowRecord buffer[5];
+   EXPECT_EQ(0, vampire.GetStructs(buffer, 5, 100));
+
+   ASSERT_TRUE(rifle.Fire(std::string(sizeof (FlowRecord) - 1, 'x'), 100));
+   ZeroCopyMessage wound;
+   size_t count = 1;
+   EXPECT_EQ(nullptr, vampire.GetStructs<FlowRecord>(wound, count, 100));
+   EXPECT_EQ(0, count);
+   EXPECT_TRUE(wound.Empty());
+
+   // the good one still gets through after the bad ones
+   ASSERT_TRUE(rifle.FireStructs(records, 100));
+   EXPECT_TRUE(vampire.GetStructs(wounds, 100));
+   EXPECT_EQ(records.size(), wounds.size());
+}
+
+TEST_F(RifleVampireTests, ZeroCopyMessageView) {
+   ZeroCopyMessage empty;
+   size_t count = 1;
+   EXPECT_EQ(nullptr, empty.View<uint32_t>(count));
+   EXPECT_EQ(0, count);
+
+   std::vector<uint32_t> values = {1, 2, 3};
+   zframe_t* frame = zframe_new(values.data(), values.size() * sizeof (uint32_t));
+   ZeroCopyMessage wound(frame);
+   const uint32_t* view = wound.View<uint32_t>(count);
+   ASSERT_NE(nullptr, view);
+   ASSERT_EQ(3, count);
+   EXPECT_EQ(3, view[2]);
+   EXPECT_EQ(nullptr, wound.View<FlowRecord>(count));
+   EXPECT_EQ(0, count);
+}
+
+TEST_F(RifleVampireTests, GetShotZeroCopy) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   ZeroCopyMessage wound;
+   EXPECT_FALSE(vampire.GetShot(wound, 1));
+   EXPECT_TRUE(wound.Empty());
+   std::string msg(65536, 'z');
+   ASSERT_TRUE(rifle.Fire(msg));
+   ASSERT_TRUE(vampire.GetShot(wound, 100));
+   ASSERT_EQ(msg.size(), wound.Size());
+   EXPECT_EQ(0, memcmp(msg.data(), wound.Data(), wound.Size()));
+
+   ZeroCopyMessage moved(std::move(wound));
+   EXPECT_TRUE(wound.Empty());
+   EXPECT_EQ(msg, moved.ToString());
+   wound = std::move(moved);
+   EXPECT_TRUE(moved.Empty());
+   EXPECT_EQ(msg, wound.ToString());
+   wound.Reset();
+   EXPECT_TRUE(wound.Empty());
+}
+
+TEST_F(RifleVampireTests, FireMovedString) {
+   std::string location = GetIpcLocation();
+   Vampire vampire(location);
+   Rifle rifle(location);
+   rifle.Aim();
+   vampire.PrepareToBeShot();
+   std::string expected(1024, 'm');
+   std::string msg = expected;
+   ASSERT_TRUE(rifle.Fire(std::move(msg), 100));
+   EXPECT_TRUE(msg.empty());
+   std::string bullet;
+   ASSERT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ(expected, bullet);
+
+   std::vector<uint8_t> binary(expected.begin(), expected.end());
+   ASSERT_TRUE(rifle.Fire(std::move(binary), 100));
+   EXPECT_TRUE(binary.empty());
+   ASSERT_TRUE(vampire.GetShot(bullet, 100));
+   EXPECT_EQ(expected, bullet);
+
+   std::string blank;
+   EXPECT_FALSE(rifle.Fire(std::move(blank), 100));
+   EXPECT_FALSE(vampire.GetShot(bullet, 1));
+}
+
+TEST_F(RifleVampireTests, FireMovedStringInTheDark) {
+   Rifle rifle(GetIpcLocation());
+   rifle.Aim();
+   //should fail without someone to shoot.
+   EXPECT_FALSE(rifle.Fire(std::string("Fire!"), 1));
+   EXPECT_FALSE(rifle.Fire(std::vector<uint8_t>(10, 'f'), 1));
+   // a bullet that was not sent is kept for another try
+   std::string bullet("Fire!");
+   EXPECT_FALSE(rifle.Fire(std::move(bullet), 1));
+   EXPECT_EQ("Fire!", bullet);
+   std::vector<uint8_t> bytes(10, 'f');
+   EXPECT_FALSE(rifle.Fire(std::move(bytes), 1));
+   EXPECT_EQ(std::vector<uint8_t>(10, 'f'), bytes);
+}
+
+/**
+ * The buffer given to ZeroMQ should be deleted once, and only once the
+ * last reference to the message is gone.
+ */
+TEST_F(RifleVampireTests, OwnedBulletIsDeleted) {
+   mShotsDeleted.store(0);
+   zmq_msg_t message;
+   ASSERT_TRUE(CZMQToolkit::InitMessageTakingOwnership(message, CountedBullet("woo")));
+   EXPECT_EQ(0, mShotsDeleted);
+   EXPECT_EQ(3, zmq_msg_size(&message));
+   EXPECT_EQ(0, memcmp("woo", zmq_msg_data(&message), 3));
+   zmq_msg_close(&message);
+   EXPECT_EQ(1, mShotsDeleted);
+
+   zctx_t* context = zctx_new();
+   void* sender = zsocket_new(context, ZMQ_PAIR);
+   void* receiver = zsocket_new(context, ZMQ_PAIR);
+   std::string location = "inproc://OwnedBulletIsDeleted";
+   ASSERT_EQ(0, zsocket_bind(receiver, location.c_str()));
+   ASSERT_EQ(0, zsocket_connect(sender, location.c_str()));
+   ASSERT_TRUE(CZMQToolkit::InitMessageTakingOwnership(message, CountedBullet("woo")));
+   ASSERT_EQ(3, zmq_msg_send(&message, sender, 0));
+   zmq_msg_close(&message);
+   zmq_msg_t received;
+   zmq_msg_init(&received);
+   ASSERT_EQ(3, zmq_msg_recv(&received, receiver, 0));
+   EXPECT_EQ(1, mShotsDeleted);
+   zmq_msg_close(&received);
+   EXPECT_EQ(2, mShotsDeleted);
+   zctx_destroy(&context);
+}
+
+/**
+ * A send that fails after the message took the buffer should hand it back,
+ * and not delete it.
+ */
+TEST_F(RifleVampireTests, OwnedBulletIsHandedBack) {
+   zctx_t* context = zctx_new();
+   void* sender = zsocket_new(context, ZMQ_PUSH);
+   ASSERT_EQ(0, zsocket_connect(sender, GetIpcLocation().c_str()));
+   // nobody to take it
+   std::string bullet("woo");
+   EXPECT_FALSE(CZMQToolkit::SendTakingOwnership(bullet, sender, ZMQ_DONTWAIT));
+   EXPECT_EQ(EAGAIN, zmq_errno());
+   EXPECT_EQ("woo", bullet);
+   std::vector<uint8_t> bytes(1000, 'w');
+   EXPECT_FALSE(CZMQToolkit::SendTakingOwnership(bytes, sender, ZMQ_DONTWAIT));
+   EXPECT_EQ(std::vector<uint8_t>(1000, 'w'), bytes);
+   zctx_destroy(&context);
+}
+
 /**
  * Test Firing after socket has been shutdown.
  */
@@ -2166,6 +3731,15 @@ TEST_F(RifleVampireTests, VampireStakingTests) {
    EXPECT_FALSE(vampire.GetStake(stake, 10));
 }
 
+TEST_F(RifleVampireTests, VampireMultiShootingTests) {
+   std::string location = GetIpcLocation();
+   TestVampire vampire(location);
+   EXPECT_TRUE(vampire.PrepareToBeShot());
+   vampire.Destroy();
+   std::vector<std::string> wounds;
+   EXPECT_EQ(0, vampire.GetShots(wounds, 10, 10));
+}
+
 TEST_F(RifleVampireTests, VampireBundleStakingTests) {
    std::string location = GetIpcLocation();
    TestVampire vampire(location);
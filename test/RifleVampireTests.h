@@ -49,6 +49,15 @@ public:
    void NRiflesOneVampireBenchmark(int nRifles, int nIOThreads,
            int rifleHWM, int vampireHWM, std::string& location, int dataSize,
            int nShotsPerRifle, int expectedSpeed, int waitTimeMs);
+   void FireVersusFireBurstBenchmark(int dataSize, int nShots, int burstSize,
+           int hwm, int waitTimeMs);
+   long InprocBenchmark(bool fastPath, int dataSize, int nShots, int hwm, int waitTimeMs);
+   void CompressionBenchmark(int level, int dataSize, int nShots, int hwm, int waitTimeMs);
+   static std::string MakeLogLines(size_t size);
+   long BatchingBenchmark(size_t batchBytes, int dataSize, int nShots, int hwm, int waitTimeMs);
+   void SpillBenchmark(bool spill, int dataSize, int nShots, int hwm, int waitTimeMs);
+   static int EpollShots(Vampire& vampire, int nShots);
+   void EpollRoundTrip(const std::string& location, int nShots, bool inprocFastPath = false);
    void NRiflesOneVampireBenchmarkZeroCopy(int nRifles, int nIOThreads,
            int rifleHWM, int vampireHWM, std::string& location, int dataSize,
            int nShotsPerRifle, int expectedSpeed, int waitTimeMs);
@@ -0,0 +1,139 @@
+#include "ShotBatchTests.h"
+#include <vector>
+
+namespace {
+   ZeroCopyMessage MakeFrame(const std::vector<std::string>& bullets) {
+      std::string frame;
+      for (const auto& bullet : bullets) {
+         ShotBatch::Append(frame, bullet.data(), bullet.size());
+      }
+      ZeroCopyMessage message;
+      message.Adopt(std::move(frame));
+      return message;
+   }
+}
+
+TEST_F(ShotBatchTests, StartsEmpty) {
+   ShotBatch batch;
+   ShotBatch::Shot shot;
+   EXPECT_TRUE(batch.Empty());
+   EXPECT_EQ(0, batch.Size());
+   EXPECT_EQ(0, batch.Bytes());
+   EXPECT_FALSE(batch.Next(shot));
+   EXPECT_TRUE(batch.begin() == batch.end());
+}
+
+TEST_F(ShotBatchTests, AppendVarintLengths) {
+   std::string frame;
+   ShotBatch::Append(frame, "a", 1);
+   ASSERT_EQ(2, frame.size());
+   EXPECT_EQ(1, frame[0]);
+   EXPECT_EQ('a', frame[1]);
+
+   frame.clear();
+   std::string bullet(300, 'x');
+   ShotBatch::Append(frame, bullet.data(), bullet.size());
+   ASSERT_EQ(302, frame.size());
+   EXPECT_EQ(0xac, static_cast<uint8_t> (frame[0]));
+   EXPECT_EQ(0x02, static_cast<uint8_t> (frame[1]));
+
+   size_t count = 0;
+   size_t bytes = 0;
+   EXPECT_TRUE(ShotBatch::Parse(reinterpret_cast<const uint8_t*> (frame.data()), frame.size(), count, bytes));
+   EXPECT_EQ(1, count);
+   EXPECT_EQ(300, bytes);
+}
+
+TEST_F(ShotBatchTests, ParseRejectsMalformed) {
+   size_t count = 0;
+   size_t bytes = 0;
+   std::string frame;
+   EXPECT_FALSE(ShotBatch::Parse(reinterpret_cast<const uint8_t*> (frame.data()), frame.size(), count, bytes));
+
+   // length runs past the end
+   ShotBatch::Append(frame, "abc", 3);
+   frame.pop_back();
+   EXPECT_FALSE(ShotBatch::Parse(reinterpret_cast<const uint8_t*> (frame.data()), frame.size(), count, bytes));
+   EXPECT_EQ(0, count);
+   EXPECT_EQ(0, bytes);
+
+   // empty bullet
+   frame.assign(1, '\0');
+   EXPECT_FALSE(ShotBatch::Parse(reinterpret_cast<const uint8_t*> (frame.data()), frame.size(), count, bytes));
+
+   // unterminated and overlong prefixes
+   frame.assign(3, static_cast<char> (0x80));
+   EXPECT_FALSE(ShotBatch::Parse(reinterpret_cast<const uint8_t*> (frame.data()), frame.size(), count, bytes));
+   frame.assign(ShotBatch::kMaxVarintSize + 1, static_cast<char> (0x80));
+   frame.append(1, '\x01');
+   EXPECT_FALSE(ShotBatch::Parse(reinterpret_cast<const uint8_t*> (frame.data()), frame.size(), count, bytes));
+
+   ShotBatch batch;
+   ZeroCopyMessage message;
+   message.Adopt(std::move(frame));
+   EXPECT_FALSE(batch.Assign(std::move(message)));
+   EXPECT_TRUE(batch.Empty());
+}
+
+TEST_F(ShotBatchTests, IterateViews) {
+   std::vector<std::string> bullets = {"one", std::string(200, 'b'), "three"};
+   ShotBatch batch;
+   ASSERT_TRUE(batch.Assign(MakeFrame(bullets)));
+   EXPECT_EQ(3, batch.Size());
+   EXPECT_EQ(3 + 200 + 5, batch.Bytes());
+
+   size_t index = 0;
+   const uint8_t* previous = nullptr;
+   for (const auto& shot : batch) {
+      ASSERT_LT(index, bullets.size());
+      EXPECT_EQ(bullets[index], shot.ToString());
+      // views point into the one frame, in order
+      EXPECT_LT(previous, shot.data);
+      previous = shot.data;
+      ++index;
+   }
+   EXPECT_EQ(bullets.size(), index);
+   // iterating does not consume
+   EXPECT_EQ(3, batch.Size());
+}
+
+TEST_F(ShotBatchTests, NextConsumes) {
+   std::vector<std::string> bullets = {"one", "two", "three"};
+   ShotBatch batch;
+   ASSERT_TRUE(batch.Assign(MakeFrame(bullets)));
+   ShotBatch::Shot shot;
+   ASSERT_TRUE(batch.Next(shot));
+   EXPECT_EQ("one", shot.ToString());
+   EXPECT_EQ(2, batch.Size());
+   EXPECT_EQ(8, batch.Bytes());
+   EXPECT_EQ("two", batch.begin()->ToString());
+
+   ShotBatch moved(std::move(batch));
+   EXPECT_TRUE(batch.Empty());
+   ASSERT_TRUE(moved.Next(shot));
+   EXPECT_EQ("two", shot.ToString());
+   ASSERT_TRUE(moved.Next(shot));
+   EXPECT_EQ("three", shot.ToString());
+   EXPECT_FALSE(moved.Next(shot));
+   EXPECT_TRUE(moved.Empty());
+   EXPECT_EQ(0, moved.Bytes());
+}
+
+TEST_F(ShotBatchTests, SingleBullet) {
+   ShotBatch batch;
+   ZeroCopyMessage message;
+   // a plain bullet has no prefix, its first byte is not a length
+   message.Adopt(std::string("\x05plain"));
+   batch.AssignSingle(std::move(message));
+   EXPECT_EQ(1, batch.Size());
+   EXPECT_EQ(6, batch.Bytes());
+   EXPECT_EQ("\x05plain", batch.begin()->ToString());
+   ShotBatch::Shot shot;
+   ASSERT_TRUE(batch.Next(shot));
+   EXPECT_EQ("\x05plain", shot.ToString());
+   EXPECT_FALSE(batch.Next(shot));
+
+   ZeroCopyMessage empty;
+   batch.AssignSingle(std::move(empty));
+   EXPECT_TRUE(batch.Empty());
+}
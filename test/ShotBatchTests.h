@@ -0,0 +1,19 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "ShotBatch.h"
+
+class ShotBatchTests : public ::testing::Test {
+public:
+
+   ShotBatchTests() {
+   };
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+};
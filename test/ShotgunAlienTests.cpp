@@ -74,6 +74,26 @@ TEST_F(ShotgunAlienTests, ShotInTheDark) {
    shotgun.Fire(msg);
 }
 
+TEST_F(ShotgunAlienTests, ShootOneAlienWithMovedBullet) {
+   Alien alien;
+   Shotgun shotgun;
+   std::string location = ShotgunAlienTests::GetIpcLocation();
+   shotgun.Aim(location);
+   alien.PrepareToBeShot(location);
+   std::string expected(4096, 's');
+   std::vector<std::string> reply;
+   int count = 0;
+   while (reply.empty() && count++ < 100 && !zctx_interrupted) {
+      std::string msg = expected;
+      shotgun.Fire(std::move(msg));
+      EXPECT_TRUE(msg.empty());
+      alien.GetShot(100, reply);
+   }
+   ASSERT_EQ(2, reply.size());
+   EXPECT_EQ("dummy", reply[0]);
+   EXPECT_EQ(expected, reply[1]);
+}
+
 TEST_F(ShotgunAlienTests, ShootOneAlienOnce) {
    Alien alien;
    ShotgunAmmo* ammo = new ShotgunAmmo();
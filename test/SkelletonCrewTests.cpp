@@ -0,0 +1,117 @@
+#include "SkelletonCrewTests.h"
+#include "BoomStick.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/**
+ * Answer like MockSkelleton does
+ */
+void SkelletonCrewTests::Echo(const std::string& command, std::string& reply) {
+   reply = command + " reply";
+}
+
+TEST_F(SkelletonCrewTests, ServesManyBoomSticks) {
+   SkelletonCrew crew(mAddress, 4, Echo);
+   EXPECT_FALSE(crew.IsRunning());
+   ASSERT_TRUE(crew.Initialize());
+   ASSERT_TRUE(crew.IsRunning());
+   EXPECT_EQ(4, crew.GetWorkerCount());
+
+   const int kClients = 4;
+   const int kRequests = 250;
+   std::atomic<int> matched{0};
+   std::vector<std::thread> clients;
+   for (int client = 0; client < kClients; ++client) {
+      clients.emplace_back([this, &matched, client, kRequests]() {
+         BoomStick stick{mAddress};
+         ASSERT_TRUE(stick.Initialize());
+         for (int i = 0; i < kRequests; ++i) {
+            const std::string command = std::to_string(client) + " " + std::to_string(i);
+            if (stick.Send(command) == command + " reply") {
+               ++matched;
+            }
+         }
+      });
+   }
+   for (auto& client : clients) {
+      client.join();
+   }
+   EXPECT_EQ(kClients * kRequests, matched.load());
+   EXPECT_EQ(kClients * kRequests, crew.GetHandled());
+   EXPECT_EQ(std::vector<size_t>(4, 0), crew.GetQueueDepths());
+   EXPECT_EQ(0, crew.GetHandled(4));
+   EXPECT_EQ(0, crew.GetQueueDepth(4));
+   crew.Stop();
+   EXPECT_FALSE(crew.IsRunning());
+}
+
+TEST_F(SkelletonCrewTests, QueueDepthPerWorker) {
+   std::atomic<bool> released{false};
+   SkelletonCrew crew(mAddress, 2, [&released](const std::string& command, std::string & reply) {
+      while (!released.load()) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      Echo(command, reply);
+   });
+   ASSERT_TRUE(crew.Initialize());
+   BoomStick stick{mAddress};
+   ASSERT_TRUE(stick.Initialize());
+
+   std::vector<std::string> ids;
+   for (int i = 0; i < 10; ++i) {
+      ids.push_back(stick.GetUuid());
+      ASSERT_TRUE(stick.SendAsync(ids.back(), "request " + std::to_string(i)));
+   }
+   // each request went to the worker with the fewest waiting
+   std::vector<size_t> depths;
+   for (int wait = 0; wait < 100; ++wait) {
+      depths = crew.GetQueueDepths();
+      if (depths[0] + depths[1] == ids.size()) {
+         break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+   }
+   EXPECT_EQ(std::vector<size_t>({5, 5}), depths);
+   EXPECT_EQ(0, crew.GetHandled());
+
+   released.store(true);
+   std::string reply;
+   for (size_t i = 0; i < ids.size(); ++i) {
+      ASSERT_TRUE(stick.GetAsyncReply(ids[i], 2000, reply));
+      EXPECT_EQ("request " + std::to_string(i) + " reply", reply);
+   }
+   EXPECT_EQ(ids.size(), crew.GetHandled());
+   EXPECT_EQ(5, crew.GetHandled(0));
+   EXPECT_EQ(5, crew.GetHandled(1));
+   EXPECT_EQ(std::vector<size_t>({0, 0}), crew.GetQueueDepths());
+}
+
+TEST_F(SkelletonCrewTests, ThroughputByWorkers) {
+   // about 100us of work per request
+   auto busy = [](const std::string& command, std::string & reply) {
+      const auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(100);
+      while (std::chrono::steady_clock::now() < until) {
+      }
+      Echo(command, reply);
+   };
+   std::vector<std::string> commands;
+   for (int i = 0; i < 2000; ++i) {
+      commands.push_back("request " + std::to_string(i));
+   }
+   for (size_t workers : {1, 2, 4}) {
+      SkelletonCrew crew(mAddress, workers, busy);
+      ASSERT_TRUE(crew.Initialize());
+      BoomStick stick{mAddress};
+      ASSERT_TRUE(stick.Initialize());
+      auto start = std::chrono::steady_clock::now();
+      EXPECT_EQ(commands.size(), stick.SendBatch(commands, 10000, [](const size_t, std::string&) {
+      }));
+      const long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start).count();
+      std::cout << workers << " workers : " << commands.size() << " requests in " << elapsedUs << "us, "
+              << (commands.size() * 1000000.0) / std::max(elapsedUs, 1L) << " requests/s" << std::endl;
+   }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "SkelletonCrew.h"
+#include <pthread.h>
+#include <sstream>
+#include <czmq.h>
+
+class SkelletonCrewTests : public ::testing::Test {
+public:
+
+   SkelletonCrewTests() {
+      std::stringstream sS;
+      sS << "ipc:///tmp/skelletoncrewtest" << pthread_self();
+      mAddress = sS.str();
+   };
+   static void Echo(const std::string& command, std::string& reply);
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+      zctx_interrupted = false;
+   };
+
+   std::string mAddress;
+};
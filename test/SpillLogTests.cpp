@@ -0,0 +1,170 @@
+#include "SpillLogTests.h"
+#include <dirent.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @return the number of files in the directory, 0 if it does not exist
+ */
+size_t SpillLogTests::CountFiles(const std::string& directory) {
+   DIR* dir = opendir(directory.c_str());
+   if (dir == nullptr) {
+      return 0;
+   }
+   size_t files = 0;
+   while (dirent* entry = readdir(dir)) {
+      const std::string name(entry->d_name);
+      if (name != "." && name != "..") {
+         ++files;
+      }
+   }
+   closedir(dir);
+   return files;
+}
+
+void SpillLogTests::RemoveDirectory(const std::string& directory) {
+   DIR* dir = opendir(directory.c_str());
+   if (dir == nullptr) {
+      return;
+   }
+   while (dirent* entry = readdir(dir)) {
+      const std::string name(entry->d_name);
+      if (name != "." && name != "..") {
+         unlink((directory + "/" + name).c_str());
+      }
+   }
+   closedir(dir);
+   rmdir(directory.c_str());
+}
+
+namespace {
+   std::string PopString(SpillLog& log) {
+      const uint8_t* data = nullptr;
+      size_t size = 0;
+      if (!log.Front(data, size)) {
+         return std::string();
+      }
+      std::string record(reinterpret_cast<const char*> (data), size);
+      log.Pop();
+      return record;
+   }
+}
+
+TEST_F(SpillLogTests, StartsEmpty) {
+   SpillLog log(mDirectory, 4096, 4);
+   ASSERT_TRUE(log.Open());
+   EXPECT_TRUE(log.Empty());
+   EXPECT_EQ(0, log.Size());
+   EXPECT_EQ(0, log.Bytes());
+   EXPECT_EQ(0, log.GetSegmentCount());
+   const uint8_t* data = nullptr;
+   size_t size = 0;
+   EXPECT_FALSE(log.Front(data, size));
+   log.Pop();
+   EXPECT_EQ(0, CountFiles(mDirectory));
+}
+
+TEST_F(SpillLogTests, AppendAndPopInOrder) {
+   SpillLog log(mDirectory, 4096, 4);
+   ASSERT_TRUE(log.Open());
+   EXPECT_FALSE(log.Append("", 0));
+   for (int i = 0; i < 10; ++i) {
+      std::string record = "record " + std::to_string(i);
+      ASSERT_TRUE(log.Append(record.data(), record.size()));
+   }
+   EXPECT_EQ(10, log.Size());
+   EXPECT_EQ(1, log.GetSegmentCount());
+   for (int i = 0; i < 10; ++i) {
+      EXPECT_EQ("record " + std::to_string(i), PopString(log));
+   }
+   EXPECT_TRUE(log.Empty());
+   EXPECT_EQ(0, log.Bytes());
+   // the only segment is reused from the start
+   ASSERT_TRUE(log.Append("again", 5));
+   EXPECT_EQ(1, log.GetSegmentCount());
+   EXPECT_EQ("again", PopString(log));
+}
+
+TEST_F(SpillLogTests, RotatesAndDeletesSegments) {
+   SpillLog log(mDirectory, 4096, 3);
+   ASSERT_TRUE(log.Open());
+   const std::string record(1200, 'r');
+   // three records of 1204 bytes fit after the header of a 4096 byte segment
+   size_t appended = 0;
+   while (log.Append(record.data(), record.size())) {
+      ++appended;
+   }
+   EXPECT_EQ(9, appended);
+   EXPECT_EQ(3, log.GetSegmentCount());
+   EXPECT_EQ(3, CountFiles(mDirectory));
+   EXPECT_FALSE(log.Append(std::string(5000, 'x').data(), 5000));
+
+   for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(record, PopString(log));
+   }
+   EXPECT_EQ(2, log.GetSegmentCount());
+   EXPECT_EQ(2, CountFiles(mDirectory));
+   // room for a segment again
+   EXPECT_TRUE(log.Append(record.data(), record.size()));
+   EXPECT_EQ(3, log.GetSegmentCount());
+   while (!log.Empty()) {
+      EXPECT_EQ(record, PopString(log));
+   }
+   EXPECT_EQ(1, log.GetSegmentCount());
+   log.Close();
+   EXPECT_EQ(0, CountFiles(mDirectory));
+}
+
+TEST_F(SpillLogTests, ReopenFindsUnread) {
+   {
+      SpillLog log(mDirectory, 4096, 8);
+      ASSERT_TRUE(log.Open());
+      for (int i = 0; i < 20; ++i) {
+         std::string record = std::to_string(i) + std::string(300, 'p');
+         ASSERT_TRUE(log.Append(record.data(), record.size()));
+      }
+      for (int i = 0; i < 5; ++i) {
+         PopString(log);
+      }
+      EXPECT_EQ(15, log.Size());
+   }
+   EXPECT_LT(0, CountFiles(mDirectory));
+   {
+      SpillLog log(mDirectory, 4096, 8);
+      ASSERT_TRUE(log.Open());
+      EXPECT_EQ(15, log.Size());
+      for (int i = 5; i < 10; ++i) {
+         EXPECT_EQ(std::to_string(i) + std::string(300, 'p'), PopString(log));
+      }
+      // new records go behind the old ones
+      ASSERT_TRUE(log.Append("new", 3));
+   }
+   SpillLog log(mDirectory, 4096, 8);
+   ASSERT_TRUE(log.Open());
+   EXPECT_EQ(11, log.Size());
+   for (int i = 10; i < 20; ++i) {
+      EXPECT_EQ(std::to_string(i) + std::string(300, 'p'), PopString(log));
+   }
+   EXPECT_EQ("new", PopString(log));
+   EXPECT_TRUE(log.Empty());
+   log.Close();
+   EXPECT_EQ(0, CountFiles(mDirectory));
+}
+
+TEST_F(SpillLogTests, ReusedSegmentDoesNotReplayOldRecords) {
+   {
+      SpillLog log(mDirectory, 4096, 2);
+      ASSERT_TRUE(log.Open());
+      for (int i = 0; i < 5; ++i) {
+         ASSERT_TRUE(log.Append("old record", 10));
+      }
+      while (!log.Empty()) {
+         PopString(log);
+      }
+      ASSERT_TRUE(log.Append("new", 3));
+   }
+   SpillLog log(mDirectory, 4096, 2);
+   ASSERT_TRUE(log.Open());
+   EXPECT_EQ(1, log.Size());
+   EXPECT_EQ("new", PopString(log));
+}
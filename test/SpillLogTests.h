@@ -0,0 +1,28 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "SpillLog.h"
+#include <unistd.h>
+
+class SpillLogTests : public ::testing::Test {
+public:
+
+   SpillLogTests() {
+   };
+   static size_t CountFiles(const std::string& directory);
+   static void RemoveDirectory(const std::string& directory);
+
+protected:
+
+   virtual void SetUp() {
+      mDirectory = "/tmp/SpillLogTests." + std::to_string(getpid()) + "." +
+              ::testing::UnitTest::GetInstance()->current_test_info()->name();
+      RemoveDirectory(mDirectory);
+   };
+
+   virtual void TearDown() {
+      RemoveDirectory(mDirectory);
+   };
+
+   std::string mDirectory;
+};
@@ -0,0 +1,150 @@
+#include "SpscRingTests.h"
+#include <chrono>
+#include <poll.h>
+#include <thread>
+
+TEST_F(SpscRingTests, CapacityRoundsUp) {
+   SpscRing<int> ring(1000);
+   ASSERT_TRUE(ring.IsValid());
+   EXPECT_EQ(1024, ring.Capacity());
+   EXPECT_EQ(0, ring.Size());
+   SpscRing<int> tiny(0);
+   EXPECT_EQ(1, tiny.Capacity());
+}
+
+TEST_F(SpscRingTests, FullAndEmpty) {
+   SpscRing<int> ring(4);
+   int item = 0;
+   EXPECT_FALSE(ring.TryPop(item));
+   for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(ring.TryPush(i));
+   }
+   EXPECT_FALSE(ring.TryPush(4));
+   EXPECT_EQ(4, ring.Size());
+   for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(ring.TryPop(item));
+      EXPECT_EQ(i, item);
+   }
+   EXPECT_FALSE(ring.TryPop(item));
+   // around the end of the slots
+   for (int i = 0; i < 10; ++i) {
+      ASSERT_TRUE(ring.TryPush(i));
+      ASSERT_TRUE(ring.TryPop(item));
+      EXPECT_EQ(i, item);
+   }
+}
+
+TEST_F(SpscRingTests, TimeoutsWait) {
+   using namespace std::chrono;
+   SpscRing<int> ring(1);
+   int item = 0;
+   steady_clock::time_point start = steady_clock::now();
+   EXPECT_FALSE(ring.Pop(item, 50));
+   EXPECT_LE(40, duration_cast<milliseconds>(steady_clock::now() - start).count());
+   EXPECT_FALSE(ring.Pop(item, 0));
+   ASSERT_TRUE(ring.Push(1, 0));
+   start = steady_clock::now();
+   EXPECT_FALSE(ring.Push(2, 50));
+   EXPECT_LE(40, duration_cast<milliseconds>(steady_clock::now() - start).count());
+}
+
+TEST_F(SpscRingTests, BlockedSidesWakeUp) {
+   SpscRing<int> ring(2);
+   int item = 0;
+   std::thread producer([&ring]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      ring.Push(7, -1);
+   });
+   ASSERT_TRUE(ring.Pop(item, 5000));
+   EXPECT_EQ(7, item);
+   producer.join();
+
+   ASSERT_TRUE(ring.TryPush(1));
+   ASSERT_TRUE(ring.TryPush(2));
+   std::thread consumer([&ring]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      int popped = 0;
+      ring.Pop(popped, -1);
+   });
+   EXPECT_TRUE(ring.Push(3, 5000));
+   consumer.join();
+}
+
+TEST_F(SpscRingTests, ManyItemsInOrder) {
+   const uint64_t kItems = 1000000;
+   SpscRing<uint64_t> ring(1024);
+   std::thread producer([&ring, kItems]() {
+      for (uint64_t i = 0; i < kItems; ++i) {
+         ring.Push(i, -1);
+      }
+   });
+   uint64_t item = 0;
+   for (uint64_t i = 0; i < kItems; ++i) {
+      ASSERT_TRUE(ring.Pop(item, 5000));
+      ASSERT_EQ(i, item);
+   }
+   producer.join();
+}
+
+TEST_F(SpscRingTests, PushAndPopMany) {
+   SpscRing<int> ring(8);
+   const int items[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+   EXPECT_EQ(8, ring.TryPushMany(items, 10));
+   EXPECT_EQ(0, ring.TryPushMany(items + 8, 2));
+   int popped[10] = {};
+   EXPECT_EQ(3, ring.TryPopMany(popped, 3));
+   EXPECT_EQ(2, popped[2]);
+   // wraps around the end of the slots
+   EXPECT_EQ(2, ring.TryPushMany(items + 8, 2));
+   EXPECT_EQ(7, ring.TryPopMany(popped, 10));
+   for (int i = 0; i < 7; ++i) {
+      EXPECT_EQ(i + 3, popped[i]);
+   }
+   EXPECT_EQ(0, ring.TryPopMany(popped, 10));
+   EXPECT_EQ(0, ring.PopMany(popped, 10, 10));
+   EXPECT_EQ(0, ring.PopMany(popped, 0, 10));
+}
+
+TEST_F(SpscRingTests, PushManyWaitsForRoom) {
+   const uint64_t kItems = 100000;
+   SpscRing<uint64_t> ring(64);
+   std::thread producer([&ring, kItems]() {
+      uint64_t batch[100];
+      for (uint64_t sent = 0; sent < kItems; sent += 100) {
+         for (uint64_t i = 0; i < 100; ++i) {
+            batch[i] = sent + i;
+         }
+         ring.PushMany(batch, 100, -1);
+      }
+   });
+   uint64_t expected = 0;
+   uint64_t batch[37];
+   while (expected < kItems) {
+      size_t popped = ring.PopMany(batch, 37, 5000);
+      ASSERT_LT(0, popped);
+      for (size_t i = 0; i < popped; ++i) {
+         ASSERT_EQ(expected, batch[i]);
+         ++expected;
+      }
+   }
+   producer.join();
+}
+
+TEST_F(SpscRingTests, ReadableFdAfterArming) {
+   SpscRing<int> ring(8);
+   pollfd item = {ring.GetReadableFd(), POLLIN, 0};
+   EXPECT_FALSE(ring.ArmReadable());
+   EXPECT_EQ(0, poll(&item, 1, 0));
+   EXPECT_TRUE(ring.TryPush(1));
+   EXPECT_TRUE(ring.TryPush(2));
+   EXPECT_EQ(1, poll(&item, 1, 0));
+   // draining does not clear the fd, arming does
+   int value;
+   while (ring.TryPop(value)) {
+   }
+   EXPECT_FALSE(ring.ArmReadable());
+   EXPECT_EQ(0, poll(&item, 1, 0));
+   EXPECT_TRUE(ring.TryPush(3));
+   EXPECT_TRUE(ring.ArmReadable());
+   EXPECT_EQ(0, poll(&item, 1, 0));
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "SpscRing.h"
+
+class SpscRingTests : public ::testing::Test {
+public:
+
+   SpscRingTests() {
+   };
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+};
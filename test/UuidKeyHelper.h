@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <boost/uuid/uuid.hpp>
+
+namespace {
+
+   /**
+    * A key that is mostly zeros with the number in its last eight bytes, the
+    * worst case for a weak hash.
+    */
+   inline boost::uuids::uuid MakeKey(const uint64_t number) {
+      boost::uuids::uuid key = boost::uuids::uuid();
+      memcpy(key.data + 8, &number, sizeof (number));
+      return key;
+   }
+}
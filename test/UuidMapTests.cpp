@@ -0,0 +1,129 @@
+#include "UuidMapTests.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+TEST_F(UuidMapTests, InsertFindErase) {
+   UuidMap<std::string> map;
+   EXPECT_TRUE(map.Empty());
+   EXPECT_EQ(nullptr, map.Find(MakeKey(1)));
+   EXPECT_FALSE(map.Erase(MakeKey(1)));
+   map[MakeKey(1)] = "one";
+   map[MakeKey(2)] = "two";
+   EXPECT_EQ(2, map.Size());
+   ASSERT_NE(nullptr, map.Find(MakeKey(1)));
+   EXPECT_EQ("one", *map.Find(MakeKey(1)));
+   map[MakeKey(1)] = "uno";
+   EXPECT_EQ(2, map.Size());
+   EXPECT_EQ("uno", *map.Find(MakeKey(1)));
+   EXPECT_TRUE(map.Erase(MakeKey(1)));
+   EXPECT_FALSE(map.Erase(MakeKey(1)));
+   EXPECT_EQ(nullptr, map.Find(MakeKey(1)));
+   EXPECT_EQ("two", *map.Find(MakeKey(2)));
+   EXPECT_EQ(1, map.Size());
+   map.Clear();
+   EXPECT_TRUE(map.Empty());
+   EXPECT_EQ(nullptr, map.Find(MakeKey(2)));
+}
+
+TEST_F(UuidMapTests, GrowAndShrink) {
+   UuidMap<uint64_t> map;
+   const uint64_t kKeys = 10000;
+   for (uint64_t i = 0; i < kKeys; ++i) {
+      map[MakeKey(i)] = i;
+   }
+   EXPECT_EQ(kKeys, map.Size());
+   const size_t grown = map.Capacity();
+   EXPECT_LT(kKeys, grown);
+   for (uint64_t i = 0; i < kKeys; i += 2) {
+      EXPECT_TRUE(map.Erase(MakeKey(i)));
+   }
+   EXPECT_EQ(grown, map.Capacity());
+   map.ShrinkToFit();
+   EXPECT_EQ(kKeys / 2, map.Size());
+   EXPECT_GT(grown, map.Capacity());
+   EXPECT_LT(kKeys / 2, map.Capacity());
+   for (uint64_t i = 0; i < kKeys; ++i) {
+      const uint64_t* value = map.Find(MakeKey(i));
+      if (i % 2 == 0) {
+         EXPECT_EQ(nullptr, value);
+      } else {
+         ASSERT_NE(nullptr, value);
+         EXPECT_EQ(i, *value);
+      }
+   }
+   uint64_t visited = 0;
+   map.ForEach([&visited](const boost::uuids::uuid&, uint64_t& value) {
+      EXPECT_EQ(1, value % 2);
+      ++visited;
+   });
+   EXPECT_EQ(kKeys / 2, visited);
+}
+
+TEST_F(UuidMapTests, MatchesStdMap) {
+   // erasing shifts entries back, check it never loses one that probed past
+   std::mt19937_64 random(42);
+   UuidMap<uint64_t> map;
+   std::map<uint64_t, uint64_t> expected;
+   for (int operation = 0; operation < 200000; ++operation) {
+      const uint64_t number = random() % 512;
+      if (random() % 3 == 0) {
+         EXPECT_EQ(expected.erase(number) == 1, map.Erase(MakeKey(number)));
+      } else {
+         expected[number] = operation;
+         map[MakeKey(number)] = operation;
+      }
+      ASSERT_EQ(expected.size(), map.Size());
+   }
+   for (uint64_t number = 0; number < 512; ++number) {
+      const uint64_t* value = map.Find(MakeKey(number));
+      auto found = expected.find(number);
+      if (found == expected.end()) {
+         EXPECT_EQ(nullptr, value);
+      } else {
+         ASSERT_NE(nullptr, value);
+         EXPECT_EQ(found->second, *value);
+      }
+   }
+}
+
+TEST_F(UuidMapTests, VersusStringMap) {
+   const size_t kInFlight = 1000;
+   const size_t kRequests = 1000000;
+   boost::uuids::random_generator generator;
+   std::vector<boost::uuids::uuid> ids;
+   std::vector<std::string> names;
+   for (size_t i = 0; i < kInFlight; ++i) {
+      ids.push_back(generator());
+      names.push_back(boost::uuids::to_string(ids.back()));
+   }
+   using namespace std::chrono;
+   // a request is added when sent and removed when its reply comes back
+   steady_clock::time_point start = steady_clock::now();
+   std::map<std::string, time_t> byName;
+   for (size_t request = 0; request < kRequests; ++request) {
+      const std::string& name = names[request % kInFlight];
+      if (request >= kInFlight) {
+         byName.erase(name);
+      }
+      byName[name] = request;
+   }
+   auto stringUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+   start = steady_clock::now();
+   UuidMap<time_t> byId;
+   for (size_t request = 0; request < kRequests; ++request) {
+      const boost::uuids::uuid& id = ids[request % kInFlight];
+      if (request >= kInFlight) {
+         byId.Erase(id);
+      }
+      byId[id] = request;
+   }
+   auto idUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+   EXPECT_EQ(byName.size(), byId.Size());
+   std::cout << kRequests << " requests, " << kInFlight << " in flight: std::map<std::string> "
+           << stringUs << "us, UuidMap " << idUs << "us" << std::endl;
+}
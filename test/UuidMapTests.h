@@ -0,0 +1,20 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "UuidMap.h"
+#include "UuidKeyHelper.h"
+
+class UuidMapTests : public ::testing::Test {
+public:
+
+   UuidMapTests() {
+   };
+
+protected:
+
+   virtual void SetUp() {
+   };
+
+   virtual void TearDown() {
+   };
+};
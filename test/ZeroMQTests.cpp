@@ -279,3 +279,219 @@ TEST_F(ZeroMQTests, ConcequencesOfFailedSetReceiveHWMOnPointerQueue) {
    EXPECT_FALSE(mockClient.Initialize());
 #endif
 }
+
+TEST_F(ZeroMQTests, RingPointerQueueHandshake) {
+   ZeroMQ<void*> serverQueue(3, ZeroMQ<void*>::Backend::RING);
+   EXPECT_EQ(ZeroMQ<void*>::Backend::RING, serverQueue.GetBackend());
+   ASSERT_FALSE(serverQueue.SendPointer(&serverQueue));
+   ASSERT_TRUE(serverQueue.Initialize());
+   ASSERT_TRUE(serverQueue.GetPointer(1) == NULL);
+   ASSERT_FALSE(serverQueue.SendClientReady());
+
+   ZeroMQ<void*> clientQueue(serverQueue);
+   EXPECT_EQ(ZeroMQ<void*>::Backend::RING, clientQueue.GetBackend());
+   ASSERT_TRUE(clientQueue.Initialize());
+   int foo;
+   ASSERT_FALSE(clientQueue.SendPointer(&foo));
+   ASSERT_FALSE(clientQueue.WaitForClient(1));
+   ASSERT_TRUE(clientQueue.GetPointer(1) == NULL);
+
+   data_ppacket packet = (data_ppacket) malloc(sizeof (data_pkt));
+   mPacketsToTest = 1000;
+   boost::thread clientThread = boost::thread(&ZeroMQTests::PacketBroadcasterReceiver, this, &clientQueue, packet);
+   ASSERT_TRUE(serverQueue.WaitForClient(20000));
+   for (int i = 0; i < mPacketsToTest; ++i) {
+      ASSERT_TRUE(serverQueue.SendPointer(packet));
+   }
+   clientThread.join();
+   EXPECT_EQ(mPacketsToTest, mPacketsSeen);
+   free(packet);
+}
+
+TEST_F(ZeroMQTests, RingPointerQueueClientWithoutServer) {
+   ZeroMQ<void*> serverQueue(4, ZeroMQ<void*>::Backend::RING);
+   ZeroMQ<void*> clientQueue(&serverQueue);
+   ASSERT_FALSE(clientQueue.Initialize());
+   ASSERT_FALSE(clientQueue.SendClientReady());
+   ASSERT_TRUE(clientQueue.GetPointer(1) == NULL);
+}
+
+TEST_F(ZeroMQTests, RingPointerQueueGetPointerTimeout) {
+   ZeroMQ<void*> serverQueue(5, ZeroMQ<void*>::Backend::RING);
+   ASSERT_TRUE(serverQueue.Initialize());
+   ZeroMQ<void*> clientQueue(serverQueue);
+   ASSERT_TRUE(clientQueue.Initialize());
+   auto start = std::chrono::steady_clock::now();
+   ASSERT_TRUE(clientQueue.GetPointer(50) == NULL);
+   EXPECT_LE(40, std::chrono::duration_cast<std::chrono::milliseconds>(
+           std::chrono::steady_clock::now() - start).count());
+   int foo;
+   ASSERT_TRUE(serverQueue.SendPointer(&foo));
+   EXPECT_EQ(&foo, clientQueue.GetPointer(50));
+}
+
+TEST_F(ZeroMQTests, PointerQueueSocketVersusRing) {
+   const int packets = PACKETS_TO_TEST << 2;
+   long socketUs = PointerBenchmark(ZeroMQ<void*>::Backend::SOCKET, packets);
+   long ringUs = PointerBenchmark(ZeroMQ<void*>::Backend::RING, packets);
+   std::cout << "ring speedup: " << static_cast<double> (socketUs) / std::max(ringUs, 1L) << "x" << std::endl;
+}
+
+TEST_F(ZeroMQTests, ValueQueueHandshake) {
+   for (auto backend : {ZeroMQ<void*>::Backend::SOCKET, ZeroMQ<void*>::Backend::RING}) {
+      ZeroMQ<FlowKey> serverQueue(6, backend);
+      EXPECT_EQ(backend, serverQueue.GetBackend());
+      FlowKey key = {1, 2, 3, 4, 5};
+      ASSERT_FALSE(serverQueue.SendValue(key));
+      ASSERT_TRUE(serverQueue.Initialize());
+      ASSERT_FALSE(serverQueue.GetValue(key, 1));
+      ASSERT_FALSE(serverQueue.SendClientReady());
+
+      ZeroMQ<FlowKey> clientQueue(serverQueue);
+      ASSERT_TRUE(clientQueue.Initialize());
+      ASSERT_FALSE(clientQueue.SendValue(key));
+      ASSERT_FALSE(clientQueue.WaitForClient(1));
+      ASSERT_FALSE(clientQueue.GetValue(key, 1));
+      ASSERT_TRUE(clientQueue.SendClientReady());
+      ASSERT_TRUE(serverQueue.WaitForClient(20000));
+
+      FlowKey sent = {10, 20, 30, 40, 50};
+      ASSERT_TRUE(serverQueue.SendValue(sent));
+      FlowKey received;
+      ASSERT_TRUE(clientQueue.GetValue(received, 1000));
+      EXPECT_EQ(0, memcmp(&sent, &received, sizeof (sent)));
+   }
+}
+
+TEST_F(ZeroMQTests, ValueQueueLargeValues) {
+   for (auto backend : {ZeroMQ<void*>::Backend::SOCKET, ZeroMQ<void*>::Backend::RING}) {
+      ZeroMQ<FlowRecord> serverQueue(7, backend);
+      ASSERT_TRUE(serverQueue.Initialize());
+      ZeroMQ<FlowRecord> clientQueue(&serverQueue);
+      ASSERT_TRUE(clientQueue.Initialize());
+      ASSERT_TRUE(clientQueue.SendClientReady());
+      ASSERT_TRUE(serverQueue.WaitForClient(20000));
+      FlowRecord sent;
+      for (size_t i = 0; i < 30; ++i) {
+         sent.counters[i] = i * 1000;
+      }
+      sent.key = {1, 2, 3, 4, 5};
+      ASSERT_TRUE(serverQueue.SendValue(sent));
+      FlowRecord received;
+      ASSERT_TRUE(clientQueue.GetValue(received, 1000));
+      EXPECT_EQ(0, memcmp(&sent, &received, sizeof (sent)));
+      ASSERT_FALSE(clientQueue.GetValue(received, 10));
+   }
+}
+
+TEST_F(ZeroMQTests, ValueQueueClientWithoutServer) {
+   ZeroMQ<FlowKey> serverQueue(8);
+   ZeroMQ<FlowKey> clientQueue(serverQueue);
+   ASSERT_FALSE(clientQueue.Initialize());
+   ASSERT_FALSE(clientQueue.SendClientReady());
+   FlowKey key;
+   ASSERT_FALSE(clientQueue.GetValue(key, 1));
+}
+
+TEST_F(ZeroMQTests, ValueQueueVersusPointerQueue) {
+   const int count = PACKETS_TO_TEST;
+   PointerBenchmark(ZeroMQ<void*>::Backend::SOCKET, count);
+   ValueBenchmark<FlowKey>(ZeroMQ<void*>::Backend::SOCKET, count);
+   ValueBenchmark<FlowRecord>(ZeroMQ<void*>::Backend::SOCKET, count);
+   PointerBenchmark(ZeroMQ<void*>::Backend::RING, count);
+   ValueBenchmark<FlowKey>(ZeroMQ<void*>::Backend::RING, count);
+   ValueBenchmark<FlowRecord>(ZeroMQ<void*>::Backend::RING, count);
+}
+
+TEST_F(ZeroMQTests, PointerBatchesSplitAcrossGets) {
+   ZeroMQ<void*> serverQueue(6);
+   ASSERT_TRUE(serverQueue.Initialize());
+   ZeroMQ<void*> clientQueue(serverQueue);
+   ASSERT_TRUE(clientQueue.Initialize());
+   void* packets[10];
+   ASSERT_FALSE(clientQueue.SendPointers(packets, 10));
+   EXPECT_EQ(0, serverQueue.GetPointers(packets, 10, 1));
+   EXPECT_EQ(0, clientQueue.GetPointers(packets, 10, 1));
+   EXPECT_TRUE(serverQueue.SendPointers(packets, 0));
+
+   int values[10];
+   for (int i = 0; i < 10; ++i) {
+      packets[i] = &values[i];
+   }
+   ASSERT_TRUE(serverQueue.SendPointers(packets, 7));
+   ASSERT_TRUE(serverQueue.SendPointers(packets + 7, 3));
+   void* received[10] = {};
+   // the rest of the first message comes before the next message
+   ASSERT_EQ(4, clientQueue.GetPointers(received, 4, 100));
+   EXPECT_EQ(&values[3], received[3]);
+   EXPECT_EQ(&values[4], clientQueue.GetPointer(100));
+   ASSERT_EQ(5, clientQueue.GetPointers(received, 10, 100));
+   for (int i = 0; i < 5; ++i) {
+      EXPECT_EQ(&values[i + 5], received[i]);
+   }
+   EXPECT_EQ(0, clientQueue.GetPointers(received, 10, 1));
+
+   ASSERT_TRUE(serverQueue.SendPointer(&values[0]));
+   ASSERT_TRUE(serverQueue.SendPointers(packets + 1, 2));
+   ASSERT_EQ(3, clientQueue.GetPointers(received, 10, 100));
+   EXPECT_EQ(&values[2], received[2]);
+}
+
+TEST_F(ZeroMQTests, RingPointerBatches) {
+   ZeroMQ<void*> serverQueue(7, ZeroMQ<void*>::Backend::RING);
+   ASSERT_TRUE(serverQueue.Initialize());
+   ZeroMQ<void*> clientQueue(serverQueue);
+   ASSERT_TRUE(clientQueue.Initialize());
+   int values[10];
+   void* packets[10];
+   for (int i = 0; i < 10; ++i) {
+      packets[i] = &values[i];
+   }
+   ASSERT_FALSE(clientQueue.SendPointers(packets, 10));
+   ASSERT_TRUE(serverQueue.SendPointers(packets, 10));
+   void* received[10] = {};
+   ASSERT_EQ(4, clientQueue.GetPointers(received, 4, 100));
+   EXPECT_EQ(&values[4], clientQueue.GetPointer(100));
+   ASSERT_EQ(5, clientQueue.GetPointers(received, 10, 100));
+   EXPECT_EQ(&values[9], received[4]);
+   EXPECT_EQ(0, clientQueue.GetPointers(received, 10, 1));
+}
+
+TEST_F(ZeroMQTests, PointerBatchSizes) {
+   const size_t count = PACKETS_TO_TEST << 2;
+   for (size_t batch : {1, 8, 64, 512}) {
+      PointerBatchBenchmark(ZeroMQ<void*>::Backend::SOCKET, batch, count);
+      PointerBatchBenchmark(ZeroMQ<void*>::Backend::RING, batch, count);
+   }
+}
+
+TEST_F(ZeroMQTests, PointerQueueFdWithEpoll) {
+   const size_t kPointers = 20000;
+   for (auto backend : {ZeroMQ<void*>::Backend::SOCKET, ZeroMQ<void*>::Backend::RING}) {
+      ZeroMQ<void*> serverQueue(8, backend);
+      EXPECT_EQ(-1, serverQueue.GetFd());
+      ASSERT_TRUE(serverQueue.Initialize());
+      EXPECT_EQ(-1, serverQueue.GetFd());
+      EXPECT_FALSE(serverQueue.IsReadable());
+      ZeroMQ<void*> clientQueue(serverQueue);
+      ASSERT_TRUE(clientQueue.Initialize());
+      ASSERT_LE(0, clientQueue.GetFd());
+      EXPECT_FALSE(clientQueue.IsReadable());
+      boost::thread sender([&serverQueue, kPointers]() {
+         std::vector<void*> packets(100);
+         for (size_t sent = 0; sent < kPointers; sent += packets.size()) {
+            for (size_t i = 0; i < packets.size(); ++i) {
+               packets[i] = reinterpret_cast<void*> (sent + i + 1);
+            }
+            EXPECT_TRUE(serverQueue.SendPointers(packets.data(), packets.size()));
+            // let the receiver run dry and go back to epoll now and then
+            if (sent % 2000 == 0) {
+               boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+            }
+         }
+      });
+      EXPECT_EQ(kPointers, EpollReceive(clientQueue, kPointers));
+      sender.join();
+      EXPECT_FALSE(clientQueue.IsReadable());
+   }
+}
@@ -2,7 +2,10 @@
 
 #include "gtest/gtest.h"
 #include "ZeroMQ.h"
+#include <sys/epoll.h>
 #include <sys/time.h>
+#include <unistd.h>
+#include <chrono>
 
 #ifndef PACKETS_TO_TEST
 #define PACKETS_TO_TEST 400000
@@ -28,6 +31,21 @@ typedef struct data_pkt *data_ppacket;
 
 
 
+/// A small value, a few words
+struct FlowKey {
+   uint32_t source;
+   uint32_t destination;
+   uint16_t sourcePort;
+   uint16_t destinationPort;
+   uint32_t sequence;
+};
+
+/// A value of a few hundred bytes
+struct FlowRecord {
+   FlowKey key;
+   uint64_t counters[30];
+};
+
 class ZeroMQTests : public ::testing::Test
 {
 public:
@@ -57,6 +75,149 @@ public:
     	return;
 
     }
+    /**
+     * Send packets pointers through a queue to a receiving thread.
+     * @return the time taken in microseconds
+     */
+    long PointerBenchmark(ZeroMQ<void*>::Backend backend, int packets) {
+    	ZeroMQ<void*> serverQueue(1, backend);
+    	EXPECT_TRUE(serverQueue.Initialize());
+    	ZeroMQ<void*> clientQueue(serverQueue);
+    	data_ppacket packet = (data_ppacket) malloc(sizeof (data_pkt));
+    	mPacketsSeen = 0;
+    	mPacketsToTest = packets;
+    	boost::thread clientThread = boost::thread(
+    	        &ZeroMQTests::PacketBroadcasterReceiver, this, &clientQueue, packet);
+    	EXPECT_TRUE(serverQueue.WaitForClient(20000));
+    	auto start = std::chrono::steady_clock::now();
+    	for (int i = 0; i < packets; ++i) {
+    		EXPECT_TRUE(serverQueue.SendPointer(packet));
+    	}
+    	clientThread.join();
+    	long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    	        std::chrono::steady_clock::now() - start).count();
+    	free(packet);
+    	std::cout << (backend == ZeroMQ<void*>::Backend::RING ? "ring  " : "socket") << " : " << packets
+    	        << " pointers in " << elapsedUs << "us, " << (packets * 1000000.0) / std::max(elapsedUs, 1L)
+    	        << " pointers/s" << std::endl;
+    	return elapsedUs;
+    }
+    /**
+     * Send count values with increasing sequence numbers, check them in
+     * order on a receiving thread.
+     * @return the time taken in microseconds
+     */
+    template<typename T>
+    long ValueBenchmark(ZeroMQ<void*>::Backend backend, int count) {
+    	ZeroMQ<T> serverQueue(1, backend);
+    	EXPECT_TRUE(serverQueue.Initialize());
+    	ZeroMQ<T> clientQueue(serverQueue);
+    	int received = 0;
+    	boost::thread clientThread([&clientQueue, &received, count]() {
+    		EXPECT_TRUE(clientQueue.Initialize());
+    		EXPECT_TRUE(clientQueue.SendClientReady());
+    		T value;
+    		while (received < count && !boost::this_thread::interruption_requested()) {
+    			if (clientQueue.GetValue(value, 1)) {
+    				EXPECT_EQ(static_cast<uint32_t> (received), SequenceOf(value));
+    				++received;
+    			}
+    		}
+    	});
+    	EXPECT_TRUE(serverQueue.WaitForClient(20000));
+    	T value;
+    	memset(&value, 0, sizeof (value));
+    	auto start = std::chrono::steady_clock::now();
+    	for (int i = 0; i < count; ++i) {
+    		SetSequence(value, i);
+    		EXPECT_TRUE(serverQueue.SendValue(value));
+    	}
+    	clientThread.join();
+    	long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    	        std::chrono::steady_clock::now() - start).count();
+    	EXPECT_EQ(count, received);
+    	std::cout << (backend == ZeroMQ<void*>::Backend::RING ? "ring  " : "socket") << " : " << count
+    	        << " values of " << sizeof (T) << " bytes in " << elapsedUs << "us, "
+    	        << (count * 1000000.0) / std::max(elapsedUs, 1L) << " values/s" << std::endl;
+    	return elapsedUs;
+    }
+    /**
+     * Send count distinct pointers in batches, the receiver takes batches of
+     * the same size and checks they come out in order.
+     * @return the time taken in microseconds
+     */
+    long PointerBatchBenchmark(ZeroMQ<void*>::Backend backend, size_t batch, size_t count) {
+    	ZeroMQ<void*> serverQueue(1, backend);
+    	EXPECT_TRUE(serverQueue.Initialize());
+    	ZeroMQ<void*> clientQueue(serverQueue);
+    	size_t received = 0;
+    	boost::thread clientThread([&clientQueue, &received, batch, count]() {
+    		EXPECT_TRUE(clientQueue.Initialize());
+    		EXPECT_TRUE(clientQueue.SendClientReady());
+    		std::vector<void*> packets(batch);
+    		while (received < count && !boost::this_thread::interruption_requested()) {
+    			size_t got = clientQueue.GetPointers(packets.data(), batch, 1);
+    			for (size_t i = 0; i < got; ++i) {
+    				EXPECT_EQ(reinterpret_cast<void*> (received + 1), packets[i]);
+    				++received;
+    			}
+    		}
+    	});
+    	EXPECT_TRUE(serverQueue.WaitForClient(20000));
+    	std::vector<void*> packets(batch);
+    	auto start = std::chrono::steady_clock::now();
+    	for (size_t sent = 0; sent < count; sent += batch) {
+    		const size_t size = std::min(batch, count - sent);
+    		for (size_t i = 0; i < size; ++i) {
+    			packets[i] = reinterpret_cast<void*> (sent + i + 1);
+    		}
+    		EXPECT_TRUE(serverQueue.SendPointers(packets.data(), size));
+    	}
+    	clientThread.join();
+    	long elapsedUs = std::chrono::duration_cast<std::chrono::microseconds>(
+    	        std::chrono::steady_clock::now() - start).count();
+    	EXPECT_EQ(count, received);
+    	std::cout << (backend == ZeroMQ<void*>::Backend::RING ? "ring  " : "socket") << " : " << count
+    	        << " pointers in batches of " << batch << " in " << elapsedUs << "us, "
+    	        << (count * 1000000.0) / std::max(elapsedUs, 1L) << " pointers/s" << std::endl;
+    	return elapsedUs;
+    }
+    /**
+     * Receive pointers numbered from 1 through an edge triggered epoll on
+     * the queue's fd, draining until IsReadable is false before each wait.
+     * @return the number received in order, stops after a second of silence
+     */
+    static size_t EpollReceive(ZeroMQ<void*>& clientQueue, size_t expected) {
+    	int epollFd = epoll_create1(0);
+    	epoll_event event = {};
+    	event.events = EPOLLIN | EPOLLET;
+    	EXPECT_EQ(0, epoll_ctl(epollFd, EPOLL_CTL_ADD, clientQueue.GetFd(), &event));
+    	size_t received = 0;
+    	int idleWaits = 0;
+    	void* packets[64];
+    	while (received < expected && idleWaits < 10) {
+    		while (clientQueue.IsReadable()) {
+    			size_t got = clientQueue.GetPointers(packets, 64, 0);
+    			for (size_t i = 0; i < got; ++i) {
+    				EXPECT_EQ(reinterpret_cast<void*> (received + 1), packets[i]);
+    				++received;
+    			}
+    		}
+    		if (received < expected) {
+    			epoll_event ready;
+    			idleWaits = (epoll_wait(epollFd, &ready, 1, 100) > 0) ? 0 : idleWaits + 1;
+    		}
+    	}
+    	close(epollFd);
+    	return received;
+    }
+    static uint32_t SequenceOf(const FlowKey& key) { return key.sequence; }
+    static uint32_t SequenceOf(const FlowRecord& record) { return record.key.sequence; }
+    static void SetSequence(FlowKey& key, int sequence) { key.sequence = sequence; }
+    static void SetSequence(FlowRecord& record, int sequence) {
+    	record.key.sequence = sequence;
+    	record.counters[29] = sequence;
+    }
     int mPacketsSeen;
     int mPacketsToTest;
 protected: